@@ -16,6 +16,7 @@
 #include <arc/message/MCC.h>
 #include <arc/Utils.h>
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientHTTPPool.h>
 #include <arc/delegation/DelegationInterface.h>
 
 #include "JobControllerPluginREST.h"
@@ -36,12 +37,11 @@ namespace Arc {
     usercfg->ApplyToConfig(cfg);
     std::string delegationPath = url.Path();
     if(!delegationId.empty()) delegationPath = delegationPath+"/"+delegationId;
-    Arc::ClientHTTP client(cfg, url);
     {
       Arc::PayloadRaw request;
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("GET"), delegationPath, &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, url, -1, std::string("GET"), delegationPath, &request, &info, &response);
       if((!res) || (info.code != 200) || (info.reason.empty()) || (!response)) {
         delete response;
         return false;
@@ -70,7 +70,7 @@ namespace Arc {
       request.Insert(delegationResponse.c_str(),0,delegationResponse.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), url.Path()+"/"+delegationId, &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, url, -1, std::string("PUT"), url.Path()+"/"+delegationId, &request, &info, &response);
       delete response;
       if((!res) || (info.code != 200) || (!response)) return false;
     }
@@ -139,11 +139,10 @@ namespace Arc {
       statusUrl.ChangePath(statusUrl.Path()+LogsPrefix+"/"+id+"/status"); // simple state
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, statusUrl);
       Arc::PayloadRaw request;
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("GET"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, statusUrl, -1, std::string("GET"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
       if((!res) || (info.code != 200) || (response == NULL) || (response->Buffer(0) == NULL)) {
         delete response;
         logger.msg(WARNING, "Job information not found in the information system: %s", (*it)->JobID);
@@ -167,13 +166,12 @@ namespace Arc {
       statusUrl.ChangePath(statusUrl.Path()+LogsPrefix+"/"+id+"/status");
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, statusUrl);
       Arc::PayloadRaw request;
       std::string const new_state("DELETED");
       request.Insert(new_state.c_str(),0,new_state.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, statusUrl, -1, std::string("PUT"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
       delete response;
       if((!res) || (info.code != 200)) {
         logger.msg(WARNING, "Failed to clean job: %s", (*it)->JobID);
@@ -197,13 +195,12 @@ namespace Arc {
       statusUrl.ChangePath(statusUrl.Path()+LogsPrefix+"/"+id+"/status");
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, statusUrl);
       Arc::PayloadRaw request;
       std::string const new_state("FINISHED");
       request.Insert(new_state.c_str(),0,new_state.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, statusUrl, -1, std::string("PUT"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
       delete response;
       if((!res) || (info.code != 200)) {
         logger.msg(WARNING, "Failed to cancel job: %s", (*it)->JobID);
@@ -262,7 +259,6 @@ namespace Arc {
       statusUrl.ChangePath(statusUrl.Path()+LogsPrefix+"/"+id+"/status");
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, statusUrl);
       Arc::PayloadRaw request;
       // It is not really important which state is requested.
       // Server will handle moving job to last failed state anyway.
@@ -270,7 +266,7 @@ namespace Arc {
       request.Insert(new_state.c_str(),0,new_state.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, statusUrl, -1, std::string("PUT"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
       delete response;
       if((!res) || (info.code != 200)) {
         logger.msg(WARNING, "Failed to cancel job: %s", (*it)->JobID);
@@ -327,11 +323,10 @@ namespace Arc {
     statusUrl.ChangePath(statusUrl.Path()+LogsPrefix+"/"+id+"/description");
     Arc::MCCConfig cfg;
     usercfg->ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, statusUrl);
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
-    Arc::MCC_Status res = client.process(std::string("GET"), &request, &info, &response);
+    Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, statusUrl, -1, std::string("GET"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
     if((!res) || (info.code != 200) || (response == NULL) || (response->Buffer(0) == NULL)) {
       delete response;
       logger.msg(ERROR, "Failed retrieving job description for job: %s", job.JobID);
@@ -15,11 +15,13 @@
 #include <arc/CheckSum.h>
 #include <arc/StringConv.h>
 #include <arc/UserConfig.h>
+#include <arc/Utils.h>
 #include <arc/compute/ExecutionTarget.h>
 #include <arc/compute/Job.h>
 #include <arc/compute/JobDescription.h>
 #include <arc/compute/SubmissionStatus.h>
 #include <arc/message/MCC.h>
+#include <arc/communication/ClientHTTPPool.h>
 #include <arc/delegation/DelegationInterface.h>
 
 #include "SubmitterPluginREST.h"
@@ -40,12 +42,11 @@ namespace Arc {
     usercfg->ApplyToConfig(cfg);
     std::string delegationPath = url.Path();
     if(!delegationId.empty()) delegationPath = delegationPath+"/"+delegationId;
-    Arc::ClientHTTP client(cfg, url);
     {
       Arc::PayloadRaw request;
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("GET"), delegationPath, &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, url, -1, std::string("GET"), delegationPath, &request, &info, &response);
       if((!res) || (info.code != 200) || (info.reason.empty()) || (!response)) {
         delete response;
         return false;
@@ -74,7 +75,7 @@ namespace Arc {
       request.Insert(delegationResponse.c_str(),0,delegationResponse.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), url.Path()+"/"+delegationId, &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, url, -1, std::string("PUT"), url.Path()+"/"+delegationId, &request, &info, &response);
       delete response;
       if((!res) || (info.code != 200) || (!response)) return false;
     }
@@ -146,12 +147,12 @@ namespace Arc {
 
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, submissionUrl);
       Arc::PayloadRaw request;
       request.Insert(product.c_str(),0,product.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, submissionUrl, -1, std::string("PUT"), submissionUrl.FullPathURIEncoded(), &request, &info, &response);
+      delete response;
       if(!res) {
         notSubmitted.push_back(&*it);
         retval |= SubmissionStatus::DESCRIPTION_NOT_SUBMITTED;
@@ -243,12 +244,12 @@ namespace Arc {
 
       Arc::MCCConfig cfg;
       usercfg->ApplyToConfig(cfg);
-      Arc::ClientHTTP client(cfg, submissionUrl);
       Arc::PayloadRaw request;
       request.Insert(product.c_str(),0,product.length());
       Arc::PayloadRawInterface* response(NULL);
       Arc::HTTPClientInfo info;
-      Arc::MCC_Status res = client.process(std::string("PUT"), &request, &info, &response);
+      Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, submissionUrl, -1, std::string("PUT"), submissionUrl.FullPathURIEncoded(), &request, &info, &response);
+      delete response;
       if(!res) {
         notSubmitted.push_back(&*it);
         retval |= SubmissionStatus::DESCRIPTION_NOT_SUBMITTED;
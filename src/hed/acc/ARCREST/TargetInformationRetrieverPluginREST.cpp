@@ -8,11 +8,13 @@
 #include <arc/StringConv.h>
 #include <arc/URL.h>
 #include <arc/UserConfig.h>
+#include <arc/Utils.h>
 #include <arc/message/MCC.h>
 #include <arc/compute/ExecutionTarget.h>
 #include <arc/compute/EndpointQueryingStatus.h>
 #include <arc/compute/GLUE2.h>
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientHTTPPool.h>
 
 #include "TargetInformationRetrieverPluginREST.h"
 
@@ -38,11 +40,10 @@ namespace Arc {
     // Fetch from information sub-path
     Arc::URL infoUrl(url);
     infoUrl.ChangePath(infoUrl.Path()+"/*info");
-    Arc::ClientHTTP client(cfg, infoUrl);
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
-    Arc::MCC_Status res = client.process(std::string("GET"), &request, &info, &response);
+    Arc::MCC_Status res = Arc::ClientHTTPPool::Process(cfg, infoUrl, -1, std::string("GET"), infoUrl.FullPathURIEncoded(), &request, &info, &response);
     if(!res) {
       delete response;
       return Arc::EndpointQueryingStatus(EndpointQueryingStatus::FAILED,res.getExplanation());
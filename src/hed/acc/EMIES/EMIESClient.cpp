@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientHTTPPool.h>
 #include <arc/delegation/DelegationInterface.h>
 #include <arc/compute/Job.h>
 #include <arc/StringConv.h>
@@ -80,14 +81,15 @@ namespace Arc {
 
     logger.msg(DEBUG, "Creating an EMI ES client");
 
-    client = new ClientSOAP(cfg, url, timeout);
+    client = ClientHTTPPool::AcquireSOAP(cfg, url, timeout);
     if (!client)
       logger.msg(VERBOSE, "Unable to create SOAP client used by EMIESClient.");
     set_namespaces(ns);
   }
 
   EMIESClient::~EMIESClient() {
-    if(client) delete client;
+    // Connection is kept for next client of same service
+    if(client) ClientHTTPPool::Release(client);
   }
 
 
@@ -95,7 +97,7 @@ namespace Arc {
   std::string EMIESClient::delegation(const std::string& renew_id) {
     std::string id = dodelegation(renew_id);
     if(!id.empty()) return id;
-    delete client; client = NULL;
+    ClientHTTPPool::Discard(client); client = NULL;
     if(!reconnect()) return id;
     return dodelegation(renew_id);
   }
@@ -159,9 +161,9 @@ namespace Arc {
   }
 
   bool EMIESClient::reconnect(void) { 
-    delete client; client = NULL; 
+    ClientHTTPPool::Discard(client); client = NULL; 
     logger.msg(DEBUG, "Re-creating an EMI ES client");
-    client = new ClientSOAP(cfg, rurl, timeout);
+    client = ClientHTTPPool::AcquireSOAP(cfg, rurl, timeout, true);
     if (!client) {
       lfailure = "Unable to create SOAP client used by EMIESClient.";
       return false;
@@ -190,7 +192,7 @@ namespace Arc {
     if (!client->process(http_attr, &req, &resp)) {
       logger.msg(VERBOSE, "%s request failed", req.Child(0).FullName());
       lfailure = "Failed processing request";
-      delete client; client = NULL;
+      ClientHTTPPool::Discard(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -199,7 +201,7 @@ namespace Arc {
     if (resp == NULL) {
       logger.msg(VERBOSE, "No response from %s", rurl.str());
       lfailure = "No response received";
-      delete client; client = NULL;
+      ClientHTTPPool::Discard(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -224,7 +226,7 @@ namespace Arc {
         logger.msg(DEBUG, "XML response: %s", s);
       };
       delete resp;
-      delete client; client = NULL;
+      ClientHTTPPool::Discard(client); client = NULL;
       if(!retry) return false; 
       if(!reconnect()) return false; 
       return process(req,response,false);
@@ -10,9 +10,13 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include <glibmm.h>
 
@@ -47,13 +51,22 @@ namespace ArcDMCFile {
       reading(false),
       writing(false),
       is_channel(false),
-      channel_num(0) {
+      channel_num(0),
+      io_direct(false),
+      io_nocache(false),
+      io_readahead(0),
+      direct_on(false),
+      readahead_pos(0),
+      written_since_drop(0) {
     fd = -1;
     fa = NULL;
     if (url.Protocol() == "file") {
       cache = false;
       is_channel = false;
       local = true;
+      // Large transfers may be kept from pushing everything else out of
+      // page cache
+      io_options(url, io_direct, io_nocache, io_readahead);
     }
     else if (url.Protocol() == "stdio") {
       linkable = false;
@@ -61,6 +74,24 @@ namespace ArcDMCFile {
     }
   }
 
+  void DataPointFile::io_options(const URL& u, bool& direct, bool& nocache,
+                                 unsigned long long int& readahead) {
+    std::string iomode = u.Option("iomode");
+    if (iomode == "direct") {
+      direct = true;
+      nocache = true;
+    } else if (iomode == "nocache") {
+      nocache = true;
+    } else if (!iomode.empty() && (iomode != "default")) {
+      logger.msg(WARNING, "Unknown I/O mode %s for %s, using default", iomode, u.str());
+    }
+    std::string readahead_str = u.Option("readahead");
+    if (!readahead_str.empty() && !stringto(readahead_str, readahead)) {
+      logger.msg(WARNING, "Invalid readahead value %s for %s", readahead_str, u.str());
+      readahead = 0;
+    }
+  }
+
   DataPointFile::~DataPointFile() {
     StopReading();
     StopWriting();
@@ -96,6 +127,75 @@ namespace ArcDMCFile {
     return fd;
   }
 
+  // O_DIRECT needs buffer address, length and file offset aligned
+  static const unsigned long long int direct_align = 4096;
+
+  static bool direct_aligned(const void* buf, unsigned long long int length,
+                             unsigned long long int offset) {
+    return ((((unsigned long long int)(unsigned long)buf) | length | offset) & (direct_align - 1)) == 0;
+  }
+
+  // After this amount of data is written it is flushed and dropped
+  // from page cache if requested
+  static const unsigned long long int drop_window = 32 * 1024 * 1024;
+
+  void DataPointFile::set_direct(bool on) {
+#ifdef O_DIRECT
+    if (!io_direct || (fd == -1) || (on == direct_on)) return;
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1) return;
+    flags = on ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+    if (fcntl(fd, F_SETFL, flags) != 0) {
+      if (on) {
+        logger.msg(VERBOSE, "Direct I/O is not supported for %s, using page cache", url.Path());
+        io_direct = false;
+      }
+      return;
+    }
+    direct_on = on;
+#endif
+  }
+
+  void DataPointFile::advise_read(unsigned long long int offset, unsigned long long int length) {
+#ifdef HAVE_POSIX_FADVISE
+    if (fd == -1) return;
+    unsigned long long int end = offset + length;
+    // Request next window when half of previous one is consumed
+    if (io_readahead && ((end + io_readahead / 2) > readahead_pos)) {
+      if (readahead_pos < end) readahead_pos = end;
+      posix_fadvise(fd, readahead_pos, end + io_readahead - readahead_pos, POSIX_FADV_WILLNEED);
+      readahead_pos = end + io_readahead;
+    }
+    if (io_nocache) posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+#endif
+  }
+
+  void DataPointFile::advise_written(unsigned long long int offset, unsigned long long int length) {
+    if (!io_nocache || (fd == -1)) return;
+#ifdef HAVE_SYNC_FILE_RANGE
+    // Start writing back early so that dropping later does not wait long
+    sync_file_range(fd, offset, length, SYNC_FILE_RANGE_WRITE);
+#endif
+    written_since_drop += length;
+    if (written_since_drop < drop_window) return;
+    drop_cache(fd, true);
+    written_since_drop = 0;
+  }
+
+  void DataPointFile::drop_cache(int h, bool flush) {
+#ifdef HAVE_POSIX_FADVISE
+    // Only clean pages can be dropped
+    if (flush) {
+#ifdef HAVE_SYNC_FILE_RANGE
+      sync_file_range(h, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+      fdatasync(h);
+#endif
+    }
+    posix_fadvise(h, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  }
+
   void DataPointFile::read_file_start(void* arg) {
     ((DataPointFile*)arg)->read_file();
   }
@@ -120,6 +220,10 @@ namespace ArcDMCFile {
       if(fd != -1) lseek(fd, 0, SEEK_SET);
       if(fa) fa->fa_lseek(0, SEEK_SET);
     }
+#ifdef HAVE_POSIX_FADVISE
+    if((fd != -1) && (io_nocache || io_readahead)) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    readahead_pos = offset;
     for (;;) {
       if (limit_length) if (range_length == 0) break;
       /* read from fd here and push to buffer */
@@ -142,7 +246,9 @@ namespace ArcDMCFile {
       if(fd != -1) {
         p = ::lseek(fd, 0, SEEK_CUR);
         if (p == (unsigned long long int)(-1)) p = offset;
+        set_direct(direct_aligned((*(buffer))[h], l, p));
         ll = ::read(fd, (*(buffer))[h], l);
+        if (ll > 0) advise_read(p, ll);
       }
       if(fa) {
         p = fa->fa_lseek(0, SEEK_CUR);
@@ -180,6 +286,7 @@ namespace ArcDMCFile {
       }
       offset += ll; // for non-seakable files
     }
+    if((fd != -1) && io_nocache) drop_cache(fd, false);
     if(fd != -1) close(fd);
     if(fa) fa->fa_close();
     buffer->eof_read(true);
@@ -265,12 +372,14 @@ namespace ArcDMCFile {
       if(fd != -1) {
         off_t coff = lseek(fd, p, SEEK_SET);
         if((coff == p) || is_channel) {
+          set_direct(direct_aligned((*(buffer))[h], l, p));
           ll = 0;
           while (l_ < l) {
             ll = write(fd, (*(buffer))[h] + l_, l - l_);
             if (ll == -1) break; // error
             l_ += ll;
           }
+          if (ll != -1) advise_written(p, l);
         }
       }
       if(fa) {
@@ -303,6 +412,7 @@ namespace ArcDMCFile {
         if(cksum_chunks.extends() > cksum_p) {
           // from file
           off_t coff = 0;
+          set_direct(false);
           if(fd != -1) coff = lseek(fd, cksum_p, SEEK_SET);
           if(fa) coff = fa->fa_lseek(cksum_p, SEEK_SET);
           if(coff == cksum_p) {
@@ -334,6 +444,7 @@ namespace ArcDMCFile {
         logger.msg(ERROR, "fsync of file %s failed: %s", url.Path(), StrError(errno));
         buffer->error_write(true);
       }
+      if (io_nocache) drop_cache(fd, false);
       if(close(fd) != 0) {
         logger.msg(ERROR, "closing file %s failed: %s", url.Path(), StrError(errno));
         buffer->error_write(true);
@@ -539,6 +650,7 @@ namespace ArcDMCFile {
     if (reading) return DataStatus::IsReadingError;
     if (writing) return DataStatus::IsWritingError;
     reading = true;
+    direct_on = false;
     /* try to open */
     int flags = O_RDONLY;
     uid_t uid = usercfg.GetUser().get_uid();
@@ -655,6 +767,8 @@ namespace ArcDMCFile {
     if (reading) return DataStatus::IsReadingError;
     if (writing) return DataStatus::IsWritingError;
     writing = true;
+    direct_on = false;
+    written_since_drop = 0;
     uid_t uid = usercfg.GetUser().get_uid();
     gid_t gid = usercfg.GetUser().get_gid();
     /* try to open */
@@ -811,6 +925,231 @@ namespace ArcDMCFile {
     return DataStatus::Success;
   }
 
+  bool DataPointFile::SupportsTransfer() const {
+    // Only copying between local files is done internally, that is
+    // decided in Transfer()
+    return !is_channel;
+  }
+
+  // Size of chunks copied in one call, between them progress is reported
+  static const unsigned long long int copy_chunk_size = 64 * 1024 * 1024;
+
+  bool DataPointFile::copy_file(int src_fd, int dst_fd, unsigned long long int size,
+                                const CopyOptions& opts, TransferCallback callback) {
+    unsigned long long int done = 0;
+    bool use_copy_range = true;
+    bool use_sendfile = true;
+#ifdef HAVE_POSIX_FADVISE
+    if (opts.src_nocache || opts.src_readahead) posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    while (done < size) {
+      size_t l = copy_chunk_size;
+      if (l > (size - done)) l = size - done;
+#ifdef HAVE_POSIX_FADVISE
+      if (opts.src_readahead) posix_fadvise(src_fd, done, opts.src_readahead, POSIX_FADV_WILLNEED);
+#endif
+      ssize_t ll = -1;
+#ifdef HAVE_COPY_FILE_RANGE
+      // Lets kernel copy data or share it on filesystems supporting reflinks
+      if (use_copy_range) {
+        ll = copy_file_range(src_fd, NULL, dst_fd, NULL, l, 0);
+        if (ll == -1) {
+          if (errno == EINTR) continue;
+          if ((errno != ENOSYS) && (errno != EXDEV) && (errno != EINVAL) &&
+              (errno != EOPNOTSUPP) && (errno != EBADF)) return false;
+          // Not supported for these files, data was not copied
+          use_copy_range = false;
+        }
+      }
+#else
+      use_copy_range = false;
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+      if ((ll == -1) && use_sendfile) {
+        ll = sendfile(dst_fd, src_fd, NULL, l);
+        if (ll == -1) {
+          if (errno == EINTR) continue;
+          if ((errno != ENOSYS) && (errno != EINVAL)) return false;
+          use_sendfile = false;
+        }
+      }
+#else
+      use_sendfile = false;
+#endif
+      if (ll == -1) {
+        char buf[65536];
+        if (l > sizeof(buf)) l = sizeof(buf);
+        ll = ::read(src_fd, buf, l);
+        if (ll == -1) {
+          if (errno == EINTR) continue;
+          return false;
+        }
+        for (ssize_t l_ = 0; l_ < ll;) {
+          ssize_t lw = ::write(dst_fd, buf + l_, ll - l_);
+          if (lw == -1) {
+            if (errno == EINTR) continue;
+            return false;
+          }
+          l_ += lw;
+        }
+      }
+      if (ll == 0) break; // file shrank
+#ifdef HAVE_POSIX_FADVISE
+      // Source pages are still needed if checksum is calculated afterwards
+      if (opts.src_nocache && !opts.src_keep) posix_fadvise(src_fd, done, ll, POSIX_FADV_DONTNEED);
+#endif
+      if (opts.dst_nocache) drop_cache(dst_fd, true);
+      done += ll;
+      if (callback) (*callback)(done);
+    }
+    if (done != size) {
+      errno = EIO;
+      return false;
+    }
+    return true;
+  }
+
+  void DataPointFile::checksum_file(int fd, unsigned long long int size) {
+    // Data was just copied so it is most probably in page cache. Map it
+    // piece by piece instead of reading into intermediate buffer.
+    unsigned long long int done = 0;
+    while (done < size) {
+      size_t l = copy_chunk_size;
+      if (l > (size - done)) l = size - done;
+      void* addr = mmap(NULL, l, PROT_READ, MAP_SHARED, fd, done);
+      if (addr == MAP_FAILED) break;
+      madvise(addr, l, MADV_SEQUENTIAL);
+      for (std::list<CheckSum*>::iterator cksum = checksums.begin();
+           cksum != checksums.end(); ++cksum) {
+        if (*cksum) (*cksum)->add(addr, l);
+      }
+      munmap(addr, l);
+      done += l;
+    }
+    if (done < size) {
+      // Mapping is not possible for some files
+      if (::lseek(fd, done, SEEK_SET) != (off_t)done) return;
+      char buf[65536];
+      while (done < size) {
+        ssize_t l = ::read(fd, buf, sizeof(buf));
+        if (l == -1) {
+          if (errno == EINTR) continue;
+          return;
+        }
+        if (l == 0) return;
+        for (std::list<CheckSum*>::iterator cksum = checksums.begin();
+             cksum != checksums.end(); ++cksum) {
+          if (*cksum) (*cksum)->add(buf, l);
+        }
+        done += l;
+      }
+    }
+    for (std::list<CheckSum*>::iterator cksum = checksums.begin();
+         cksum != checksums.end(); ++cksum) {
+      if (*cksum) (*cksum)->end();
+    }
+  }
+
+  DataStatus DataPointFile::Transfer(const URL& otherendpoint, bool source,
+                                     TransferCallback callback) {
+    if (reading) return DataStatus(DataStatus::IsReadingError, EARCLOGIC);
+    if (writing) return DataStatus(DataStatus::IsWritingError, EARCLOGIC);
+    // Anything else than copying between local files goes through DataBuffer
+    if (is_channel || (otherendpoint.Protocol() != "file")) {
+      return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+    }
+    // Switching user id and reading ranges is left to buffered transfer
+    uid_t uid = usercfg.GetUser().get_uid();
+    gid_t gid = usercfg.GetUser().get_gid();
+    if ((uid && (uid != getuid())) || (gid && (gid != getgid())) ||
+        (range_end > range_start)) {
+      return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+    }
+    std::string src_path(source ? url.Path() : otherendpoint.Path());
+    std::string dst_path(source ? otherendpoint.Path() : url.Path());
+    if (src_path.empty() || dst_path.empty()) {
+      return DataStatus(DataStatus::UnimplementedError, EINVAL);
+    }
+
+    int src_fd = ::open(src_path.c_str(), O_RDONLY);
+    if (src_fd == -1) {
+      logger.msg(VERBOSE, "Failed to open %s for reading: %s", src_path, StrError(errno));
+      return DataStatus(DataStatus::ReadStartError, errno, "Failed to open file "+src_path+" for reading");
+    }
+    struct stat st;
+    if (::fstat(src_fd, &st) != 0) {
+      int err = errno;
+      ::close(src_fd);
+      return DataStatus(DataStatus::ReadStartError, err, "Failed to stat file "+src_path);
+    }
+    if (!S_ISREG(st.st_mode)) {
+      // Special files can't be copied in kernel and have no reliable size
+      ::close(src_fd);
+      return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+    }
+    if (source) {
+      SetSize(st.st_size);
+      SetModified(st.st_mtime);
+    }
+
+    std::string dirpath = Glib::path_get_dirname(dst_path);
+    if(dirpath == ".") dirpath = G_DIR_SEPARATOR_S;
+    if (!DirCreate(dirpath, uid, gid, S_IRWXU, true)) {
+      int err = errno;
+      logger.msg(VERBOSE, "Failed to create directory %s: %s", dirpath, StrError(err));
+      ::close(src_fd);
+      return DataStatus(DataStatus::WriteStartError, err, "Failed to create directory "+dirpath);
+    }
+    int dst_fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (dst_fd == -1) {
+      int err = errno;
+      logger.msg(VERBOSE, "Failed to create file %s: %s", dst_path, StrError(err));
+      ::close(src_fd);
+      return DataStatus(DataStatus::WriteStartError, err, "Failed to create file "+dst_path);
+    }
+
+    // Page cache options of both endpoints are honored, each for its own
+    // file. O_DIRECT makes no sense for copying inside kernel, so
+    // iomode=direct is same as iomode=nocache here.
+    CopyOptions opts;
+    bool other_direct = false;
+    bool other_nocache = false;
+    unsigned long long int other_readahead = 0;
+    io_options(otherendpoint, other_direct, other_nocache, other_readahead);
+    opts.src_nocache = source ? io_nocache : other_nocache;
+    opts.dst_nocache = source ? other_nocache : io_nocache;
+    opts.src_readahead = source ? io_readahead : other_readahead;
+    opts.src_keep = !checksums.empty();
+
+    logger.msg(VERBOSE, "Copying %s to %s", src_path, dst_path);
+    bool result = copy_file(src_fd, dst_fd, st.st_size, opts, callback);
+    int err = errno;
+    // fsync is for broken filesystems. Specifically for Lustre.
+    if (result && (fsync(dst_fd) != 0)) {
+      err = errno;
+      logger.msg(ERROR, "fsync of file %s failed: %s", dst_path, StrError(err));
+      result = false;
+    }
+    if (result && opts.dst_nocache) drop_cache(dst_fd, false);
+    if ((::close(dst_fd) != 0) && result) {
+      err = errno;
+      logger.msg(ERROR, "closing file %s failed: %s", dst_path, StrError(err));
+      result = false;
+    }
+    if (!result) {
+      ::close(src_fd);
+      logger.msg(VERBOSE, "Failed to copy %s to %s: %s", src_path, dst_path, StrError(err));
+      if (!FileDelete(dst_path) && (errno != ENOENT)) {
+        logger.msg(WARNING, "Failed to clean up file %s: %s", dst_path, StrError(errno));
+      }
+      return DataStatus(DataStatus::TransferError, err, "Failed to copy "+src_path+" to "+dst_path);
+    }
+    if (!checksums.empty()) checksum_file(src_fd, st.st_size);
+    if (opts.src_nocache) drop_cache(src_fd, false);
+    ::close(src_fd);
+    return DataStatus::Success;
+  }
+
   bool DataPointFile::WriteOutOfOrder() {
     if (!url)
       return false;
@@ -18,6 +18,18 @@ namespace ArcDMCFile {
    *
    * This class is a loadable module and cannot be used directly. The DataHandle
    * class loads modules at runtime and should be used instead of this.
+   *
+   * Following URL options control use of page cache for large files, e.g.
+   * file://;iomode=nocache;readahead=67108864/data/file
+   * - iomode=nocache - data is dropped from page cache after it is read or
+   *   written, so that large transfers do not push out other files.
+   * - iomode=direct - like nocache but O_DIRECT is used where buffers are
+   *   suitably aligned.
+   * - readahead=bytes - amount of data kernel is asked to read ahead of
+   *   current position.
+   * These options have no effect if file is accessed under another user id.
+   * When file is copied to or from another local file inside kernel, options
+   * of each URL apply to its own file and iomode=direct acts as nocache.
    */
   class DataPointFile
     : public DataPointDirect {
@@ -38,6 +50,9 @@ namespace ArcDMCFile {
     virtual DataStatus Rename(const URL& newurl);
     virtual bool WriteOutOfOrder();
     virtual bool RequiresCredentials() const { return false; };
+    virtual bool SupportsTransfer() const;
+    virtual DataStatus Transfer(const URL& otherendpoint, bool source,
+                                TransferCallback callback = NULL);
   private:
     SimpleCounter transfers_started;
     int open_channel();
@@ -45,12 +60,42 @@ namespace ArcDMCFile {
     static void write_file_start(void* arg);
     void read_file();
     void write_file();
+    /// Page cache handling for copying inside kernel
+    struct CopyOptions {
+      bool src_nocache;
+      bool dst_nocache;
+      /// source pages are needed after copy (for checksum)
+      bool src_keep;
+      unsigned long long int src_readahead;
+    };
+    /// Reads page cache related options of URL
+    static void io_options(const URL& u, bool& direct, bool& nocache,
+                           unsigned long long int& readahead);
+    bool copy_file(int src_fd, int dst_fd, unsigned long long int size,
+                   const CopyOptions& opts, TransferCallback callback);
+    void checksum_file(int fd, unsigned long long int size);
+    void set_direct(bool on);
+    void advise_read(unsigned long long int offset, unsigned long long int length);
+    void advise_written(unsigned long long int offset, unsigned long long int length);
+    void drop_cache(int h, bool flush);
     bool reading;
     bool writing;
     int fd;
     FileAccess* fa;
     bool is_channel;
     unsigned int channel_num;
+    /// use O_DIRECT where buffers are aligned (URL option iomode=direct)
+    bool io_direct;
+    /// keep transferred data out of page cache (URL option iomode=nocache)
+    bool io_nocache;
+    /// bytes to read ahead of current position (URL option readahead)
+    unsigned long long int io_readahead;
+    /// O_DIRECT is currently set for fd
+    bool direct_on;
+    /// end of area already requested to be read ahead
+    unsigned long long int readahead_pos;
+    /// bytes written since data was last dropped from page cache
+    unsigned long long int written_since_drop;
     static Logger logger;
   };
 
@@ -278,9 +278,6 @@ using namespace Arc;
     StopReading();
     StopWriting();
     if (chunks) delete chunks;
-    for(std::multimap<std::string,ClientHTTP*>::iterator cl = clients.begin(); cl != clients.end(); ++cl) {
-      delete cl->second;
-    };
   }
 
   Plugin* DataPointHTTP::Instance(PluginArgument *arg) {
@@ -363,7 +360,7 @@ using namespace Arc;
       PayloadRaw request;
       std::string path = rurl.FullPathURIEncoded();
       info.lastModified = (time_t)(-1);
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &ClientHTTPPool::Discard);
       if (!client) return DataStatus::StatError;
       // Do HEAD to obtain some metadata
       MCC_Status r = client->process("HEAD", path, &request, &info, &inbuf);
@@ -371,6 +368,7 @@ using namespace Arc;
       if (!r) {
         // Because there is no reliable way to check if connection
         // is still alive at this place, we must try again
+        client = NULL;
         client = acquire_new_client(rurl);
         if(client) r = client->process("HEAD", path, &request, &info, &inbuf);
         if (inbuf) { delete inbuf; inbuf = NULL; }
@@ -487,7 +485,7 @@ using namespace Arc;
     propattr.insert(std::pair<std::string, std::string>("Depth","0"));
     for(int redirects_max = 10;redirects_max>=0;--redirects_max) {
       std::string path = rurl.FullPathURIEncoded();
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &ClientHTTPPool::Discard);
       if (!client) return DataStatus::StatError;
       PayloadRawInterface *inbuf = NULL;
       HTTPClientInfo info;
@@ -497,6 +495,7 @@ using namespace Arc;
         if (inbuf) { delete inbuf; inbuf = NULL; }
         // Because there is no reliable way to check if connection
         // is still alive at this place, we must try again
+        client = NULL;
         client = acquire_new_client(rurl);
         if(client) r = client->process("PROPFIND", path, propattr, &request, &info, &inbuf);
         if(!r) {
@@ -568,7 +567,7 @@ using namespace Arc;
     propattr.insert(std::pair<std::string, std::string>("Depth","1")); // for listing
     for(int redirects_max = 10;redirects_max>=0;--redirects_max) {
       std::string path = rurl.FullPathURIEncoded();
-      AutoPointer<ClientHTTP> client(acquire_client(rurl));
+      AutoPointer<ClientHTTP> client(acquire_client(rurl), &ClientHTTPPool::Discard);
       if (!client) return DataStatus::StatError;
       PayloadRawInterface *inbuf = NULL;
       HTTPClientInfo info;
@@ -578,6 +577,7 @@ using namespace Arc;
         if (inbuf) { delete inbuf; inbuf = NULL; }
         // Because there is no reliable way to check if connection
         // is still alive at this place, we must try again
+        client = NULL;
         client = acquire_new_client(rurl);
         if(client) r = client->process("PROPFIND", path, propattr, &request, &info, &inbuf);
         if(!r) {
@@ -878,7 +878,7 @@ using namespace Arc;
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &ClientHTTPPool::Discard);
     if (!client) return DataStatus::CheckError;
     MCC_Status r = client->process("GET", url.FullPathURIEncoded(), 0, 15,
                                   &request, &info, &inbuf);
@@ -888,6 +888,7 @@ using namespace Arc;
       delete inbuf; inbuf = NULL;
     }
     if (!r) {
+      client = NULL;
       client = acquire_new_client(url);
       if(client) r = client->process("GET", url.FullPathURIEncoded(), 0, 15,
                                     &request, &info, &inbuf);
@@ -907,7 +908,7 @@ using namespace Arc;
   }
 
   DataStatus DataPointHTTP::Remove() {
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &ClientHTTPPool::Discard);
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
@@ -915,6 +916,7 @@ using namespace Arc;
                                   &request, &info, &inbuf);
     if (inbuf) { delete inbuf; inbuf = NULL; }
     if(!r) {
+      client = NULL;
       client = acquire_new_client(url);
       if(client) r = client->process("DELETE", url.FullPathURIEncoded(),
                                     &request, &info, &inbuf);
@@ -929,7 +931,7 @@ using namespace Arc;
   }
 
   DataStatus DataPointHTTP::Rename(const URL& destination) {
-    AutoPointer<ClientHTTP> client(acquire_client(url));
+    AutoPointer<ClientHTTP> client(acquire_client(url), &ClientHTTPPool::Discard);
     PayloadRaw request;
     PayloadRawInterface *inbuf = NULL;
     HTTPClientInfo info;
@@ -939,6 +941,7 @@ using namespace Arc;
                                    attributes, &request, &info, &inbuf);
     if (inbuf) { delete inbuf; inbuf = NULL; }
     if(!r) {
+      client = NULL;
       client = acquire_new_client(url);
       if(client) r = client->process("MOVE", url.FullPathURIEncoded(),
                                      attributes, &request, &info, &inbuf);
@@ -956,7 +959,7 @@ using namespace Arc;
     HTTPInfo_t& info = *((HTTPInfo_t*)arg);
     DataPointHTTP& point = *(info.point);
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &ClientHTTPPool::Discard);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = point.CurrentLocation().FullPathURIEncoded();
@@ -1068,14 +1071,14 @@ using namespace Arc;
     point.transfer_lock.lock();
     point.transfer_lock.unlock();
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &ClientHTTPPool::Discard);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = point.CurrentLocation().FullPathURIEncoded();
     DataStatus failure_code;
     bool partial_read_allowed = (client_url.Option("httpgetpartial") == "yes");
     if(partial_read_allowed) for (;;) {
-      if(client && client->GetClosed()) client = point.acquire_client(client_url);
+      if(client && client->GetClosed()) { client = NULL; client = point.acquire_client(client_url); }
       if (!client) {
         transfer_failure = true;
         break;
@@ -1246,7 +1249,7 @@ using namespace Arc;
     HTTPInfo_t& info = *((HTTPInfo_t*)arg);
     DataPointHTTP& point = *(info.point);
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &ClientHTTPPool::Discard);
     if (!client) return false;
     std::string path = client_url.FullPathURIEncoded();
     // TODO: Do ping to *client in order to check if connection is alive.
@@ -1332,7 +1335,7 @@ using namespace Arc;
     point.transfer_lock.lock();
     point.transfer_lock.unlock();
     URL client_url = point.url;
-    AutoPointer<ClientHTTP> client(point.acquire_client(client_url));
+    AutoPointer<ClientHTTP> client(point.acquire_client(client_url), &ClientHTTPPool::Discard);
     bool transfer_failure = false;
     int retries = 0;
     std::string path = client_url.FullPathURIEncoded();
@@ -1340,7 +1343,7 @@ using namespace Arc;
     DataStatus failure_code;
     // Fall through if partial PUT is not allowed
     if(!partial_write_failure) for (;;) {
-      if(client && client->GetClosed()) client = point.acquire_client(client_url);
+      if(client && client->GetClosed()) { client = NULL; client = point.acquire_client(client_url); }
       if (!client) {
         transfer_failure = true;
         break;
@@ -1476,28 +1479,15 @@ using namespace Arc;
   }
 
   ClientHTTP* DataPointHTTP::acquire_client(const URL& curl) {
-    // TODO: lock
     if(!curl) return NULL;
     if((curl.Protocol() != "http") &&
        (curl.Protocol() != "https") &&
        (curl.Protocol() != "httpg") &&
        (curl.Protocol() != "dav") &&
        (curl.Protocol() != "davs")) return NULL;
-    ClientHTTP* client = NULL;
-    std::string key = curl.ConnectionURL();
-    clients_lock.lock();
-    std::multimap<std::string,ClientHTTP*>::iterator cl = clients.find(key);
-    if(cl != clients.end()) {
-      client = cl->second;
-      clients.erase(cl);
-      clients_lock.unlock();
-    } else {
-      clients_lock.unlock();
-      MCCConfig cfg;
-      usercfg.ApplyToConfig(cfg);
-      client = new ClientHTTP(cfg, curl, usercfg.Timeout());
-    };
-    return client;
+    MCCConfig cfg;
+    usercfg.ApplyToConfig(cfg);
+    return ClientHTTPPool::Acquire(cfg, curl, usercfg.Timeout());
   }
 
   ClientHTTP* DataPointHTTP::acquire_new_client(const URL& curl) {
@@ -1509,17 +1499,11 @@ using namespace Arc;
        (curl.Protocol() != "davs")) return NULL;
     MCCConfig cfg;
     usercfg.ApplyToConfig(cfg);
-    return new ClientHTTP(cfg, curl, usercfg.Timeout());
+    return ClientHTTPPool::Acquire(cfg, curl, usercfg.Timeout(), true);
   }
 
   void DataPointHTTP::release_client(const URL& curl, ClientHTTP* client) {
-    if(!client) return;
-    if(client->GetClosed()) { delete client; return; }
-    std::string key = curl.ConnectionURL();
-    //if(!*client) return;
-    clients_lock.lock();
-    clients.insert(std::pair<std::string,ClientHTTP*>(key,client));
-    clients_lock.unlock();
+    ClientHTTPPool::Release(client);
   }
 
   int DataPointHTTP::http2errno(int http_code) const {
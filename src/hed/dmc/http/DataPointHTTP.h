@@ -5,6 +5,7 @@
 
 #include <arc/Thread.h>
 #include <arc/communication/ClientInterface.h>
+#include <arc/communication/ClientHTTPPool.h>
 #include <arc/data/DataPointDirect.h>
 
 namespace ArcDMCHTTP {
@@ -55,11 +56,9 @@ using namespace Arc;
     bool reading;
     bool writing;
     ChunkControl *chunks;
-    std::multimap<std::string,ClientHTTP*> clients;
     SimpleCounter transfers_started;
     int transfers_tofinish;
     Glib::Mutex transfer_lock;
-    Glib::Mutex clients_lock;
   };
 
 } // namespace Arc
@@ -87,6 +87,23 @@ static uint32_t gtable[256] = {
   0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4
 };
 
+// Tables for processing 8 bytes at once (slicing-by-8). Table k gives
+// contribution of byte followed by k zero bytes. Table 0 is gtable.
+static uint32_t gtable8[8][256];
+
+static class CRC32TableInit {
+ public:
+  CRC32TableInit(void) {
+    for (int i = 0; i < 256; ++i) gtable8[0][i] = gtable[i];
+    for (int k = 1; k < 8; ++k) {
+      for (int i = 0; i < 256; ++i) {
+        uint32_t v = gtable8[k-1][i];
+        gtable8[k][i] = (v << 8) ^ gtable[v >> 24];
+      }
+    }
+  }
+} crc32_table_init;
+
 namespace Arc {
 
   CRC32Sum::CRC32Sum(void) {
@@ -99,11 +116,26 @@ namespace Arc {
     computed = false;
   }
 
+  // Register r holds CRC of data so far without the 4 zero bytes which
+  // 'cksum' appends to the data. The result is therefore the same as if
+  // data was shifted through the register one byte at a time and 4 zero
+  // bytes were added at the end.
   void CRC32Sum::add(void *buf, unsigned long long int len) {
-    for (unsigned long long int i = 0; i < len; i++) {
-      unsigned char c = (r >> 24);
-      r = ((r << 8) | ((unsigned char*)buf)[i]) ^ gtable[c];
+    const unsigned char *p = (const unsigned char*)buf;
+    unsigned long long int l = len;
+    uint32_t c = r;
+    for (; l >= 8; l -= 8, p += 8) {
+      uint32_t h = c ^ (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                        ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+      c = gtable8[7][h >> 24] ^ gtable8[6][(h >> 16) & 0xFF] ^
+          gtable8[5][(h >> 8) & 0xFF] ^ gtable8[4][h & 0xFF] ^
+          gtable8[3][p[4]] ^ gtable8[2][p[5]] ^
+          gtable8[1][p[6]] ^ gtable8[0][p[7]];
     }
+    for (; l; --l, ++p) {
+      c = (c << 8) ^ gtable[(c >> 24) ^ *p];
+    }
+    r = c;
     count += len;
   }
 
@@ -113,11 +145,9 @@ namespace Arc {
     unsigned long long l = count;
     for (; l;) {
       unsigned char c = (l & 0xFF);
-      ((CheckSum*)this)->add(&c, 1);
+      r = (r << 8) ^ gtable[(r >> 24) ^ c];
       l >>= 8;
     }
-    uint32_t u = 0;
-    ((CheckSum*)this)->add(&u, 4);
     r = ((~r) & 0xFFFFFFFF);
     computed = true;
   }
@@ -219,6 +249,103 @@ namespace Arc {
   };
 
 
+  // Process one 64 bytes block stored in X as 16 little-endian words
+  static void md5_block(uint32_t& A, uint32_t& B, uint32_t& C, uint32_t& D,
+                        const uint32_t *X) {
+    uint32_t AA = A;
+    uint32_t BB = B;
+    uint32_t CC = C;
+    uint32_t DD = D;
+
+    OP1(A, B, C, D, 0, 7, 1);
+    OP1(D, A, B, C, 1, 12, 2);
+    OP1(C, D, A, B, 2, 17, 3);
+    OP1(B, C, D, A, 3, 22, 4);
+
+    OP1(A, B, C, D, 4, 7, 5);
+    OP1(D, A, B, C, 5, 12, 6);
+    OP1(C, D, A, B, 6, 17, 7);
+    OP1(B, C, D, A, 7, 22, 8);
+
+    OP1(A, B, C, D, 8, 7, 9);
+    OP1(D, A, B, C, 9, 12, 10);
+    OP1(C, D, A, B, 10, 17, 11);
+    OP1(B, C, D, A, 11, 22, 12);
+
+    OP1(A, B, C, D, 12, 7, 13);
+    OP1(D, A, B, C, 13, 12, 14);
+    OP1(C, D, A, B, 14, 17, 15);
+    OP1(B, C, D, A, 15, 22, 16);
+
+
+    OP2(A, B, C, D, 1, 5, 17);
+    OP2(D, A, B, C, 6, 9, 18);
+    OP2(C, D, A, B, 11, 14, 19);
+    OP2(B, C, D, A, 0, 20, 20);
+
+    OP2(A, B, C, D, 5, 5, 21);
+    OP2(D, A, B, C, 10, 9, 22);
+    OP2(C, D, A, B, 15, 14, 23);
+    OP2(B, C, D, A, 4, 20, 24);
+
+    OP2(A, B, C, D, 9, 5, 25);
+    OP2(D, A, B, C, 14, 9, 26);
+    OP2(C, D, A, B, 3, 14, 27);
+    OP2(B, C, D, A, 8, 20, 28);
+
+    OP2(A, B, C, D, 13, 5, 29);
+    OP2(D, A, B, C, 2, 9, 30);
+    OP2(C, D, A, B, 7, 14, 31);
+    OP2(B, C, D, A, 12, 20, 32);
+
+
+    OP3(A, B, C, D, 5, 4, 33);
+    OP3(D, A, B, C, 8, 11, 34);
+    OP3(C, D, A, B, 11, 16, 35);
+    OP3(B, C, D, A, 14, 23, 36);
+
+    OP3(A, B, C, D, 1, 4, 37);
+    OP3(D, A, B, C, 4, 11, 38);
+    OP3(C, D, A, B, 7, 16, 39);
+    OP3(B, C, D, A, 10, 23, 40);
+
+    OP3(A, B, C, D, 13, 4, 41);
+    OP3(D, A, B, C, 0, 11, 42);
+    OP3(C, D, A, B, 3, 16, 43);
+    OP3(B, C, D, A, 6, 23, 44);
+
+    OP3(A, B, C, D, 9, 4, 45);
+    OP3(D, A, B, C, 12, 11, 46);
+    OP3(C, D, A, B, 15, 16, 47);
+    OP3(B, C, D, A, 2, 23, 48);
+
+
+    OP4(A, B, C, D, 0, 6, 49);
+    OP4(D, A, B, C, 7, 10, 50);
+    OP4(C, D, A, B, 14, 15, 51);
+    OP4(B, C, D, A, 5, 21, 52);
+
+    OP4(A, B, C, D, 12, 6, 53);
+    OP4(D, A, B, C, 3, 10, 54);
+    OP4(C, D, A, B, 10, 15, 55);
+    OP4(B, C, D, A, 1, 21, 56);
+
+    OP4(A, B, C, D, 8, 6, 57);
+    OP4(D, A, B, C, 15, 10, 58);
+    OP4(C, D, A, B, 6, 15, 59);
+    OP4(B, C, D, A, 13, 21, 60);
+
+    OP4(A, B, C, D, 4, 6, 61);
+    OP4(D, A, B, C, 11, 10, 62);
+    OP4(C, D, A, B, 2, 15, 63);
+    OP4(B, C, D, A, 9, 21, 64);
+
+    A += AA;
+    B += BB;
+    C += CC;
+    D += DD;
+  }
+
   MD5Sum::MD5Sum(void) {
     // for(u_int i = 1;i<=64;i++) T[i-1]=(uint32_t)(4294967296LL*fabs(sin(i)));
     start();
@@ -238,6 +365,19 @@ namespace Arc {
   void MD5Sum::add(void *buf, unsigned long long int len) {
     u_char *buf_ = (u_char*)buf;
     for (; len;) {
+      // Whole blocks are taken directly from buffer
+      if (Xlen == 0) {
+        uint32_t W[16];
+        for (; len >= 64; len -= 64, buf_ += 64, count += 64) {
+          for (int i = 0; i < 16; ++i) {
+            const u_char *w = buf_ + (i << 2);
+            W[i] = ((uint32_t)w[0]) | (((uint32_t)w[1]) << 8) |
+                   (((uint32_t)w[2]) << 16) | (((uint32_t)w[3]) << 24);
+          }
+          md5_block(A, B, C, D, W);
+        }
+        if (!len) return;
+      }
       for(;Xlen < 64;) { // 16 words = 64 bytes
         if(!len) break;
         u_int Xi = Xlen >> 2;
@@ -249,101 +389,7 @@ namespace Arc {
         ++buf_;
       }
       if (Xlen < 64) return;
-
-      uint32_t AA = A;
-      uint32_t BB = B;
-      uint32_t CC = C;
-      uint32_t DD = D;
-
-
-      OP1(A, B, C, D, 0, 7, 1);
-      OP1(D, A, B, C, 1, 12, 2);
-      OP1(C, D, A, B, 2, 17, 3);
-      OP1(B, C, D, A, 3, 22, 4);
-
-      OP1(A, B, C, D, 4, 7, 5);
-      OP1(D, A, B, C, 5, 12, 6);
-      OP1(C, D, A, B, 6, 17, 7);
-      OP1(B, C, D, A, 7, 22, 8);
-
-      OP1(A, B, C, D, 8, 7, 9);
-      OP1(D, A, B, C, 9, 12, 10);
-      OP1(C, D, A, B, 10, 17, 11);
-      OP1(B, C, D, A, 11, 22, 12);
-
-      OP1(A, B, C, D, 12, 7, 13);
-      OP1(D, A, B, C, 13, 12, 14);
-      OP1(C, D, A, B, 14, 17, 15);
-      OP1(B, C, D, A, 15, 22, 16);
-
-
-      OP2(A, B, C, D, 1, 5, 17);
-      OP2(D, A, B, C, 6, 9, 18);
-      OP2(C, D, A, B, 11, 14, 19);
-      OP2(B, C, D, A, 0, 20, 20);
-
-      OP2(A, B, C, D, 5, 5, 21);
-      OP2(D, A, B, C, 10, 9, 22);
-      OP2(C, D, A, B, 15, 14, 23);
-      OP2(B, C, D, A, 4, 20, 24);
-
-      OP2(A, B, C, D, 9, 5, 25);
-      OP2(D, A, B, C, 14, 9, 26);
-      OP2(C, D, A, B, 3, 14, 27);
-      OP2(B, C, D, A, 8, 20, 28);
-
-      OP2(A, B, C, D, 13, 5, 29);
-      OP2(D, A, B, C, 2, 9, 30);
-      OP2(C, D, A, B, 7, 14, 31);
-      OP2(B, C, D, A, 12, 20, 32);
-
-
-      OP3(A, B, C, D, 5, 4, 33);
-      OP3(D, A, B, C, 8, 11, 34);
-      OP3(C, D, A, B, 11, 16, 35);
-      OP3(B, C, D, A, 14, 23, 36);
-
-      OP3(A, B, C, D, 1, 4, 37);
-      OP3(D, A, B, C, 4, 11, 38);
-      OP3(C, D, A, B, 7, 16, 39);
-      OP3(B, C, D, A, 10, 23, 40);
-
-      OP3(A, B, C, D, 13, 4, 41);
-      OP3(D, A, B, C, 0, 11, 42);
-      OP3(C, D, A, B, 3, 16, 43);
-      OP3(B, C, D, A, 6, 23, 44);
-
-      OP3(A, B, C, D, 9, 4, 45);
-      OP3(D, A, B, C, 12, 11, 46);
-      OP3(C, D, A, B, 15, 16, 47);
-      OP3(B, C, D, A, 2, 23, 48);
-
-
-      OP4(A, B, C, D, 0, 6, 49);
-      OP4(D, A, B, C, 7, 10, 50);
-      OP4(C, D, A, B, 14, 15, 51);
-      OP4(B, C, D, A, 5, 21, 52);
-
-      OP4(A, B, C, D, 12, 6, 53);
-      OP4(D, A, B, C, 3, 10, 54);
-      OP4(C, D, A, B, 10, 15, 55);
-      OP4(B, C, D, A, 1, 21, 56);
-
-      OP4(A, B, C, D, 8, 6, 57);
-      OP4(D, A, B, C, 15, 10, 58);
-      OP4(C, D, A, B, 6, 15, 59);
-      OP4(B, C, D, A, 13, 21, 60);
-
-      OP4(A, B, C, D, 4, 6, 61);
-      OP4(D, A, B, C, 11, 10, 62);
-      OP4(C, D, A, B, 2, 15, 63);
-      OP4(B, C, D, A, 9, 21, 64);
-
-
-      A += AA;
-      B += BB;
-      C += CC;
-      D += DD;
+      md5_block(A, B, C, D, X);
       Xlen = 0;
       memset(X,0,sizeof(X));
     }
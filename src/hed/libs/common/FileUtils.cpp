@@ -17,6 +17,9 @@
 #include <glibmm.h>
 #include <poll.h>
 #include <sys/mman.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include <arc/StringConv.h>
 #include <arc/DateTime.h>
@@ -108,21 +111,65 @@ bool FileCopy(int source_handle,const std::string& destination_path) {
 }
 
 #define FileCopyBigThreshold (50*1024*1024)
-#define FileCopyBufSize (4*1024)
+#define FileCopyBufSize (64*1024)
+#define FileCopyKernelChunk (64*1024*1024)
+
+// Copies data without passing it through user space, starting at
+// current positions. Returns false on error. Amount copied is stored in
+// copied, it is less than size if kernel can't copy between these files.
+static bool copy_in_kernel(int source_handle,int destination_handle,off_t size,off_t& copied) {
+  copied = 0;
+#ifdef HAVE_COPY_FILE_RANGE
+  // On filesystems supporting it this makes a reflink
+  while(copied < size) {
+    size_t l = FileCopyKernelChunk;
+    if(l > (size_t)(size-copied)) l = size-copied;
+    ssize_t ll = copy_file_range(source_handle,NULL,destination_handle,NULL,l,0);
+    if(ll == -1) {
+      if(errno == EINTR) continue;
+      if((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) ||
+         (errno == EOPNOTSUPP) || (errno == EBADF)) break;
+      return false;
+    }
+    if(ll == 0) return true; // less than expected
+    copied += ll;
+  }
+  if(copied >= size) return true;
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+  while(copied < size) {
+    size_t l = FileCopyKernelChunk;
+    if(l > (size_t)(size-copied)) l = size-copied;
+    ssize_t ll = sendfile(destination_handle,source_handle,NULL,l);
+    if(ll == -1) {
+      if(errno == EINTR) continue;
+      if((errno == ENOSYS) || (errno == EINVAL)) break;
+      return false;
+    }
+    if(ll == 0) return true;
+    copied += ll;
+  }
+#endif
+  return true;
+}
 
 bool FileCopy(int source_handle,int destination_handle) {
   off_t source_size = lseek(source_handle,0,SEEK_END);
   if(source_size == (off_t)(-1)) return false;
   if(source_size == 0) return true;
+  if(lseek(source_handle,0,SEEK_SET) != 0) return false;
+  off_t copied = 0;
+  if(!copy_in_kernel(source_handle,destination_handle,source_size,copied)) return false;
+  if(copied >= source_size) return true;
   if(source_size <= FileCopyBigThreshold) {
     void* source_addr = mmap(NULL,source_size,PROT_READ,MAP_SHARED,source_handle,0);
     if(source_addr != MAP_FAILED) {
-      bool r = write_all(destination_handle,source_addr,source_size);
+      bool r = write_all(destination_handle,((const char*)source_addr)+copied,source_size-copied);
       munmap(source_addr,source_size);
       return r;
     }
   }
-  if(lseek(source_handle,0,SEEK_SET) != 0) return false;
+  if(lseek(source_handle,copied,SEEK_SET) != copied) return false;
   char* buf = new char[FileCopyBufSize];
   if(!buf) return false;
   bool r = true;
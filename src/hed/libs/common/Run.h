@@ -126,6 +126,10 @@ namespace Arc {
     }
     /// Return true if execution is going on.
     bool Running(void);
+    /// Returns process id of started executable or -1 if not started.
+    int Pid(void) {
+      return pid_;
+    }
     /// Returns time when executable was started.
     Time RunTime(void) {
       return run_time_;
@@ -161,6 +165,12 @@ namespace Arc {
         \param size size of buf
         \return number of written bytes. */
     int WriteStdin(int timeout, const char *buf, int size);
+    /// Returns handle of stdout pipe of running executable or -1 if there is none.
+    /** It may be used to wait for data before calling ReadStdout(). The
+        handle must not be closed or read directly. */
+    int GetStdoutHandle(void) {
+      return stdout_;
+    }
     /// Associate stdout pipe of executable with string.
     /** This method must be called before Start(). str object
         must be valid as long as this object exists. */
@@ -17,6 +17,7 @@ class CheckSumTest
   CPPUNIT_TEST(CRC32SumTest);
   CPPUNIT_TEST(MD5SumTest);
   CPPUNIT_TEST(Adler32SumTest);
+  CPPUNIT_TEST(BlocksTest);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -26,6 +27,7 @@ public:
   void CRC32SumTest();
   void MD5SumTest();
   void Adler32SumTest();
+  void BlocksTest();
 };
 
 
@@ -77,4 +79,31 @@ void CheckSumTest::Adler32SumTest() {
   //CPPUNIT_ASSERT_EQUAL((std::string)"adler32:471b96e5", (std::string)buf);
 }
 
+void CheckSumTest::BlocksTest() {
+  // Result must not depend on how data is split into blocks
+  std::string data;
+  for (int i = 0; i < 10000; ++i) data += (char)(i * 31 + (i >> 7));
+  const char* types[] = { "cksum", "md5", "adler32", NULL };
+  for (int t = 0; types[t]; ++t) {
+    char whole[64];
+    Arc::CheckSumAny ck1(types[t]);
+    ck1.start();
+    ck1.add((void*)data.c_str(), data.length());
+    ck1.end();
+    ck1.print(whole, sizeof(whole));
+    char parts[64];
+    Arc::CheckSumAny ck2(types[t]);
+    ck2.start();
+    std::string::size_type pos = 0;
+    for (std::string::size_type l = 1; pos < data.length(); l = (l * 3 + 1) % 200) {
+      if (pos + l > data.length()) l = data.length() - pos;
+      ck2.add((void*)(data.c_str() + pos), l);
+      pos += l;
+    }
+    ck2.end();
+    ck2.print(parts, sizeof(parts));
+    CPPUNIT_ASSERT_EQUAL((std::string)whole, (std::string)parts);
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(CheckSumTest);
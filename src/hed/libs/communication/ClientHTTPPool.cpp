@@ -0,0 +1,285 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <map>
+#include <list>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/message/PayloadRaw.h>
+
+#include "ClientHTTPPool.h"
+
+namespace Arc {
+
+  // Default maximal number of connections to one host
+  #define POOL_MAX_PER_HOST (16)
+  // Default time to keep unused connection (s)
+  #define POOL_IDLE_TIMEOUT (60)
+  // Time to wait for connection if client has no timeout (s)
+  #define POOL_WAIT_TIMEOUT (60)
+
+  static Logger logger(Logger::getRootLogger(), "ClientHTTPPool");
+
+  // Options of URL which affect connection itself
+  static char const * const connection_options[] = {
+    "protocol", "encryption", "tlscred", "tcpnodelay", "relativeuri", "encodeduri", NULL
+  };
+
+  class PooledClient {
+  public:
+    std::string key;
+    std::string host;
+    time_t released;
+  };
+
+  static Glib::Mutex pool_lock;
+  static Glib::Cond pool_cond;
+  // Connected clients not used by anyone
+  static std::multimap<std::string,std::pair<ClientHTTP*,PooledClient> > pool_idle;
+  // Clients handed out
+  static std::map<ClientHTTP*,PooledClient> pool_busy;
+  // Number of open connections per host
+  static std::map<std::string,unsigned int> pool_hosts;
+  static unsigned int pool_max_per_host = POOL_MAX_PER_HOST;
+  static int pool_idle_timeout = POOL_IDLE_TIMEOUT;
+
+  static std::string pool_key(const char* type, const BaseConfig& cfg, const URL& url, int timeout) {
+    std::string key(type);
+    key += "\n" + url.ConnectionURL() + "\n" + tostring(timeout);
+    for(char const * const * option = connection_options; *option; ++option) {
+      key += "\n" + url.Option(*option);
+    };
+    // Connections made with different identity are not interchangeable
+    key += "\n" + cfg.credential + "\n" + cfg.key + "\n" + cfg.cert + "\n" + cfg.proxy +
+           "\n" + cfg.cafile + "\n" + cfg.cadir + "\n" + cfg.otoken;
+    if(cfg.overlay) {
+      std::string overlay;
+      cfg.overlay.GetXML(overlay);
+      key += "\n" + overlay;
+    };
+    return key;
+  }
+
+  // Must be called with pool_lock held. Clients to be destroyed are
+  // returned in expired.
+  static void pool_expire(std::list<ClientHTTP*>& expired) {
+    time_t now = time(NULL);
+    std::multimap<std::string,std::pair<ClientHTTP*,PooledClient> >::iterator c = pool_idle.begin();
+    while(c != pool_idle.end()) {
+      if((now - c->second.second.released) < pool_idle_timeout) { ++c; continue; };
+      expired.push_back(c->second.first);
+      --(pool_hosts[c->second.second.host]);
+      pool_idle.erase(c++);
+    };
+    if(!expired.empty()) pool_cond.broadcast();
+  }
+
+  static void pool_destroy(std::list<ClientHTTP*>& clients) {
+    for(std::list<ClientHTTP*>::iterator c = clients.begin(); c != clients.end(); ++c) delete *c;
+    clients.clear();
+  }
+
+  // Finds idle client or reserves place for new one. Returns NULL if new
+  // client must be created.
+  static ClientHTTP* pool_take(const std::string& key, const std::string& host, int timeout, bool fresh) {
+    std::list<ClientHTTP*> expired;
+    ClientHTTP* client = NULL;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      pool_expire(expired);
+      std::multimap<std::string,std::pair<ClientHTTP*,PooledClient> >::iterator c = pool_idle.find(key);
+      if(fresh && (c != pool_idle.end())) {
+        // Caller suspects connections to this endpoint are broken
+        while((c != pool_idle.end()) && (c->first == key)) {
+          expired.push_back(c->second.first);
+          --(pool_hosts[c->second.second.host]);
+          pool_idle.erase(c++);
+        };
+        c = pool_idle.end();
+      };
+      if(c != pool_idle.end()) {
+        client = c->second.first;
+        pool_busy[client] = c->second.second;
+        pool_idle.erase(c);
+      } else {
+        Glib::TimeVal etime;
+        etime.assign_current_time();
+        etime.add_seconds((timeout > 0) ? timeout : POOL_WAIT_TIMEOUT);
+        while(pool_hosts[host] >= pool_max_per_host) {
+          // Closing unused connection to same host made with other identity
+          // is better than waiting.
+          for(c = pool_idle.begin(); c != pool_idle.end(); ++c) {
+            if(c->second.second.host == host) break;
+          };
+          if(c != pool_idle.end()) {
+            expired.push_back(c->second.first);
+            --(pool_hosts[host]);
+            pool_idle.erase(c);
+            break;
+          };
+          if(!pool_cond.timed_wait(pool_lock, etime)) {
+            logger.msg(VERBOSE, "Exceeding limit of %u connections to %s", pool_max_per_host, host);
+            break;
+          };
+        };
+        ++(pool_hosts[host]);
+      };
+    };
+    pool_destroy(expired);
+    return client;
+  }
+
+  static void pool_add(ClientHTTP* client, const std::string& key, const std::string& host) {
+    Glib::Mutex::Lock lock(pool_lock);
+    PooledClient& pooled = pool_busy[client];
+    pooled.key = key;
+    pooled.host = host;
+    pooled.released = 0;
+  }
+
+  static void pool_cancel(const std::string& host) {
+    Glib::Mutex::Lock lock(pool_lock);
+    --(pool_hosts[host]);
+    pool_cond.signal();
+  }
+
+  // Same as ClientHTTPPool::Acquire but also tells if connection was
+  // used before
+  static ClientHTTP* pool_acquire(const BaseConfig& cfg, const URL& url, int timeout, bool fresh, bool& reused) {
+    std::string key = pool_key("http", cfg, url, timeout);
+    std::string host = url.Host() + ":" + tostring(url.Port());
+    ClientHTTP* client = pool_take(key, host, timeout, fresh);
+    reused = (client != NULL);
+    if(client) return client;
+    client = new ClientHTTP(cfg, url, timeout);
+    if(!client) {
+      pool_cancel(host);
+      return NULL;
+    };
+    pool_add(client, key, host);
+    return client;
+  }
+
+  ClientHTTP* ClientHTTPPool::Acquire(const BaseConfig& cfg, const URL& url, int timeout, bool fresh) {
+    bool reused = false;
+    return pool_acquire(cfg, url, timeout, fresh, reused);
+  }
+
+  MCC_Status ClientHTTPPool::Process(const BaseConfig& cfg, const URL& url, int timeout,
+                                     const std::string& method, const std::string& path,
+                                     PayloadRawInterface* request, HTTPClientInfo* info,
+                                     PayloadRawInterface** response) {
+    if(response) *response = NULL;
+    bool fresh = false;
+    for(;;) {
+      bool reused = false;
+      ClientHTTP* client = pool_acquire(cfg, url, timeout, fresh, reused);
+      if(!client) return MCC_Status(GENERIC_ERROR, "ClientHTTPPool", "Failed to create HTTP client");
+      PayloadRawInterface* inbuf = NULL;
+      MCC_Status r = client->process(method, path, request, info, &inbuf);
+      if(!r) {
+        delete inbuf;
+        Discard(client);
+        // Pooled connection may have been closed by server while being idle
+        if(reused) {
+          logger.msg(DEBUG, "Request to %s failed on reused connection, retrying with new one", url.ConnectionURL());
+          fresh = true;
+          continue;
+        };
+        return r;
+      };
+      // Body of response is read from connection on demand. So it must be
+      // fetched completely before connection is given to anyone else.
+      // Callers expect whole body in single buffer.
+      PayloadRaw* outbuf = NULL;
+      if(inbuf) {
+        std::string body;
+        for(unsigned int n = 0; inbuf->Buffer(n); ++n) {
+          body.append(inbuf->Buffer(n), inbuf->BufferSize(n));
+        };
+        delete inbuf;
+        outbuf = new PayloadRaw;
+        if(!body.empty()) outbuf->Insert(body.c_str(), 0, body.length());
+      };
+      Release(client);
+      if(response) {
+        *response = outbuf;
+      } else {
+        delete outbuf;
+      };
+      return r;
+    };
+  }
+
+  ClientSOAP* ClientHTTPPool::AcquireSOAP(const BaseConfig& cfg, const URL& url, int timeout, bool fresh) {
+    // Path is part of SOAP endpoint and can't be changed per request
+    std::string key = pool_key("soap", cfg, url, timeout) + "\n" + url.FullPath();
+    std::string host = url.Host() + ":" + tostring(url.Port());
+    ClientHTTP* client = pool_take(key, host, timeout, fresh);
+    if(client) return static_cast<ClientSOAP*>(client);
+    ClientSOAP* soap_client = new ClientSOAP(cfg, url, timeout);
+    if(!soap_client) {
+      pool_cancel(host);
+      return NULL;
+    };
+    pool_add(soap_client, key, host);
+    return soap_client;
+  }
+
+  void ClientHTTPPool::Release(ClientHTTP* client) {
+    if(!client) return;
+    if(client->GetClosed()) {
+      Discard(client);
+      return;
+    };
+    std::list<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      std::map<ClientHTTP*,PooledClient>::iterator c = pool_busy.find(client);
+      if(c == pool_busy.end()) {
+        // Not from pool
+        expired.push_back(client);
+      } else {
+        c->second.released = time(NULL);
+        pool_idle.insert(std::pair<std::string,std::pair<ClientHTTP*,PooledClient> >(
+                         c->second.key, std::pair<ClientHTTP*,PooledClient>(client, c->second)));
+        pool_busy.erase(c);
+        pool_cond.signal();
+      };
+      pool_expire(expired);
+    };
+    pool_destroy(expired);
+  }
+
+  void ClientHTTPPool::Discard(ClientHTTP* client) {
+    if(!client) return;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      std::map<ClientHTTP*,PooledClient>::iterator c = pool_busy.find(client);
+      if(c != pool_busy.end()) {
+        --(pool_hosts[c->second.host]);
+        pool_busy.erase(c);
+        pool_cond.signal();
+      };
+    };
+    delete client;
+  }
+
+  void ClientHTTPPool::SetLimits(unsigned int max_per_host, int idle_timeout) {
+    std::list<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      if(max_per_host > 0) pool_max_per_host = max_per_host;
+      if(idle_timeout >= 0) pool_idle_timeout = idle_timeout;
+      pool_expire(expired);
+      pool_cond.broadcast();
+    };
+    pool_destroy(expired);
+  }
+
+} // namespace Arc
@@ -0,0 +1,63 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef __ARC_CLIENTHTTPPOOL_H__
+#define __ARC_CLIENTHTTPPOOL_H__
+
+#include <arc/ArcConfig.h>
+#include <arc/URL.h>
+#include <arc/communication/ClientInterface.h>
+
+namespace Arc {
+
+  //! Process-wide pool of HTTP(S) connections
+  /** Clients obtained from the pool are kept connected after being
+   *  released and handed out again to requests for the same endpoint
+   *  made with the same credentials. So many consecutive operations on
+   *  one service share few connections instead of making new connection
+   *  and TLS handshake each time.
+   *  Client is used by one caller at a time. Because one HTTP client
+   *  may be used with any path on the same server, the path of request
+   *  must be passed to ClientHTTP::process() explicitly. ClientSOAP is
+   *  only shared between callers of exactly the same URL.
+   *  Number of connections to one host is limited. If limit is reached
+   *  Acquire waits for a connection to be released, but not longer than
+   *  the timeout of the client.
+   *  Connections not used for longer than idle timeout are closed.
+   *  By default at most 16 connections are made to one host and idle
+   *  connections are kept for 60 seconds. Both can be changed with
+   *  SetLimits(). If the limit is reached and no connection is released
+   *  within the timeout of the client, Acquire makes new connection
+   *  exceeding the limit rather than failing.
+   *  Server may close connection while it is kept idle in pool. Hence
+   *  failed request on reused connection should be repeated on new one
+   *  (fresh = true). Process() does that for simple requests.
+   **/
+  class ClientHTTPPool {
+  public:
+    /// Get HTTP client for url.
+    /** Client must be returned by Release() or destroyed by Discard()
+     *  (e.g. by AutoPointer using Discard as deleter). If fresh is true
+     *  new connection is always made. */
+    static ClientHTTP* Acquire(const BaseConfig& cfg, const URL& url, int timeout = -1, bool fresh = false);
+    /// Get SOAP client for url. Same rules as for Acquire() apply.
+    static ClientSOAP* AcquireSOAP(const BaseConfig& cfg, const URL& url, int timeout = -1, bool fresh = false);
+    /// Make HTTP request using pooled connection.
+    /** Request failed on previously used connection is repeated once on
+     *  new connection. Response is read completely and connection is
+     *  returned to pool before this method returns. Caller owns response. */
+    static MCC_Status Process(const BaseConfig& cfg, const URL& url, int timeout,
+                              const std::string& method, const std::string& path,
+                              PayloadRawInterface* request, HTTPClientInfo* info,
+                              PayloadRawInterface** response);
+    /// Return client to pool. Response obtained through this client
+    /// must be deleted before. Client with closed connection is destroyed.
+    static void Release(ClientHTTP* client);
+    /// Destroy client. To be used if connection is in unknown state.
+    static void Discard(ClientHTTP* client);
+    /// Set maximal number of connections per host and idle timeout in seconds.
+    static void SetLimits(unsigned int max_per_host, int idle_timeout);
+  };
+
+} // namespace Arc
+
+#endif // __ARC_CLIENTHTTPPOOL_H__
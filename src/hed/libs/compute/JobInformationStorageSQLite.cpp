@@ -67,15 +67,16 @@ namespace Arc {
     val = Arc::Time(Arc::unescape_chars(str, sql_escape_char,sql_escape_type));
   }
 
+  static int sqlite3_busy_wait(void* arg, int count) {
+    // Access to database is designed in such way that it should not block for long time.
+    // So it should be safe to simply wait for lock to be released without any timeout.
+    sqlite3_sleep((count < 10) ? 1 : 10);
+    return 1;
+  }
+
   int sqlite3_exec_nobusy(sqlite3* db, const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg) {
-    int err;
-    while((err = sqlite3_exec(db, sql, callback, arg, errmsg)) == SQLITE_BUSY) {
-      // Access to database is designed in such way that it should not block for long time.
-      // So it should be safe to simply wait for lock to be released without any timeout.
-      struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
-      (void)::nanosleep(&delay, NULL);
-    };
-    return err;
+    // Waiting for busy database is done by handler installed in JobDB
+    return sqlite3_exec(db, sql, callback, arg, errmsg);
   }
 
   #define JOBS_COLUMNS_OLD \
@@ -119,6 +120,7 @@ namespace Arc {
       tearDown();
       throw SQLiteException(IString("Unable to create data base (%s)", name).str(), err);
     }
+    (void)sqlite3_busy_handler(jobDB, &sqlite3_busy_wait, NULL);
 
     if(create) {
       err = sqlite3_exec_nobusy(jobDB, "CREATE TABLE IF NOT EXISTS jobs(" JOBS_COLUMNS ", UNIQUE(id))", NULL, NULL, NULL);   
@@ -267,6 +269,9 @@ namespace Arc {
     
     try {
       JobDB db(name, true);
+      // All changes are written at once. Transaction is rolled back
+      // when database is closed without commit.
+      (void)sqlite3_exec_nobusy(db.handle(), "BEGIN IMMEDIATE", NULL, NULL, NULL);
       // Identify jobs to remove
       std::list<std::string> prunedIds;
       ListJobsCallbackArg prunedArg(prunedIds);
@@ -379,6 +384,13 @@ namespace Arc {
         }
         if(new_job) newJobs.push_back(&(*it));
       }
+      int err = sqlite3_exec_nobusy(db.handle(), "COMMIT", NULL, NULL, NULL);
+      if(err != SQLITE_OK) {
+        logger.msg(VERBOSE, "Unable to write records into job database (%s)", name);
+        logErrorMessage(err);
+        newJobs.clear();
+        return false;
+      }
     } catch (const SQLiteException& e) {
       return false;
     }
@@ -634,6 +646,7 @@ namespace Arc {
 
     try {
       JobDB db(name, true);
+      (void)sqlite3_exec_nobusy(db.handle(), "BEGIN IMMEDIATE", NULL, NULL, NULL);
       for (std::list<std::string>::const_iterator it = jobids.begin();
            it != jobids.end(); ++it) {
         std::string sqlcmd = "DELETE FROM jobs WHERE (id = '"+sql_escape(*it)+"')";
@@ -642,6 +655,9 @@ namespace Arc {
         } else if(sqlite3_changes(db.handle()) < 1) {
         }
       }
+      if(sqlite3_exec_nobusy(db.handle(), "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        return false;
+      }
     } catch (const SQLiteException& e) {
       return false;
     }
@@ -5,18 +5,48 @@
 #endif
 
 #include <cstdlib>
+#include <sys/mman.h>
 
 #include <arc/CheckSum.h>
 #include <arc/data/DataBuffer.h>
 
 namespace Arc {
 
+  // Buffers of at least this size are aligned so that kernel can back
+  // them with huge pages.
+  static const unsigned int huge_page_size = 2 * 1024 * 1024;
+
+  // Alignment needed for O_DIRECT on most filesystems
+  static const unsigned int page_align = 4096;
+
+  // Shortest interval over which transfer rate is measured
+  static const unsigned int adapt_min_interval = 100;
+
+  char* DataBuffer::buf_alloc(unsigned int size) {
+    if (size >= huge_page_size) {
+      void *start = NULL;
+      if (posix_memalign(&start, huge_page_size, size) != 0) return NULL;
+#ifdef MADV_HUGEPAGE
+      madvise(start, size, MADV_HUGEPAGE);
+#endif
+      return (char*)start;
+    }
+    if (size >= page_align) {
+      // Aligned buffers can be used for direct I/O
+      void *start = NULL;
+      if (posix_memalign(&start, page_align, size) != 0) return NULL;
+      return (char*)start;
+    }
+    return (char*)malloc(size);
+  }
+
   bool DataBuffer::set(CheckSum *cksum, unsigned int size, int blocks) {
     lock.lock();
     if (blocks < 0) {
       lock.unlock();
       return false;
     }
+    sum_thread_stop();
     if (bufs != NULL) {
       for (int i = 0; i < bufs_n; i++) {
         if (bufs[i].start) free(bufs[i].start);
@@ -27,6 +57,9 @@ namespace Arc {
       set_counter++;
       cond.broadcast(); /* make all waiting loops to exit */
     }
+    adapt_bytes = 0;
+    adapt_rate = 0;
+    adapt_start.assign_current_time();
     if ((size == 0) || (blocks == 0)) {
       lock.unlock();
       return true;
@@ -41,6 +74,8 @@ namespace Arc {
       bufs[i].start = NULL;
       bufs[i].taken_for_read = false;
       bufs[i].taken_for_write = false;
+      bufs[i].taken_for_sum = false;
+      bufs[i].written = false;
       bufs[i].size = size;
       bufs[i].used = 0;
       bufs[i].offset = 0;
@@ -49,6 +84,9 @@ namespace Arc {
     checksums.clear();
     checksums.push_back(checksum_desc(cksum));
     if (cksum) cksum->start();
+    if (sum_async) {
+      sum_running = CreateThreadFunction(&sum_thread_func, this, &sum_thread_count);
+    }
     lock.unlock();
     return true;
   }
@@ -70,7 +108,14 @@ namespace Arc {
         }
       }
     }
-    if (eof_read_flag && cs.ready) cs.sum->end();
+    if (sum_running) {
+      // Data which was already released can't be added later
+      cs.dropped = !cs.ready;
+      if (eof_read_flag) {
+        cs.sum->end();
+        cs.ended = true;
+      }
+    } else if (eof_read_flag && cs.ready) cs.sum->end();
     checksums.push_back(cs);
     int res = checksums.size() - 1;
     lock.unlock();
@@ -86,6 +131,12 @@ namespace Arc {
     error_read_flag = false;
     error_write_flag = false;
     error_transfer_flag = false;
+    cond_waiting = 0;
+    sum_async = false;
+    sum_stop = false;
+    sum_running = false;
+    bufs_max = 0;
+    adapt_window = 0;
     set(NULL, size, blocks);
     eof_pos = 0;
   }
@@ -100,6 +151,12 @@ namespace Arc {
     error_read_flag = false;
     error_write_flag = false;
     error_transfer_flag = false;
+    cond_waiting = 0;
+    sum_async = false;
+    sum_stop = false;
+    sum_running = false;
+    bufs_max = 0;
+    adapt_window = 0;
     set(cksum, size, blocks);
     eof_pos = 0;
   }
@@ -130,19 +187,35 @@ namespace Arc {
 
   void DataBuffer::eof_read(bool eof_) {
     lock.lock();
-    if (eof_) {
+    if (eof_ && !sum_running) {
       for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
            itCheckSum != checksums.end(); itCheckSum++) {
         if (itCheckSum->sum) itCheckSum->sum->end();
       }
     }
     eof_read_flag = eof_;
+    if (sum_running) sum_cond.signal();
     cond.broadcast();
     lock.unlock();
   }
 
   void DataBuffer::eof_write(bool eof_) {
     lock.lock();
+    if (eof_ && sum_running) {
+      // Checksums must be complete when transfer is seen as finished
+      for (;;) {
+        if (!eof_read_flag || !sum_running) break;
+        bool pending = false;
+        for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+             itCheckSum != checksums.end(); itCheckSum++) {
+          if (itCheckSum->sum && !itCheckSum->ended) pending = true;
+        }
+        if (!pending) break;
+        cond_waiting++;
+        cond.wait(lock);
+        cond_waiting--;
+      }
+    }
     eof_write_flag = eof_;
     cond.broadcast();
     lock.unlock();
@@ -157,11 +230,14 @@ namespace Arc {
     // error_read_flag=error_;
     if (error_) {
       if (!(error_write_flag || error_transfer_flag)) error_read_flag = true;
-      for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
-           itCheckSum != checksums.end(); itCheckSum++) {
-        if (itCheckSum->sum) itCheckSum->sum->end();
+      if (!sum_running) {
+        for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+             itCheckSum != checksums.end(); itCheckSum++) {
+          if (itCheckSum->sum) itCheckSum->sum->end();
+        }
       }
       eof_read_flag = true;
+      if (sum_running) sum_cond.signal();
     } else {
       error_read_flag = false;
     }
@@ -186,7 +262,9 @@ namespace Arc {
     lock.lock();
     for (;;) {
       if (eof_read_flag) break;
+      cond_waiting++;
       cond.wait(lock);
+      cond_waiting--;
     }
     lock.unlock();
     return true;
@@ -197,7 +275,9 @@ namespace Arc {
     for (;;) {
       if (eof_read_flag) break;
       if (error_read_flag) break;
+      cond_waiting++;
       cond.wait(lock);
+      cond_waiting--;
     }
     lock.unlock();
     return true;
@@ -207,7 +287,9 @@ namespace Arc {
     lock.lock();
     for (;;) {
       if (eof_write_flag) break;
+      cond_waiting++;
       cond.wait(lock);
+      cond_waiting--;
     }
     lock.unlock();
     return true;
@@ -218,7 +300,9 @@ namespace Arc {
     for (;;) {
       if (eof_write_flag) break;
       if (error_write_flag) break;
+      cond_waiting++;
       cond.wait(lock);
+      cond_waiting--;
     }
     lock.unlock();
     return true;
@@ -228,7 +312,9 @@ namespace Arc {
     lock.lock();
     for (;;) {
       if (eof_read_flag && eof_write_flag) break;
+      cond_waiting++;
       cond.wait(lock);
+      cond_waiting--;
     }
     lock.unlock();
     return true;
@@ -263,7 +349,9 @@ namespace Arc {
       Glib::TimeVal stime;
       stime.assign_current_time();
       // Using timeout to workaround lost signal
+      cond_waiting++;
       err = cond.timed_wait(lock, stime + t);
+      cond_waiting--;
     }
     return true;
   }
@@ -297,17 +385,21 @@ namespace Arc {
         if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
             (bufs[i].used == 0)) {
           if (bufs[i].start == NULL) {
-            bufs[i].start = (char*)malloc(bufs[i].size);
+            bufs[i].start = buf_alloc(bufs[i].size);
             if (bufs[i].start == NULL) continue;
           }
           handle = i;
           bufs[i].taken_for_read = true;
           length = bufs[i].size;
-          cond.broadcast();
+          cond_signal();
           lock.unlock();
           return true;
         }
       }
+      /* more buffers may be allowed if transfer is fast enough */
+      if (adapt_grow()) continue;
+      /* data kept for checksums may be blocking all buffers */
+      if (sum_running) sum_drop();
       /* suitable block not found - wait for changes or quit */
       if (eof_write_flag) { /* writing side quited, no need to wait */
         lock.unlock();
@@ -363,6 +455,13 @@ namespace Arc {
     bufs[handle].offset = offset;
     if ((offset + length) > eof_pos)
       eof_pos = offset + length;
+    if (sum_running) {
+      /* checksum is computed by own thread */
+      sum_cond.signal();
+      cond_signal();
+      lock.unlock();
+      return true;
+    }
     /* checksum on the fly */
     for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
          itCheckSum != checksums.end(); itCheckSum++) {
@@ -381,7 +480,7 @@ namespace Arc {
         }
       }
     }
-    cond.broadcast();
+    cond_signal();
     lock.unlock();
     return true;
   }
@@ -392,7 +491,7 @@ namespace Arc {
     lock.lock();
     for (int i = 0; i < bufs_n; i++) {
       if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-          (bufs[i].used != 0)) {
+          (!bufs[i].written) && (bufs[i].used != 0)) {
         lock.unlock();
         return true;
       }
@@ -422,7 +521,7 @@ namespace Arc {
       for (int i = 0; i < bufs_n; i++) {
         if (bufs[i].taken_for_read) have_for_read = true;
         if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-            (bufs[i].used != 0)) {
+            (!bufs[i].written) && (bufs[i].used != 0)) {
           if (bufs[i].offset < min_offset) {
             min_offset = bufs[i].offset;
             handle = i;
@@ -432,6 +531,8 @@ namespace Arc {
       }
       if (handle != -1) {
         bool keep_buffers = false;
+        /* checksum thread keeps buffers itself */
+        if (!sum_running)
         for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
              itCheckSum != checksums.end(); itCheckSum++) {
           if ((!itCheckSum->ready) && (bufs[handle].offset >= itCheckSum->offset)) {
@@ -459,7 +560,7 @@ namespace Arc {
         bufs[handle].taken_for_write = true;
         length = bufs[handle].used;
         offset = bufs[handle].offset;
-        cond.broadcast();
+        cond_signal();
         lock.unlock();
         return true;
       }
@@ -525,10 +626,27 @@ namespace Arc {
           (!(eof_read_flag && eof_write_flag))) {
         error_transfer_flag = true;
     }
+    if (adapt_window) {
+      adapt_bytes += bufs[handle].used;
+      Glib::TimeVal now;
+      now.assign_current_time();
+      now.subtract(adapt_start);
+      if (now.as_double() * 1000 >= adapt_min_interval) {
+        adapt_rate = adapt_bytes / now.as_double();
+        adapt_bytes = 0;
+        adapt_start.add(now);
+      }
+    }
     bufs[handle].taken_for_write = false;
-    bufs[handle].used = 0;
-    bufs[handle].offset = 0;
-    cond.broadcast();
+    if (sum_running && (bufs[handle].taken_for_sum || sum_needed(handle))) {
+      /* checksum thread will release buffer */
+      bufs[handle].written = true;
+      sum_cond.signal();
+    } else {
+      bufs[handle].used = 0;
+      bufs[handle].offset = 0;
+    }
+    cond_signal();
     lock.unlock();
     return true;
   }
@@ -548,11 +666,168 @@ namespace Arc {
       return false;
     }
     bufs[handle].taken_for_write = false;
-    cond.broadcast();
+    cond_signal();
     lock.unlock();
     return true;
   }
 
+  void DataBuffer::set_adaptive(int max_blocks, unsigned int window) {
+    lock.lock();
+    bufs_max = max_blocks;
+    adapt_window = window;
+    lock.unlock();
+  }
+
+  bool DataBuffer::adapt_grow() {
+    if ((bufs == NULL) || (bufs_n >= bufs_max) || (adapt_window == 0)) return false;
+    if ((adapt_rate * adapt_window / 1000) <= ((double)bufs_n * bufs[0].size)) return false;
+    /* handles are indices, so existing buffers stay valid after realloc */
+    buf_desc *new_bufs = (buf_desc*)realloc(bufs, sizeof(buf_desc) * (bufs_n + 1));
+    if (new_bufs == NULL) return false;
+    bufs = new_bufs;
+    bufs[bufs_n] = bufs[0];
+    bufs[bufs_n].start = NULL;
+    bufs[bufs_n].taken_for_read = false;
+    bufs[bufs_n].taken_for_write = false;
+    bufs[bufs_n].taken_for_sum = false;
+    bufs[bufs_n].written = false;
+    bufs[bufs_n].used = 0;
+    bufs[bufs_n].offset = 0;
+    bufs_n++;
+    return true;
+  }
+
+  void DataBuffer::set_async_checksum(bool v) {
+    lock.lock();
+    sum_async = v;
+    if (!v) {
+      sum_thread_stop();
+    } else if (!sum_running) {
+      sum_stop = false;
+      sum_running = CreateThreadFunction(&sum_thread_func, this, &sum_thread_count);
+    }
+    lock.unlock();
+  }
+
+  void DataBuffer::sum_thread_stop() {
+    if (!sum_running) return;
+    sum_stop = true;
+    sum_cond.signal();
+    lock.unlock();
+    sum_thread_count.wait();
+    lock.lock();
+    sum_running = false;
+    sum_stop = false;
+    /* release whatever was kept for checksums */
+    for (int i = 0; i < bufs_n; i++) {
+      if (bufs[i].written) {
+        bufs[i].written = false;
+        bufs[i].used = 0;
+        bufs[i].offset = 0;
+      }
+    }
+    cond.broadcast();
+  }
+
+  bool DataBuffer::sum_needed(int handle) const {
+    for (std::list<checksum_desc>::const_iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (itCheckSum->sum && !itCheckSum->dropped && !itCheckSum->ended &&
+          (itCheckSum->offset <= bufs[handle].offset)) return true;
+    }
+    return false;
+  }
+
+  void DataBuffer::sum_drop() {
+    /* buffer being filled may contain missing data */
+    for (int i = 0; i < bufs_n; i++) {
+      if (bufs[i].taken_for_read || bufs[i].taken_for_sum) return;
+      if ((bufs[i].used == 0) || !bufs[i].written) return;
+    }
+    /* all buffers are kept for checksums but none can be processed */
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (!itCheckSum->sum || itCheckSum->dropped) continue;
+      bool found = false;
+      for (int i = 0; i < bufs_n; i++) {
+        if (bufs[i].offset == itCheckSum->offset) found = true;
+      }
+      if (!found) {
+        itCheckSum->dropped = true;
+        itCheckSum->ready = false;
+      }
+    }
+    for (int i = 0; i < bufs_n; i++) {
+      if (!sum_needed(i)) {
+        bufs[i].written = false;
+        bufs[i].used = 0;
+        bufs[i].offset = 0;
+      }
+    }
+  }
+
+  void DataBuffer::sum_thread_func(void *arg) {
+    ((DataBuffer*)arg)->sum_thread();
+  }
+
+  void DataBuffer::sum_thread() {
+    lock.lock();
+    while (!sum_stop) {
+      bool progress = false;
+      for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+           itCheckSum != checksums.end(); itCheckSum++) {
+        if (!itCheckSum->sum || itCheckSum->dropped || itCheckSum->ended) continue;
+        for (int i = 0; i < bufs_n && !sum_stop; i++) {
+          if ((bufs[i].used != 0) && (!bufs[i].taken_for_read) &&
+              (bufs[i].offset == itCheckSum->offset)) {
+            /* buffer can't be reused while taken_for_sum is set */
+            bufs[i].taken_for_sum = true;
+            char *start = bufs[i].start;
+            unsigned int used = bufs[i].used;
+            lock.unlock();
+            itCheckSum->sum->add(start, used);
+            lock.lock();
+            bufs[i].taken_for_sum = false;
+            itCheckSum->offset += used;
+            progress = true;
+            i = -1;
+          }
+        }
+      }
+      if (sum_stop) break;
+      for (int i = 0; i < bufs_n; i++) {
+        if (bufs[i].written && !bufs[i].taken_for_sum && !sum_needed(i)) {
+          bufs[i].written = false;
+          bufs[i].used = 0;
+          bufs[i].offset = 0;
+          progress = true;
+        }
+      }
+      if (eof_read_flag) {
+        for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+             itCheckSum != checksums.end(); itCheckSum++) {
+          if (!itCheckSum->sum || itCheckSum->ended) continue;
+          bool more = false;
+          if (!itCheckSum->dropped) {
+            for (int i = 0; i < bufs_n; i++) {
+              if ((bufs[i].used != 0) && (bufs[i].offset == itCheckSum->offset)) more = true;
+            }
+          }
+          if (more) continue;
+          itCheckSum->sum->end();
+          itCheckSum->ended = true;
+          progress = true;
+        }
+      }
+      if (progress) {
+        cond_signal();
+        continue;
+      }
+      sum_cond.wait(lock);
+    }
+    lock.unlock();
+  }
+
   char* DataBuffer::operator[](int block) {
     lock.lock();
     if ((block < 0) || (block >= bufs_n)) {
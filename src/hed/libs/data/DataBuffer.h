@@ -23,6 +23,8 @@ namespace Arc {
     /// general purpose mutex and condition used to achieve thread safety
     Glib::Mutex lock;
     Glib::Cond cond;
+    /// number of threads waiting on cond, signal is only needed if non-zero
+    int cond_waiting;
     /// internal struct to describe status of every buffer
     typedef struct {
       /// buffer address in memory
@@ -31,6 +33,10 @@ namespace Arc {
       bool taken_for_read;
       /// true if taken by application for emptying
       bool taken_for_write;
+      /// true if checksum thread is processing content
+      bool taken_for_sum;
+      /// true if emptied by application but content still needed for checksum
+      bool written;
       /// size of buffer
       unsigned int size;
       /// amount of information stored
@@ -57,19 +63,61 @@ namespace Arc {
     bool error_transfer_flag;
     /// wait for any change of buffers' status
     bool cond_wait();
+    /// wake up threads waiting for change of buffers' status
+    void cond_signal() {
+      if (cond_waiting > 0) cond.broadcast();
+    }
     /// internal class with pointer to object to compute checksum
     class checksum_desc {
      public:
       checksum_desc(CheckSum *sum)
         : sum(sum),
           offset(0),
-          ready(true) {}
+          ready(true),
+          dropped(false),
+          ended(false) {}
       CheckSum *sum;
       unsigned long long int offset;
       bool ready;
+      /// checksum can't be computed because data was lost
+      bool dropped;
+      /// end() was called for sum
+      bool ended;
     };
     /// checksums to be computed in this buffer
     std::list<checksum_desc> checksums;
+    /// compute checksums in separate thread
+    bool sum_async;
+    /// checksum thread was asked to exit
+    bool sum_stop;
+    /// checksum thread is running
+    bool sum_running;
+    /// used to wake up checksum thread
+    Glib::Cond sum_cond;
+    /// used to wait for checksum thread to exit
+    SimpleCounter sum_thread_count;
+    /// checksum thread
+    static void sum_thread_func(void* arg);
+    void sum_thread();
+    /// stop checksum thread, must be called with lock held
+    void sum_thread_stop();
+    /// true if content of buffer is still needed by checksums
+    bool sum_needed(int handle) const;
+    /// drop checksums which can't progress and release buffers kept for them
+    void sum_drop();
+    /// maximal number of buffers when number adapts to transfer rate
+    int bufs_max;
+    /// time in ms of data to keep in buffers when number adapts to transfer rate
+    unsigned int adapt_window;
+    /// data written since adapt_start
+    unsigned long long int adapt_bytes;
+    Glib::TimeVal adapt_start;
+    /// measured transfer rate in bytes per second
+    double adapt_rate;
+    /// add one more buffer if measured transfer rate needs it
+    bool adapt_grow();
+    /// allocate memory for one buffer
+    static char* buf_alloc(unsigned int size);
 
   public:
     /// This object controls transfer speed
@@ -104,6 +152,26 @@ namespace Arc {
      */
     bool set(CheckSum *cksum = NULL, unsigned int size = 1048576,
              int blocks = 3);
+    /// Let number of buffers grow with measured transfer rate.
+    /**
+     * When no free buffer is available for reading into and buffers can't
+     * hold \a window milliseconds of data at the measured rate, a new buffer
+     * is added instead of waiting. Buffers are never removed until set() is
+     * called again.
+     * \param max_blocks maximal number of buffers. If it is not larger than
+     * current number of buffers the number stays fixed.
+     * \param window time in milliseconds
+     */
+    void set_adaptive(int max_blocks, unsigned int window = 100);
+    /// Compute checksums in a separate thread.
+    /**
+     * By default checksums are computed in is_read() while object is
+     * locked. If enabled checksums are computed by a dedicated thread and
+     * buffers are not reused until their content was added to checksums.
+     * eof_write(true) waits for checksums to be completed. Must be set
+     * before transfer starts.
+     */
+    void set_async_checksum(bool v);
     /// Add a checksum object which will compute checksum of buffer.
     /**
      * \param cksum object which will compute checksum. Should not be
@@ -776,16 +776,18 @@ namespace Arc {
           logger.msg(INFO, "Using internal transfer method of %s", source_url.str());
           URL dest_url(cacheable ? chdest.GetURL() : destination.GetURL());
           DataStatus datares = source_url.Transfer(dest_url, true, show_progress ? transfer_cb : NULL);
-          if (!datares.Passed()) {
+          if (datares == DataStatus::UnimplementedError) {
+            // SupportsTransfer was too optimistic, e.g. file plugin
+            // copies internally only to other local files
+            logger.msg(INFO, "Internal transfer method is not supported for %s", source_url.str());
+          } else if (!datares.Passed()) {
             if (source.NextLocation()) {
               logger.msg(VERBOSE, "(Re)Trying next source");
               continue;
             }
             if (cacheable)
               cache.StopAndDelete(canonic_url);
-            // Check if SupportsTransfer was too optimistic
-            if (datares != DataStatus::UnimplementedError) return datares;
-              logger.msg(INFO, "Internal transfer method is not supported for %s", source_url.str());
+            return datares;
           } else {
             try_another_transfer = false;
           }
@@ -795,14 +797,15 @@ namespace Arc {
         if (destination.SupportsTransfer()) {
           logger.msg(INFO, "Using internal transfer method of %s", destination.str());
           DataStatus datares = destination.Transfer(source_url.GetURL(), false, show_progress ? transfer_cb : NULL);
-          if (!datares.Passed()) {
+          if (datares == DataStatus::UnimplementedError) {
+            // SupportsTransfer was too optimistic
+            logger.msg(INFO, "Internal transfer method is not supported for %s", destination.str());
+          } else if (!datares.Passed()) {
             if (source.NextLocation()) {
               logger.msg(VERBOSE, "(Re)Trying next source");
               continue;
             }
-            // Check if SupportsTransfer was too optimistic
-            if (datares != DataStatus::UnimplementedError) return datares;
-            logger.msg(INFO, "Internal transfer method is not supported for %s", destination.str());
+            return datares;
           } else {
             try_another_transfer = false;
           }
@@ -3,6 +3,8 @@
 #endif
 
 #include <cstdlib>
+#include <ctime>
+#include <cstring>
 #include <unistd.h>
 
 // NOTE: On Solaris errno is not working properly if cerrno is included first
@@ -13,6 +15,9 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #define ErrNo errno
 
 #include <arc/message/PayloadStream.h>
@@ -67,7 +72,7 @@ namespace ArcMCCTCP {
 using namespace Arc;
 
 
-MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false) {
+MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false),epoll_(-1),workers_(0),stopping_(false),expired_(0) {
     for(int i = 0;;++i) {
         struct addrinfo hint;
         struct addrinfo *info = NULL;
@@ -208,6 +213,34 @@ MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,
         logger.msg(INFO, "Setting connections limit to %i, connections over limit will be %s",max_executers_,max_executers_drop_?istring("dropped"):istring("put on hold"));
       };
     };
+    if((*cfg)["Threads"]) {
+      std::string v = (*cfg)["Threads"];
+      int threads = atoi(v.c_str());
+      if(threads > 0) {
+#ifdef HAVE_SYS_EPOLL_H
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        if(epoll_ == -1) {
+          logger.msg(WARNING, "Failed to create epoll set, every connection will get dedicated thread: %s", StrError(errno));
+        } else {
+          for(int n = 0; n < threads; ++n) {
+            ++workers_;
+            if(!CreateThreadFunction(&worker,this)) {
+              --workers_;
+              logger.msg(ERROR, "Failed to start thread for serving connections");
+              break;
+            };
+          };
+          if(workers_ > 0) {
+            logger.msg(INFO, "Serving connections with %i threads", workers_);
+          } else {
+            ::close(epoll_); epoll_ = -1;
+          };
+        };
+#else
+        logger.msg(WARNING, "Pool of threads is not supported on this platform, every connection will get dedicated thread");
+#endif
+      };
+    };
     if(!CreateThreadFunction(&listener,this)) {
         logger.msg(ERROR, "Failed to start thread for listening");
         for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
@@ -224,6 +257,10 @@ MCC_TCP_Service::~MCC_TCP_Service(void) {
     for(std::list<mcc_tcp_exec_t>::iterator e = executers_.begin();e != executers_.end();++e) {
         ::shutdown(e->handle,2);
     };
+    stopping_ = true;
+    for(std::set<mcc_tcp_conn_t*>::iterator c = connections_.begin();c != connections_.end();++c) {
+        ::shutdown((*c)->handle,2);
+    };
     if(!valid_) {
         for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) { };
     };
@@ -234,6 +271,16 @@ MCC_TCP_Service::~MCC_TCP_Service(void) {
     while(handles_.size() > 0) {
         lock_.unlock(); sleep(1); lock_.lock();
     };
+    // Pool threads leave parked connections behind
+    while(workers_ > 0) {
+        lock_.unlock(); sleep(1); lock_.lock();
+    };
+    for(std::set<mcc_tcp_conn_t*>::iterator c = connections_.begin();c != connections_.end();++c) {
+        ::close((*c)->handle);
+        delete *c;
+    };
+    connections_.clear();
+    if(epoll_ != -1) ::close(epoll_);
     lock_.unlock();
 }
 
@@ -297,7 +344,7 @@ void MCC_TCP_Service::listener(void* arg) {
                     bool rejected = false;
                     bool first_time = true;
                     while((it.max_executers_ > 0) &&
-                          (it.executers_.size() >= (size_t) it.max_executers_)) {
+                          ((it.executers_.size() + it.connections_.size()) >= (size_t) it.max_executers_)) {
                         if(it.max_executers_drop_) {
                             logger.msg(WARNING, "Too many connections - dropping new one");
                             ::shutdown(h,2);
@@ -315,7 +362,11 @@ void MCC_TCP_Service::listener(void* arg) {
                         };
                     };
                     if(!rejected) {
-                      mcc_tcp_exec_t t(&it,h,i->timeout,i->no_delay);
+                      if(it.epoll_ != -1) {
+                        it.park(h,i->timeout,i->no_delay);
+                      } else {
+                        mcc_tcp_exec_t t(&it,h,i->timeout,i->no_delay);
+                      };
                     };
                 };
             };
@@ -471,96 +522,95 @@ static bool get_host_port(struct sockaddr_storage *addr, std::string &host, std:
     return true;
 }
 
-void MCC_TCP_Service::executer(void* arg) {
-    MCC_TCP_Service& it = *(((mcc_tcp_exec_t*)arg)->obj);
-    int s = ((mcc_tcp_exec_t*)arg)->handle;
-    int no_delay = ((mcc_tcp_exec_t*)arg)->no_delay;
-    int timeout = ((mcc_tcp_exec_t*)arg)->timeout;
-    std::string host_attr,port_attr;
-    std::string remotehost_attr,remoteport_attr;
-    std::string endpoint_attr;
+MCC_TCP_Service::mcc_tcp_conn_t::mcc_tcp_conn_t(int h,int t,bool nd):
+      handle(h),timeout(t),parked(true),last_used(time(NULL)),stream(h,t,logger) {
     // Extract useful attributes
-    {
-        struct sockaddr_storage addr;
-        socklen_t addrlen;
-        addrlen=sizeof(addr);
-        if(getsockname(s, (struct sockaddr*)(&addr), &addrlen) == 0) {
-            if (get_host_port(&addr, host_attr, port_attr) == true) {
-                endpoint_attr = "://"+host_attr+":"+port_attr;
-            }
-        }
-        if(getpeername(s, (struct sockaddr*)&addr, &addrlen) == 0) {
-            get_host_port(&addr, remotehost_attr, remoteport_attr);
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    addrlen=sizeof(addr);
+    if(getsockname(h, (struct sockaddr*)(&addr), &addrlen) == 0) {
+        if (get_host_port(&addr, host_attr, port_attr) == true) {
+            endpoint_attr = "://"+host_attr+":"+port_attr;
         }
-        // SESSIONID
-    };
+    }
+    if(getpeername(h, (struct sockaddr*)&addr, &addrlen) == 0) {
+        get_host_port(&addr, remotehost_attr, remoteport_attr);
+    }
+    // SESSIONID
+    stream.NoDelay(nd);
+}
 
-    // Creating stream payload
-    PayloadTCPSocket stream(s, timeout, logger);
-    stream.NoDelay(no_delay);
-    MessageContext context;
-    MessageAuthContext auth_context;
-    for(;;) {
-        // TODO: Check state of socket here and leave immediately if not connected anymore.
-        // Preparing Message objects for chain
-        MessageAttributes attributes_in;
-        MessageAttributes attributes_out;
-        MessageAuth auth_in;
-        MessageAuth auth_out;
-        Message nextinmsg;
-        Message nextoutmsg;
-        nextinmsg.Payload(&stream);
-        nextinmsg.Attributes(&attributes_in);
-        nextinmsg.Attributes()->set("TCP:HOST",host_attr);
-        nextinmsg.Attributes()->set("TCP:PORT",port_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEHOST",remotehost_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEPORT",remoteport_attr);
-        nextinmsg.Attributes()->set("TCP:ENDPOINT",endpoint_attr);
-        nextinmsg.Attributes()->set("ENDPOINT",endpoint_attr);
-        nextinmsg.Context(&context);
-        nextinmsg.Auth(&auth_in);
-        TCPSecAttr* tattr = new TCPSecAttr(remotehost_attr, remoteport_attr, host_attr, port_attr);
-        nextinmsg.Auth()->set("TCP",tattr);
-        nextinmsg.AuthContext(&auth_context);
-        nextoutmsg.Attributes(&attributes_out);
-        nextoutmsg.Context(&context);
-        nextoutmsg.Auth(&auth_out);
-        nextoutmsg.AuthContext(&auth_context);
-        if(!it.ProcessSecHandlers(nextinmsg,"incoming")) break;
-        // Call next MCC
-        MCCInterface* next = it.Next();
-        if(!next) break;
-        logger.msg(VERBOSE, "next chain element called");
-        MCC_Status ret = next->process(nextinmsg,nextoutmsg);
-        if(!it.ProcessSecHandlers(nextoutmsg,"outgoing")) {
-          if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
-          break;
-        };
-        // If nextoutmsg contains some useful payload send it here.
-        // So far only buffer payload is supported
-        // Extracting payload
-        if(nextoutmsg.Payload()) {
-            PayloadRawInterface* outpayload = NULL;
-            try {
-                outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
-            } catch(std::exception& e) { };
-            if(!outpayload) {
-                logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
-            } else {
-                // Sending payload
-                for(int n=0;;++n) {
-                    char* buf = outpayload->Buffer(n);
-                    if(!buf) break;
-                    int bufsize = outpayload->BufferSize(n);
-                    if(!(stream.Put(buf,bufsize))) {
-                        logger.msg(ERROR, "Failed to send content of buffer");
-                        break;
-                    };
+bool MCC_TCP_Service::serve(mcc_tcp_conn_t& conn) {
+    // TODO: Check state of socket here and leave immediately if not connected anymore.
+    // Preparing Message objects for chain
+    MessageAttributes attributes_in;
+    MessageAttributes attributes_out;
+    MessageAuth auth_in;
+    MessageAuth auth_out;
+    Message nextinmsg;
+    Message nextoutmsg;
+    nextinmsg.Payload(&conn.stream);
+    nextinmsg.Attributes(&attributes_in);
+    nextinmsg.Attributes()->set("TCP:HOST",conn.host_attr);
+    nextinmsg.Attributes()->set("TCP:PORT",conn.port_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEHOST",conn.remotehost_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEPORT",conn.remoteport_attr);
+    nextinmsg.Attributes()->set("TCP:ENDPOINT",conn.endpoint_attr);
+    nextinmsg.Attributes()->set("ENDPOINT",conn.endpoint_attr);
+    nextinmsg.Context(&conn.context);
+    nextinmsg.Auth(&auth_in);
+    TCPSecAttr* tattr = new TCPSecAttr(conn.remotehost_attr, conn.remoteport_attr, conn.host_attr, conn.port_attr);
+    nextinmsg.Auth()->set("TCP",tattr);
+    nextinmsg.AuthContext(&conn.auth_context);
+    nextoutmsg.Attributes(&attributes_out);
+    nextoutmsg.Context(&conn.context);
+    nextoutmsg.Auth(&auth_out);
+    nextoutmsg.AuthContext(&conn.auth_context);
+    if(!ProcessSecHandlers(nextinmsg,"incoming")) return false;
+    // Call next MCC
+    MCCInterface* next = Next();
+    if(!next) return false;
+    logger.msg(VERBOSE, "next chain element called");
+    MCC_Status ret = next->process(nextinmsg,nextoutmsg);
+    if(!ProcessSecHandlers(nextoutmsg,"outgoing")) {
+      if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
+      return false;
+    };
+    // If nextoutmsg contains some useful payload send it here.
+    // So far only buffer payload is supported
+    // Extracting payload
+    if(nextoutmsg.Payload()) {
+        PayloadRawInterface* outpayload = NULL;
+        try {
+            outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
+        } catch(std::exception& e) { };
+        if(!outpayload) {
+            logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
+        } else {
+            // Sending payload
+            for(int n=0;;++n) {
+                char* buf = outpayload->Buffer(n);
+                if(!buf) break;
+                int bufsize = outpayload->BufferSize(n);
+                if(!(conn.stream.Put(buf,bufsize))) {
+                    logger.msg(ERROR, "Failed to send content of buffer");
+                    break;
                 };
             };
-            delete nextoutmsg.Payload();
         };
-        if(!ret) break;
+        delete nextoutmsg.Payload();
+    };
+    return (bool)ret;
+}
+
+void MCC_TCP_Service::executer(void* arg) {
+    MCC_TCP_Service& it = *(((mcc_tcp_exec_t*)arg)->obj);
+    int s = ((mcc_tcp_exec_t*)arg)->handle;
+    int no_delay = ((mcc_tcp_exec_t*)arg)->no_delay;
+    int timeout = ((mcc_tcp_exec_t*)arg)->timeout;
+    {
+        mcc_tcp_conn_t conn(s,timeout,no_delay);
+        while(it.serve(conn)) { };
     };
     it.lock_.lock();
     for(std::list<mcc_tcp_exec_t>::iterator e = it.executers_.begin();e != it.executers_.end();++e) {
@@ -579,6 +629,102 @@ void MCC_TCP_Service::executer(void* arg) {
     return;
 }
 
+bool MCC_TCP_Service::park(int h,int timeout,bool no_delay) {
+    // lists are locked externally
+#ifdef HAVE_SYS_EPOLL_H
+    mcc_tcp_conn_t* conn = new mcc_tcp_conn_t(h,timeout,no_delay);
+    struct epoll_event ev;
+    memset(&ev,0,sizeof(ev));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = conn;
+    connections_.insert(conn);
+    if(epoll_ctl(epoll_,EPOLL_CTL_ADD,h,&ev) == 0) return true;
+    logger.msg(ERROR, "Failed to add connection to epoll set: %s", StrError(errno));
+    connections_.erase(conn);
+    delete conn;
+#endif
+    ::shutdown(h,2);
+    ::close(h);
+    return false;
+}
+
+void MCC_TCP_Service::expire(void) {
+    // lists are locked externally
+    time_t now = time(NULL);
+    if(now == expired_) return;
+    expired_ = now;
+    // Shut down connection is reported as readable and is
+    // closed by thread picking it up.
+    for(std::set<mcc_tcp_conn_t*>::iterator c = connections_.begin();c != connections_.end();++c) {
+        if((*c)->parked && ((*c)->timeout > 0) && ((now - (*c)->last_used) > (*c)->timeout)) {
+            ::shutdown((*c)->handle,2);
+        };
+    };
+}
+
+void MCC_TCP_Service::worker(void* arg) {
+    MCC_TCP_Service& it = *((MCC_TCP_Service*)arg);
+#ifdef HAVE_SYS_EPOLL_H
+    for(;;) {
+        // Each idle thread takes one connection at a time so that
+        // ready connections are never queued behind busy thread.
+        struct epoll_event ev;
+        int n = epoll_wait(it.epoll_,&ev,1,1000);
+        if((n < 0) && (ErrNo != EINTR)) {
+            logger.msg(ERROR, "Failed while waiting for requests on connections: %s", StrError(errno));
+            break;
+        };
+        it.lock_.lock();
+        it.expire();
+        if(it.stopping_) { it.lock_.unlock(); break; };
+        if(n != 1) { it.lock_.unlock(); continue; };
+        mcc_tcp_conn_t* conn = (mcc_tcp_conn_t*)(ev.data.ptr);
+        conn->parked = false;
+        it.lock_.unlock();
+        bool keep = it.serve(*conn);
+        it.lock_.lock();
+        if(keep && !it.stopping_) {
+            // Wait for next request without occupying thread
+            conn->parked = true;
+            conn->last_used = time(NULL);
+            memset(&ev,0,sizeof(ev));
+            ev.events = EPOLLIN | EPOLLONESHOT;
+            ev.data.ptr = conn;
+            if(epoll_ctl(it.epoll_,EPOLL_CTL_MOD,conn->handle,&ev) == 0) {
+                it.lock_.unlock();
+                continue;
+            };
+            logger.msg(ERROR, "Failed to add connection to epoll set: %s", StrError(errno));
+        };
+        it.connections_.erase(conn);
+        ::shutdown(conn->handle,2);
+        ::close(conn->handle);
+        it.cond_.signal();
+        it.lock_.unlock();
+        delete conn;
+    };
+    it.lock_.lock();
+    if((--it.workers_ == 0) && !it.stopping_) {
+        // Nobody is left to pick up parked connections. Close them and
+        // let new connections be served by dedicated threads.
+        logger.msg(ERROR, "No threads left for serving connections, every connection will get dedicated thread");
+        for(std::set<mcc_tcp_conn_t*>::iterator c = it.connections_.begin();c != it.connections_.end();++c) {
+            ::shutdown((*c)->handle,2);
+            ::close((*c)->handle);
+            delete *c;
+        };
+        it.connections_.clear();
+        ::close(it.epoll_); it.epoll_ = -1;
+        it.cond_.signal();
+    };
+    it.lock_.unlock();
+#else
+    it.lock_.lock();
+    --it.workers_;
+    it.lock_.unlock();
+#endif
+}
+
 MCC_Status MCC_TCP_Service::process(Message&,Message&) {
   // Service is not really processing messages because there
   // are no lower lelel MCCs in chain.
@@ -1,6 +1,8 @@
 #ifndef __ARC_MCCTCP_H__
 #define __ARC_MCCTCP_H__
 
+#include <set>
+
 #include <arc/message/MCC.h>
 #include <arc/message/PayloadStream.h>
 #include "PayloadTCPSocket.h"
@@ -38,6 +40,11 @@ using namespace Arc;
    TCP:REMOTEPORT - TCP port from which connection is accepted
    TCP:ENDPOINT - URL-like representation of remote connection - ://HOST:PORT
    ENDPOINT - global attribute equal to TCP:ENDPOINT
+  If Threads element is configured and epoll is available connections
+ are not given dedicated threads. Instead connection waiting for next
+ request is parked in epoll set and fixed number of threads pick up
+ connections which have data available, process one request and park
+ connection again.
 */
 class MCC_TCP_Service: public MCC_TCP
 {
@@ -52,6 +59,23 @@ class MCC_TCP_Service: public MCC_TCP
                 mcc_tcp_exec_t(MCC_TCP_Service* o,int h,int t, bool nd = false);
                 operator bool(void) { return (handle != -1); };
         };
+        /** State of connection kept between requests */
+        class mcc_tcp_conn_t {
+            public:
+                int handle;
+                int timeout;
+                bool parked; /** waiting in epoll set for next request */
+                time_t last_used;
+                PayloadTCPSocket stream;
+                MessageContext context;
+                MessageAuthContext auth_context;
+                std::string host_attr;
+                std::string port_attr;
+                std::string remotehost_attr;
+                std::string remoteport_attr;
+                std::string endpoint_attr;
+                mcc_tcp_conn_t(int h,int t,bool nd);
+        };
         class mcc_tcp_handle_t {
             public:
                 int handle;
@@ -63,13 +87,26 @@ class MCC_TCP_Service: public MCC_TCP
         bool valid_;
         std::list<mcc_tcp_handle_t> handles_; /** listening sockets */
         std::list<mcc_tcp_exec_t> executers_; /** active connections and associated threads */
+        std::set<mcc_tcp_conn_t*> connections_; /** connections served by pool of threads */
         int max_executers_;
         bool max_executers_drop_;
+        int epoll_; /** epoll set of parked connections, -1 if pool is not used */
+        int workers_; /** number of running pool threads */
+        bool stopping_;
+        time_t expired_; /** last time idle parked connections were checked */
         /* pthread_t listen_th_; ** thread listening for incoming connections */
         Glib::Mutex lock_; /** lock for safe operations in internal lists */
         Glib::Cond cond_;
         static void listener(void *); /** executing function for listening thread */
         static void executer(void *); /** executing function for connection thread */
+        static void worker(void *); /** executing function for pool thread */
+        /** Process one request coming through connection. Returns false if
+            connection must be closed. */
+        bool serve(mcc_tcp_conn_t& conn);
+        /** Accept connection h using pool of threads */
+        bool park(int h,int timeout,bool no_delay);
+        /** Shut down parked connections idle longer than their timeout */
+        void expire(void);
     public:
         MCC_TCP_Service(Config *cfg, PluginArgument* parg);
         virtual ~MCC_TCP_Service(void);
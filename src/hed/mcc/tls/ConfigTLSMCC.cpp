@@ -5,9 +5,11 @@
 #include <glibmm/miscutils.h>
 #include <openssl/err.h>
 
+#include <arc/StringConv.h>
 #include <arc/credential/Credential.h>
 
 #include "PayloadTLSStream.h"
+#include "TrustStoreTLSMCC.h"
 
 #include "ConfigTLSMCC.h"
 
@@ -15,6 +17,18 @@ namespace ArcMCCTLS {
 
 using namespace Arc;
 
+#if (OPENSSL_VERSION_NUMBER < 0x10101000L)
+// SSL_CTX_set1_cert_store appeared in OpenSSL 1.1.1
+static void SSL_CTX_set1_cert_store(SSL_CTX* sslctx, X509_STORE* store) {
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+  CRYPTO_add(&store->references,1,CRYPTO_LOCK_X509_STORE);
+#else
+  X509_STORE_up_ref(store);
+#endif
+  SSL_CTX_set_cert_store(sslctx,store);
+}
+#endif
+
 static void config_VOMS_add(XMLNode cfg,std::vector<std::string>& vomscert_trust_dn) {
   XMLNode nd = cfg["VOMSCertTrustDNChain"];
   for(;(bool)nd;++nd) {
@@ -56,6 +70,10 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
     // Client is using safest setup by default
     cipher_list_ = "TLSv1:SSLv3:!eNULL:!aNULL";
     hostname_ = (std::string)(cfg["Hostname"]);
+    // Services on same host may have different sessions
+    peer_ = hostname_;
+    std::string port = (std::string)(cfg["Port"]);
+    if(!peer_.empty() && !port.empty()) peer_ += ":" + port;
     XMLNode protocol_node = cfg["Protocol"];
     while((bool)protocol_node) {
       std::string protocol = (std::string)protocol_node;
@@ -136,7 +154,12 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
 
 bool ConfigTLSMCC::Set(SSL_CTX* sslctx) {
   if((!ca_file_.empty()) || (!ca_dir_.empty())) {
-    if(!SSL_CTX_load_verify_locations(sslctx, ca_file_.empty()?NULL:ca_file_.c_str(), ca_dir_.empty()?NULL:ca_dir_.c_str())) {
+    // Preferably use store shared by all contexts. Otherwise let
+    // OpenSSL load CA certificates from files when needed.
+    ThreadedPointer<TrustStoreTLSMCC> trust = TrustStoreTLSMCC::Get(ca_file_, ca_dir_);
+    if(trust) {
+      SSL_CTX_set1_cert_store(sslctx, trust->Store());
+    } else if(!SSL_CTX_load_verify_locations(sslctx, ca_file_.empty()?NULL:ca_file_.c_str(), ca_dir_.empty()?NULL:ca_dir_.c_str())) {
       failure_ = "Can not assign CA location - "+(ca_dir_.empty()?ca_file_:ca_dir_)+"\n";
       failure_ += HandleError();
       return false;
@@ -223,6 +246,23 @@ bool ConfigTLSMCC::Set(SSL_CTX* sslctx) {
   return true;
 }
 
+std::string ConfigTLSMCC::ContextKey(bool client) const {
+  std::string key = client?"client":"server";
+  key += "\n" + Arc::tostring((int)handshake_);
+  key += "\n" + ca_file_;
+  key += "\n" + ca_dir_;
+  key += "\n" + cert_file_;
+  key += "\n" + key_file_;
+  key += "\n" + credential_;
+  key += "\n" + cipher_list_;
+  key += "\n" + protocols_;
+  key += client_authn_?"\nauthn":"\n";
+  key += globus_policy_?"\npolicy":"\n";
+  key += globus_gsi_?"\ngsi":"\n";
+  key += globusio_gsi_?"\ngsiio":"\n";
+  return key;
+}
+
 std::string ConfigTLSMCC::HandleError(int code) {
   std::string errstr;
   unsigned long e = (code==SSL_ERROR_NONE)?ERR_get_error():code;
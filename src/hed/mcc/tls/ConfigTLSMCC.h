@@ -44,6 +44,7 @@ class ConfigTLSMCC {
   std::vector<std::string> vomscert_trust_dn_;
   std::string cipher_list_;
   std::string hostname_;
+  std::string peer_;
   std::string protocols_;
   std::string protocol_;
   std::string failure_;
@@ -61,6 +62,8 @@ class ConfigTLSMCC {
   bool GlobusIOGSI(void) const { return globusio_gsi_; };
   const std::vector<std::string>& VOMSCertTrustDN(void) { return vomscert_trust_dn_; };
   bool Set(SSL_CTX* sslctx);
+  // Description of all parameters which affect SSL context
+  std::string ContextKey(bool client) const;
   bool IfClientAuthn(void) const { return client_authn_; };
   bool IfTLSHandshake(void) const { return handshake_ == tls_handshake; };
   bool IfSSLv3Handshake(void) const { return handshake_ == ssl3_handshake; };
@@ -74,6 +77,8 @@ class ConfigTLSMCC {
   bool IfFailOnVOMSParsing(void) const { return (voms_processing_ == noerrors_voms) || (voms_processing_ == strict_voms); };
   bool IfFailOnVOMSInvalid(void) const { return (voms_processing_ == noerrors_voms); };
   const std::string& Hostname() const { return hostname_; };
+  // Identifies service for client session resumption - host:port
+  const std::string& Peer() const { return peer_; };
   const std::string& Failure(void) { return failure_; };
   static std::string HandleError(int code = SSL_ERROR_NONE);
   static void ClearError(void);
@@ -0,0 +1,245 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <list>
+
+#include <openssl/evp.h>
+
+#include "TrustStoreTLSMCC.h"
+#include "ContextTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+static int SSL_CTX_up_ref(SSL_CTX* ctx) {
+  return (CRYPTO_add(&ctx->references,1,CRYPTO_LOCK_SSL_CTX) > 1) ? 1 : 0;
+}
+#endif
+
+// How often files used by context are checked for changes
+#define CONTEXT_CHECK_PERIOD (10)
+// Contexts are renewed at least that often to pick up files
+// changed in place, like CRLs in CA directory if TrustStoreTLSMCC
+// could not be used
+#define CONTEXT_MAX_AGE (3600)
+// Contexts not used for that long are removed from cache
+#define CONTEXT_MAX_IDLE (600)
+// Lifetime of sessions. Verification of peer is not repeated
+// for resumed session, hence this value should not be too big.
+#define SESSION_TIMEOUT (600)
+// Maximal number of client sessions kept per context
+#define SESSION_MAX_NUM (1000)
+// How often handshake counters are reported
+#define STATISTICS_PERIOD (600)
+
+class ContextFileStamp {
+ public:
+  std::string path;
+  bool exists;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  ContextFileStamp(const std::string& p): path(p), exists(false), dev(0), ino(0), size(0), mtime(0) {
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0) return;
+    exists = true; dev = st.st_dev; ino = st.st_ino; size = st.st_size; mtime = st.st_mtime;
+  };
+  bool operator==(const ContextFileStamp& s) const {
+    return (path == s.path) && (exists == s.exists) && (dev == s.dev) &&
+           (ino == s.ino) && (size == s.size) && (mtime == s.mtime);
+  };
+};
+
+class ContextEntry {
+ public:
+  SSL_CTX* sslctx;
+  std::list<ContextFileStamp> files;
+  time_t created;
+  time_t checked;
+  time_t used;
+  ContextEntry(void): sslctx(NULL), created(0), checked(0), used(0) {};
+};
+
+static Glib::Mutex contexts_lock;
+static std::map<std::string,ContextEntry> contexts;
+static time_t contexts_swept = 0;
+static int ex_data_index = -1;
+
+static Glib::Mutex statistics_lock;
+static unsigned long long handshakes_server = 0;
+static unsigned long long handshakes_server_resumed = 0;
+static unsigned long long handshakes_client = 0;
+static unsigned long long handshakes_client_resumed = 0;
+static unsigned long long handshakes_failed = 0;
+static time_t statistics_reported = 0;
+
+static void context_files(const ConfigTLSMCC& config, std::list<ContextFileStamp>& files) {
+  if(!config.CertFile().empty()) files.push_back(ContextFileStamp(config.CertFile()));
+  if((!config.KeyFile().empty()) && (config.KeyFile() != config.CertFile())) files.push_back(ContextFileStamp(config.KeyFile()));
+}
+
+// Context must be renewed if new trust store was built meanwhile
+static bool context_trust_changed(const ConfigTLSMCC& config, SSL_CTX* sslctx) {
+  if(config.CAFile().empty() && config.CADir().empty()) return false;
+  ThreadedPointer<TrustStoreTLSMCC> trust = TrustStoreTLSMCC::Get(config.CAFile(), config.CADir());
+  if(!trust) return false;
+  return (trust->Store() != SSL_CTX_get_cert_store(sslctx));
+}
+
+static void context_drop(std::map<std::string,ContextEntry>::iterator entry) {
+  // Must be called with contexts_lock held. Connections still using
+  // context keep it alive till they are destroyed.
+  if(entry->second.sslctx) SSL_CTX_free(entry->second.sslctx);
+  contexts.erase(entry);
+}
+
+ContextTLSMCC::ContextTLSMCC(void) {
+}
+
+ContextTLSMCC::~ContextTLSMCC(void) {
+  for(std::map<std::string,SSL_SESSION*>::iterator s = sessions_.begin(); s != sessions_.end(); ++s) {
+    SSL_SESSION_free(s->second);
+  };
+}
+
+void ContextTLSMCC::Free(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp) {
+  if(ptr) delete (ContextTLSMCC*)ptr;
+}
+
+ContextTLSMCC* ContextTLSMCC::Get(SSL_CTX* sslctx) {
+  if((ex_data_index == -1) || (sslctx == NULL)) return NULL;
+  return (ContextTLSMCC*)SSL_CTX_get_ex_data(sslctx, ex_data_index);
+}
+
+std::string ContextTLSMCC::Key(const ConfigTLSMCC& config, bool client) {
+  std::string description = config.ContextKey(client);
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int md_len = 0;
+  if(!EVP_Digest(description.c_str(), description.length(), md, &md_len, EVP_sha256(), NULL)) return description;
+  if(md_len > SSL_MAX_SID_CTX_LENGTH) md_len = SSL_MAX_SID_CTX_LENGTH;
+  return std::string((char const*)md, md_len);
+}
+
+SSL_CTX* ContextTLSMCC::Acquire(const std::string& key, const ConfigTLSMCC& config) {
+  Glib::Mutex::Lock lock(contexts_lock);
+  time_t now = ::time(NULL);
+  if((now - contexts_swept) >= CONTEXT_CHECK_PERIOD) {
+    contexts_swept = now;
+    for(std::map<std::string,ContextEntry>::iterator entry = contexts.begin(); entry != contexts.end();) {
+      std::map<std::string,ContextEntry>::iterator next = entry; ++next;
+      if((now - entry->second.used) >= CONTEXT_MAX_IDLE) context_drop(entry);
+      entry = next;
+    };
+  };
+  std::map<std::string,ContextEntry>::iterator entry = contexts.find(key);
+  if(entry == contexts.end()) return NULL;
+  if((now - entry->second.created) >= CONTEXT_MAX_AGE) {
+    context_drop(entry);
+    return NULL;
+  };
+  if((now - entry->second.checked) >= CONTEXT_CHECK_PERIOD) {
+    std::list<ContextFileStamp> files;
+    context_files(config, files);
+    if((files != entry->second.files) || context_trust_changed(config, entry->second.sslctx)) {
+      context_drop(entry);
+      return NULL;
+    };
+    entry->second.checked = now;
+  };
+  if(SSL_CTX_up_ref(entry->second.sslctx) != 1) return NULL;
+  entry->second.used = now;
+  return entry->second.sslctx;
+}
+
+void ContextTLSMCC::Put(const std::string& key, const ConfigTLSMCC& config, SSL_CTX* sslctx) {
+  if(!sslctx) return;
+  // Files are stamped after they were loaded. Modification happening
+  // in between is picked up at renewal.
+  std::list<ContextFileStamp> files;
+  context_files(config, files);
+  Glib::Mutex::Lock lock(contexts_lock);
+  if(ex_data_index == -1) {
+    ex_data_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, &Free);
+    if(ex_data_index == -1) return;
+  };
+  if(SSL_CTX_get_ex_data(sslctx, ex_data_index) == NULL) {
+    ContextTLSMCC* context = new ContextTLSMCC;
+    if(!SSL_CTX_set_ex_data(sslctx, ex_data_index, context)) {
+      delete context;
+      return;
+    };
+  };
+  if(SSL_CTX_up_ref(sslctx) != 1) return;
+  // Sessions must not outlive credentials for too long
+  SSL_CTX_set_timeout(sslctx, SESSION_TIMEOUT);
+  // Concurrent connection may have stored context meanwhile. Newer one wins.
+  std::map<std::string,ContextEntry>::iterator entry = contexts.find(key);
+  if(entry != contexts.end()) context_drop(entry);
+  ContextEntry& new_entry = contexts[key];
+  new_entry.sslctx = sslctx;
+  new_entry.files.swap(files);
+  new_entry.created = new_entry.checked = new_entry.used = ::time(NULL);
+}
+
+void ContextTLSMCC::RestoreSession(SSL* ssl, const std::string& peer) {
+  if(peer.empty()) return;
+  ContextTLSMCC* context = Get(SSL_get_SSL_CTX(ssl));
+  if(!context) return;
+  Glib::Mutex::Lock lock(context->lock_);
+  std::map<std::string,SSL_SESSION*>::iterator s = context->sessions_.find(peer);
+  if(s == context->sessions_.end()) return;
+  if((long)::time(NULL) >= (SSL_SESSION_get_time(s->second) + SSL_SESSION_get_timeout(s->second))) {
+    SSL_SESSION_free(s->second);
+    context->sessions_.erase(s);
+    return;
+  };
+  SSL_set_session(ssl, s->second);
+}
+
+bool ContextTLSMCC::StoreSession(SSL* ssl, const std::string& peer, SSL_SESSION* session) {
+  if(peer.empty()) return false;
+  ContextTLSMCC* context = Get(SSL_get_SSL_CTX(ssl));
+  if(!context) return false;
+  Glib::Mutex::Lock lock(context->lock_);
+  std::map<std::string,SSL_SESSION*>::iterator s = context->sessions_.find(peer);
+  if(s != context->sessions_.end()) {
+    SSL_SESSION_free(s->second);
+    s->second = session;
+    return true;
+  };
+  if(context->sessions_.size() >= SESSION_MAX_NUM) {
+    // Just start over. Peers in use will store their sessions again soon.
+    for(s = context->sessions_.begin(); s != context->sessions_.end(); ++s) SSL_SESSION_free(s->second);
+    context->sessions_.clear();
+  };
+  context->sessions_[peer] = session;
+  return true;
+}
+
+void ContextTLSMCC::Handshake(SSL* ssl, bool client, bool success, Logger& logger) {
+  Glib::Mutex::Lock lock(statistics_lock);
+  if(!success) {
+    ++handshakes_failed;
+  } else if(client) {
+    ++handshakes_client;
+    if(ssl && SSL_session_reused(ssl)) ++handshakes_client_resumed;
+  } else {
+    ++handshakes_server;
+    if(ssl && SSL_session_reused(ssl)) ++handshakes_server_resumed;
+  };
+  time_t now = ::time(NULL);
+  if(statistics_reported == 0) statistics_reported = now;
+  if((now - statistics_reported) < STATISTICS_PERIOD) return;
+  statistics_reported = now;
+  logger.msg(INFO, "TLS handshakes: %llu accepted (%llu resumed), %llu initiated (%llu resumed), %llu failed",
+             handshakes_server, handshakes_server_resumed,
+             handshakes_client, handshakes_client_resumed, handshakes_failed);
+}
+
+} // namespace ArcMCCTLS
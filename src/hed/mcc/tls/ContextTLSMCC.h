@@ -0,0 +1,55 @@
+#ifndef __ARC_CONTEXTTLSMCC_H__
+#define __ARC_CONTEXTTLSMCC_H__
+
+#include <string>
+#include <map>
+
+#include <openssl/ssl.h>
+
+#include <arc/Thread.h>
+#include <arc/Logger.h>
+
+#include "ConfigTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+using namespace Arc;
+
+// Process-wide cache of SSL contexts. Connections with same TLS
+// configuration share one context, so CA locations and credentials
+// are loaded only once and sessions can be resumed. Context is
+// replaced by new one when files it was loaded from change.
+// Object of this class is attached to every cached context and holds
+// client sessions established through it. It is destroyed together
+// with context.
+class ContextTLSMCC {
+ private:
+  Glib::Mutex lock_;
+  // Client sessions identified by peer (host:port)
+  std::map<std::string,SSL_SESSION*> sessions_;
+  ContextTLSMCC(void);
+  ~ContextTLSMCC(void);
+  static ContextTLSMCC* Get(SSL_CTX* sslctx);
+  static void Free(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp);
+ public:
+  // Identifier of configuration. It is also suitable as session id context.
+  static std::string Key(const ConfigTLSMCC& config, bool client);
+  // Returns cached context with additional reference which must be
+  // released by SSL_CTX_free(). NULL is returned if there is no context
+  // for this configuration or it became outdated.
+  static SSL_CTX* Acquire(const std::string& key, const ConfigTLSMCC& config);
+  // Stores newly created context in cache and prepares it for being
+  // shared. Cache obtains own reference.
+  static void Put(const std::string& key, const ConfigTLSMCC& config, SSL_CTX* sslctx);
+  // Assigns previously stored client session for peer to connection
+  static void RestoreSession(SSL* ssl, const std::string& peer);
+  // Stores client session for peer. Returns true if reference to
+  // session is taken over.
+  static bool StoreSession(SSL* ssl, const std::string& peer, SSL_SESSION* session);
+  // Counts handshakes and reports counters from time to time.
+  static void Handshake(SSL* ssl, bool client, bool success, Logger& logger);
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_CONTEXTTLSMCC_H__ */
@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <list>
 
@@ -243,5 +244,10 @@ bool GlobusSigningPolicy::open(const X509_NAME* issuer_subject,const std::string
   return true;
 }
 
+bool GlobusSigningPolicy::assign(const std::string& policy) {
+  close();
+  stream_ = new std::istringstream(policy);
+  return true;
 }
 
+}
@@ -11,6 +11,7 @@ class GlobusSigningPolicy {
     GlobusSigningPolicy(): stream_(NULL) { };
     ~GlobusSigningPolicy() { close(); };
     bool open(const X509_NAME* issuer_subject,const std::string& ca_path);
+    bool assign(const std::string& policy);
     void close() { delete stream_; stream_ = NULL; };
     bool match(const X509_NAME* issuer_subject,const X509_NAME* subject);
   private:
@@ -589,10 +589,19 @@ Arc::Logger ArcMCCTLS::MCC_TLS::logger(Arc::Logger::getRootLogger(), "MCC.TLS");
 ArcMCCTLS::MCC_TLS::MCC_TLS(Arc::Config& cfg,bool client,PluginArgument* parg) : Arc::MCC(&cfg,parg), config_(cfg,client) {
 }
 
+// SSL contexts and trust stores are shared by whole process and
+// refer to code of this module. Hence it must stay in memory.
+static void make_persistent(Arc::PluginArgument* arg) {
+    Arc::PluginsFactory* factory = arg->get_factory();
+    Glib::Module* module = arg->get_module();
+    if(factory && module) factory->makePersistent(module);
+}
+
 static Arc::Plugin* get_mcc_service(Arc::PluginArgument* arg) {
     Arc::MCCPluginArgument* mccarg =
             arg?dynamic_cast<Arc::MCCPluginArgument*>(arg):NULL;
     if(!mccarg) return NULL;
+    make_persistent(mccarg);
     return new ArcMCCTLS::MCC_TLS_Service(*(Arc::Config*)(*mccarg),mccarg);
 }
 
@@ -600,6 +609,7 @@ static Arc::Plugin* get_mcc_client(Arc::PluginArgument* arg) {
     Arc::MCCPluginArgument* mccarg =
             arg?dynamic_cast<Arc::MCCPluginArgument*>(arg):NULL;
     if(!mccarg) return NULL;
+    make_persistent(mccarg);
     return new ArcMCCTLS::MCC_TLS_Client(*(Arc::Config*)(*mccarg),mccarg);
 }
 
@@ -6,6 +6,8 @@
 
 #include "GlobusSigningPolicy.h"
 
+#include "ContextTLSMCC.h"
+#include "TrustStoreTLSMCC.h"
 #include "PayloadTLSMCC.h"
 #include <openssl/err.h>
 #include <glibmm/miscutils.h>
@@ -30,8 +32,8 @@ static X509_VERIFY_PARAM *SSL_CTX_get0_param(SSL_CTX *ctx) {
 }
 #endif
 
-static const char * ex_data_id = "ARC_MCC_Payload_TLS";
 int PayloadTLSMCC::ex_data_index_ = -1;
+static Glib::Mutex ex_data_lock;
 
 Time asn1_to_utctime(const ASN1_UTCTIME *s) {
   std::string t_str;
@@ -106,7 +108,16 @@ static int verify_callback(int ok,X509_STORE_CTX *sctx) {
              (X509_NAME_cmp(X509_get_issuer_name(cert),X509_get_subject_name(cert)) != 0)) {
             //std::cerr<<"+++ additional verification: check signing policy - is not proxy"<<std::endl;
             GlobusSigningPolicy globus_policy;
-            if(globus_policy.open(X509_get_issuer_name(cert),it->Config().CADir())) {
+            // Policies are normally kept in memory together with CA certificates
+            bool policy_open = false;
+            ThreadedPointer<TrustStoreTLSMCC> trust = TrustStoreTLSMCC::Get(it->Config().CAFile(),it->Config().CADir());
+            if(trust) {
+              std::string policy;
+              if(trust->SigningPolicy(X509_get_issuer_name(cert),policy)) policy_open = globus_policy.assign(policy);
+            } else {
+              policy_open = globus_policy.open(X509_get_issuer_name(cert),it->Config().CADir());
+            };
+            if(policy_open) {
               //std::cerr<<"+++ additional verification: policy is open"<<std::endl;
               if(!globus_policy.match(X509_get_issuer_name(cert),X509_get_subject_name(cert))) {
                 it->SetFailure(std::string("Certificate ")+subject_name+" failed Globus signing policy");
@@ -148,38 +159,58 @@ static int no_passphrase_callback(char*, int, int, void*) {
    return -1;
 }
 
+// Called by OpenSSL on client side when session suitable for
+// resumption is obtained from server.
+static int new_session_callback(SSL* ssl, SSL_SESSION* session) {
+   PayloadTLSMCC* it = PayloadTLSMCC::RetrieveInstance(ssl);
+   if(!it) return 0;
+   return ContextTLSMCC::StoreSession(ssl, it->Config().Peer(), session) ? 1 : 0;
+}
+
+// Verification is not repeated for resumed session. But credentials,
+// especially proxies, may expire while session is still valid.
+static bool peer_expired(SSL* ssl) {
+   X509* cert = SSL_get_peer_certificate(ssl);
+   if(!cert) return false;
+   bool expired = (X509_cmp_current_time(X509_getm_notAfter(cert)) < 0);
+   X509_free(cert);
+   return expired;
+}
+
 bool PayloadTLSMCC::StoreInstance(void) {
    if(ex_data_index_ == -1) {
-      // In case of race condition we will have 2 indices assigned - harmless?
-      ex_data_index_=OpenSSLAppDataIndex(ex_data_id);
+      Glib::Mutex::Lock lock(ex_data_lock);
+      if(ex_data_index_ == -1) ex_data_index_=SSL_get_ex_new_index(0,NULL,NULL,NULL,NULL);
    };
    if(ex_data_index_ == -1) {
       logger_.msg(WARNING,"Failed to store application data");
       return false;
    };
-   if(!sslctx_) return false;
-   SSL_CTX_set_ex_data(sslctx_,ex_data_index_,this);
+   // Context is shared by many connections, hence link is
+   // stored in SSL object.
+   if(!ssl_) return false;
+   SSL_set_ex_data(ssl_,ex_data_index_,this);
    return true;
 }
 
 bool PayloadTLSMCC::ClearInstance(void) {
-  if((ex_data_index_ != -1) && sslctx_) {
-    SSL_CTX_set_ex_data(sslctx_,ex_data_index_,NULL);
+  if((ex_data_index_ != -1) && ssl_) {
+    SSL_set_ex_data(ssl_,ex_data_index_,NULL);
     return true;
   };
   return false;
 }
 
+PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(SSL* ssl) {
+  if((ex_data_index_ == -1) || (ssl == NULL)) return NULL;
+  return (PayloadTLSMCC*)SSL_get_ex_data(ssl,ex_data_index_);
+}
+
 PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   PayloadTLSMCC* it = NULL;
   if(ex_data_index_ != -1) {
     SSL* ssl = (SSL*)X509_STORE_CTX_get_ex_data(container,SSL_get_ex_data_X509_STORE_CTX_idx());
-    if(ssl != NULL) {
-      SSL_CTX* ssl_ctx = SSL_get_SSL_CTX(ssl);
-      if(ssl_ctx != NULL) {
-        it = (PayloadTLSMCC*)SSL_CTX_get_ex_data(ssl_ctx,ex_data_index_);
-      }
-    };
+    it = RetrieveInstance(ssl);
   };
   if(it == NULL) {
     Logger::getRootLogger().msg(WARNING,"Failed to retrieve application data from OpenSSL");
@@ -187,59 +218,49 @@ PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   return it;
 }
 
-
-PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger):
-    PayloadTLSStream(logger),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0) {
-   // Client mode
-   int err = SSL_ERROR_NONE;
-   char gsi_cmd[1] = { '0' };
-   master_=true;
-   // Creating BIO for communication through stream which it will
-   // extract from provided MCC
-   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
-   // Initialize the SSL Context object
+bool PayloadTLSMCC::CreateClientContext(void) {
    long ctx_options = 0;
 
-   if(cfg.IfSSLv3Handshake()) {
+   if(config_.IfSSLv3Handshake()) {
 #if defined HAVE_SSLV3_METHOD
      sslctx_=SSL_CTX_new(SSLv3_client_method());
 #elif defined HAVE_TLS_METHOD
      ctx_options |= SSL_OP_NO_SSLv3;
      sslctx_=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv1Handshake()) {
+   } else if(config_.IfTLSv1Handshake()) {
 #if defined HAVE_TLSV1_METHOD
      sslctx_=SSL_CTX_new(TLSv1_client_method());
 #elif defined HAVE_TLS_METHOD
      ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
      sslctx_=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv11Handshake()) {
+   } else if(config_.IfTLSv11Handshake()) {
 #if defined HAVE_TLSV1_1_METHOD
      sslctx_=SSL_CTX_new(TLSv1_1_client_method());
 #elif defined HAVE_TLS_METHOD
      ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1;
      sslctx_=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfTLSv12Handshake()) {
+   } else if(config_.IfTLSv12Handshake()) {
 #ifdef HAVE_TLSV1_2_METHOD
      sslctx_=SSL_CTX_new(TLSv1_2_client_method());
 #elif defined HAVE_TLS_METHOD
      ctx_options = SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1_1 | SSL_OP_NO_TLSv1;
      sslctx_=SSL_CTX_new(TLS_client_method());
 #endif
-   } else if(cfg.IfDTLSHandshake()) {
+   } else if(config_.IfDTLSHandshake()) {
 #if defined HAVE_DTLS_METHOD
      sslctx_=SSL_CTX_new(DTLS_client_method());
 #endif
-   } else if(cfg.IfDTLSv1Handshake()) {
+   } else if(config_.IfDTLSv1Handshake()) {
 #if defined HAVE_DTLSV1_METHOD
      sslctx_=SSL_CTX_new(DTLSv1_client_method());
 #elif defined HAVE_DTLS_METHOD
      sslctx_=SSL_CTX_new(DTLS_client_method());
      ctx_options |= SSL_OP_NO_DTLSv1_2;
 #endif
-   } else if(cfg.IfDTLSv12Handshake()) {
+   } else if(config_.IfDTLSv12Handshake()) {
 #if defined HAVE_DTLSV1_2_METHOD
      sslctx_=SSL_CTX_new(DTLSv1_2_client_method());
 #elif defined HAVE_DTLS_METHOD
@@ -254,34 +275,110 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
 #endif
    };
    if(sslctx_==NULL){
-      logger.msg(ERROR, "Can not create the SSL Context object");
-      goto error;
+      logger_.msg(ERROR, "Can not create the SSL Context object");
+      return false;
    };
    SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
+   // Sessions are kept by ContextTLSMCC per server
+   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+   SSL_CTX_sess_set_new_cb(sslctx_,&new_session_callback);
    if(!config_.Set(sslctx_)) {
       SetFailure(config_.Failure());
-      goto error;
+      return false;
    };
    SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &verify_callback);
 
    // Allow proxies, request CRL check
    if(SSL_CTX_get0_param(sslctx_) == NULL) {
-      logger.msg(ERROR,"Can't set OpenSSL verify flags");
-      goto error;
+      logger_.msg(ERROR,"Can't set OpenSSL verify flags");
+      return false;
    } else {
       X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
    };
-   StoreInstance();
-#ifdef SSL_OP_NO_TICKET
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL | SSL_OP_NO_TICKET;
+   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
+   SSL_CTX_set_options(sslctx_, ctx_options);
+
+   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
+   return true;
+}
+
+bool PayloadTLSMCC::CreateServerContext(const std::string& sid_ctx) {
+   long ctx_options = 0;
+   if(config_.IfTLSHandshake()) {
+#if defined HAVE_TLS_METHOD
+     sslctx_=SSL_CTX_new(TLS_server_method());
 #else
+     sslctx_=SSL_CTX_new(SSLv23_server_method());
+#endif
+   } else {
+#if defined HAVE_SSLV3_METHOD
+     sslctx_=SSL_CTX_new(SSLv3_server_method());
+#elif defined HAVE_TLS_METHOD
+     sslctx_=SSL_CTX_new(TLS_server_method());
+     ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
+#endif
+   };
+   if(sslctx_==NULL){
+      logger_.msg(ERROR, "Can not create the SSL Context object");
+      return false;
+   };
+   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
+   // Sessions are resumed from internal cache of shared context.
+   // Client's certificate chain is needed for processing proxies
+   // and only sessions kept in memory preserve it.
+   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_SERVER);
+   if(!SSL_CTX_set_session_id_context(sslctx_,(unsigned char const*)sid_ctx.c_str(),sid_ctx.length())) {
+      logger_.msg(ERROR,"Can't set OpenSSL session id context");
+      return false;
+   };
+   if(config_.IfClientAuthn()) {
+     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+   }
+   else {
+     //SSL_CTX_set_verify(sslctx_, SSL_VERIFY_NONE, NULL);
+     // Ask for client certificate but do not fail if not provided
+     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
+   }
+   if(!config_.Set(sslctx_)) {
+      SetFailure(config_.Failure());
+      return false;
+   }
+
+   // Allow proxies, request CRL check
+   if(SSL_CTX_get0_param(sslctx_) == NULL) {
+      logger_.msg(ERROR,"Can't set OpenSSL verify flags");
+      return false;
+   } else {
+      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
+   };
+
    ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
+#ifdef SSL_OP_NO_TICKET
+   // Stateless tickets would lose client's chain. With TLS 1.3
+   // this option makes tickets refer to internal cache instead.
+   ctx_options |= SSL_OP_NO_TICKET;
 #endif
    SSL_CTX_set_options(sslctx_, ctx_options);
-
    SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
-   /* Get DN from certificate, and put it into message's attribute */
+   return true;
+}
+
+PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger& logger):
+    PayloadTLSStream(logger),sslctx_(NULL),bio_(NULL),config_(cfg),flags_(0) {
+   // Client mode
+   int err = SSL_ERROR_NONE;
+   char gsi_cmd[1] = { '0' };
+   master_=true;
+   // Creating BIO for communication through stream which it will
+   // extract from provided MCC
+   BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(mcc):BIO_new_MCC(mcc));
+   // Obtain shared SSL Context object or create new one
+   std::string ctx_key = ContextTLSMCC::Key(config_,true);
+   sslctx_ = ContextTLSMCC::Acquire(ctx_key,config_);
+   if(!sslctx_) {
+      if(!CreateClientContext()) goto error;
+      ContextTLSMCC::Put(ctx_key,config_,sslctx_);
+   };
 
    // Creating SSL object for handling connection
    ssl_ = SSL_new(sslctx_);
@@ -289,6 +386,7 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       logger.msg(ERROR, "Can not create the SSL object");
       goto error;
    };
+   StoreInstance();
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -299,10 +397,12 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
          logger.msg(WARNING, "Faile to assign hostname extension");
       };
    };
+   ContextTLSMCC::RestoreSession(ssl_,cfg.Peer());
    SSL_set_bio(ssl_,bio,bio); bio=NULL;
    //SSL_set_connect_state(ssl_);
    if((err=SSL_connect(ssl_)) != 1) {
       err = SSL_get_error(ssl_,err);
+      ContextTLSMCC::Handshake(ssl_,true,false,logger);
       /* TODO: Print nice message when server side certificate has
        *       expired. Still to investigate if this case is only when
        *       server side certificate has expired.
@@ -313,7 +413,9 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       logger.msg(VERBOSE, "Failed to establish SSL connection");
       goto error;
    };
+   ContextTLSMCC::Handshake(ssl_,true,true,logger);
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(DEBUG, "Resumed SSL session");
    // if(SSL_in_init(ssl_)){
    //handle error
    // }
@@ -324,7 +426,7 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
    if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
@@ -336,60 +438,21 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
    master_=true;
    // Creating BIO for communication through provided stream
    BIO* bio = (bio_ = config_.GlobusIOGSI()?BIO_new_GSIMCC(stream):BIO_new_MCC(stream));
-   // Initialize the SSL Context object
-   long ctx_options = 0;
-   if(cfg.IfTLSHandshake()) {
-#if defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-#else
-     sslctx_=SSL_CTX_new(SSLv23_server_method());
-#endif
-   } else {
-#if defined HAVE_SSLV3_METHOD
-     sslctx_=SSL_CTX_new(SSLv3_server_method());
-#elif defined HAVE_TLS_METHOD
-     sslctx_=SSL_CTX_new(TLS_server_method());
-     ctx_options |= SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_2 | SSL_OP_NO_TLSv1_1;
-#endif
-   };
-   if(sslctx_==NULL){
-      logger.msg(ERROR, "Can not create the SSL Context object");
-      goto error;
-   };
-   SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
-   if(config_.IfClientAuthn()) {
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   else {
-     //SSL_CTX_set_verify(sslctx_, SSL_VERIFY_NONE, NULL);
-     // Ask for client certificate but do not fail if not provided
-     SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_CLIENT_ONCE, &verify_callback);
-   }
-   if(!config_.Set(sslctx_)) {
-      SetFailure(config_.Failure());
-      goto error;
-   }
-
-   // Allow proxies, request CRL check
-   if(SSL_CTX_get0_param(sslctx_) == NULL) {
-      logger.msg(ERROR,"Can't set OpenSSL verify flags");
-      goto error;
-   } else {
-      X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
+   // Obtain shared SSL Context object or create new one
+   std::string ctx_key = ContextTLSMCC::Key(config_,false);
+   sslctx_ = ContextTLSMCC::Acquire(ctx_key,config_);
+   if(!sslctx_) {
+      if(!CreateServerContext(ctx_key)) goto error;
+      ContextTLSMCC::Put(ctx_key,config_,sslctx_);
    };
 
-   StoreInstance();
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
-   SSL_CTX_set_options(sslctx_, ctx_options);
-   SSL_CTX_set_default_passwd_cb(sslctx_, no_passphrase_callback);
-
    // Creating SSL object for handling connection
    ssl_ = SSL_new(sslctx_);
    if (ssl_ == NULL){
       logger.msg(ERROR, "Can not create the SSL object");
       goto error;
    };
+   StoreInstance();
    //for(int n = 0;;++n) {
    //  const char * s = SSL_get_cipher_list(ssl_,n);
    //  if(!s) break;
@@ -399,10 +462,18 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
    //SSL_set_accept_state(ssl_);
    if((err=SSL_accept(ssl_)) != 1) {
       err = SSL_get_error(ssl_,err);
+      ContextTLSMCC::Handshake(ssl_,false,false,logger);
       logger.msg(ERROR, "Failed to accept SSL connection");
       goto error;
    };
+   if(SSL_session_reused(ssl_) && peer_expired(ssl_)) {
+      ContextTLSMCC::Handshake(ssl_,false,false,logger);
+      SetFailure("Peer certificate expired since SSL session was established");
+      goto error;
+   };
+   ContextTLSMCC::Handshake(ssl_,false,true,logger);
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(DEBUG, "Resumed SSL session");
    //handle error
    // if(SSL_in_init(ssl_)){
    //handle error
@@ -411,7 +482,7 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
 error:
    if (failure_) SetFailure(err); // Only set if not already set.
    if(bio) { BIO_free(bio); bio_=NULL; }
-   if(ssl_) { SSL_free(ssl_); ssl_=NULL; }
+   if(ssl_) { ClearInstance(); SSL_free(ssl_); ssl_=NULL; }
    if(sslctx_) { SSL_CTX_free(sslctx_); sslctx_=NULL; }
    return;
 }
@@ -431,7 +502,7 @@ PayloadTLSMCC::~PayloadTLSMCC(void) {
   // was called after this object was destroyed. Although
   // that may be misinterpretation it is probably safer
   // to detach code of this object from OpenSSL now by
-  // calling SSL_set_verify/SSL_CTX_set_verify and by
+  // calling SSL_set_verify and by
   // removing associated ex_data.
   ClearInstance();
   if (ssl_) {
@@ -462,8 +533,8 @@ PayloadTLSMCC::~PayloadTLSMCC(void) {
     SSL_free(ssl_);
     ssl_ = NULL;
   }
+  // Context is shared with other connections and must not be modified.
   if(sslctx_) {
-    SSL_CTX_set_verify(sslctx_,SSL_VERIFY_NONE,NULL);
     SSL_CTX_free(sslctx_);
     sslctx_ = NULL;
   }
@@ -21,7 +21,7 @@ class PayloadTLSMCC: public PayloadTLSStream {
  private:
   /** Specifies if this object owns internal SSL objects */
   bool master_;
-  /** SSL context */
+  /** SSL context. Shared with other connections through ContextTLSMCC. */
   SSL_CTX* sslctx_;
   BIO* bio_;
   static int ex_data_index_;
@@ -29,6 +29,8 @@ class PayloadTLSMCC: public PayloadTLSStream {
   ConfigTLSMCC config_;
   bool StoreInstance(void);
   bool ClearInstance(void);
+  bool CreateClientContext(void);
+  bool CreateServerContext(const std::string& sid_ctx);
   // Generic purpose bit flags
   unsigned long flags_;
  public:
@@ -47,6 +49,7 @@ class PayloadTLSMCC: public PayloadTLSStream {
   virtual ~PayloadTLSMCC(void);
   const ConfigTLSMCC& Config(void) { return config_; };
   static PayloadTLSMCC* RetrieveInstance(X509_STORE_CTX* container);
+  static PayloadTLSMCC* RetrieveInstance(SSL* ssl);
   unsigned long Flags(void) { return flags_; };
   void Flags(unsigned long flags) { flags_=flags; };
   void SetFailure(const std::string& err);
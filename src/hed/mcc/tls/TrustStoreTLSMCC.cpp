@@ -0,0 +1,225 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <list>
+
+#include <glibmm/fileutils.h>
+#include <openssl/err.h>
+#include <openssl/x509.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "TrustStoreTLSMCC.h"
+
+namespace ArcMCCTLS {
+
+using namespace Arc;
+
+// How often CA locations are checked for changes
+#define TRUST_CHECK_PERIOD (60)
+
+static Logger& logger = Logger::getRootLogger();
+
+static const char policy_suffix[] = "signing_policy";
+
+// Identifies content of file without reading it
+typedef std::map<std::string,std::string> TrustStamps;
+
+class TrustLocation {
+ public:
+  std::string ca_file;
+  std::string ca_dir;
+  ThreadedPointer<TrustStoreTLSMCC> trust;
+  TrustStamps stamps;
+};
+
+static Glib::Mutex trust_lock;
+static std::map<std::string,TrustLocation> locations;
+static bool refresh_started = false;
+
+static void file_stamp(const std::string& path, TrustStamps& stamps) {
+  struct stat st;
+  if(::stat(path.c_str(), &st) != 0) {
+    stamps[path] = "";
+    return;
+  };
+  stamps[path] = tostring(st.st_dev) + ":" + tostring(st.st_ino) + ":" +
+                 tostring(st.st_size) + ":" + tostring(st.st_mtime);
+}
+
+static void location_stamps(const std::string& ca_file, const std::string& ca_dir, TrustStamps& stamps) {
+  if(!ca_file.empty()) file_stamp(ca_file, stamps);
+  if(!ca_dir.empty()) {
+    file_stamp(ca_dir, stamps);
+    try {
+      Glib::Dir dir(ca_dir);
+      for(;;) {
+        std::string name = dir.read_name();
+        if(name.empty()) break;
+        file_stamp(ca_dir + G_DIR_SEPARATOR_S + name, stamps);
+      };
+    } catch(Glib::FileError& e) {
+    };
+  };
+}
+
+// Names of files in CA directory are <subject hash>.<suffix>
+static bool split_name(const std::string& name, std::string& hash, std::string& suffix) {
+  std::string::size_type p = name.find('.');
+  if(p != 8) return false;
+  hash = name.substr(0, p);
+  suffix = name.substr(p+1);
+  if(hash.find_first_not_of("0123456789abcdef") != std::string::npos) return false;
+  return !suffix.empty();
+}
+
+static bool is_number(const std::string& str) {
+  return (!str.empty()) && (str.find_first_not_of("0123456789") == std::string::npos);
+}
+
+static std::string subject_hash(const X509_NAME* subject) {
+  unsigned long hash = X509_NAME_hash((X509_NAME*)subject);
+  char hash_str[32];
+  snprintf(hash_str,sizeof(hash_str)-1,"%08lx",hash);
+  hash_str[sizeof(hash_str)-1]=0;
+  return hash_str;
+}
+
+TrustStoreTLSMCC::TrustStoreTLSMCC(void): store_(NULL) {
+}
+
+TrustStoreTLSMCC::~TrustStoreTLSMCC(void) {
+  // Contexts using store hold own references
+  if(store_) X509_STORE_free(store_);
+}
+
+TrustStoreTLSMCC* TrustStoreTLSMCC::Build(const std::string& ca_file, const std::string& ca_dir) {
+  X509_STORE* store = X509_STORE_new();
+  if(!store) return NULL;
+  X509_LOOKUP* lookup = X509_STORE_add_lookup(store, X509_LOOKUP_file());
+  if(!lookup) {
+    X509_STORE_free(store);
+    return NULL;
+  };
+  TrustStoreTLSMCC* trust = new TrustStoreTLSMCC;
+  trust->store_ = store;
+  if(!ca_file.empty()) {
+    if(X509_load_cert_crl_file(lookup, ca_file.c_str(), X509_FILETYPE_PEM) <= 0) {
+      logger.msg(ERROR, "Failed to load CA certificates from %s", ca_file);
+      ERR_clear_error();
+      delete trust;
+      return NULL;
+    };
+  };
+  unsigned int certs_num = 0;
+  unsigned int crls_num = 0;
+  if(!ca_dir.empty()) {
+    try {
+      Glib::Dir dir(ca_dir);
+      for(;;) {
+        std::string name = dir.read_name();
+        if(name.empty()) break;
+        std::string hash;
+        std::string suffix;
+        if(!split_name(name, hash, suffix)) continue;
+        std::string path = ca_dir + G_DIR_SEPARATOR_S + name;
+        if(suffix == policy_suffix) {
+          std::ifstream f(path.c_str());
+          if(!f) continue;
+          std::stringstream policy;
+          policy << f.rdbuf();
+          trust->policies_[hash] = policy.str();
+        } else if((suffix[0] == 'r') && is_number(suffix.substr(1))) {
+          if(X509_load_crl_file(lookup, path.c_str(), X509_FILETYPE_PEM) > 0) ++crls_num;
+        } else if(is_number(suffix)) {
+          if(X509_load_cert_file(lookup, path.c_str(), X509_FILETYPE_PEM) > 0) ++certs_num;
+        };
+        // Duplicates and broken files are not fatal
+        ERR_clear_error();
+      };
+    } catch(Glib::FileError& e) {
+      logger.msg(WARNING, "Failed to read CA directory %s", ca_dir);
+    };
+  };
+  logger.msg(VERBOSE, "Loaded %u CA certificates, %u CRLs and %u signing policies from %s",
+             certs_num, crls_num, (unsigned int)trust->policies_.size(), ca_dir.empty()?ca_file:ca_dir);
+  return trust;
+}
+
+ThreadedPointer<TrustStoreTLSMCC> TrustStoreTLSMCC::Get(const std::string& ca_file, const std::string& ca_dir) {
+  std::string key = ca_file + "\n" + ca_dir;
+  Glib::Mutex::Lock lock(trust_lock);
+  std::map<std::string,TrustLocation>::iterator l = locations.find(key);
+  if(l != locations.end()) return l->second.trust;
+  // First request for this location. Building under lock makes
+  // concurrent requests wait instead of loading same files.
+  TrustStamps stamps;
+  location_stamps(ca_file, ca_dir, stamps);
+  TrustStoreTLSMCC* trust = Build(ca_file, ca_dir);
+  if(!trust) return ThreadedPointer<TrustStoreTLSMCC>();
+  TrustLocation& location = locations[key];
+  location.ca_file = ca_file;
+  location.ca_dir = ca_dir;
+  location.trust = trust;
+  location.stamps.swap(stamps);
+  if(!refresh_started) {
+    refresh_started = CreateThreadFunction(&RefreshThread, NULL);
+    if(!refresh_started) logger.msg(WARNING, "Failed to start thread for refreshing CA certificates");
+  };
+  return location.trust;
+}
+
+void TrustStoreTLSMCC::RefreshThread(void* arg) {
+  for(;;) {
+    ::sleep(TRUST_CHECK_PERIOD);
+    std::list<std::string> keys;
+    {
+      Glib::Mutex::Lock lock(trust_lock);
+      for(std::map<std::string,TrustLocation>::iterator l = locations.begin(); l != locations.end(); ++l) {
+        keys.push_back(l->first);
+      };
+    };
+    for(std::list<std::string>::iterator key = keys.begin(); key != keys.end(); ++key) {
+      std::string ca_file;
+      std::string ca_dir;
+      TrustStamps old_stamps;
+      {
+        Glib::Mutex::Lock lock(trust_lock);
+        TrustLocation& location = locations[*key];
+        ca_file = location.ca_file;
+        ca_dir = location.ca_dir;
+        old_stamps = location.stamps;
+      };
+      TrustStamps stamps;
+      location_stamps(ca_file, ca_dir, stamps);
+      if(stamps == old_stamps) continue;
+      // Files are parsed without holding lock, so connections keep
+      // using previous instance meanwhile. If loading fails previous
+      // instance stays and loading is retried next time.
+      TrustStoreTLSMCC* trust = Build(ca_file, ca_dir);
+      if(!trust) continue;
+      logger.msg(INFO, "Reloaded CA certificates from %s", ca_dir.empty()?ca_file:ca_dir);
+      Glib::Mutex::Lock lock(trust_lock);
+      TrustLocation& location = locations[*key];
+      location.trust = trust;
+      location.stamps.swap(stamps);
+    };
+  };
+}
+
+bool TrustStoreTLSMCC::SigningPolicy(const X509_NAME* issuer_subject, std::string& policy) const {
+  std::map<std::string,std::string>::const_iterator p = policies_.find(subject_hash(issuer_subject));
+  if(p == policies_.end()) return false;
+  policy = p->second;
+  return true;
+}
+
+} // namespace ArcMCCTLS
@@ -0,0 +1,40 @@
+#ifndef __ARC_TRUSTSTORETLSMCC_H__
+#define __ARC_TRUSTSTORETLSMCC_H__
+
+#include <string>
+#include <map>
+
+#include <openssl/ssl.h>
+
+#include <arc/Thread.h>
+
+namespace ArcMCCTLS {
+
+// In-memory copy of trusted CA certificates, CRLs and Globus signing
+// policies. One instance per CA location is shared by all TLS contexts
+// of process. Files are parsed once and background thread builds new
+// instance when any of them changes. Instances are never modified after
+// being built, hence can be used without locking.
+class TrustStoreTLSMCC {
+ private:
+  X509_STORE* store_;
+  // Content of signing policy files indexed by CA subject hash
+  std::map<std::string,std::string> policies_;
+  TrustStoreTLSMCC(void);
+  TrustStoreTLSMCC(const TrustStoreTLSMCC&);
+  static TrustStoreTLSMCC* Build(const std::string& ca_file, const std::string& ca_dir);
+  static void RefreshThread(void* arg);
+ public:
+  ~TrustStoreTLSMCC(void);
+  // Returns current instance for CA location. Instance is built
+  // at first request. Returns NULL if CA location can't be loaded.
+  static Arc::ThreadedPointer<TrustStoreTLSMCC> Get(const std::string& ca_file, const std::string& ca_dir);
+  // Store suitable for SSL_CTX_set1_cert_store()
+  X509_STORE* Store(void) const { return store_; };
+  // Provides signing policy for CA with specified subject.
+  bool SigningPolicy(const X509_NAME* issuer_subject, std::string& policy) const;
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_TRUSTSTORETLSMCC_H__ */
@@ -12,6 +12,7 @@
 #include "Processor.h"
 #include "DataDelivery.h"
 #include "Scheduler.h"
+#include "DTRList.h"
 
 #include "DTR.h"
 
@@ -72,7 +73,8 @@ namespace DataStaging {
        use_host_cert_for_remote_delivery(false),
        current_owner(GENERATOR),
        log_destinations(logs),
-       perf_record(perf_log)
+       perf_record(perf_log),
+       dtr_list(NULL)
   {
     logger = new Arc::Logger(Arc::Logger::getRootLogger(), logname.c_str());
     logger->addDestinations(get_log_destinations());
@@ -212,8 +214,12 @@ namespace DataStaging {
     logger->msg(Arc::VERBOSE, "%s->%s", status.str(), stat.str());
     lock.lock();
     status = stat;
+    // DTRList may remove this DTR concurrently
+    DTRList* list = dtr_list;
     lock.unlock();
     mark_modification();
+    // update the index outside the DTR lock
+    if (list) list->update_dtr(this);
   }
   
   DTRStatus DTR::get_status() {
@@ -313,7 +319,9 @@ namespace DataStaging {
   	 */
     dtr->lock.lock();
     dtr->current_owner = new_owner;
+    DTRList* list = dtr->dtr_list;
     dtr->lock.unlock();
+    if (list) list->update_dtr(dtr.Ptr());
 
     std::list<DTRCallback*> callbacks = dtr->get_callbacks(dtr->proc_callback,dtr->current_owner);
     if (callbacks.empty())
@@ -110,9 +110,24 @@ namespace DataStaging {
     unsigned long long int min_current_bandwidth;
     /// The time in seconds over which to average the calculation of min_current_bandwidth.
     unsigned int averaging_time;
+    /// Number of transfers after which a persistent delivery process is replaced.
+    /**
+     * If zero (the default) a new delivery process is started for each
+     * transfer. Otherwise local transfers are passed to a pool of long-lived
+     * delivery processes which are restarted after this many transfers.
+     */
+    unsigned int persistent_delivery_transfers;
+    /// Memory limit in bytes for a persistent delivery process.
+    /**
+     * A persistent delivery process whose resident memory exceeds this value
+     * after a transfer is replaced. Zero means no limit.
+     */
+    unsigned long long int persistent_delivery_memory;
     /// Constructor. Initialises all values to zero.
     TransferParameters() : min_average_bandwidth(0), max_inactivity_time(0),
-                           min_current_bandwidth(0), averaging_time(0) {};
+                           min_current_bandwidth(0), averaging_time(0),
+                           persistent_delivery_transfers(0),
+                           persistent_delivery_memory(0) {};
   };
 
   /// The configured cache directories
@@ -205,6 +220,8 @@ namespace DataStaging {
       //virtual void cancelDTR(DTR& dtr) = 0;
   };
 
+  class DTRList;
+
   /// Data Transfer Request.
   /**
    * DTR stands for Data Transfer Request and a DTR describes a data transfer
@@ -226,6 +243,8 @@ namespace DataStaging {
    * \headerfile DTR.h arc/data-staging/DTR.h
    */
   class DTR {
+
+    friend class DTRList;
   	
   private:
     /// Identifier
@@ -377,6 +396,10 @@ namespace DataStaging {
     /// Lock to avoid collisions while changing DTR properties
     Arc::SimpleCondition lock;
 
+    /// List indexing this DTR, which is notified of status and owner changes.
+    /** Set and cleared by DTRList when the DTR is added or removed. Protected by lock. */
+    DTRList* dtr_list;
+
     /** Possible fields  (types, names and so on are subject to change) **
 
     /// DTRs that are grouped must have the same number here
@@ -11,7 +11,23 @@ namespace DataStaging {
   
   bool DTRList::add_dtr(DTR_ptr DTRToAdd) {
   	Lock.lock();
-  	DTRs.push_back(DTRToAdd);
+  	if (DTRIndex.find(DTRToAdd.Ptr()) != DTRIndex.end()) {
+  	  Lock.unlock();
+  	  return false;
+  	}
+  	DTRIndexEntry& entry = DTRIndex[DTRToAdd.Ptr()];
+  	entry.status = DTRToAdd->get_status().GetStatus();
+  	entry.owner = DTRToAdd->get_owner();
+  	entry.all_pos = DTRs.insert(DTRs.end(), DTRToAdd);
+  	std::list<DTR_ptr>& status_list = StatusIndex[entry.status];
+  	entry.status_pos = status_list.insert(status_list.end(), DTRToAdd);
+  	std::list<DTR_ptr>& owner_list = OwnerIndex[entry.owner];
+  	entry.owner_pos = owner_list.insert(owner_list.end(), DTRToAdd);
+  	std::list<DTR_ptr>& job_list = JobIndex[DTRToAdd->get_parent_job_id()];
+  	entry.job_pos = job_list.insert(job_list.end(), DTRToAdd);
+  	DTRToAdd->lock.lock();
+  	DTRToAdd->dtr_list = this;
+  	DTRToAdd->lock.unlock();
   	Lock.unlock();
   	
   	// Added successfully
@@ -21,20 +37,65 @@ namespace DataStaging {
   bool DTRList::delete_dtr(DTR_ptr DTRToDelete) {
   	
   	Lock.lock();
-  	DTRs.remove(DTRToDelete);
+  	std::map<const DTR*, DTRIndexEntry>::iterator entry = DTRIndex.find(DTRToDelete.Ptr());
+  	if (entry != DTRIndex.end()) {
+  	  DTRToDelete->lock.lock();
+  	  DTRToDelete->dtr_list = NULL;
+  	  DTRToDelete->lock.unlock();
+  	  DTRs.erase(entry->second.all_pos);
+  	  StatusIndex[entry->second.status].erase(entry->second.status_pos);
+  	  OwnerIndex[entry->second.owner].erase(entry->second.owner_pos);
+  	  std::map<std::string, std::list<DTR_ptr> >::iterator job = JobIndex.find(DTRToDelete->get_parent_job_id());
+  	  job->second.erase(entry->second.job_pos);
+  	  if (job->second.empty()) JobIndex.erase(job);
+  	  DTRIndex.erase(entry);
+  	}
   	Lock.unlock();
   	
   	// Deleted successfully
   	return true;
   }
+
+  void DTRList::update_dtr(const DTR* dtr) {
+    // Status and owner are read again under the list lock, so that if several
+    // threads change the DTR at once the last update leaves the right values
+    Lock.lock();
+    std::map<const DTR*, DTRIndexEntry>::iterator entry = DTRIndex.find(dtr);
+    if (entry == DTRIndex.end()) {
+      Lock.unlock();
+      return;
+    }
+    DTR_ptr dtr_ptr(*(entry->second.all_pos));
+    DTRStatus::DTRStatusType status = dtr_ptr->get_status().GetStatus();
+    if (status != entry->second.status) {
+      StatusIndex[entry->second.status].erase(entry->second.status_pos);
+      std::list<DTR_ptr>& status_list = StatusIndex[status];
+      entry->second.status_pos = status_list.insert(status_list.end(), dtr_ptr);
+      entry->second.status = status;
+    }
+    StagingProcesses owner = dtr_ptr->get_owner();
+    if (owner != entry->second.owner) {
+      OwnerIndex[entry->second.owner].erase(entry->second.owner_pos);
+      std::list<DTR_ptr>& owner_list = OwnerIndex[owner];
+      entry->second.owner_pos = owner_list.insert(owner_list.end(), dtr_ptr);
+      entry->second.owner = owner;
+    }
+    Lock.unlock();
+  }
+
+  void DTRList::append_by_status(DTRStatus::DTRStatusType StatusToFilter, std::list<DTR_ptr>& FilteredList) {
+    std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::const_iterator bucket = StatusIndex.find(StatusToFilter);
+    if (bucket != StatusIndex.end()) {
+      FilteredList.insert(FilteredList.end(), bucket->second.begin(), bucket->second.end());
+    }
+  }
   
   bool DTRList::filter_dtrs_by_owner(StagingProcesses OwnerToFilter, std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
-     
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    FilteredList.push_back(*it);
+    std::map<StagingProcesses, std::list<DTR_ptr> >::const_iterator bucket = OwnerIndex.find(OwnerToFilter);
+    if (bucket != OwnerIndex.end()) {
+      FilteredList.insert(FilteredList.end(), bucket->second.begin(), bucket->second.end());
+    }
     Lock.unlock();
 
   	// Filtered successfully
@@ -42,36 +103,54 @@ namespace DataStaging {
   }
   
   int DTRList::number_of_dtrs_by_owner(StagingProcesses OwnerToFilter){
-  	std::list<DTR_ptr>::iterator it;
     int counter = 0;
     
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    counter++;
+    std::map<StagingProcesses, std::list<DTR_ptr> >::const_iterator bucket = OwnerIndex.find(OwnerToFilter);
+    if (bucket != OwnerIndex.end()) counter = bucket->second.size();
     Lock.unlock();
 
   	// Filtered successfully
   	return counter;
   }
+
+  int DTRList::number_of_dtrs_by_status(DTRStatus::DTRStatusType StatusToFilter){
+    int counter = 0;
+
+    Lock.lock();
+    std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::const_iterator bucket = StatusIndex.find(StatusToFilter);
+    if (bucket != StatusIndex.end()) counter = bucket->second.size();
+    Lock.unlock();
+
+    return counter;
+  }
+
+  void DTRList::for_each_dtr_by_status(DTRStatus::DTRStatusType StatusToFilter,
+                                       void (*func)(DTR_ptr, void*), void* arg) {
+    Lock.lock();
+    std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >::const_iterator bucket = StatusIndex.find(StatusToFilter);
+    if (bucket != StatusIndex.end()) {
+      for (std::list<DTR_ptr>::const_iterator it = bucket->second.begin(); it != bucket->second.end(); ++it) {
+        (*func)(*it, arg);
+      }
+    }
+    Lock.unlock();
+  }
   
   bool DTRList::filter_dtrs_by_status(DTRStatus::DTRStatusType StatusToFilter, std::list<DTR_ptr>& FilteredList){
-    std::vector<DTRStatus::DTRStatusType> StatusesToFilter(1, StatusToFilter);
-    return filter_dtrs_by_statuses(StatusesToFilter, FilteredList);
+    Lock.lock();
+    append_by_status(StatusToFilter, FilteredList);
+    Lock.unlock();
+
+    // Filtered successfully
+    return true;
   }
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::list<DTR_ptr>& FilteredList){
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList.push_back(*it);
-          break;
-        }
-      }
+    for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
+      append_by_status(*i, FilteredList);
     }
     Lock.unlock();
 
@@ -81,16 +160,9 @@ namespace DataStaging {
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList[*i].push_back(*it);
-          break;
-        }
-      }
+    for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
+      append_by_status(*i, FilteredList[*i]);
     }
     Lock.unlock();
 
@@ -99,30 +171,29 @@ namespace DataStaging {
   }
 
   bool DTRList::filter_dtrs_by_next_receiver(StagingProcesses NextReceiver, std::list<DTR_ptr>& FilteredList) {
-  	std::list<DTR_ptr>::iterator it;
   	
   	switch(NextReceiver){
   	  case PRE_PROCESSOR: {
         Lock.lock();
-        for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_pre_processor())
-  	        FilteredList.push_back(*it);
+        append_by_status(DTRStatus::PRE_CLEAN, FilteredList);
+        append_by_status(DTRStatus::CHECK_CACHE, FilteredList);
+        append_by_status(DTRStatus::RESOLVE, FilteredList);
+        append_by_status(DTRStatus::QUERY_REPLICA, FilteredList);
+        append_by_status(DTRStatus::STAGE_PREPARE, FilteredList);
   	    Lock.unlock();
   	    return true;  	  	
   	  }
   	  case POST_PROCESSOR: {
   	  	Lock.lock();
-  	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_post_processor())
-  	        FilteredList.push_back(*it);
+        append_by_status(DTRStatus::RELEASE_REQUEST, FilteredList);
+        append_by_status(DTRStatus::REGISTER_REPLICA, FilteredList);
+        append_by_status(DTRStatus::PROCESS_CACHE, FilteredList);
   	    Lock.unlock();
   	    return true;
   	  }
   	  case DELIVERY: {
   	  	Lock.lock();
-  	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_delivery())
-  	        FilteredList.push_back(*it);
+        append_by_status(DTRStatus::TRANSFER, FilteredList);
   	    Lock.unlock();
   	    return true;
   	  }
@@ -132,29 +203,40 @@ namespace DataStaging {
   }
   
   bool DTRList::filter_pending_dtrs(std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
   	Arc::Time now;
+  	std::list<DTR_ptr> candidates;
   	
   	Lock.lock(); 	
-  	for(it = DTRs.begin();it != DTRs.end(); ++it){
-  	  if( ((*it)->came_from_pre_processor() || (*it)->came_from_post_processor() ||
-  	       (*it)->came_from_delivery() || (*it)->came_from_generator()) &&
-  	      ((*it)->get_process_time() <= now) )
+  	// States in which DTRs arrive from pre-, post-processor, delivery or generator
+  	append_by_status(DTRStatus::NEW, candidates);
+  	append_by_status(DTRStatus::PRE_CLEANED, candidates);
+  	append_by_status(DTRStatus::CACHE_WAIT, candidates);
+  	append_by_status(DTRStatus::CACHE_CHECKED, candidates);
+  	append_by_status(DTRStatus::RESOLVED, candidates);
+  	append_by_status(DTRStatus::REPLICA_QUERIED, candidates);
+  	append_by_status(DTRStatus::STAGING_PREPARING_WAIT, candidates);
+  	append_by_status(DTRStatus::STAGED_PREPARED, candidates);
+  	append_by_status(DTRStatus::TRANSFERRED, candidates);
+  	append_by_status(DTRStatus::REQUEST_RELEASED, candidates);
+  	append_by_status(DTRStatus::REPLICA_REGISTERED, candidates);
+  	append_by_status(DTRStatus::CACHE_PROCESSED, candidates);
+  	Lock.unlock();
+
+  	for(std::list<DTR_ptr>::iterator it = candidates.begin();it != candidates.end(); ++it){
+  	  if ((*it)->get_process_time() <= now)
   	    FilteredList.push_back(*it);
   	}  	    
-  	Lock.unlock();
   	
   	// Filtered successfully
   	return true;
   }
   
   bool DTRList::filter_dtrs_by_job(const std::string& jobid, std::list<DTR_ptr>& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it)
-      if((*it)->get_parent_job_id() == jobid)
-        FilteredList.push_back(*it);
+    std::map<std::string, std::list<DTR_ptr> >::const_iterator bucket = JobIndex.find(jobid);
+    if (bucket != JobIndex.end()) {
+      FilteredList.insert(FilteredList.end(), bucket->second.begin(), bucket->second.end());
+    }
     Lock.unlock();
 
     // Filtered successfully
@@ -241,17 +323,10 @@ namespace DataStaging {
 
   std::list<std::string> DTRList::all_jobs() {
     std::list<std::string> alljobs;
-    std::list<DTR_ptr>::iterator it;
 
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      std::list<std::string>::iterator i = alljobs.begin();
-      for (; i != alljobs.end(); ++i) {
-        if (*i == (*it)->get_parent_job_id())
-          break;
-      }
-      if (i == alljobs.end())
-        alljobs.push_back((*it)->get_parent_job_id());
+    for(std::map<std::string, std::list<DTR_ptr> >::const_iterator it = JobIndex.begin(); it != JobIndex.end(); ++it) {
+      alljobs.push_back(it->first);
     }
     Lock.unlock();
 
@@ -263,12 +338,14 @@ namespace DataStaging {
     std::string data;
     Lock.lock();
     for(std::list<DTR_ptr>::iterator it = DTRs.begin();it != DTRs.end(); ++it) {
+      // status is taken from the index to avoid locking each DTR
+      DTRStatus::DTRStatusType status = DTRIndex[it->Ptr()].status;
       data += (*it)->get_id() + " " +
-              (*it)->get_status().str() + " " +
+              DTRStatus(status).str() + " " +
               Arc::tostring((*it)->get_priority()) + " " +
               (*it)->get_transfer_share();
       // add destination for recovery after crash
-      if ((*it)->get_status() == DTRStatus::TRANSFERRING || (*it)->get_status() == DTRStatus::TRANSFER) {
+      if (status == DTRStatus::TRANSFERRING || status == DTRStatus::TRANSFER) {
         data += " " + (*it)->get_destination()->CurrentLocation().fullstr();
         data += " " + (*it)->get_delivery_endpoint().Host();
       }
@@ -10,18 +10,44 @@ namespace DataStaging {
   /// Global list of all active DTRs in the system.
   /**
    * This class contains several methods for filtering the list by owner, state
-   * etc.
+   * etc. Indexes by status, owner and job ID are maintained so that filtering
+   * does not require scanning the whole list. DTRs in the list notify it
+   * through update_dtr() whenever their status or owner changes.
    * \ingroup datastaging
    * \headerfile DTRList.h arc/data-staging/DTRList.h
    */
   class DTRList {
 
+    friend class DTR;
+
     private:
 
-      /// Internal list of DTRs
+      /// Position of a DTR in the list and in each index
+      struct DTRIndexEntry {
+        DTRStatus::DTRStatusType status;
+        StagingProcesses owner;
+        std::list<DTR_ptr>::iterator all_pos;
+        std::list<DTR_ptr>::iterator status_pos;
+        std::list<DTR_ptr>::iterator owner_pos;
+        std::list<DTR_ptr>::iterator job_pos;
+      };
+
+      /// Internal list of DTRs, in the order they were added
       std::list<DTR_ptr> DTRs;
+
+      /// Index entries for all DTRs in the list
+      std::map<const DTR*, DTRIndexEntry> DTRIndex;
+
+      /// DTRs in each status, in the order they entered that status
+      std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > StatusIndex;
+
+      /// DTRs owned by each process
+      std::map<StagingProcesses, std::list<DTR_ptr> > OwnerIndex;
+
+      /// DTRs belonging to each job
+      std::map<std::string, std::list<DTR_ptr> > JobIndex;
   
-      /// Lock to protect list during modification
+      /// Lock to protect list and indexes during modification
       Arc::SimpleCondition Lock;
 
       /// Internal set of sources that are currently being cached.
@@ -34,6 +60,12 @@ namespace DataStaging {
       /// Lock to protect caching sources set during modification
       Arc::SimpleCondition CachingLock;
 
+      /// Move the DTR to the right status and owner buckets. Called by DTR.
+      void update_dtr(const DTR* dtr);
+
+      /// Append DTRs in the given status to FilteredList. Lock must be held.
+      void append_by_status(DTRStatus::DTRStatusType StatusToFilter, std::list<DTR_ptr>& FilteredList);
+
     public:
 
       /// Put a new DTR into the list.
@@ -52,6 +84,21 @@ namespace DataStaging {
       /// Returns the number of DTRs owned by a particular process
       int number_of_dtrs_by_owner(StagingProcesses OwnerToFilter);
 
+      /// Returns the number of DTRs with a particular status
+      int number_of_dtrs_by_status(DTRStatus::DTRStatusType StatusToFilter);
+
+      /// Call a function for each DTR with a particular status.
+      /**
+       * The DTRs are passed directly from the index without copying the list.
+       * The list is locked while func runs, so func must not call methods of
+       * this DTRList or change the status or owner of the DTR.
+       * @param StatusToFilter DTR status to filter on
+       * @param func Function called for each DTR
+       * @param arg Argument passed to func
+       */
+      void for_each_dtr_by_status(DTRStatus::DTRStatusType StatusToFilter,
+                                  void (*func)(DTR_ptr, void*), void* arg);
+
       /// Filter the queue to select DTRs with particular status.
       /**
        * If we have only one common queue for all DTRs, this method is
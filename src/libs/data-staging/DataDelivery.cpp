@@ -116,6 +116,11 @@ namespace DataStaging {
     dp->start();
   }
 
+  void DataDelivery::status_notify(void* arg) {
+    DataDelivery* it = (DataDelivery*)arg;
+    it->cond.signal();
+  }
+
   void DataDelivery::stop_delivery(void* arg) {
     delivery_pair_t* dp = (delivery_pair_t*)arg;
     delete dp->comm;
@@ -218,6 +223,7 @@ namespace DataStaging {
             DTR::push(tmp, SCHEDULER);
 
           } else {
+            if (dp->comm) dp->comm->SetStatusNotifier(&status_notify, this);
             dtr_list_lock.lock();
             ++d;
             dtr_list_lock.unlock();
@@ -312,8 +318,9 @@ namespace DataStaging {
         dtr_list_lock.unlock();
       }
       	
-      // Go through main loop every half a second or when new transfer arrives
-      cond.wait(100);
+      // Go through main loop every second or when a new transfer arrives,
+      // a transfer is cancelled or status of a transfer changes
+      cond.wait(1000);
     }
     // Kill any transfers still running
     dtr_list_lock.lock();
@@ -57,6 +57,9 @@ namespace DataStaging {
     /// Thread to stop Delivery process
     static void stop_delivery(void* arg);
 
+    /// Called by DataDeliveryComm when status of transfer may have changed
+    static void status_notify(void* arg);
+
     /// Delete delivery_pair_t object. Starts a new thread which calls stop_delivery()
     bool delete_delivery_pair(delivery_pair_t* dp);
 
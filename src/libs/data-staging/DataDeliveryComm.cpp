@@ -2,6 +2,12 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+
 #include "DataDeliveryComm.h"
 #include "DataDeliveryRemoteComm.h"
 #include "DataDeliveryLocalComm.h"
@@ -15,7 +21,8 @@ namespace DataStaging {
   }
 
   DataDeliveryComm::DataDeliveryComm(DTR_ptr dtr, const TransferParameters& params)
-    : status_pos_(0),transfer_params(params),logger_(dtr->get_logger()) {
+    : status_pos_(0),transfer_params(params),logger_(dtr->get_logger()),
+      notify_func_(NULL),notify_arg_(NULL) {
     handler_= DataDeliveryCommHandler::getInstance();
   }
 
@@ -25,20 +32,66 @@ namespace DataStaging {
     return tmp;
   }
 
+  void DataDeliveryComm::SetStatusNotifier(void (*func)(void*), void* arg) {
+    {
+      Glib::Mutex::Lock lock(lock_);
+      notify_func_ = func;
+      notify_arg_ = arg;
+    }
+    if(func) (*func)(arg);
+  }
+
   bool DataDeliveryComm::CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg) {
     if (!dtr->get_delivery_endpoint() || dtr->get_delivery_endpoint() == DTR::LOCAL_DELIVERY)
       return DataDeliveryLocalComm::CheckComm(dtr, allowed_dirs, load_avg);
     return DataDeliveryRemoteComm::CheckComm(dtr, allowed_dirs, load_avg);
   }
 
-  DataDeliveryCommHandler::DataDeliveryCommHandler(void) {
+  DataDeliveryCommHandler::DataDeliveryCommHandler(void): epoll_fd_(-1) {
     Glib::Mutex::Lock lock(lock_);
+#ifdef HAVE_SYS_EPOLL_H
+    epoll_fd_ = epoll_create(64);
+    if(epoll_fd_ != -1) fcntl(epoll_fd_, F_SETFD, FD_CLOEXEC);
+#endif
     Arc::CreateThreadFunction(&func,this);
   }
 
   void DataDeliveryCommHandler::Add(DataDeliveryComm* item) {
     Glib::Mutex::Lock lock(lock_);
     items_.push_back(item);
+    add_handle(item);
+  }
+
+  // Must be called with lock_ held
+  void DataDeliveryCommHandler::add_handle(DataDeliveryComm* item) {
+#ifdef HAVE_SYS_EPOLL_H
+    if(epoll_fd_ == -1) return;
+    int h = item->GetHandle();
+    if(h == -1) return;
+    // One-shot mode so that a handle closed by the comm object while still
+    // referred to elsewhere can't produce events. Handles are re-armed after
+    // each event.
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = h;
+    if(epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, h, &ev) != 0) {
+      if((errno != ENOENT) || (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, h, &ev) != 0)) return;
+    }
+    handles_[h] = item;
+#endif
+  }
+
+  // Must be called with lock_ held
+  void DataDeliveryCommHandler::pull_status(DataDeliveryComm* item) {
+    item->PullStatus();
+    void (*notify_func)(void*) = NULL;
+    void* notify_arg = NULL;
+    {
+      Glib::Mutex::Lock lock(item->lock_);
+      notify_func = item->notify_func_;
+      notify_arg = item->notify_arg_;
+    }
+    if(notify_func) (*notify_func)(notify_arg);
   }
 
   void DataDeliveryCommHandler::Remove(DataDeliveryComm* item) {
@@ -51,6 +104,18 @@ namespace DataStaging {
         ++i;
       }
     }
+    for(std::map<int, DataDeliveryComm*>::iterator h = handles_.begin();
+                        h!=handles_.end();) {
+      if(h->second == item) {
+#ifdef HAVE_SYS_EPOLL_H
+        // Handle may be already closed, then this fails harmlessly
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, h->first, NULL);
+#endif
+        handles_.erase(h++);
+      } else {
+        ++h;
+      }
+    }
   }
 
   DataDeliveryCommHandler* DataDeliveryCommHandler::comm_handler = NULL;
@@ -60,8 +125,10 @@ namespace DataStaging {
     return (comm_handler = new DataDeliveryCommHandler);
   }
 
-  // This is a dedicated thread which periodically checks for
-  // new state reported by comm instances and modifies states accordingly
+  // This is a dedicated thread which waits for new state reported by comm
+  // instances and modifies states accordingly. Comm instances with a handle
+  // are processed as soon as data arrives. All instances are also polled
+  // once per second to detect timeouts and to query those without a handle.
   void DataDeliveryCommHandler::func(void* arg) {
     if(!arg) return;
 
@@ -69,20 +136,39 @@ namespace DataStaging {
     Arc::Logger::getRootLogger().setThreadContext();
     Arc::Logger::getRootLogger().removeDestinations();
 
-    // We do not need extremely low latency, so this
-    // thread simply polls for data 2 times per second.
     DataDeliveryCommHandler& it = *(DataDeliveryCommHandler*)arg;
+    Arc::Time last_poll(0);
     for(;;) {
-      {
-        Glib::Mutex::Lock lock(it.lock_);
-        for(std::list<DataDeliveryComm*>::iterator i = it.items_.begin();
-                  i != it.items_.end();++i) {
-          DataDeliveryComm* comm = *i;
-          if(comm)
-            comm->PullStatus();
+#ifdef HAVE_SYS_EPOLL_H
+      if(it.epoll_fd_ != -1) {
+        struct epoll_event events[64];
+        int n = epoll_wait(it.epoll_fd_, events, sizeof(events)/sizeof(events[0]), 1000);
+        if(n > 0) {
+          Glib::Mutex::Lock lock(it.lock_);
+          for(int e = 0; e < n; ++e) {
+            std::map<int, DataDeliveryComm*>::iterator h = it.handles_.find(events[e].data.fd);
+            if(h == it.handles_.end()) continue;
+            DataDeliveryComm* comm = h->second;
+            it.handles_.erase(h);
+            it.pull_status(comm);
+            it.add_handle(comm); // re-arm if comm still uses handle
+          }
         }
+      } else {
+        Glib::usleep(500000);
       }
+#else
       Glib::usleep(500000);
+#endif
+      if((it.epoll_fd_ != -1) && ((Arc::Time() - last_poll) < Arc::Period(1))) continue;
+      last_poll = Arc::Time();
+      Glib::Mutex::Lock lock(it.lock_);
+      for(std::list<DataDeliveryComm*>::iterator i = it.items_.begin();
+                i != it.items_.end();++i) {
+        DataDeliveryComm* comm = *i;
+        if(comm)
+          it.pull_status(comm);
+      }
     }
   }
 
@@ -1,6 +1,8 @@
 #ifndef DATA_DELIVERY_COMM_H_
 #define DATA_DELIVERY_COMM_H_
 
+#include <map>
+
 #include "DTR.h"
 
 namespace DataStaging {
@@ -18,9 +20,12 @@ namespace DataStaging {
    * CreateInstance() should be used to get a pointer to the instantiated
    * object. This also starts the transfer. Deleting this object stops the
    * transfer and cleans up any used resources. A singleton instance of
-   * DataDeliveryCommHandler regularly polls all active transfers using
-   * PullStatus() and fills the Status object with current information,
-   * which can be obtained through GetStatus().
+   * DataDeliveryCommHandler calls PullStatus() on active transfers as soon as
+   * data arrives on their communication channel (see GetHandle()) and
+   * regularly polls those without such a channel. PullStatus() fills the
+   * Status object with current information, which can be obtained through
+   * GetStatus(). SetStatusNotifier() can be used to be informed when new
+   * information is available.
    * \ingroup datastaging
    * \headerfile DataDeliveryComm.h arc/data-staging/DataDeliveryComm.h
    */
@@ -77,6 +82,10 @@ namespace DataStaging {
     Arc::Time start_;
     /// Logger object. Pointer to DTR's Logger.
     DTRLogger logger_;
+    /// Function called after status was updated
+    void (*notify_func_)(void*);
+    /// Argument passed to notify_func_
+    void* notify_arg_;
 
     /// Check for new state and fill state accordingly.
     /**
@@ -86,6 +95,14 @@ namespace DataStaging {
      */
     virtual void PullStatus() = 0;
 
+    /// Handle which becomes readable when new status information arrives.
+    /**
+     * The comm handler waits for data on this handle and calls PullStatus()
+     * when it is readable. If -1 is returned PullStatus() is only called
+     * periodically.
+     */
+    virtual int GetHandle() { return -1; };
+
     /// Start transfer with parameters taken from DTR and supplied transfer limits.
     /**
      * Constructor should not be used directly, CreateInstance() should be used
@@ -103,6 +120,14 @@ namespace DataStaging {
     /// Obtain status of transfer
     Status GetStatus() const;
 
+    /// Set function to be called when status of transfer may have changed.
+    /**
+     * The function is called from the comm handler thread and must not block.
+     * It is called once immediately, in case status changed before the
+     * function was set.
+     */
+    void SetStatusNotifier(void (*func)(void*), void* arg);
+
     /// Check the delivery method is available. Calls CheckComm of the appropriate subclass.
     /**
      * \param dtr DTR from which credentials are used
@@ -133,8 +158,17 @@ namespace DataStaging {
     Glib::Mutex lock_;
     static void func(void* arg);
     std::list<DataDeliveryComm*> items_;
+    /// Handles being watched and the comm objects they belong to
+    std::map<int, DataDeliveryComm*> handles_;
+    /// epoll instance used to wait for data, -1 if not available
+    int epoll_fd_;
     static DataDeliveryCommHandler* comm_handler;
 
+    /// Start watching handle of item
+    void add_handle(DataDeliveryComm* item);
+    /// Call PullStatus() on item and inform about possible change of status
+    void pull_status(DataDeliveryComm* item);
+
     /// Constructor is private - getInstance() should be used instead
     DataDeliveryCommHandler();
     DataDeliveryCommHandler(const DataDeliveryCommHandler&);
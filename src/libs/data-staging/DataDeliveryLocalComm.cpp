@@ -7,6 +7,7 @@
 #include <arc/FileUtils.h>
 
 #include "DataDeliveryLocalComm.h"
+#include "DataDeliveryWorkerPool.h"
 
 namespace DataStaging {
 
@@ -35,8 +36,27 @@ namespace DataStaging {
     return proxy_new_path;
   }
 
+  // Pass output of child to DTR log
+  static void log_stderr(Arc::Run& child, Arc::Logger& logger) {
+    // TODO: direct redirect
+    for(;;) {
+      char buf[1024+1];
+      int l = child.ReadStderr(0,buf,sizeof(buf)-1);
+      if(l <= 0) break;
+      buf[l] = 0;
+      char* start = buf;
+      for(;*start;) {
+        char* end = strchr(start,'\n');
+        if(end) *end = 0;
+        logger.msg(Arc::INFO, "DataDelivery: %s", start);
+        if(!end) break;
+        start = end + 1;
+      }
+    }
+  }
+
   DataDeliveryLocalComm::DataDeliveryLocalComm(DTR_ptr dtr, const TransferParameters& params)
-    : DataDeliveryComm(dtr, params),child_(NULL),last_comm(Arc::Time()) {
+    : DataDeliveryComm(dtr, params),child_(NULL),worker_(NULL),last_comm(Arc::Time()) {
     if(!dtr->get_source()) return;
     if(!dtr->get_destination()) return;
     {
@@ -151,25 +171,46 @@ namespace DataStaging {
         args.push_back("--cstype");
         args.push_back(dtr->get_destination()->DefaultCheckSum());
       }
-      child_ = new Arc::Run(args);
-      // Set up pipes
-      child_->KeepStdout(false);
-      child_->KeepStderr(false);
-      child_->KeepStdin(false);
-      child_->AssignUserId(child_uid);
-      child_->AssignGroupId(child_gid);
-      child_->AssignStdin(stdin_);
-      // Start child
-      std::string cmd;
-      for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
-        cmd += *arg;
-        cmd += " ";
-      }
-      logger_->msg(Arc::DEBUG, "Running command: %s", cmd);
-      if(!child_->Start()) {
-        delete child_;
-        child_=NULL;
-        return;
+      if (transfer_params.persistent_delivery_transfers > 0) {
+        // Pass transfer to a persistent process. Path to executable is not
+        // part of the request.
+        args.pop_front();
+        std::string cmd;
+        for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
+          cmd += *arg;
+          cmd += " ";
+        }
+        worker_ = DataDeliveryWorkerPool::getInstance().Acquire(child_uid, child_gid);
+        if (!worker_) return;
+        logger_->msg(Arc::DEBUG, "Passing to persistent delivery process %i: %s", worker_->Process()->Pid(), cmd);
+        if (!worker_->Send(args, stdin_)) {
+          logger_->msg(Arc::ERROR, "Failed to pass transfer to persistent delivery process");
+          delete worker_;
+          worker_ = NULL;
+          return;
+        }
+        child_ = worker_->Process();
+      } else {
+        child_ = new Arc::Run(args);
+        // Set up pipes
+        child_->KeepStdout(false);
+        child_->KeepStderr(false);
+        child_->KeepStdin(false);
+        child_->AssignUserId(child_uid);
+        child_->AssignGroupId(child_gid);
+        child_->AssignStdin(stdin_);
+        // Start child
+        std::string cmd;
+        for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
+          cmd += *arg;
+          cmd += " ";
+        }
+        logger_->msg(Arc::DEBUG, "Running command: %s", cmd);
+        if(!child_->Start()) {
+          delete child_;
+          child_=NULL;
+          return;
+        }
       }
     }
     handler_->Add(this);
@@ -178,7 +219,10 @@ namespace DataStaging {
   DataDeliveryLocalComm::~DataDeliveryLocalComm(void) {
     {
       Glib::Mutex::Lock lock(lock_);
-      if(child_) {
+      if(worker_) {
+        // Transfer was not finished so worker can't be reused
+        release_child(false);
+      } else if(child_) {
         child_->Kill(10); // Give it a chance
         delete child_; child_=NULL;  // And then kill for sure
       }
@@ -192,23 +236,8 @@ namespace DataStaging {
     if(!child_) return;
     for(;;) {
       if(status_pos_ < sizeof(status_buf_)) {
-        int l;
-        // TODO: direct redirect
-        for(;;) {
-          char buf[1024+1];
-          l = child_->ReadStderr(0,buf,sizeof(buf)-1);
-          if(l <= 0) break;
-          buf[l] = 0;
-          char* start = buf;
-          for(;*start;) {
-            char* end = strchr(start,'\n');
-            if(end) *end = 0;
-            logger_->msg(Arc::INFO, "DataDelivery: %s", start);
-            if(!end) break;
-            start = end + 1;
-          }
-        }
-        l = child_->ReadStdout(0,((char*)&status_buf_)+status_pos_,sizeof(status_buf_)-status_pos_);
+        log_stderr(*child_, *logger_);
+        int l = child_->ReadStdout(0,((char*)&status_buf_)+status_pos_,sizeof(status_buf_)-status_pos_);
         if(l == -1) { // child error or closed comm
           if(child_->Running()) {
             status_.commstatus = CommClosed;
@@ -219,7 +248,7 @@ namespace DataStaging {
               status_.commstatus = CommFailed;
             }
           }
-          delete child_; child_=NULL; return;
+          release_child(false); return;
         }
         if(l == 0) break;
         status_pos_+=l;
@@ -229,6 +258,15 @@ namespace DataStaging {
         status_buf_.error_desc[sizeof(status_buf_.error_desc)-1] = 0;
         status_=status_buf_;
         status_pos_-=sizeof(status_buf_);
+        if(worker_ && (status_.commstatus != CommNoError)) {
+          // Persistent process marks end of transfer with exit status.
+          // Make sure its log is not passed to the next transfer.
+          log_stderr(*child_, *logger_);
+          if(status_.commstatus == CommFailed) {
+            logger_->msg(Arc::ERROR, "DataStagingDelivery transfer failed");
+          }
+          release_child(true); return;
+        }
       }
     }
     // check for stuck child process (no report through comm channel)
@@ -236,9 +274,28 @@ namespace DataStaging {
     if (transfer_params.max_inactivity_time > 0 && t >= transfer_params.max_inactivity_time*2) {
       logger_->msg(Arc::ERROR, "Transfer killed after %i seconds without communication", t.GetPeriod());
       child_->Kill(1);
+      release_child(false);
+    }
+  }
+
+  int DataDeliveryLocalComm::GetHandle(void) {
+    Glib::Mutex::Lock lock(lock_);
+    if(!child_) return -1;
+    return child_->GetStdoutHandle();
+  }
+
+  void DataDeliveryLocalComm::release_child(bool reusable) {
+    if(worker_) {
+      if(reusable) {
+        DataDeliveryWorkerPool::getInstance().Release(worker_, transfer_params);
+      } else {
+        delete worker_;
+      }
+      worker_ = NULL;
+    } else {
       delete child_;
-      child_ = NULL;
     }
+    child_ = NULL;
   }
 
   bool DataDeliveryLocalComm::CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg) {
@@ -7,6 +7,8 @@
 
 namespace DataStaging {
 
+  class DataDeliveryWorker;
+
   /// This class starts, monitors and controls a local Delivery process.
   /**
    * \ingroup datastaging
@@ -23,6 +25,9 @@ namespace DataStaging {
     /// Read from stdout of child to get status
     virtual void PullStatus();
 
+    /// Returns stdout of child, which carries status information
+    virtual int GetHandle();
+
     /// Returns "/" since local Delivery can access everywhere
     static bool CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg);
 
@@ -32,8 +37,12 @@ namespace DataStaging {
     virtual bool operator!() const { return (child_ == NULL); };
 
   private:
+    /// Stop using child process, returning persistent worker to pool if reusable
+    void release_child(bool reusable);
     /// Child process
     Arc::Run* child_;
+    /// Persistent worker owning child_, NULL if child_ is a one-off process
+    DataDeliveryWorker* worker_;
     /// Stdin of child, used to pass credentials
     std::string stdin_;
     /// Temporary credentails location
@@ -0,0 +1,182 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <vector>
+
+#include <arc/ArcLocation.h>
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+
+#include "DataDeliveryWorkerPool.h"
+
+namespace DataStaging {
+
+  Arc::Logger DataDeliveryWorker::logger(Arc::Logger::getRootLogger(), "DataStaging.DataDeliveryWorker");
+
+  DataDeliveryWorker::DataDeliveryWorker(int uid, int gid)
+    : child_(NULL), uid_(uid), gid_(gid), transfers_(0), last_used_(Arc::Time()) {
+  }
+
+  DataDeliveryWorker::~DataDeliveryWorker() {
+    if (!child_) return;
+    if (child_->Running()) {
+      // Closing stdin makes an idle worker exit. A busy one is told
+      // to stop its transfer.
+      child_->CloseStdin();
+      child_->Kill(10);
+    }
+    delete child_;
+    child_ = NULL;
+  }
+
+  bool DataDeliveryWorker::Start() {
+    std::list<std::string> args;
+    args.push_back(Arc::ArcLocation::GetLibDir()+G_DIR_SEPARATOR_S+"DataStagingDelivery");
+    args.push_back("--worker");
+    child_ = new Arc::Run(args);
+    child_->KeepStdout(false);
+    child_->KeepStderr(false);
+    child_->KeepStdin(false);
+    child_->AssignUserId(uid_);
+    child_->AssignGroupId(gid_);
+    if (!child_->Start()) {
+      logger.msg(Arc::ERROR, "Failed to start persistent delivery process for uid %i", uid_);
+      delete child_;
+      child_ = NULL;
+      return false;
+    }
+    logger.msg(Arc::VERBOSE, "Started persistent delivery process %i for uid %i", child_->Pid(), uid_);
+    return true;
+  }
+
+  bool DataDeliveryWorker::Send(const std::list<std::string>& args, const std::string& credential) {
+    if (!child_ || !child_->Running()) return false;
+    // Request is the number of arguments, the credential and then the
+    // arguments, all terminated by \0
+    std::string request(Arc::tostring(args.size()));
+    request += '\0';
+    request += credential;
+    request += '\0';
+    for (std::list<std::string>::const_iterator arg = args.begin(); arg != args.end(); ++arg) {
+      request += *arg;
+      request += '\0';
+    }
+    std::string::size_type pos = 0;
+    while (pos < request.length()) {
+      int l = child_->WriteStdin(10000, request.c_str()+pos, request.length()-pos);
+      if (l <= 0) return false;
+      pos += l;
+    }
+    ++transfers_;
+    return true;
+  }
+
+  unsigned long long int DataDeliveryWorker::Memory() {
+    if (!child_ || child_->Pid() <= 0) return 0;
+    std::string statm;
+    if (!Arc::FileRead("/proc/"+Arc::tostring(child_->Pid())+"/statm", statm)) return 0;
+    // Second field is resident set size in pages
+    std::vector<std::string> fields;
+    Arc::tokenize(statm, fields);
+    unsigned long long int pages = 0;
+    if (fields.size() < 2 || !Arc::stringto(fields[1], pages)) return 0;
+    return pages * sysconf(_SC_PAGESIZE);
+  }
+
+  DataDeliveryWorkerPool* DataDeliveryWorkerPool::instance = NULL;
+
+  Arc::Logger DataDeliveryWorkerPool::logger(Arc::Logger::getRootLogger(), "DataStaging.DataDeliveryWorkerPool");
+
+  DataDeliveryWorkerPool& DataDeliveryWorkerPool::getInstance() {
+    static Glib::Mutex instance_lock;
+    Glib::Mutex::Lock lock(instance_lock);
+    if (!instance) instance = new DataDeliveryWorkerPool();
+    return *instance;
+  }
+
+  void DataDeliveryWorkerPool::purge(std::list<DataDeliveryWorker*>& expired) {
+    Arc::Time now;
+    for (std::list<DataDeliveryWorker*>::iterator w = idle_.begin(); w != idle_.end();) {
+      if (!(*w)->Process()->Running() || (now - (*w)->LastUsed()) > Arc::Period(max_idle_time)) {
+        expired.push_back(*w);
+        w = idle_.erase(w);
+      } else {
+        ++w;
+      }
+    }
+  }
+
+  DataDeliveryWorker* DataDeliveryWorkerPool::Acquire(int uid, int gid) {
+    DataDeliveryWorker* worker = NULL;
+    std::list<DataDeliveryWorker*> expired;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      purge(expired);
+      for (std::list<DataDeliveryWorker*>::iterator w = idle_.begin(); w != idle_.end(); ++w) {
+        if ((*w)->UserId() == uid && (*w)->GroupId() == gid) {
+          worker = *w;
+          idle_.erase(w);
+          break;
+        }
+      }
+    }
+    // Stopping processes may take time so do it outside the lock
+    for (std::list<DataDeliveryWorker*>::iterator w = expired.begin(); w != expired.end(); ++w) delete *w;
+    if (worker) return worker;
+    worker = new DataDeliveryWorker(uid, gid);
+    if (!worker->Start()) {
+      delete worker;
+      return NULL;
+    }
+    return worker;
+  }
+
+  void DataDeliveryWorkerPool::Release(DataDeliveryWorker* worker, const TransferParameters& params) {
+    if (!worker) return;
+    if (!worker->Process() || !worker->Process()->Running() ||
+        worker->Transfers() >= params.persistent_delivery_transfers) {
+      delete worker;
+      return;
+    }
+    if (params.persistent_delivery_memory > 0) {
+      unsigned long long int memory = worker->Memory();
+      if (memory > params.persistent_delivery_memory) {
+        logger.msg(Arc::VERBOSE, "Replacing persistent delivery process %i using %llu bytes of memory",
+                   worker->Process()->Pid(), memory);
+        delete worker;
+        return;
+      }
+    }
+    worker->LastUsed(Arc::Time());
+    Glib::Mutex::Lock lock(lock_);
+    idle_.push_back(worker);
+    // Without new transfers Acquire() is not called, so idle workers
+    // must also be stopped from elsewhere
+    if (!expiring_) expiring_ = Arc::CreateThreadFunction(&expire_thread, this);
+  }
+
+  void DataDeliveryWorkerPool::expire_thread(void* arg) {
+    static_cast<DataDeliveryWorkerPool*>(arg)->expire();
+  }
+
+  void DataDeliveryWorkerPool::expire() {
+    for (;;) {
+      Glib::usleep(expire_interval*1000000);
+      std::list<DataDeliveryWorker*> expired;
+      {
+        Glib::Mutex::Lock lock(lock_);
+        purge(expired);
+        // Thread is started again by Release() when needed
+        if (idle_.empty() && expired.empty()) {
+          expiring_ = false;
+          return;
+        }
+      }
+      for (std::list<DataDeliveryWorker*>::iterator w = expired.begin(); w != expired.end(); ++w) delete *w;
+    }
+  }
+
+} // namespace DataStaging
@@ -0,0 +1,99 @@
+#ifndef DATADELIVERYWORKERPOOL_H_
+#define DATADELIVERYWORKERPOOL_H_
+
+#include <list>
+#include <string>
+
+#include <arc/DateTime.h>
+#include <arc/Logger.h>
+#include <arc/Run.h>
+#include <arc/Thread.h>
+
+#include "DTR.h"
+
+namespace DataStaging {
+
+  /// A long-lived DataStagingDelivery process which performs many transfers.
+  /**
+   * The process is started with the --worker option and reads transfer
+   * requests from its stdin. Status of each transfer is reported on stdout
+   * using DataDeliveryComm::Status in the same way as for a single transfer.
+   * The end of a transfer is marked by a Status with commstatus set to
+   * CommExited or CommFailed.
+   */
+  class DataDeliveryWorker {
+  public:
+    /// Create worker running under the given user and group ids
+    DataDeliveryWorker(int uid, int gid);
+    /// Stops the process, killing it if needed
+    ~DataDeliveryWorker();
+    /// Start the process
+    bool Start();
+    /// Send request for a new transfer to the process
+    /**
+     * \param args Options for the transfer, as passed to DataStagingDelivery
+     * \param credential Credential string, may be empty
+     */
+    bool Send(const std::list<std::string>& args, const std::string& credential);
+    /// Resident memory of the process in bytes, 0 if unknown
+    unsigned long long int Memory();
+    /// Process handle
+    Arc::Run* Process() { return child_; };
+    int UserId() const { return uid_; };
+    int GroupId() const { return gid_; };
+    /// Number of transfers requested from this process
+    unsigned int Transfers() const { return transfers_; };
+    /// Time when the process finished its last transfer
+    Arc::Time LastUsed() const { return last_used_; };
+    void LastUsed(const Arc::Time& t) { last_used_ = t; };
+  private:
+    Arc::Run* child_;
+    int uid_;
+    int gid_;
+    unsigned int transfers_;
+    Arc::Time last_used_;
+    static Arc::Logger logger;
+  };
+
+  /// Pool of idle persistent delivery processes shared by all local transfers.
+  class DataDeliveryWorkerPool {
+  public:
+    /// Get the singleton instance
+    static DataDeliveryWorkerPool& getInstance();
+    /// Get an idle process for the given user or start a new one.
+    /**
+     * Returns NULL if a new process could not be started. The caller owns the
+     * returned worker until it is passed back with Release() or deleted.
+     */
+    DataDeliveryWorker* Acquire(int uid, int gid);
+    /// Return worker after its transfer finished.
+    /**
+     * The worker is kept for further transfers unless it has done the
+     * maximum number of transfers or uses too much memory according to
+     * params, in which case it is stopped.
+     */
+    void Release(DataDeliveryWorker* worker, const TransferParameters& params);
+  private:
+    DataDeliveryWorkerPool(): expiring_(false) {};
+    DataDeliveryWorkerPool(const DataDeliveryWorkerPool&);
+    DataDeliveryWorkerPool& operator=(const DataDeliveryWorkerPool&);
+    /// Remove idle workers which are dead or have been idle too long
+    void purge(std::list<DataDeliveryWorker*>& expired);
+    /// Regularly stops expired workers while there are idle ones
+    static void expire_thread(void* arg);
+    void expire();
+    Glib::Mutex lock_;
+    std::list<DataDeliveryWorker*> idle_;
+    /// Thread running expire() exists
+    bool expiring_;
+    static DataDeliveryWorkerPool* instance;
+    static Arc::Logger logger;
+    /// Idle workers are stopped after this many seconds
+    static const int max_idle_time = 600;
+    /// How often idle workers are checked, in seconds
+    static const int expire_interval = 60;
+  };
+
+} // namespace DataStaging
+
+#endif /* DATADELIVERYWORKERPOOL_H_ */
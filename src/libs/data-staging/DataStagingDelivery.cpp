@@ -3,6 +3,7 @@
 #endif
 
 #include <iostream>
+#include <vector>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
@@ -20,6 +21,7 @@ using namespace Arc;
 
 static Arc::Logger logger(Arc::Logger::getRootLogger(), "DataDelivery");
 static bool delivery_shutdown = false;
+static bool persistent_worker = false;
 static Arc::Time start_time;
 
 static void sig_shutdown(int)
@@ -28,6 +30,28 @@ static void sig_shutdown(int)
     delivery_shutdown = true;
 }
 
+static DataStaging::DataDeliveryComm::Status status;
+static unsigned int status_pos = 0;
+static bool status_changed = true;
+
+static void WriteStatus() {
+  for(;;) {
+    ssize_t l = ::write(STDOUT_FILENO,((char*)&status)+status_pos,sizeof(status)-status_pos);
+    if(l == -1) { // error, parent exited?
+      break;
+    } else if(l == 0) { // will happen if stdout is non-blocking
+      break;
+    } else {
+      status_pos+=l;
+    };
+    if(status_pos >= sizeof(status)) {
+      status_pos=0;
+      status_changed=false;
+      break;
+    };
+  };
+}
+
 static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
                          DataStaging::DTRErrorStatus::DTRErrorStatusType err,
                          DataStaging::DTRErrorStatus::DTRErrorLocation err_loc,
@@ -36,10 +60,6 @@ static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
                          unsigned long long int size,
                          Arc::Time transfer_start_time,
                          const std::string& checksum = "") {
-  static DataStaging::DataDeliveryComm::Status status;
-  static unsigned int status_pos = 0;
-  static bool status_changed = true;
-
   unsigned long long int transfer_time = 0;
   if (transfer_start_time != Arc::Time(0)) {
     Arc::Period p = Arc::Time() - transfer_start_time;
@@ -63,23 +83,17 @@ static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
   if(status_pos == 0) {
     status_changed=true;
   };
-  if(status_changed) {
-    for(;;) {
-      ssize_t l = ::write(STDOUT_FILENO,((char*)&status)+status_pos,sizeof(status)-status_pos);
-      if(l == -1) { // error, parent exited?
-        break;
-      } else if(l == 0) { // will happen if stdout is non-blocking
-        break;
-      } else {
-        status_pos+=l;
-      };
-      if(status_pos >= sizeof(status)) {
-        status_pos=0;
-        status_changed=false;
-        break;
-      };
-    };
-  };
+  if(status_changed) WriteStatus();
+}
+
+// In persistent mode tells parent that transfer is finished by repeating
+// last status with exit status of transfer in commstatus.
+static void ReportTransferEnd(int code) {
+  status.commstatus = (code == 0) ? DataStaging::DataDeliveryComm::CommExited
+                                  : DataStaging::DataDeliveryComm::CommFailed;
+  status.timestamp = ::time(NULL);
+  status_changed = true;
+  WriteStatus();
 }
 
 static unsigned long long int transfer_bytes = 0;
@@ -106,13 +120,21 @@ static unsigned long long int GetFileSize(const DataPoint& source, const DataPoi
   return 0;
 }
 
-int main(int argc,char* argv[]) {
+// Finish transfer with given exit code. Single transfer process exits
+// immediately, persistent one goes on to next transfer.
+static int TransferExit(int code) {
+  if(!persistent_worker) _exit(code);
+  return code;
+}
 
-  // log to stderr
-  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
-  Arc::LogStream logcerr(std::cerr);
-  logcerr.setFormat(Arc::EmptyFormat);
-  Arc::Logger::getRootLogger().addDestination(logcerr);
+static int RunTransfer(int argc, char* argv[], const std::string& proxy_cred) {
+
+  // Reset state left by previous transfer in persistent mode
+  memset(&status,0,sizeof(status));
+  status_pos = 0;
+  status_changed = true;
+  start_time = Arc::Time();
+  transfer_bytes = 0;
 
   // Collecting parameters
   // --surl: source URL 
@@ -221,7 +243,7 @@ int main(int argc,char* argv[]) {
           buffer.speed.set_base(value);
         } else {
           logger.msg(ERROR, "Unknown transfer option: %s", name);
-          _exit(-1);
+          return TransferExit(-1);
         }
       };
     };
@@ -233,10 +255,6 @@ int main(int argc,char* argv[]) {
   CheckSumAny crc_source;
   CheckSumAny crc_dest;
 
-  // Read credential from stdin if available
-  std::string proxy_cred;
-  std::getline(std::cin, proxy_cred, '\0');
-
   initializeCredentialsType source_cred(initializeCredentialsType::SkipCredentials);
   UserConfig source_cfg(source_cred);
   if(!source_cred_path.empty()) source_cfg.ProxyPath(source_cred_path);
@@ -246,12 +264,11 @@ int main(int argc,char* argv[]) {
   DataHandle source(source_url, source_cfg);
   if(!source) {
     logger.msg(ERROR, "Source URL not supported: %s", source_url.str());
-    _exit(-1);
-    //return -1;
+    return TransferExit(-1);
   };
   if (source->RequiresCredentialsInFile() && source_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return TransferExit(-1);
   }
 
   source->SetSecure(false);
@@ -265,12 +282,11 @@ int main(int argc,char* argv[]) {
   DataHandle dest(dest_url,dest_cfg);
   if(!dest) {
     logger.msg(ERROR, "Destination URL not supported: %s", dest_url.str());
-    _exit(-1);
-    //return -1;
+    return TransferExit(-1);
   };
   if (dest->RequiresCredentialsInFile() && dest_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return TransferExit(-1);
   }
   dest->SetSecure(false);
   dest->Passive(true);
@@ -318,6 +334,10 @@ int main(int argc,char* argv[]) {
     dest->AddCheckSumObject(&crc_dest);
   }
   buffer.set(&crc);
+  // Let more buffers be used for fast transfers and keep checksum
+  // calculation out of the way of reading and writing threads
+  buffer.set_adaptive(16);
+  buffer.set_async_checksum(true);
 
   if (!size.empty()) {
     unsigned long long int total_size;
@@ -396,8 +416,7 @@ int main(int argc,char* argv[]) {
                    std::string("Failed reading from source: ")+source->CurrentLocation().str()+
                     " : "+std::string(source_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      return TransferExit(-1);
     };
     dest_st = dest->StartWriting(buffer);
     if(!dest_st) {
@@ -410,8 +429,7 @@ int main(int argc,char* argv[]) {
                    std::string("Failed writing to destination: ")+dest->CurrentLocation().str()+
                     " : "+std::string(dest_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      return TransferExit(-1);
     }
     // While transfer is running in another threads
     // here we periodically report status to parent
@@ -438,7 +456,7 @@ int main(int argc,char* argv[]) {
                  buffer.speed.transferred_size(),
                  GetFileSize(*source,*dest),0);
     dest->StopWriting();
-    _exit(-1);
+    return TransferExit(-1);
   }
   ReportStatus(DataStaging::DTRStatus::TRANSFERRING,
                DataStaging::DTRErrorStatus::NONE_ERROR,
@@ -567,7 +585,61 @@ int main(int argc,char* argv[]) {
                  start_time,
                  calc_csum);
   };
-  _exit(eof_reached?0:1);
-  //return eof_reached?0:1;
+  return TransferExit(eof_reached?0:1);
+}
+
+int main(int argc,char* argv[]) {
+
+  // log to stderr
+  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
+  Arc::LogStream logcerr(std::cerr);
+  logcerr.setFormat(Arc::EmptyFormat);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+
+  if((argc < 2) || (strcmp(argv[1], "--worker") != 0)) {
+    // Read credential from stdin if available
+    std::string proxy_cred;
+    std::getline(std::cin, proxy_cred, '\0');
+    return RunTransfer(argc, argv, proxy_cred);
+  }
+
+  // Persistent mode: read transfer requests from stdin until it is closed.
+  // Each request is the number of arguments, the credential and the
+  // arguments, all terminated by \0.
+  persistent_worker = true;
+  signal(SIGTERM, sig_shutdown);
+  signal(SIGINT, sig_shutdown);
+  while(!delivery_shutdown) {
+    std::string num_str;
+    if(!std::getline(std::cin, num_str, '\0')) break;
+    unsigned int num = 0;
+    if(!stringto(num_str, num)) {
+      logger.msg(ERROR, "Bad request received: %s", num_str);
+      return -1;
+    };
+    std::string proxy_cred;
+    std::getline(std::cin, proxy_cred, '\0');
+    std::vector<std::string> args(1, argv[0]);
+    for(unsigned int n = 0; n < num; ++n) {
+      std::string arg;
+      std::getline(std::cin, arg, '\0');
+      args.push_back(arg);
+    };
+    if(!std::cin) break;
+    std::vector<char*> args_p;
+    for(std::vector<std::string>::iterator arg = args.begin(); arg != args.end(); ++arg) {
+      args_p.push_back(const_cast<char*>(arg->c_str()));
+    };
+    args_p.push_back(NULL);
+    // Credentials of previous transfer must not be used by 3rd party tools
+    UnsetEnv("X509_USER_PROXY");
+    UnsetEnv("X509_USER_CERT");
+    UnsetEnv("X509_USER_KEY");
+    UnsetEnv("X509_CERT_DIR");
+    optind = 0; // getopt must start parsing from beginning again
+    int code = RunTransfer(args_p.size()-1, &args_p[0], proxy_cred);
+    ReportTransferEnd(code);
+  };
+  return 0;
 }
 
@@ -803,6 +803,7 @@ namespace DataStaging {
     event_lock.lock();
     events.push_back(event);
     event_lock.unlock();
+    wakeup_signal.signal();
   }
 
   void Scheduler::choose_delivery_service(DTR_ptr request) {
@@ -957,9 +958,10 @@ namespace DataStaging {
     }
   }
 
-  void Scheduler::process_events(void){
+  bool Scheduler::process_events(void){
     
     Arc::Time now;
+    bool processed = false;
     event_lock.lock();
 
     for (std::list<DTR_ptr>::iterator event = events.begin(); event != events.end();) {
@@ -967,10 +969,13 @@ namespace DataStaging {
       event_lock.unlock();
 
       if (tmp->get_process_time() <= now) {
+        DTRStatus::DTRStatusType status = tmp->get_status().GetStatus();
         map_state_and_process(tmp);
+        if (tmp->get_status().GetStatus() != status) processed = true;
         // If final state, the DTR is returned to the generator and deleted
         if (tmp->is_in_final_state()) {
           ProcessDTRFINAL_STATE(tmp);
+          processed = true;
           event_lock.lock();
           event = events.erase(event);
           continue;
@@ -979,15 +984,70 @@ namespace DataStaging {
         if (tmp->is_destined_for_pre_processor() ||
             tmp->is_destined_for_delivery() ||
             tmp->is_destined_for_post_processor()) {
+          processed = true;
           event_lock.lock();
           event = events.erase(event);
           continue;
         }
       }
+      // The DTR has to wait, so park it until its process time instead of
+      // checking it again on every loop
+      if (tmp->get_process_time() > now) {
+        delayed_events.insert(std::make_pair(tmp->get_process_time(), tmp));
+        event_lock.lock();
+        event = events.erase(event);
+        continue;
+      }
       event_lock.lock();
       ++event;
     }
     event_lock.unlock();
+    return processed;
+  }
+
+  void Scheduler::process_delayed_events(bool all) {
+
+    Arc::Time now;
+    std::list<DTR_ptr> ready;
+    for (std::multimap<Arc::Time, DTR_ptr>::iterator event = delayed_events.begin();
+         event != delayed_events.end();) {
+      if (event->first > now && !all) break;
+      // The process time may have changed since the DTR was parked
+      if (event->first <= now || event->second->get_process_time() <= now) {
+        ready.push_back(event->second);
+        delayed_events.erase(event++);
+        continue;
+      }
+      ++event;
+    }
+    if (ready.empty()) return;
+    event_lock.lock();
+    events.splice(events.end(), ready);
+    event_lock.unlock();
+  }
+
+  bool Scheduler::process_cancelled_jobs(void) {
+
+    bool cancelled = false;
+    cancelled_jobs_lock.lock();
+    std::list<std::string>::iterator jobid = cancelled_jobs.begin();
+    for (;jobid != cancelled_jobs.end();) {
+      std::list<DTR_ptr> requests;
+      DtrList.filter_dtrs_by_job(*jobid, requests);
+      for (std::list<DTR_ptr>::iterator dtr = requests.begin(); dtr != requests.end(); ++dtr) {
+        (*dtr)->set_cancel_request();
+        (*dtr)->get_logger()->msg(Arc::INFO, "DTR %s cancelled", (*dtr)->get_id());
+        cancelled = true;
+      }
+      jobid = cancelled_jobs.erase(jobid);
+    }
+    cancelled_jobs_lock.unlock();
+    return cancelled;
+  }
+
+  void Scheduler::count_delivery_host(DTR_ptr request, void* arg) {
+    std::map<std::string, int>* hosts = (std::map<std::string, int>*)arg;
+    (*hosts)[request->get_delivery_endpoint().Host()]++;
   }
 
   void Scheduler::revise_queues() {
@@ -1003,10 +1063,7 @@ namespace DataStaging {
     // Get the number of current transfers for each delivery service for
     // enforcing limits per server
     delivery_hosts.clear();
-    for (std::list<DTR_ptr>::const_iterator i = DTRRunningStates[DTRStatus::TRANSFERRING].begin();
-         i != DTRRunningStates[DTRStatus::TRANSFERRING].end(); i++) {
-      delivery_hosts[(*i)->get_delivery_endpoint().Host()]++;
-    }
+    DtrList.for_each_dtr_by_status(DTRStatus::TRANSFERRING, &count_delivery_host, &delivery_hosts);
 
     // Check for any requested changes in priority
     DtrList.check_priority_changes(std::string(dumplocation + ".prio"));
@@ -1034,8 +1091,8 @@ namespace DataStaging {
     // Go through "to process" states, work out shares and push DTRs
     for (unsigned int i = 0; i < DTRStatus::ToProcessStates.size(); ++i) {
 
-      std::list<DTR_ptr> DTRQueue = DTRQueueStates[DTRStatus::ToProcessStates.at(i)];
-      std::list<DTR_ptr> ActiveDTRs = DTRRunningStates[DTRStatus::ProcessingStates.at(i)];
+      std::list<DTR_ptr>& DTRQueue = DTRQueueStates[DTRStatus::ToProcessStates.at(i)];
+      std::list<DTR_ptr>& ActiveDTRs = DTRRunningStates[DTRStatus::ProcessingStates.at(i)];
 
       if (DTRQueue.empty() && ActiveDTRs.empty()) continue;
 
@@ -1320,6 +1377,7 @@ namespace DataStaging {
     cancelled_jobs_lock.lock();
     cancelled_jobs.push_back(jobid);
     cancelled_jobs_lock.unlock();
+    wakeup_signal.signal();
     return true;
   }
 
@@ -1351,6 +1409,7 @@ namespace DataStaging {
 
     // signal main loop to stop and wait for completion of all DTRs
     scheduler_state = TO_STOP;
+    wakeup_signal.signal();
     run_signal.wait();
     scheduler_state = STOPPED;
 
@@ -1389,27 +1448,39 @@ namespace DataStaging {
     Arc::Logger::getRootLogger().removeDestinations();
     Arc::Logger::getRootLogger().setThreshold(DTR::LOG_LEVEL);
 
+    // The loop sleeps until an event arrives, a delayed DTR becomes ready
+    // or it is time for the periodic revision of queues, which takes care of
+    // timeouts, priority changes and retries of delivery endpoints.
+    const int revise_period = 1000; // ms
+    Arc::Time next_revise;
+
     while(scheduler_state != TO_STOP || !DtrList.empty()) {
-      // first check for cancelled jobs
-      cancelled_jobs_lock.lock();
-      std::list<std::string>::iterator jobid = cancelled_jobs.begin();
-      for (;jobid != cancelled_jobs.end();) {
-        std::list<DTR_ptr> requests;
-        DtrList.filter_dtrs_by_job(*jobid, requests);
-        for (std::list<DTR_ptr>::iterator dtr = requests.begin(); dtr != requests.end(); ++dtr) {
-          (*dtr)->set_cancel_request();
-          (*dtr)->get_logger()->msg(Arc::INFO, "DTR %s cancelled", (*dtr)->get_id());
-        }
-        jobid = cancelled_jobs.erase(jobid);
-      }
-      cancelled_jobs_lock.unlock();
+      // first check for cancelled jobs, DTRs waiting for their process time
+      // may now have to be processed
+      bool changed = process_cancelled_jobs();
+      process_delayed_events(changed);
 
       // Dealing with pending events, i.e. DTRs from another processes
-      process_events();
+      if (process_events()) changed = true;
+
       // Revise all the internal queues and take actions
-      revise_queues();
+      Arc::Time now;
+      if (changed || next_revise <= now) {
+        revise_queues();
+        next_revise = Arc::Time() + Arc::Period(revise_period/1000);
+      }
 
-      Glib::usleep(50000);
+      // Work out how long we can sleep before something must be done
+      now = Arc::Time();
+      Arc::Time wakeup(next_revise);
+      if (!delayed_events.empty() && delayed_events.begin()->first < wakeup) {
+        wakeup = delayed_events.begin()->first;
+      }
+      if (wakeup <= now) continue;
+      Arc::Period sleep_period(wakeup - now);
+      int sleep_time = sleep_period.GetPeriod()*1000 + sleep_period.GetPeriodNanoseconds()/1000000 + 1;
+      if (sleep_time > revise_period) sleep_time = revise_period;
+      wakeup_signal.wait(sleep_time);
     }
     // make sure final state is dumped before exit
     dump_signal.signal();
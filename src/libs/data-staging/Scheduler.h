@@ -40,6 +40,10 @@ class Scheduler: public DTRCallback {
     /// A list of DTRs to process
     std::list<DTR_ptr> events;
 
+    /// DTRs which must wait until their process time, ordered by that time.
+    /** Only accessed from the main thread, so no lock is needed. */
+    std::multimap<Arc::Time, DTR_ptr> delayed_events;
+
     /// Map of transfer shares to staged DTRs. Filled each event processing loop
     std::map<std::string, std::list<DTR_ptr> > staged_queue;
 
@@ -61,6 +65,9 @@ class Scheduler: public DTRCallback {
     /// Lock for events list
     Arc::SimpleCondition event_lock;
 
+    /// Condition to wake up the main loop when new events or cancellations arrive
+    Arc::SimpleCondition wakeup_signal;
+
     /// Condition to signal end of running
     Arc::SimpleCondition run_signal;
 
@@ -179,15 +186,30 @@ class Scheduler: public DTRCallback {
     /// configured services when the first DTR is received.
     void choose_delivery_service(DTR_ptr request);
 
+    /// Add the delivery host of the DTR to the map of hosts passed in arg.
+    static void count_delivery_host(DTR_ptr request, void* arg);
+
     /// Go through all DTRs waiting to go into a processing state and decide
     /// whether to push them into that state, depending on shares and limits.
     void revise_queues();
 
     /// Add a new event for the Scheduler to process. Used in receiveDTR().
+    /** The main loop is woken up to process it immediately. */
     void add_event(DTR_ptr event);
 
-    /// Process the pool of DTRs which have arrived from other processes
-    void process_events(void);
+    /// Process the pool of DTRs which have arrived from other processes.
+    /** DTRs which cannot be processed yet are moved to delayed_events.
+     * Returns true if any DTR changed state. */
+    bool process_events(void);
+
+    /// Move delayed DTRs whose process time has passed back to the events list.
+    /** If all is true then all delayed DTRs with cancellation requests are
+     * also moved, since cancellation resets the process time. */
+    void process_delayed_events(bool all = false);
+
+    /// Handle jobs which were requested to be cancelled. Returns true if any
+    /// DTR was marked as cancelled.
+    bool process_cancelled_jobs(void);
     
     /// Move to the next replica in the DTR.
     /** Utility function which should be called in the case of error
@@ -0,0 +1,101 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../DTRList.h"
+
+using namespace DataStaging;
+
+class DTRListTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DTRListTest);
+  CPPUNIT_TEST(TestDTRListIndexes);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestDTRListIndexes();
+
+  void setUp();
+  void tearDown();
+
+private:
+  std::list<DTRLogDestination> logs;
+  char const * log_name;
+  Arc::UserConfig cfg;
+};
+
+void DTRListTest::setUp() {
+  logs.clear();
+  const std::list<Arc::LogDestination*>& destinations = Arc::Logger::getRootLogger().getDestinations();
+  for(std::list<Arc::LogDestination*>::const_iterator dest = destinations.begin(); dest != destinations.end(); ++dest) {
+    logs.push_back(*dest);
+  }
+  log_name = "DataStagingTest";
+}
+
+void DTRListTest::tearDown() {
+}
+
+void DTRListTest::TestDTRListIndexes() {
+  DTRList dtrlist;
+  DTR_ptr dtr1(new DTR("mock://mocksrc/1", "mock://mockdest/1", cfg, "job1", Arc::User().get_uid(), logs, log_name));
+  DTR_ptr dtr2(new DTR("mock://mocksrc/2", "mock://mockdest/2", cfg, "job1", Arc::User().get_uid(), logs, log_name));
+  DTR_ptr dtr3(new DTR("mock://mocksrc/3", "mock://mockdest/3", cfg, "job2", Arc::User().get_uid(), logs, log_name));
+  CPPUNIT_ASSERT(*dtr1);
+  CPPUNIT_ASSERT(*dtr2);
+  CPPUNIT_ASSERT(*dtr3);
+
+  CPPUNIT_ASSERT(dtrlist.add_dtr(dtr1));
+  CPPUNIT_ASSERT(dtrlist.add_dtr(dtr2));
+  CPPUNIT_ASSERT(dtrlist.add_dtr(dtr3));
+  // adding twice is not allowed
+  CPPUNIT_ASSERT(!dtrlist.add_dtr(dtr1));
+  CPPUNIT_ASSERT_EQUAL(3, (int)dtrlist.size());
+  CPPUNIT_ASSERT_EQUAL(3, dtrlist.number_of_dtrs_by_status(DTRStatus::NEW));
+  CPPUNIT_ASSERT_EQUAL(3, dtrlist.number_of_dtrs_by_owner(GENERATOR));
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrlist.all_jobs().size());
+
+  // status changes are reflected in the index
+  dtr1->set_status(DTRStatus::CHECK_CACHE);
+  dtr2->set_status(DTRStatus::TRANSFER);
+  CPPUNIT_ASSERT_EQUAL(1, dtrlist.number_of_dtrs_by_status(DTRStatus::NEW));
+  std::list<DTR_ptr> dtrs;
+  dtrlist.filter_dtrs_by_status(DTRStatus::CHECK_CACHE, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr1->get_id(), dtrs.front()->get_id());
+  dtrs.clear();
+  dtrlist.filter_dtrs_by_next_receiver(DELIVERY, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr2->get_id(), dtrs.front()->get_id());
+  dtrs.clear();
+  dtrlist.filter_pending_dtrs(dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(dtr3->get_id(), dtrs.front()->get_id());
+
+  // owner changes are reflected in the index
+  DTR::push(dtr3, SCHEDULER);
+  CPPUNIT_ASSERT_EQUAL(2, dtrlist.number_of_dtrs_by_owner(GENERATOR));
+  CPPUNIT_ASSERT_EQUAL(1, dtrlist.number_of_dtrs_by_owner(SCHEDULER));
+
+  dtrs.clear();
+  dtrlist.filter_dtrs_by_job("job1", dtrs);
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrs.size());
+
+  // deleted DTRs are removed from all indexes
+  CPPUNIT_ASSERT(dtrlist.delete_dtr(dtr1));
+  dtr1->set_status(DTRStatus::CHECKING_CACHE);
+  CPPUNIT_ASSERT_EQUAL(0, dtrlist.number_of_dtrs_by_status(DTRStatus::CHECK_CACHE));
+  CPPUNIT_ASSERT_EQUAL(0, dtrlist.number_of_dtrs_by_status(DTRStatus::CHECKING_CACHE));
+  dtrs.clear();
+  dtrlist.filter_dtrs_by_job("job1", dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT(dtrlist.delete_dtr(dtr3));
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrlist.all_jobs().size());
+  CPPUNIT_ASSERT(dtrlist.delete_dtr(dtr2));
+  CPPUNIT_ASSERT(dtrlist.empty());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DTRListTest);
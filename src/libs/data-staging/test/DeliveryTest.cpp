@@ -23,12 +23,14 @@ class DeliveryTest
   CPPUNIT_TEST(TestDeliverySimple);
   CPPUNIT_TEST(TestDeliveryFailure);
   CPPUNIT_TEST(TestDeliveryUnsupported);
+  CPPUNIT_TEST(TestDeliveryPersistent);
   CPPUNIT_TEST_SUITE_END();
 
 public:
   void TestDeliverySimple();
   void TestDeliveryFailure();
   void TestDeliveryUnsupported();
+  void TestDeliveryPersistent();
   void setUp();
   void tearDown();
 
@@ -146,4 +148,37 @@ void DeliveryTest::TestDeliveryUnsupported() {
   CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::INTERNAL_LOGIC_ERROR, dtr->get_error_status().GetErrorStatus());
 }
 
+void DeliveryTest::TestDeliveryPersistent() {
+
+  // Each delivery process does two transfers, so the third transfer
+  // checks that the process is replaced correctly
+  DataStaging::TransferParameters params;
+  params.persistent_delivery_transfers = 2;
+  DataStaging::DataDelivery delivery;
+  delivery.SetTransferParameters(params);
+  delivery.start();
+
+  const char* sources[] = { "mock://mocksrc/1", "fail://mocksrc/2", "mock://mocksrc/3" };
+  const char* destinations[] = { "mock://mockdest/1", "fail://mockdest/2", "mock://mockdest/3" };
+  for (int n = 0; n < 3; ++n) {
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR(sources[n],destinations[n],cfg,"1234",Arc::User().get_uid(),logs,log_name));
+    CPPUNIT_ASSERT(*dtr);
+    delivery.receiveDTR(dtr);
+    DataStaging::DTRStatus status = dtr->get_status();
+    for(int cnt=0;;++cnt) {
+      status = dtr->get_status();
+      if(status != DataStaging::DTRStatus::TRANSFERRING && status != DataStaging::DTRStatus::NULL_STATE) break;
+      CPPUNIT_ASSERT(cnt < 300); // 30s limit on transfer time
+      Glib::usleep(100000);
+    }
+    CPPUNIT_ASSERT_EQUAL(DataStaging::DTRStatus::TRANSFERRED, status.GetStatus());
+    if (n == 1) {
+      // Failure must not affect following transfers done by the same process
+      CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::TEMPORARY_REMOTE_ERROR, dtr->get_error_status().GetErrorStatus());
+    } else {
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(dtr->get_error_status().GetDesc(), DataStaging::DTRErrorStatus::NONE_ERROR, dtr->get_error_status().GetErrorStatus());
+    }
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DeliveryTest);
@@ -0,0 +1,190 @@
+#ifndef __AREX_SQLITE_DB_H__
+#define __AREX_SQLITE_DB_H__
+
+#include <string>
+#include <map>
+
+#include <sqlite3.h>
+
+#include <arc/Thread.h>
+
+namespace ARex {
+
+/// Connection to SQLite database used by A-REX stores.
+/**
+ * Statements are prepared once per distinct SQL text and kept till the
+ * connection is closed. Values are passed as bound parameters. Waiting
+ * for database locked by other process is done by busy handler inside
+ * SQLite. Database is switched to WAL mode, so readers and writer do not
+ * block each other.
+ * Connection may be used by several threads. Statement or transaction
+ * holds lock of connection while it exists.
+ */
+class SQLiteDB {
+  friend class SQLiteStatement;
+  friend class SQLiteTransaction;
+ private:
+  sqlite3* db_;
+  Glib::RecMutex lock_;
+  std::map<std::string,sqlite3_stmt*> statements_;
+  SQLiteDB(const SQLiteDB&);
+  static int BusyHandler(void* arg, int count) {
+    // Access to database is designed in such way that it should not block for long time.
+    // So it is safe to wait for lock to be released without any timeout.
+    sqlite3_sleep((count < 10) ? 1 : 10);
+    return 1;
+  };
+ public:
+  SQLiteDB(void): db_(NULL) {};
+  ~SQLiteDB(void) { Close(); };
+  /// Open database file. Returns SQLite error code.
+  int Open(const std::string& path, bool create, bool wal = true) {
+    Glib::RecMutex::Lock lock(lock_);
+    if(db_) return SQLITE_OK;
+    int flags = SQLITE_OPEN_READWRITE;
+    if(create) flags |= SQLITE_OPEN_CREATE;
+    int err = sqlite3_open_v2(path.c_str(), &db_, flags, NULL);
+    if(err != SQLITE_OK) {
+      if(db_) (void)sqlite3_close(db_);
+      db_ = NULL;
+      return err;
+    };
+    (void)sqlite3_busy_handler(db_, &BusyHandler, NULL);
+    if(wal) {
+      // Failure is not fatal - database then stays in rollback journal mode.
+      // In WAL mode commits are synced at checkpoints only, which is still
+      // safe against corruption.
+      if(sqlite3_exec(db_, "PRAGMA journal_mode=WAL", NULL, NULL, NULL) == SQLITE_OK) {
+        (void)sqlite3_exec(db_, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+      };
+    };
+    return SQLITE_OK;
+  };
+  void Close(void) {
+    Glib::RecMutex::Lock lock(lock_);
+    for(std::map<std::string,sqlite3_stmt*>::iterator s = statements_.begin(); s != statements_.end(); ++s) {
+      (void)sqlite3_finalize(s->second);
+    };
+    statements_.clear();
+    if(db_) (void)sqlite3_close(db_);
+    db_ = NULL;
+  };
+  operator bool(void) const { return (db_ != NULL); };
+  bool operator!(void) const { return (db_ == NULL); };
+  /// Run SQL text without preparing it for later use. Suitable for schema handling.
+  int Exec(const char* sql, int (*callback)(void*,int,char**,char**) = NULL, void* arg = NULL) {
+    Glib::RecMutex::Lock lock(lock_);
+    if(!db_) return SQLITE_MISUSE;
+    return sqlite3_exec(db_, sql, callback, arg, NULL);
+  };
+  /// Number of rows changed by last statement. Must be called while statement still exists.
+  int Changes(void) { return db_ ? sqlite3_changes(db_) : 0; };
+  /// Row id of last inserted row. Must be called while statement still exists.
+  sqlite3_int64 LastInsertId(void) { return db_ ? sqlite3_last_insert_rowid(db_) : 0; };
+};
+
+/// Prepared statement of SQLiteDB
+/**
+ * Parameters are bound in order of their appearance in SQL text.
+ * Statement is reset and connection is released when object is destroyed.
+ */
+class SQLiteStatement {
+ private:
+  SQLiteDB& db_;
+  Glib::RecMutex::Lock lock_;
+  sqlite3_stmt* stmt_;
+  int err_;
+  int param_;
+  SQLiteStatement(const SQLiteStatement&);
+ public:
+  SQLiteStatement(SQLiteDB& db, const std::string& sql):
+      db_(db), lock_(db.lock_), stmt_(NULL), err_(SQLITE_OK), param_(0) {
+    if(!db_.db_) { err_ = SQLITE_MISUSE; return; };
+    std::map<std::string,sqlite3_stmt*>::iterator s = db_.statements_.find(sql);
+    if(s != db_.statements_.end()) { stmt_ = s->second; return; };
+    err_ = sqlite3_prepare_v2(db_.db_, sql.c_str(), -1, &stmt_, NULL);
+    if(err_ != SQLITE_OK) {
+      if(stmt_) (void)sqlite3_finalize(stmt_);
+      stmt_ = NULL;
+      return;
+    };
+    db_.statements_[sql] = stmt_;
+  };
+  ~SQLiteStatement(void) {
+    if(stmt_) {
+      (void)sqlite3_reset(stmt_);
+      (void)sqlite3_clear_bindings(stmt_);
+    };
+  };
+  operator bool(void) const { return (stmt_ != NULL); };
+  bool operator!(void) const { return (stmt_ == NULL); };
+  /// First error which happened while preparing, binding or running statement
+  int Error(void) const { return err_; };
+  SQLiteStatement& Bind(const std::string& value) {
+    if(stmt_ && (err_ == SQLITE_OK)) err_ = sqlite3_bind_text(stmt_, ++param_, value.c_str(), value.length(), SQLITE_TRANSIENT);
+    return *this;
+  };
+  SQLiteStatement& Bind(sqlite3_int64 value) {
+    if(stmt_ && (err_ == SQLITE_OK)) err_ = sqlite3_bind_int64(stmt_, ++param_, value);
+    return *this;
+  };
+  /// Run statement till next row. Returns SQLITE_ROW, SQLITE_DONE or error code.
+  int Step(void) {
+    if(!stmt_ || (err_ != SQLITE_OK)) return err_;
+    int err = sqlite3_step(stmt_);
+    if((err != SQLITE_ROW) && (err != SQLITE_DONE)) err_ = err;
+    return err;
+  };
+  /// Run statement which is not expected to return rows. Returns SQLite error code.
+  int Exec(void) {
+    int err = Step();
+    return ((err == SQLITE_ROW) || (err == SQLITE_DONE)) ? SQLITE_OK : err;
+  };
+  /// Value of column of current row
+  std::string Text(int col) {
+    const unsigned char* text = sqlite3_column_text(stmt_, col);
+    if(!text) return "";
+    return std::string((char const*)text, sqlite3_column_bytes(stmt_, col));
+  };
+  sqlite3_int64 Int(int col) { return sqlite3_column_int64(stmt_, col); };
+};
+
+/// Transaction of SQLiteDB
+/**
+ * Write lock is taken when transaction starts, so statements inside it
+ * do not fail because database is busy. Transaction is rolled back if
+ * not committed before object is destroyed.
+ * Transaction started while other one is active becomes savepoint
+ * inside it. So its failure does not discard other changes of outer
+ * transaction and its changes are written only when outer transaction
+ * is committed.
+ */
+class SQLiteTransaction {
+ private:
+  SQLiteDB& db_;
+  Glib::RecMutex::Lock lock_;
+  bool active_;
+  bool nested_;
+  SQLiteTransaction(const SQLiteTransaction&);
+ public:
+  SQLiteTransaction(SQLiteDB& db): db_(db), lock_(db.lock_), active_(false), nested_(false) {
+    if(!db_.db_) return;
+    nested_ = (sqlite3_get_autocommit(db_.db_) == 0);
+    active_ = (sqlite3_exec(db_.db_, nested_ ? "SAVEPOINT nested" : "BEGIN IMMEDIATE", NULL, NULL, NULL) == SQLITE_OK);
+  };
+  ~SQLiteTransaction(void) {
+    if(active_) (void)sqlite3_exec(db_.db_, nested_ ? "ROLLBACK TO nested; RELEASE nested" : "ROLLBACK", NULL, NULL, NULL);
+  };
+  operator bool(void) const { return active_; };
+  bool operator!(void) const { return !active_; };
+  int Commit(void) {
+    if(!active_) return SQLITE_MISUSE;
+    int err = sqlite3_exec(db_.db_, nested_ ? "RELEASE nested" : "COMMIT", NULL, NULL, NULL);
+    if(err == SQLITE_OK) active_ = false;
+    return err;
+  };
+};
+
+} // namespace ARex
+
+#endif // __AREX_SQLITE_DB_H__
@@ -34,16 +34,28 @@ class CountedResource {
 };
 
 class OptimizedInformationContainer: public Arc::InformationContainer {
+ public:
+  /// Forms of document revision prepared once for serving many requests
+  class Rendition {
+   public:
+    std::string etag; // strong entity tag, quoted
+    std::string gzip; // gzip compressed document, empty if not available
+    std::string gzip_etag; // strong entity tag of compressed document
+  };
  private:
   bool parse_xml_;
   std::string filename_;
   int handle_;
   Arc::XMLNode doc_;
+  Arc::ThreadedPointer<Rendition> rendition_;
   Glib::Mutex olock_;
+  static Rendition* Render(const std::string& xml);
  public:
   OptimizedInformationContainer(bool parse_xml = true);
   ~OptimizedInformationContainer(void);
   int OpenDocument(void);
+  /// Open document together with its rendition belonging to same revision
+  int OpenDocument(Arc::ThreadedPointer<Rendition>& rendition);
   void AssignFile(const std::string& filename);
   void Assign(const std::string& xml,const std::string filename = "");
 };
@@ -190,6 +202,7 @@ class ARexService: public Arc::Service {
   static Arc::MCC_Status extract_content(Arc::Message& inmsg, std::string& content,uint32_t size_limit = 0);
 
   void InformationCollector(void);
+  bool UpdateJobsInformation(JobsCounters& last_counters, bool force);
   virtual bool RegistrationCollector(Arc::XMLNode &doc);
   virtual std::string getID();
   void StopChildThreads(void);
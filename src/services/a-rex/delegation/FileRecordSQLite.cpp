@@ -41,8 +41,7 @@ namespace ARex {
   }
 
   FileRecordSQLite::FileRecordSQLite(const std::string& base, bool create):
-      FileRecord(base, create),
-      db_(NULL) {
+      FileRecord(base, create) {
     valid_ = open(create);
   }
 
@@ -55,65 +54,35 @@ namespace ARex {
     close();
   }
 
-  int FileRecordSQLite::sqlite3_exec_nobusy(const char *sql, int (*callback)(void*,int,char**,char**), 
-    void *arg, char **errmsg) {
-      int err;
-      while((err = sqlite3_exec(db_, sql, callback, arg, errmsg)) == SQLITE_BUSY) {
-        // Access to database is designed in such way that it should not block for long time.
-        // So it should be safe to simply wait for lock to be released without any timeout.
-        struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
-        (void)::nanosleep(&delay, NULL);
-      };
-      return err;
-  }
-
   bool FileRecordSQLite::open(bool create) {
     std::string dbpath = basepath_ + G_DIR_SEPARATOR_S + FR_DB_NAME;
-    if(db_ != NULL) return true; // already open
+    if(db_) return true; // already open
 
-    int flags = SQLITE_OPEN_READWRITE; // it will open read-only if access is protected
-    if(create) {
-      flags |= SQLITE_OPEN_CREATE;
-    };
-    int err;
-    while((err = sqlite3_open_v2(dbpath.c_str(), &db_, flags, NULL)) == SQLITE_BUSY) {
-      // In case something prevents databasre from open right now - retry
-      if(db_) (void)sqlite3_close(db_);
-      db_ = NULL;
-      struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
-      (void)::nanosleep(&delay, NULL);
-    };
-    if(!dberr("Error opening database", err)) {
-      if(db_) (void)sqlite3_close(db_);
-      db_ = NULL;
+    // it will open read-only if access is protected
+    if(!dberr("Error opening database", db_.Open(dbpath, create))) {
       return false;
     };
     if(create) {
-      if(!dberr("Error creating table rec", sqlite3_exec_nobusy("CREATE TABLE IF NOT EXISTS rec(id, owner, uid, meta, UNIQUE(id, owner), UNIQUE(uid))", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+      if(!dberr("Error creating table rec", db_.Exec("CREATE TABLE IF NOT EXISTS rec(id, owner, uid, meta, UNIQUE(id, owner), UNIQUE(uid))"))) {
+        db_.Close();
         return false;
       };
-      if(!dberr("Error creating table lock", sqlite3_exec_nobusy("CREATE TABLE IF NOT EXISTS lock(lockid, uid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+      if(!dberr("Error creating table lock", db_.Exec("CREATE TABLE IF NOT EXISTS lock(lockid, uid)"))) {
+        db_.Close();
         return false;
       };
-      if(!dberr("Error creating index lockid", sqlite3_exec_nobusy("CREATE INDEX IF NOT EXISTS lockid ON lock (lockid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+      if(!dberr("Error creating index lockid", db_.Exec("CREATE INDEX IF NOT EXISTS lockid ON lock (lockid)"))) {
+        db_.Close();
         return false;
       };
-      if(!dberr("Error creating index uid", sqlite3_exec_nobusy("CREATE INDEX IF NOT EXISTS uid ON lock (uid)", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+      if(!dberr("Error creating index uid", db_.Exec("CREATE INDEX IF NOT EXISTS uid ON lock (uid)"))) {
+        db_.Close();
         return false;
       };
     } else {
       // SQLite opens database in lazy way. But we still want to know if it is good database.
-      if(!dberr("Error checking database", sqlite3_exec_nobusy("PRAGMA schema_version;", NULL, NULL, NULL))) {
-        (void)sqlite3_close(db_); // todo: handle error
-        db_ = NULL;
+      if(!dberr("Error checking database", db_.Exec("PRAGMA schema_version;"))) {
+        db_.Close();
         return false;
       };
     };
@@ -122,29 +91,23 @@ namespace ARex {
 
   void FileRecordSQLite::close(void) {
     valid_ = false;
-    if(db_) {
-      (void)sqlite3_close(db_); // todo: handle error
-      db_ = NULL;
-    };
+    db_.Close();
   }
 
   void store_strings(const std::list<std::string>& strs, std::string& buf) {
-    if(!strs.empty()) {
-      for(std::list<std::string>::const_iterator str = strs.begin(); ; ++str) {
-        buf += sql_escape(*str);
-        if (str == strs.end()) break;
-        buf += '#';
-      };
+    for(std::list<std::string>::const_iterator str = strs.begin(); str != strs.end(); ++str) {
+      buf += sql_escape(*str);
+      buf += '#';
     };
   }
 
-  static void parse_strings(std::list<std::string>& strs, const char* buf) {
-    if(!buf || (*buf == '\0')) return;
-    const char* sep = std::strchr(buf, '#');
-    while(sep) {
-      strs.push_back(sql_unescape(std::string(buf,sep-buf)));
-      buf = sep+1;
-      sep = std::strchr(buf, '#');
+  static void parse_strings(std::list<std::string>& strs, const std::string& buf) {
+    std::string::size_type start = 0;
+    std::string::size_type sep = buf.find('#');
+    while(sep != std::string::npos) {
+      strs.push_back(sql_unescape(buf.substr(start, sep-start)));
+      start = sep+1;
+      sep = buf.find('#', start);
     };
   }
 
@@ -157,121 +120,31 @@ namespace ARex {
     return false;
   }
 
-  struct FindCallbackRecArg {
-    sqlite3_int64 rowid;
-    std::string id;
-    std::string owner;
-    std::string uid;
-    std::list<std::string> meta;
-    FindCallbackRecArg(): rowid(-1) {};
-  };
-
-  static int FindCallbackRec(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if((strcmp(names[n], "rowid") == 0) || (strcmp(names[n], "_rowid_") == 0)) {
-          (void)Arc::stringto(texts[n], ((FindCallbackRecArg*)arg)->rowid);
-        } else if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackRecArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "id") == 0) {
-          ((FindCallbackRecArg*)arg)->id = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          ((FindCallbackRecArg*)arg)->owner = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackRecArg*)arg)->meta, texts[n]);
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackUidMetaArg {
-    std::string& uid;
-    std::list<std::string>& meta;
-    FindCallbackUidMetaArg(std::string& uid, std::list<std::string>& meta): uid(uid), meta(meta) {};
-  };
-
-  static int FindCallbackUidMeta(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackUidMetaArg*)arg)->meta, texts[n]);
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackUidArg {
-    std::string& uid;
-    FindCallbackUidArg(std::string& uid): uid(uid) {};
-  };
-
-  static int FindCallbackUid(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        };
-      };
-    };
-    return 0;
-  }
-
-  struct FindCallbackCountArg {
-    int count;
-    FindCallbackCountArg():count(0) {};
-  };
-
-  static int FindCallbackCount(void* arg, int colnum, char** texts, char** names) {
-    ((FindCallbackCountArg*)arg)->count += 1;
-    return 0;
+  // Fetches uid of record. Returns false on database error.
+  bool FileRecordSQLite::find_uid(const std::string& id, const std::string& owner, std::string& uid) {
+    SQLiteStatement stmt(db_, "SELECT uid FROM rec WHERE ((id = ?) AND (owner = ?))");
+    stmt.Bind(sql_escape(id)).Bind(sql_escape(owner));
+    if(stmt.Step() == SQLITE_ROW) uid = stmt.Text(0);
+    return dberr("Failed to retrieve record from database", stmt.Error());
   }
 
-  struct FindCallbackIdOwnerArg {
-    std::list< std::pair<std::string,std::string> >& records;
-    FindCallbackIdOwnerArg(std::list< std::pair<std::string,std::string> >& recs): records(recs) {};
-  };
-
-  static int FindCallbackIdOwner(void* arg, int colnum, char** texts, char** names) {
-    std::pair<std::string,std::string> rec;
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "id") == 0) {
-          rec.first = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          rec.second = sql_unescape(texts[n]);
-        };
-      };
+  // Fetches id and owner of records locked by lock_id
+  bool FileRecordSQLite::find_locked(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids, const char* errmsg) {
+    SQLiteStatement stmt(db_, "SELECT id,owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = ?))");
+    stmt.Bind(sql_escape(lock_id));
+    while(stmt.Step() == SQLITE_ROW) {
+      std::pair<std::string,std::string> rec(sql_unescape(stmt.Text(0)), sql_unescape(stmt.Text(1)));
+      if(!rec.first.empty()) ids.push_back(rec);
     };
-    if(!rec.first.empty()) ((FindCallbackIdOwnerArg*)arg)->records.push_back(rec);
-    return 0;
+    return dberr(errmsg, stmt.Error());
   }
 
-  struct FindCallbackLockArg {
-    std::list< std::string >& records;
-    FindCallbackLockArg(std::list< std::string >& recs): records(recs) {};
-  };
-
-  static int FindCallbackLock(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "lockid") == 0) {
-          std::string rec = sql_unescape(texts[n]);
-          if(!rec.empty()) ((FindCallbackLockArg*)arg)->records.push_back(rec);
-        };
-      };
-    };
-    return 0;
-  }
-
-
   std::string FileRecordSQLite::Add(std::string& id, const std::string& owner, const std::list<std::string>& meta) {
     if(!valid_) return "";
     int uidtries = 10; // some sane number
     std::string uid;
+    std::string metas;
+    store_strings(meta, metas);
     while(true) {
       if(!(uidtries--)) {
         error_str_ = "Out of tries adding record to database";
@@ -279,12 +152,9 @@ namespace ARex {
       };
       Glib::Mutex::Lock lock(lock_);
       uid = rand_uid64().substr(4);
-      std::string metas;
-      store_strings(meta, metas);
-      std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-               sql_escape(id.empty()?uid:id)+"', '"+
-               sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-      int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
+      SQLiteStatement stmt(db_, "INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)");
+      stmt.Bind(sql_escape(id.empty()?uid:id)).Bind(sql_escape(owner)).Bind(uid).Bind(metas);
+      int dbres = stmt.Exec();
       if(dbres == SQLITE_CONSTRAINT) {
         // retry due to non-unique id
         uid.resize(0);
@@ -293,7 +163,7 @@ namespace ARex {
       if(!dberr("Failed to add record to database", dbres)) {
         return "";
       };
-      if(sqlite3_changes(db_) != 1) {
+      if(db_.Changes() != 1) {
         error_str_ = "Failed to add record to database";
         return "";
       };
@@ -309,14 +179,12 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-             sql_escape(id.empty()?uid:id)+"', '"+
-             sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-    int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
-    if(!dberr("Failed to add record to database", dbres)) {
+    SQLiteStatement stmt(db_, "INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)");
+    stmt.Bind(sql_escape(id.empty()?uid:id)).Bind(sql_escape(owner)).Bind(uid).Bind(metas);
+    if(!dberr("Failed to add record to database", stmt.Exec())) {
       return false;
     };
-    if(sqlite3_changes(db_) != 1) {
+    if(db_.Changes() != 1) {
       error_str_ = "Failed to add record to database";
       return false;
     };
@@ -326,10 +194,14 @@ namespace ARex {
   std::string FileRecordSQLite::Find(const std::string& id, const std::string& owner, std::list<std::string>& meta) {
     if(!valid_) return "";
     Glib::Mutex::Lock lock(lock_);
-    std::string sqlcmd = "SELECT uid, meta FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
+    SQLiteStatement stmt(db_, "SELECT uid, meta FROM rec WHERE ((id = ?) AND (owner = ?))");
+    stmt.Bind(sql_escape(id)).Bind(sql_escape(owner));
     std::string uid;
-    FindCallbackUidMetaArg arg(uid, meta);
-    if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUidMeta, &arg, NULL))) {
+    if(stmt.Step() == SQLITE_ROW) {
+      uid = stmt.Text(0);
+      parse_strings(meta, stmt.Text(1));
+    };
+    if(!dberr("Failed to retrieve record from database", stmt.Error())) {
       return "";
     };
     if(uid.empty()) {
@@ -344,11 +216,12 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "UPDATE rec SET meta = '"+metas+"' WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-    if(!dberr("Failed to update record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+    SQLiteStatement stmt(db_, "UPDATE rec SET meta = ? WHERE ((id = ?) AND (owner = ?))");
+    stmt.Bind(metas).Bind(sql_escape(id)).Bind(sql_escape(owner));
+    if(!dberr("Failed to update record in database", stmt.Exec())) {
       return false;
     };
-    if(sqlite3_changes(db_) < 1) {
+    if(db_.Changes() < 1) {
       error_str_ = "Failed to find record in database";
       return false;
     };
@@ -358,39 +231,46 @@ namespace ARex {
   bool FileRecordSQLite::Remove(const std::string& id, const std::string& owner) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    // Lock check and removal must not be separated by other process adding lock
+    SQLiteTransaction transaction(db_);
+    if(!transaction) {
+      error_str_ = "Failed to start transaction in database";
+      return false;
+    };
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(id, owner, uid)) {
+      return false; // No such record?
     };
     if(uid.empty()) {
       error_str_ = "Record not found";
       return false; // No such record
     };
     {
-      std::string sqlcmd = "SELECT uid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackCountArg arg;
-      if(!dberr("Failed to find locks in database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackCount, &arg, NULL))) {
+      SQLiteStatement stmt(db_, "SELECT uid FROM lock WHERE (uid = ?) LIMIT 1");
+      stmt.Bind(uid);
+      bool locked = (stmt.Step() == SQLITE_ROW);
+      if(!dberr("Failed to find locks in database", stmt.Error())) {
         return false;
       };
-      if(arg.count > 0) {
+      if(locked) {
         error_str_ = "Record has active locks";
         return false; // have locks
       };
     };
     {
-      std::string sqlcmd = "DELETE FROM rec WHERE (uid = '"+uid+"')";
-      if(!dberr("Failed to delete record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      SQLiteStatement stmt(db_, "DELETE FROM rec WHERE (uid = ?)");
+      stmt.Bind(uid);
+      if(!dberr("Failed to delete record in database", stmt.Exec())) {
         return false;
       };
-      if(sqlite3_changes(db_) < 1) {
+      if(db_.Changes() < 1) {
         error_str_ = "Failed to delete record in database";
         return false; // no such record
       };
     };
+    if(!dberr("Failed to delete record in database", transaction.Commit())) {
+      return false;
+    };
     remove_file(uid);
     return true;
   }
@@ -398,25 +278,28 @@ namespace ARex {
   bool FileRecordSQLite::AddLock(const std::string& lock_id, const std::list<std::string>& ids, const std::string& owner) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    // All credentials are locked at once
+    SQLiteTransaction transaction(db_);
+    if(!transaction) {
+      error_str_ = "Failed to start transaction in database";
+      return false;
+    };
     for(std::list<std::string>::const_iterator id = ids.begin(); id != ids.end(); ++id) {
       std::string uid;
-      {
-        std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(*id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-        FindCallbackUidArg arg(uid);
-        if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-          return false; // No such record?
-        };
+      if(!find_uid(*id, owner, uid)) {
+        return false; // No such record?
       };
       if(uid.empty()) {
         // No such record
         continue;
       };
-      std::string sqlcmd = "INSERT INTO lock(lockid, uid) VALUES ('"+sql_escape(lock_id)+"','"+uid+"')";
-      if(!dberr("addlock:put",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      SQLiteStatement stmt(db_, "INSERT INTO lock(lockid, uid) VALUES (?, ?)");
+      stmt.Bind(sql_escape(lock_id)).Bind(uid);
+      if(!dberr("addlock:put", stmt.Exec())) {
         return false;
       };
     };
-    return true;
+    return dberr("addlock:commit", transaction.Commit());
   }
 
   bool FileRecordSQLite::RemoveLock(const std::string& lock_id) {
@@ -424,11 +307,12 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     // map lock to id,owner 
     {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      SQLiteStatement stmt(db_, "DELETE FROM lock WHERE (lockid = ?)");
+      stmt.Bind(sql_escape(lock_id));
+      if(!dberr("removelock:del", stmt.Exec())) {
         return false;
       };
-      if(sqlite3_changes(db_) < 1) {
+      if(db_.Changes() < 1) {
         error_str_ = "";
         return false;
       };
@@ -439,25 +323,28 @@ namespace ARex {
   bool FileRecordSQLite::RemoveLock(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
+    // Reported credentials must be same as those unlocked
+    SQLiteTransaction transaction(db_);
+    if(!transaction) {
+      error_str_ = "Failed to start transaction in database";
+      return false;
+    };
     // map lock to id,owner 
-    {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("removelock:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        //return false;
-      };
+    if(!find_locked(lock_id, ids, "removelock:get")) {
+      //return false;
     };
     {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      SQLiteStatement stmt(db_, "DELETE FROM lock WHERE (lockid = ?)");
+      stmt.Bind(sql_escape(lock_id));
+      if(!dberr("removelock:del", stmt.Exec())) {
         return false;
       };
-      if(sqlite3_changes(db_) < 1) {
+      if(db_.Changes() < 1) {
         error_str_ = "";
         return false;
       };
     };
-    return true;
+    return dberr("removelock:commit", transaction.Commit());
   }
 
 
@@ -465,12 +352,8 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     // map lock to id,owner 
-    {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("listlocked:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        return false;
-      };
+    if(!find_locked(lock_id, ids, "listlocked:get")) {
+      return false;
     };
     //if(ids.empty()) return false;
     return true;
@@ -480,9 +363,12 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     {
-      std::string sqlcmd = "SELECT lockid FROM lock";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
+      SQLiteStatement stmt(db_, "SELECT lockid FROM lock");
+      while(stmt.Step() == SQLITE_ROW) {
+        std::string rec = sql_unescape(stmt.Text(0));
+        if(!rec.empty()) locks.push_back(rec);
+      };
+      if(!dberr("listlocks:get", stmt.Error())) {
         return false;
       };
     };
@@ -493,21 +379,21 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(id, owner, uid)) {
+      return false; // No such record?
     };
     if(uid.empty()) {
       error_str_ = "Record not found";
       return false; // No such record
     };
     {
-      std::string sqlcmd = "SELECT lockid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
+      SQLiteStatement stmt(db_, "SELECT lockid FROM lock WHERE (uid = ?)");
+      stmt.Bind(uid);
+      while(stmt.Step() == SQLITE_ROW) {
+        std::string rec = sql_unescape(stmt.Text(0));
+        if(!rec.empty()) locks.push_back(rec);
+      };
+      if(!dberr("listlocks:get", stmt.Error())) {
         return false;
       };
     };
@@ -517,47 +403,39 @@ namespace ARex {
   FileRecordSQLite::Iterator::Iterator(FileRecordSQLite& frec):FileRecord::Iterator(frec) {
     rowid_ = -1;
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec ORDER BY _rowid_ LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        return;
-      };
-      if(arg.uid.empty()) {
-        return;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
-    };
+    SQLiteStatement stmt(frec.db_, "SELECT _rowid_,id,owner,uid,meta FROM rec ORDER BY _rowid_ LIMIT 1");
+    fetch(stmt);
   }
 
   FileRecordSQLite::Iterator::~Iterator(void) {
   }
 
+  // Takes record from result of query. Iterator becomes invalid if there are no more records.
+  void FileRecordSQLite::Iterator::fetch(SQLiteStatement& stmt) {
+    FileRecordSQLite& frec((FileRecordSQLite&)frec_);
+    sqlite3_int64 rowid = -1;
+    if(stmt.Step() == SQLITE_ROW) {
+      std::list<std::string> meta;
+      rowid = stmt.Int(0);
+      id_ = sql_unescape(stmt.Text(1));
+      owner_ = sql_unescape(stmt.Text(2));
+      uid_ = stmt.Text(3);
+      parse_strings(meta, stmt.Text(4));
+      meta_.swap(meta);
+    };
+    if(!frec.dberr("listlocks:get", stmt.Error()) || uid_.empty()) {
+      rowid = -1;
+    };
+    rowid_ = rowid;
+  }
+
   FileRecordSQLite::Iterator& FileRecordSQLite::Iterator::operator++(void) {
     if(rowid_ == -1) return *this;
     FileRecordSQLite& frec((FileRecordSQLite&)frec_);
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ > " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ ASC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
-    };
+    SQLiteStatement stmt(frec.db_, "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ > ?) ORDER BY _rowid_ ASC LIMIT 1");
+    stmt.Bind(rowid_);
+    fetch(stmt);
     return *this;
   }
 
@@ -565,23 +443,9 @@ namespace ARex {
     if(rowid_ == -1) return *this;
     FileRecordSQLite& frec((FileRecordSQLite&)frec_);
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ < " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ DESC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
-    };
+    SQLiteStatement stmt(frec.db_, "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ < ?) ORDER BY _rowid_ DESC LIMIT 1");
+    stmt.Bind(rowid_);
+    fetch(stmt);
     return *this;
   }
 
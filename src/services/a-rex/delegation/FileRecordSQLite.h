@@ -8,6 +8,7 @@
 
 #include <arc/Thread.h>
 
+#include "../SQLiteDB.h"
 #include "FileRecord.h"
 
 namespace ARex {
@@ -15,9 +16,10 @@ namespace ARex {
 class FileRecordSQLite: public FileRecord {
  private:
   Glib::Mutex lock_; // TODO: use DB locking
-  sqlite3* db_;
-  int sqlite3_exec_nobusy(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
+  SQLiteDB db_;
   bool dberr(const char* s, int err);
+  bool find_uid(const std::string& id, const std::string& owner, std::string& uid);
+  bool find_locked(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids, const char* errmsg);
   bool open(bool create);
   void close(void);
   bool verify(void);
@@ -27,6 +29,7 @@ class FileRecordSQLite: public FileRecord {
    private:
     Iterator(const Iterator&); // disabled constructor
     Iterator(FileRecordSQLite& frec);
+    void fetch(SQLiteStatement& stmt);
     sqlite3_int64 rowid_;
    public:
     ~Iterator(void);
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 
 #include <string>
+#include <list>
 
 #include <glibmm.h>
 
@@ -273,9 +274,116 @@ Arc::MCC_Status ARexService::GetInfo(Arc::Message& inmsg,Arc::Message& outmsg,AR
   return GetInfo(inmsg, outmsg);
 }
 
+// Serves compressed document directly from buffer shared by all requests
+class RenditionPayload: public Arc::PayloadRawInterface {
+ private:
+  Arc::ThreadedPointer<OptimizedInformationContainer::Rendition> rendition_;
+  const std::string& data_;
+ public:
+  RenditionPayload(const Arc::ThreadedPointer<OptimizedInformationContainer::Rendition>& rendition):
+      rendition_(rendition), data_(rendition->gzip) {
+  };
+  virtual ~RenditionPayload(void) { };
+  virtual char operator[](Size_t pos) const {
+    if((pos < 0) || (pos >= (Size_t)data_.length())) return 0;
+    return data_[pos];
+  };
+  virtual char* Content(Size_t pos) {
+    if((pos < 0) || (pos >= (Size_t)data_.length())) return NULL;
+    return (char*)(data_.c_str() + pos);
+  };
+  virtual Size_t Size(void) const { return data_.length(); };
+  virtual char* Insert(Size_t /* pos */ = 0,Size_t /* size */ = 0) { return NULL; };
+  virtual char* Insert(const char* /* s */,Size_t /* pos */ = 0,Size_t /* size */ = -1) { return NULL; };
+  virtual char* Buffer(unsigned int num = 0) {
+    if(num != 0) return NULL;
+    return (char*)(data_.c_str());
+  };
+  virtual Size_t BufferSize(unsigned int num = 0) const {
+    if(num != 0) return 0;
+    return data_.length();
+  };
+  virtual Size_t BufferPos(unsigned int num = 0) const {
+    if(num == 0) return 0;
+    return data_.length();
+  };
+  virtual bool Truncate(Size_t /* size */) { return false; };
+};
+
+// Checks if entity tag is listed in value of If-None-Match header
+static bool ETagMatches(const std::string& header, const std::string& etag) {
+  std::list<std::string> tags;
+  Arc::tokenize(header, tags, ",");
+  for(std::list<std::string>::iterator tag = tags.begin(); tag != tags.end(); ++tag) {
+    std::string t = Arc::trim(*tag);
+    if(t == "*") return true;
+    // Weak comparison is used for If-None-Match
+    if(t.compare(0, 2, "W/") == 0) t.erase(0, 2);
+    if(t == etag) return true;
+  };
+  return false;
+}
+
+// Checks if value of Accept-Encoding header allows gzip
+static bool AcceptsGzip(const std::string& header) {
+  std::list<std::string> codings;
+  Arc::tokenize(header, codings, ",");
+  for(std::list<std::string>::iterator coding = codings.begin(); coding != codings.end(); ++coding) {
+    std::string::size_type p = coding->find(';');
+    std::string name = Arc::lower(Arc::trim(coding->substr(0, p)));
+    if((name != "gzip") && (name != "x-gzip")) continue;
+    if(p == std::string::npos) return true;
+    std::string param = Arc::trim(coding->substr(p+1));
+    if(param.compare(0, 2, "q=") != 0) return true;
+    double q = 1.0;
+    if(!Arc::stringto(param.substr(2), q)) return true;
+    return (q > 0.0);
+  };
+  return false;
+}
+
+// Checks if compressed variant of info document is to be served
+static bool InfoGzip(Arc::Message& inmsg,
+                     const Arc::ThreadedPointer<OptimizedInformationContainer::Rendition>& rendition) {
+  return rendition && !rendition->gzip.empty() &&
+         AcceptsGzip(inmsg.Attributes()->get("HTTP:accept-encoding"));
+}
+
+// Sets headers describing revision of info document and checks if client
+// already has it. Each variant has own entity tag. Returns true if not
+// modified response was prepared.
+static bool InfoNotModified(Arc::Message& inmsg, Arc::Message& outmsg,
+                            const Arc::ThreadedPointer<OptimizedInformationContainer::Rendition>& rendition,
+                            bool gzip) {
+  if(!rendition) return false;
+  const std::string& etag = gzip ? rendition->gzip_etag : rendition->etag;
+  outmsg.Attributes()->set("HTTP:etag",etag);
+  outmsg.Attributes()->set("HTTP:vary","Accept-Encoding");
+  if(gzip) outmsg.Attributes()->set("HTTP:content-encoding","gzip");
+  std::string if_none_match = inmsg.Attributes()->get("HTTP:if-none-match");
+  if(if_none_match.empty() || !ETagMatches(if_none_match, etag)) return false;
+  Arc::PayloadRaw* buf = new Arc::PayloadRaw;
+  outmsg.Payload(buf);
+  outmsg.Attributes()->set("HTTP:CODE","304");
+  outmsg.Attributes()->set("HTTP:REASON","Not Modified");
+  return true;
+}
+
 Arc::MCC_Status ARexService::GetInfo(Arc::Message& inmsg,Arc::Message& outmsg) {
-  int h = infodoc_.OpenDocument();
+  Arc::ThreadedPointer<OptimizedInformationContainer::Rendition> rendition;
+  int h = infodoc_.OpenDocument(rendition);
   if(h == -1) return Arc::MCC_Status();
+  bool gzip = InfoGzip(inmsg, rendition);
+  if(InfoNotModified(inmsg, outmsg, rendition, gzip)) {
+    ::close(h);
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  };
+  if(gzip) {
+    ::close(h);
+    outmsg.Payload(new RenditionPayload(rendition));
+    outmsg.Attributes()->set("HTTP:content-type","text/xml");
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  };
   Arc::MessagePayload* payload = newFileRead(h);
   if(!payload) { ::close(h); return Arc::MCC_Status(); };
   outmsg.Payload(payload);
@@ -341,8 +449,23 @@ Arc::MCC_Status ARexService::HeadInfo(Arc::Message& inmsg,Arc::Message& outmsg,A
 }
 
 Arc::MCC_Status ARexService::HeadInfo(Arc::Message& inmsg,Arc::Message& outmsg) {
-  int h = infodoc_.OpenDocument();
+  Arc::ThreadedPointer<OptimizedInformationContainer::Rendition> rendition;
+  int h = infodoc_.OpenDocument(rendition);
   if(h == -1) return Arc::MCC_Status();
+  // Same variant is described as would be served by GET
+  bool gzip = InfoGzip(inmsg, rendition);
+  if(InfoNotModified(inmsg, outmsg, rendition, gzip)) {
+    ::close(h);
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  };
+  if(gzip) {
+    ::close(h);
+    Arc::PayloadRaw* buf = new Arc::PayloadRaw;
+    buf->Truncate(rendition->gzip.length());
+    outmsg.Payload(buf);
+    outmsg.Attributes()->set("HTTP:content-type","text/xml");
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  };
   outmsg.Payload(newFileInfo(h));
   outmsg.Attributes()->set("HTTP:content-type","text/xml");
   return Arc::MCC_Status(Arc::STATUS_OK);
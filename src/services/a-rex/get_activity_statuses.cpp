@@ -8,6 +8,7 @@
 #include "delegation/DelegationStore.h"
 #include "job.h"
 #include "grid-manager/files/ControlFileHandling.h"
+#include "grid-manager/jobs/JobsList.h"
 
 #include "arex.h"
 
@@ -34,6 +35,13 @@ static bool match_list(const std::string& item1,
 
 #define MAX_ACTIVITIES (10000)
 
+// Same as ARexJob::Modified but without need to create ARexJob
+static Arc::Time job_modified(const std::string& id, const GMConfig& config) {
+  time_t t = job_state_time(id,config);
+  if(t == 0) return Arc::Time(); // ???
+  return Arc::Time(t);
+}
+
 static bool match(const std::pair<std::string,std::list<std::string> >& status,const std::string& es_status, const std::list<std::string>& es_attributes) {
   // Specs do not define how exactly to match status. Assuming
   // exact match is needed.
@@ -131,13 +139,26 @@ Arc::MCC_Status ARexService::ESListActivities(ARexGMConfig& config,Arc::XMLNode
     filter_status = true;
   };
   std::list<std::string> job_ids = ARexJob::Jobs(config,logger);
+  // States of jobs being processed are taken from grid-manager's snapshot
+  std::map<std::string,GMJobStatus> known;
+  if(filter_status && !filter_time && gm_) gm_->GetJobsStatus(job_ids, known);
   unsigned int count = 0;
   for(std::list<std::string>::iterator id = job_ids.begin();id!=job_ids.end();++id) {
     if(count >= limit) {
       out.NewAttribute("truncated") = "true";
       break;
     };
-    if(filter_time || filter_status) {
+    std::map<std::string,GMJobStatus>::iterator k = known.find(*id);
+    if((k != known.end()) && (k->second.owner == config.GridName())) {
+      // Session directory of deleted job is gone, hence it is not accessible anymore
+      if(k->second.state == JOB_STATE_DELETED) continue;
+      std::string es_status;
+      std::list<std::string> es_attributes;
+      convertActivityStatusES(GMJob::get_state_name(k->second.state),es_status,es_attributes,
+                              k->second.failed,k->second.pending,
+                              k->second.failed_state,k->second.failed_cause);
+      if(!match(statuses,es_status,es_attributes)) continue;
+    } else if(filter_time || filter_status) {
       ARexJob job(*id,config,logger_);
       if(!job) continue;
       if(filter_time) {
@@ -202,11 +223,42 @@ Arc::MCC_Status ARexService::ESGetActivityStatus(ARexGMConfig& config,Arc::XMLNo
       return Arc::MCC_Status(Arc::STATUS_OK);
     };
   };
+  // Jobs being processed by grid-manager are resolved from snapshot of
+  // its state. For those owned by client there is no need to read job's
+  // description and check session directory.
+  std::list<std::string> jobids;
+  for(id = in["ActivityID"];(bool)id;++id) jobids.push_back((std::string)id);
+  std::map<std::string,GMJobStatus> known;
+  if(gm_) gm_->GetJobsStatus(jobids, known);
   id = in["ActivityID"];
   for(;(bool)id;++id) {
     std::string jobid = id;
     Arc::XMLNode item = out.NewChild("esainfo:ActivityStatusItem");
     item.NewChild("estypes:ActivityID") = jobid;
+    std::map<std::string,GMJobStatus>::iterator k = known.find(jobid);
+    // Session directory of deleted job is gone, ARexJob reports such job as missing
+    if((k != known.end()) && (k->second.owner == config.GridName()) &&
+       (k->second.state != JOB_STATE_DELETED)) {
+      bool job_pending = k->second.pending;
+#ifdef HONEST_JOB_STATE
+      std::string gm_state = GMJob::get_state_name(k->second.state);
+      bool job_failed = k->second.failed;
+      std::string failed_cause = k->second.failed_cause;
+      std::string failed_state = k->second.failed_state;
+      Arc::XMLNode status = addActivityStatusES(item,gm_state,job_failed,job_pending,failed_state,failed_cause);
+      status.NewChild("estypes:Timestamp") = job_modified(jobid,config.GmConfig()).str(Arc::ISOTime);
+#else
+      std::string glue_s;
+      Arc::XMLNode glue_xml(job_xml_read_file(jobid,config.GmConfig(),glue_s)?glue_s:"");
+      if(!glue_xml) {
+        Arc::XMLNode status = addActivityStatusES(item,"ACCEPTED",false,false,"","");
+        status.NewChild("estypes:Timestamp") = job_modified(jobid,config.GmConfig()).str(Arc::ISOTime);
+      } else {
+        addActivityStatusES(item,glue_xml);
+      };
+#endif
+      continue;
+    };
     ARexJob job(jobid,config,logger_);
     if(!job) {
       // There is no such job
@@ -12,6 +12,7 @@
 #include <arc/Watchdog.h>
 #include "jobs/JobsList.h"
 #include "jobs/CommFIFO.h"
+#include "jobs/ControlDirWatcher.h"
 #include "log/JobLog.h"
 #include "log/JobsMetrics.h"
 #include "log/HeartBeatMetrics.h"
@@ -272,11 +273,20 @@ bool GridManager::thread() {
     return false;
   };  
 
+  // Services fall back to scanning control directory till index is complete
+  JobsList::BuildOwnerIndex(config_);
+
   // Start jobs processing
   jobs_ = &jobs;
   logger.msg(Arc::INFO,"Picking up left jobs");
   jobs.RestartJobs();
 
+  // Jobs which appear from now on are reported without scanning directories
+  ControlDirWatcher control_dir_watcher(jobs, config_.ControlDir());
+  if(!control_dir_watcher.start()) {
+    logger.msg(Arc::INFO,"Control directory is not watched, new jobs will be found by scanning");
+  };
+
   logger.msg(Arc::INFO, "Starting data staging threads");
   std::string heartbeat_file("gm-heartbeat");
   Arc::WatchdogChannel wd(config_.WakeupPeriod()*3+300);
@@ -311,7 +321,10 @@ bool GridManager::thread() {
       }
     }
     JobsMetrics* metrics = config_.GetJobsMetrics();
-    if(metrics) metrics->Sync();
+    if(metrics) {
+      if(joblog) metrics->ReportAccountingQueue(joblog->AccountingQueueSize());
+      metrics->Sync();
+    }
     // Process jobs which need attention ASAP
     jobs.ActJobsAttention();
     if(((int)(time(NULL) - poll_job_time)) >= 0) {
@@ -324,9 +337,9 @@ bool GridManager::thread() {
       if(config_.ConfigIsTemp()) ::utimes(config_.ConfigFile().c_str(), NULL);
       // Tell watchdog we are alive
       wd.Kick();
-      /* check for new marks and activate related jobs - TODO: remove */
+      /* check for new marks and activate related jobs - only occasionally if watched */
       jobs.ScanNewMarks();
-      /* look for new jobs - TODO: remove */
+      /* look for new jobs - only occasionally if watched */
       jobs.ScanNewJobs();
       /* process jobs which do not get attention calls in their current state */
       jobs.ActJobsPolling();
@@ -380,6 +393,18 @@ void GridManager::RequestJobAttention(const std::string& job_id) {
   };
 }
 
+bool GridManager::GetJobsCounters(JobsCounters& counters) {
+  if(!jobs_) return false; // Same race condition as above
+  jobs_->GetJobsCounters(counters);
+  return true;
+}
+
+bool GridManager::GetJobsStatus(const std::list<std::string>& ids, std::map<std::string,GMJobStatus>& statuses) {
+  if(!jobs_) return false; // Same race condition as above
+  jobs_->GetJobsStatus(ids, statuses);
+  return true;
+}
+
 GridManager::GridManager(GMConfig& config):tostop_(false), config_(config) {
   jobs_ = NULL;
   if(!Arc::CreateThreadFunction(&grid_manager,(void*)this,&active_)) { };
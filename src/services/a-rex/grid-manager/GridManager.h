@@ -1,11 +1,17 @@
 #ifndef GRID_MANAGER_H
 #define GRID_MANAGER_H
 
+#include <string>
+#include <list>
+#include <map>
+
 #include <arc/Thread.h>
 
 namespace ARex {
 
 class JobsList;
+class JobsCounters;
+class GMJobStatus;
 class DTRGenerator;
 class GMConfig;
 
@@ -24,6 +30,10 @@ class GridManager {
   ~GridManager(void);
   operator bool(void) { return (active_.get()>0); };
   void RequestJobAttention(const std::string& job_id);
+  /// Obtain numbers of jobs being processed. Returns false if jobs are not processed yet.
+  bool GetJobsCounters(JobsCounters& counters);
+  /// Obtain states of requested jobs which are kept in memory
+  bool GetJobsStatus(const std::list<std::string>& ids, std::map<std::string,GMJobStatus>& statuses);
 };
 
 } // namespace ARex
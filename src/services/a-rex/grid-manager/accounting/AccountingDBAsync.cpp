@@ -0,0 +1,262 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include <glibmm.h>
+
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+
+#include "AccountingDBAsync.h"
+
+// Maximal number of records waiting to be written
+#define ACCOUNTING_QUEUE_MAX (10000)
+// Time to collect records for one transaction (ms)
+#define ACCOUNTING_FLUSH_INTERVAL (1000)
+// Records written immediately when so many collected
+#define ACCOUNTING_BATCH_MAX (1000)
+
+namespace ARex {
+    Arc::Logger AccountingDBAsync::logger(Arc::Logger::getRootLogger(), "AccountingDBAsync");
+
+    AccountingDBAsync::AccountingDBAsync(const std::string& name, const std::string& spooldir):
+            AccountingDB(name), db(name), spooldir(spooldir),
+            queue_size(0), replay_fetch(NULL), replay_arg(NULL),
+            queue_full(false), exiting(false) {
+        isValid = false;
+        if (!db.IsValid()) return;
+        if (!Arc::DirCreate(spooldir, S_IRWXU, true)) {
+            logger.msg(Arc::ERROR, "Failed to create directory %s for pending accounting records", spooldir);
+            return;
+        }
+        // Names of marks must keep order of records also after restart
+        mark_seq = ((unsigned long long int)time(NULL)) << 20;
+        replay_limit = mark_seq;
+        if (!Arc::CreateThreadFunction(&writerThread, this, &writer_count)) {
+            logger.msg(Arc::ERROR, "Failed to start accounting records writer thread");
+            return;
+        }
+        isValid = true;
+    }
+
+    AccountingDBAsync::~AccountingDBAsync() {
+        lock_.lock();
+        exiting = true;
+        queued_.signal();
+        lock_.unlock();
+        writer_count.wait();
+    }
+
+    void AccountingDBAsync::writerThread(void* arg) {
+        static_cast<AccountingDBAsync*>(arg)->writer();
+    }
+
+    bool AccountingDBAsync::writeMark(Record* rec, const std::string& state, const Arc::Time& time) {
+        rec->mark = spooldir + G_DIR_SEPARATOR_S + Arc::inttostr(mark_seq++, 10, 20);
+        std::string content = rec->jobid + "\n" + state + "\n" + Arc::tostring(time.GetTime()) + "\n";
+        if (!Arc::FileCreate(rec->mark, content)) {
+            logger.msg(Arc::WARNING, "Failed to mark accounting record of job %s in %s", rec->jobid, rec->mark);
+            rec->mark.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool AccountingDBAsync::enqueue(Record* rec, const std::string& state, const Arc::Time& time) {
+        Glib::Mutex::Lock lock(lock_);
+        if (!isValid) {
+            delete rec;
+            return false;
+        }
+        while ((queue_size >= ACCOUNTING_QUEUE_MAX) && !exiting) {
+            // Database can't keep up. Slowing down job processing is
+            // better than losing records.
+            if (!queue_full) logger.msg(Arc::WARNING, "Accounting records queue is full, waiting for database");
+            queue_full = true;
+            space_.wait(lock_);
+        }
+        // Record being replayed has its mark already
+        if (rec->mark.empty()) (void)writeMark(rec, state, time);
+        queue.push_back(rec);
+        ++queue_size;
+        queued_.signal();
+        return true;
+    }
+
+    bool AccountingDBAsync::createAAR(AAR& aar) {
+        Record* rec = new Record;
+        rec->type = Record::aar_create;
+        rec->aar = aar;
+        rec->jobid = aar.jobid;
+        return enqueue(rec, "ACCEPTED", aar.submittime);
+    }
+
+    bool AccountingDBAsync::updateAAR(AAR& aar) {
+        Record* rec = new Record;
+        rec->type = Record::aar_update;
+        rec->aar = aar;
+        rec->jobid = aar.jobid;
+        return enqueue(rec, "FINISHED", aar.endtime);
+    }
+
+    bool AccountingDBAsync::addJobEvent(aar_jobevent_t& event, const std::string& jobid) {
+        Record* rec = new Record;
+        rec->type = Record::aar_event;
+        rec->event = event;
+        rec->jobid = jobid;
+        return enqueue(rec, event.first, event.second);
+    }
+
+    unsigned int AccountingDBAsync::QueueSize(void) {
+        Glib::Mutex::Lock lock(lock_);
+        return queue_size;
+    }
+
+    void AccountingDBAsync::Replay(aar_fetch_t fetch, void* arg) {
+        Glib::Mutex::Lock lock(lock_);
+        if (!isValid) return;
+        // Rebuilding records needs job files and may take long time.
+        // It is done by writer thread to not hold calling processing thread.
+        replay_fetch = fetch;
+        replay_arg = arg;
+        queued_.signal();
+    }
+
+    void AccountingDBAsync::replay(aar_fetch_t fetch, void* arg) {
+        std::string limit = Arc::inttostr(replay_limit, 10, 20);
+        std::list<std::string> marks;
+        try {
+            Glib::Dir dir(spooldir);
+            for (;;) {
+                std::string name = dir.read_name();
+                if (name.empty()) break;
+                if (name.find_first_not_of("0123456789") != std::string::npos) continue;
+                // Marks of this run belong to queued records
+                if ((name.length() != limit.length()) || (name >= limit)) continue;
+                marks.push_back(name);
+            }
+        } catch (Glib::FileError& e) {
+            logger.msg(Arc::ERROR, "Failed to read directory %s of pending accounting records", spooldir);
+            return;
+        }
+        if (marks.empty()) return;
+        logger.msg(Arc::INFO, "Replaying %u accounting records not written by previous run", (unsigned int)marks.size());
+        // Names are sequence numbers of same width
+        marks.sort();
+        std::list<Record*> batch;
+        for (std::list<std::string>::iterator m = marks.begin(); m != marks.end(); ++m) {
+            std::string path = spooldir + G_DIR_SEPARATOR_S + *m;
+            std::string data;
+            std::vector<std::string> content;
+            time_t t = 0;
+            if (Arc::FileRead(path, data)) Arc::tokenize(data, content, "\n");
+            if ((content.size() < 3) || !Arc::stringto(content[2], t)) {
+                logger.msg(Arc::WARNING, "Dropping broken pending accounting record %s", path);
+                (void)::unlink(path.c_str());
+                continue;
+            }
+            Record* rec = new Record;
+            rec->jobid = content[0];
+            rec->mark = path;
+            rec->replayed = true;
+            std::string state = content[1];
+            // Also used to detect records already in database
+            rec->event = aar_jobevent_t(state, Arc::Time(t));
+            if ((state == "ACCEPTED") || (state == "FINISHED")) {
+                rec->type = (state == "ACCEPTED") ? Record::aar_create : Record::aar_update;
+                if (!(*fetch)(arg, rec->jobid, state, rec->aar)) {
+                    logger.msg(Arc::WARNING, "Dropping pending accounting record of job %s: job information is not available", rec->jobid);
+                    (void)::unlink(path.c_str());
+                    delete rec;
+                    continue;
+                }
+            } else {
+                rec->type = Record::aar_event;
+            }
+            batch.push_back(rec);
+            if (batch.size() >= ACCOUNTING_BATCH_MAX) writeBatch(batch);
+        }
+        if (!batch.empty()) writeBatch(batch);
+    }
+
+    void AccountingDBAsync::writeBatch(std::list<Record*>& batch) {
+        // If transaction can't be started records are still written one by one
+        bool in_batch = db.beginBatch();
+        unsigned int failed = 0;
+        unsigned int total = batch.size();
+        for (std::list<Record*>::iterator r = batch.begin(); r != batch.end(); ++r) {
+            Record& rec = **r;
+            bool result = false;
+            // Transaction of previous run may have been committed before
+            // its marks were removed. Such records are skipped. For FINISHED
+            // record its end event tells if AAR was already updated.
+            switch (rec.type) {
+                case Record::aar_create:
+                    result = (rec.replayed && db.hasAAR(rec.jobid)) || db.createAAR(rec.aar);
+                    break;
+                case Record::aar_update:
+                    result = (rec.replayed && db.hasJobEvent(rec.event, rec.jobid)) || db.updateAAR(rec.aar);
+                    break;
+                case Record::aar_event:
+                    result = (rec.replayed && db.hasJobEvent(rec.event, rec.jobid)) || db.addJobEvent(rec.event, rec.jobid);
+                    break;
+            }
+            if (!result) ++failed;
+        }
+        // Failed records are not retried - same as with synchronous writing.
+        // But if transaction failed marks stay and records are replayed
+        // after restart.
+        bool committed = in_batch ? db.commitBatch() : true;
+        for (std::list<Record*>::iterator r = batch.begin(); r != batch.end(); ++r) {
+            if (committed && !(*r)->mark.empty()) (void)::unlink((*r)->mark.c_str());
+            delete *r;
+        }
+        batch.clear();
+        if (failed) {
+            logger.msg(Arc::ERROR, "Failed to write %u of %u accounting records", failed, total);
+        }
+    }
+
+    void AccountingDBAsync::writer(void) {
+        Glib::Mutex::Lock lock(lock_);
+        for (;;) {
+            if (replay_fetch) {
+                // Records of previous run go to database before new ones
+                aar_fetch_t fetch = replay_fetch;
+                void* arg = replay_arg;
+                replay_fetch = NULL;
+                lock_.unlock();
+                replay(fetch, arg);
+                lock_.lock();
+                continue;
+            }
+            if (queue.empty()) {
+                if (exiting) break;
+                queued_.wait(lock_);
+                continue;
+            }
+            // Let more records arrive to be written in same transaction
+            Glib::TimeVal flush_time;
+            flush_time.assign_current_time();
+            flush_time.add_milliseconds(ACCOUNTING_FLUSH_INTERVAL);
+            while (!exiting && (queue_size < ACCOUNTING_BATCH_MAX)) {
+                if (!queued_.timed_wait(lock_, flush_time)) break;
+            }
+            std::list<Record*> batch;
+            batch.splice(batch.end(), queue);
+            unsigned int batch_size = queue_size;
+            queue_size = 0;
+            queue_full = false;
+            space_.broadcast();
+            lock_.unlock();
+            logger.msg(Arc::DEBUG, "Writing %u accounting records", batch_size);
+            writeBatch(batch);
+            lock_.lock();
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef ARC_ACCOUNTING_DB_ASYNC_H
+#define ARC_ACCOUNTING_DB_ASYNC_H
+
+#include <string>
+#include <list>
+#include <arc/Logger.h>
+#include <arc/Thread.h>
+
+#include "AccountingDB.h"
+#include "AccountingDBSQLite.h"
+
+namespace ARex {
+    /// Callback used to rebuild AAR of job for replaying it.
+    /**
+     * Gets job id and name of state in which record was made.
+     * Returns false if AAR can't be rebuilt (e.g. job is gone).
+     * Called from writer thread.
+     **/
+    typedef bool (*aar_fetch_t)(void* arg, const std::string& jobid, const std::string& state, AAR& aar);
+
+    /// Class writing A-REX accounting records (AAR) to SQLite database from dedicated thread
+    /**
+     * Records are put into bounded queue and caller does not wait for
+     * database. Writer thread collects records arriving during flush
+     * interval and stores them in one transaction.
+     * Every queued record is marked by small file in spool directory
+     * which is removed after record is committed. Records which were
+     * not written because process stopped can be rebuilt from control
+     * files of jobs using Replay().
+     * Replayed records whose transaction was committed just before
+     * process stopped, but marks were not removed yet, are detected and
+     * not written again.
+     **/
+    class AccountingDBAsync : public AccountingDB {
+      public:
+        AccountingDBAsync(const std::string& name, const std::string& spooldir);
+        /// Writes all queued records and stops writer thread
+        ~AccountingDBAsync();
+        /// Queue creation of new AAR (ACCEPTED)
+        bool createAAR(AAR& aar);
+        /// Queue update of AAR (FINISHED)
+        bool updateAAR(AAR& aar);
+        /// Queue job event record (any other state changes)
+        bool addJobEvent(aar_jobevent_t& event, const std::string& jobid);
+        /// Write again records left in spool directory by previous run
+        /**
+         * Records are rebuilt and written by writer thread before records
+         * queued by this run, so this method does not block caller.
+         **/
+        void Replay(aar_fetch_t fetch, void* arg);
+        /// Number of records waiting to be written
+        unsigned int QueueSize(void);
+      private:
+        class Record {
+          public:
+            enum { aar_create, aar_update, aar_event } type;
+            AAR aar;
+            aar_jobevent_t event;
+            std::string jobid;
+            // Spool file marking this record
+            std::string mark;
+            // Record left by previous run, may be already in database
+            bool replayed;
+            Record(void): replayed(false) {};
+        };
+        static Arc::Logger logger;
+        AccountingDBSQLite db;
+        std::string spooldir;
+        Glib::Mutex lock_;
+        // Signaled when records are queued or writer must exit
+        Glib::Cond queued_;
+        // Signaled when queue has space
+        Glib::Cond space_;
+        std::list<Record*> queue;
+        unsigned int queue_size;
+        unsigned long long int mark_seq;
+        // Marks with lower sequence numbers were made by previous run
+        unsigned long long int replay_limit;
+        aar_fetch_t replay_fetch;
+        void* replay_arg;
+        bool queue_full;
+        bool exiting;
+        Arc::SimpleCounter writer_count;
+        bool enqueue(Record* rec, const std::string& state, const Arc::Time& time);
+        bool writeMark(Record* rec, const std::string& state, const Arc::Time& time);
+        void writeBatch(std::list<Record*>& batch);
+        void replay(aar_fetch_t fetch, void* arg);
+        static void writerThread(void* arg);
+        void writer(void);
+    };
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <arc/Logger.h>
 #include <arc/Thread.h>
 
+#include "../../SQLiteDB.h"
 #include "AccountingDB.h"
 
 namespace ARex {
@@ -24,6 +25,19 @@ namespace ARex {
         bool updateAAR(AAR& aar);
         /// Add job event record to AAR (any other state changes)
         bool addJobEvent(aar_jobevent_t& events, const std::string& jobid);
+        /// Check if AAR of job is already in the database
+        bool hasAAR(const std::string& jobid);
+        /// Check if same event (state and time) is already recorded for job
+        bool hasJobEvent(aar_jobevent_t& event, const std::string& jobid);
+        /// Start writing several records in one transaction
+        /**
+         * Records passed to methods above are stored in database only when
+         * commitBatch() is called. Failure of single record does not affect
+         * others. Batch must be committed by same thread which started it.
+         **/
+        bool beginBatch(void);
+        /// Commit records written since beginBatch()
+        bool commitBatch(void);
       private:
         static Arc::Logger logger;
         Glib::Mutex lock_;
@@ -34,30 +48,20 @@ namespace ARex {
         name_id_map_t db_status;
         // AAR specific structures representation
         std::map <aar_endpoint_t, unsigned int> db_endpoints;
-        // Class to handle SQLite DB Operations
-        class SQLiteDB {
-        public:
-            SQLiteDB(const std::string& name, bool create = false);
-            ~SQLiteDB();
-            bool isConnected(void);
-            int changes(void) { return sqlite3_changes(aDB); }
-            sqlite3_int64 insertID(void) { return sqlite3_last_insert_rowid(aDB); }
-            int exec(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
-            void logError(const char* errpfx, int err, Arc::LogLevel level = Arc::DEBUG);
-        private:
-            sqlite3* aDB;
-            void closeDB();
-        };
-
-        SQLiteDB* db;
+        // Connection to SQLite database
+        SQLiteDB db;
+        // Transaction of batch in progress
+        SQLiteTransaction* batch;
+        /// Log SQLite error code
+        void logError(const char* errpfx, int err, Arc::LogLevel level = Arc::DEBUG);
         /// Initialize and close connection to SQLite database
-        void initSQLiteDB(void);
+        bool initSQLiteDB(bool create = false);
         void closeSQLiteDB(void);
 
         /// General helper to execute INSERT statement and return the autoincrement ID
-        unsigned int GeneralSQLInsert(const std::string& sql);
+        unsigned int GeneralSQLInsert(SQLiteStatement& stmt);
         /// General helper to execute UPDATE statement
-        bool GeneralSQLUpdate(const std::string& sql);
+        bool GeneralSQLUpdate(SQLiteStatement& stmt);
 
         /// General helper that return accounting database ID for requested iname 
         /** 
@@ -0,0 +1,108 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <iostream>
+
+#include <sqlite3.h>
+#include <glibmm.h>
+
+#include <arc/FileUtils.h>
+#include <arc/StringConv.h>
+
+#include "AccountingDBSQLite.h"
+#include "AccountingDBAsync.h"
+#include "AAR.h"
+
+static const char* dbname = "/tmp/adb_replay.sqlite";
+static const char* spooldir = "/tmp/adb_replay.pending";
+static const char* jobid = "0DULDmc8azunjwO5upha6lOqABFKDmABFKDmpjJKDmABFKDmQs7RCo";
+
+// Job information is not needed for replaying events
+static bool fetch(void*, const std::string&, const std::string&, ARex::AAR&) {
+    return false;
+}
+
+// Mark as left by previous run which stopped before removing it
+static bool mark(unsigned long long int seq, const std::string& state, time_t t) {
+    return Arc::FileCreate(std::string(spooldir) + "/" + Arc::inttostr(seq, 10, 20),
+                           std::string(jobid) + "\n" + state + "\n" + Arc::tostring(t) + "\n");
+}
+
+static int count_events(const std::string& state) {
+    sqlite3* db = NULL;
+    if (sqlite3_open(dbname, &db) != SQLITE_OK) return -1;
+    int count = -1;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM JobEvents WHERE EventKey = ?", -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, state.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) count = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    Arc::LogStream logcerr(std::cerr);
+    Arc::Logger::getRootLogger().addDestination(logcerr);
+    Arc::Logger::getRootLogger().setThreshold(Arc::DEBUG);
+
+    (void)::unlink(dbname);
+    (void)Arc::DirDelete(spooldir, true);
+
+    time_t now = time(NULL);
+    Arc::Time preparing_time(now - 200);
+    Arc::Time submitting_time(now - 100);
+    {
+        ARex::AccountingDBSQLite adb(dbname);
+        if (!adb.IsValid()) {
+           std::cerr << "Database connection was not successfull" << std::endl;
+           return EXIT_FAILURE;
+        }
+        ARex::AAR aar;
+        aar.jobid = jobid;
+        aar.endpoint = { "org.nordugrid.arcrest", "https://arc6.univ.kiev.ua:443/arex" };
+        aar.queue = "grid";
+        aar.userdn = "/DC=org/DC=ugrid/O=people/O=KNU/CN=Andrii Salnikov";
+        aar.wlcgvo = "testbed.univ.kiev.ua";
+        aar.status = "in-progress";
+        aar.submittime = Arc::Time(now - 300);
+        if (!adb.createAAR(aar)) return EXIT_FAILURE;
+        // Committed by previous run but its mark is still there
+        ARex::aar_jobevent_t preparing_event("PREPARING", preparing_time);
+        if (!adb.addJobEvent(preparing_event, jobid)) return EXIT_FAILURE;
+    }
+
+    if (!Arc::DirCreate(spooldir, S_IRWXU, true)) return EXIT_FAILURE;
+    unsigned long long int seq = ((unsigned long long int)(now - 10)) << 20;
+    if (!mark(seq, "PREPARING", preparing_time.GetTime())) return EXIT_FAILURE;
+    if (!mark(seq + 1, "SUBMIT", submitting_time.GetTime())) return EXIT_FAILURE;
+
+    {
+        ARex::AccountingDBAsync adb(dbname, spooldir);
+        if (!adb.IsValid()) {
+           std::cerr << "Database connection was not successfull" << std::endl;
+           return EXIT_FAILURE;
+        }
+        adb.Replay(&fetch, NULL);
+        // queued records are written when writer thread exits
+    }
+
+    int preparing = count_events("PREPARING");
+    int submitting = count_events("SUBMIT");
+    std::cerr << "PREPARING events: " << preparing << ", SUBMIT events: " << submitting << std::endl;
+    if ((preparing != 1) || (submitting != 1)) {
+        std::cerr << "Replayed records were not written exactly once" << std::endl;
+        return EXIT_FAILURE;
+    }
+    Glib::Dir dir(spooldir);
+    if (!dir.read_name().empty()) {
+        std::cerr << "Marks of replayed records were not removed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
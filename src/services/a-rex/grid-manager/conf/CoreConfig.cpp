@@ -244,6 +244,15 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
             logger.msg(Arc::ERROR,"Wrong number in wakeupperiod: %s",wakeup_s); return false;
           }
         }
+        else if (command == "processingthreads") {
+          std::string threads_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(threads_s, config.processing_threads) || (config.processing_threads < 1)) {
+            logger.msg(Arc::ERROR,"Wrong number in processingthreads: %s",threads_s); return false;
+          }
+        }
+        else if (command == "lrmshelper") {
+          if (!CheckYesNoCommand(config.use_lrms_helper, command, rest)) return false;
+        }
         else if (command == "mail") { // internal address from which to send mail
           config.support_email_address = rest;
           if (config.support_email_address.empty()) {
@@ -365,6 +374,18 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
             logger.msg(Arc::ERROR, "Wrong option in delegationdb"); return false;
           };
         }
+        else if (command == "controldb") {
+          std::string s = Arc::ConfigIni::NextArg(rest);
+          if (s == "files") {
+            config.control_db = GMConfig::control_db_files;
+          }
+          else if (s == "sqlite") {
+            config.control_db = GMConfig::control_db_sqlite;
+          }
+          else {
+            logger.msg(Arc::ERROR, "Wrong option in controldb"); return false;
+          };
+        }
         else if (command == "forcedefaultvoms") {
           std::string str = rest;
           if (str.empty()) {
@@ -96,8 +96,11 @@ void GMConfig::SetDefaults() {
   max_jobs = -1;
   max_jobs_per_dn = -1;
   max_scripts = -1;
+  processing_threads = 1;
+  use_lrms_helper = true;
 
   deleg_db = deleg_db_sqlite;
+  control_db = control_db_files;
 
   enable_arc_interface = false;
   enable_emies_interface = false;
@@ -61,6 +61,11 @@ public:
     deleg_db_sqlite
   };
 
+  enum control_db_t {
+    control_db_files,
+    control_db_sqlite
+  };
+
   /// Returns configuration file as guessed.
   /**
    * Guessing uses $ARC_CONFIG, $ARC_LOCATION/etc/arc.conf or the default
@@ -130,6 +135,8 @@ public:
   std::string DelegationDir() const;
   /// Database type to use for delegation storage
   deleg_db_t DelegationDBType() const;
+  /// Where to keep control files used only by A-REX
+  control_db_t ControlDBType() const { return control_db; }
   /// Helper(s) log file path
   const std::string& HelperLog() const { return helper_log; }
 
@@ -242,6 +249,10 @@ public:
   int MaxTotal() const { return max_jobs_total; }
   /// Max submit/cancel scripts 
   int MaxScripts() const { return max_scripts; }
+  /// Number of threads processing jobs in parallel
+  int ProcessingThreads() const { return processing_threads; }
+  /// Whether submit/cancel scripts are started through long-running lrms-helper
+  bool UseLRMSHelper() const { return use_lrms_helper; }
 
   /// Returns true if the shared uid matches the given uid
   bool MatchShareUid(uid_t suid) const { return ((share_uid==0) || (share_uid==suid)); };
@@ -350,6 +361,10 @@ private:
   int max_jobs_per_dn;
   /// Maximum submit/cancel scripts running
   int max_scripts;
+  /// Number of threads processing jobs in parallel
+  int processing_threads;
+  /// Whether submit/cancel scripts are started through long-running lrms-helper
+  bool use_lrms_helper;
 
   /// Whether WS-interface is enabled
   bool enable_arc_interface;
@@ -363,6 +378,8 @@ private:
   std::string arex_endpoint;
   /// Delegation db type
   deleg_db_t deleg_db;
+  /// Control files storage type
+  control_db_t control_db;
   /// Forced VOMS attribute for non-VOMS credentials per queue
   std::map<std::string,std::string> forced_voms;
   /// VOs authorized per queue
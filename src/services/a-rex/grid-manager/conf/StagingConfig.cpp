@@ -23,6 +23,8 @@ StagingConfig::StagingConfig(const GMConfig& config):
   passive(true),
   httpgetpartial(false),
   remote_size_limit(0),
+  persistent_delivery_transfers(0),
+  persistent_delivery_memory(0),
   use_host_cert_for_remote_delivery(false),
   log_level(Arc::Logger::getRootLogger().getThreshold()),
   dtr_log(config.ControlDir()+"/dtr.state"),
@@ -144,6 +146,16 @@ bool StagingConfig::readStagingConf(Arc::ConfigFile& cfile) {
         return false;
       }
     }
+    else if (command == "persistentdelivery") {
+      unsigned long long int memory = 0;
+      std::string memory_str;
+      if (!Arc::stringto(Arc::ConfigIni::NextArg(rest), persistent_delivery_transfers) ||
+          (!(memory_str = Arc::ConfigIni::NextArg(rest)).empty() && !Arc::stringto(memory_str, memory))) {
+        logger.msg(Arc::ERROR, "Bad number in persistentdelivery");
+        return false;
+      }
+      persistent_delivery_memory = memory * 1024 * 1024;
+    }
     else if (command == "passivetransfer") {
       std::string pasv = Arc::ConfigIni::NextArg(rest);
       if (pasv == "yes") passive = true;
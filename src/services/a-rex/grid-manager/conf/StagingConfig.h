@@ -38,6 +38,8 @@ public:
   std::string get_preferred_pattern() const { return preferred_pattern; };
   std::vector<Arc::URL> get_delivery_services() const { return delivery_services; };
   unsigned long long int get_remote_size_limit() const { return remote_size_limit; };
+  unsigned int get_persistent_delivery_transfers() const { return persistent_delivery_transfers; };
+  unsigned long long int get_persistent_delivery_memory() const { return persistent_delivery_memory; };
   std::string get_share_type() const { return share_type; };
   std::map<std::string, int> get_defined_shares() const { return defined_shares; };
   bool get_use_host_cert_for_remote_delivery() const { return use_host_cert_for_remote_delivery; };
@@ -77,6 +79,10 @@ private:
   std::vector<Arc::URL> delivery_services;
   /// File size limit (in bytes) below which local transfer should be used
   unsigned long long int remote_size_limit;
+  /// Number of transfers done by a local delivery process before it is restarted, 0 for one process per transfer
+  unsigned int persistent_delivery_transfers;
+  /// Memory (in bytes) used by a local delivery process above which it is restarted
+  unsigned long long int persistent_delivery_memory;
   /// Criterion on which to split transfers into shares
   std::string share_type;
   /// The list of shares with defined priorities
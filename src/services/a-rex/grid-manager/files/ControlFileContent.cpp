@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <string>
+#include <map>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -36,8 +37,12 @@ class KeyValueFile {
   bool operator!(void) { return handle_ == -1; };
   bool Write(std::string const& name, std::string const& value);
   bool Read(std::string& name, std::string& value);
+  // Remember all pairs written from now on in content
+  void Record(std::list<std::pair<std::string,std::string> >* content) { written_ = content; };
+  bool Stat(struct stat& st) { return (handle_ != -1) && (::fstat(handle_, &st) == 0); };
  private:
   int handle_;
+  std::list<std::pair<std::string,std::string> >* written_;
   char* read_buf_;
   int read_buf_pos_;
   int read_buf_avail_;
@@ -46,7 +51,7 @@ class KeyValueFile {
 };
 
 KeyValueFile::KeyValueFile(std::string const& fname, OpenMode mode):
-          handle_(-1),read_buf_(NULL),read_buf_pos_(0),read_buf_avail_(0) {
+          handle_(-1),written_(NULL),read_buf_(NULL),read_buf_pos_(0),read_buf_avail_(0) {
   if(mode == Create) {
     handle_ = ::open(fname.c_str(),O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
     if(handle_==-1) return;
@@ -108,6 +113,7 @@ bool KeyValueFile::Write(std::string const& name, std::string const& value) {
   if(!write_str(handle_, "=", 1)) return false;
   if(!write_str(handle_, value.c_str(), value.length())) return false;
   if(!write_str(handle_, "\n", 1)) return false;
+  if(written_) written_->push_back(std::pair<std::string,std::string>(name,value));
   return true;
 }
 
@@ -147,6 +153,91 @@ bool KeyValueFile::Read(std::string& name, std::string& value) {
   return true;
 }
 
+// Content of recently used .local files. Entries are checked against
+// identity, size and modification time of file on every access, so
+// changes made by other processes are noticed. JobLocalDescription::write()
+// replaces entry directly. Access is protected by local_lock.
+class LocalCache {
+ public:
+  typedef std::list<std::pair<std::string,std::string> > Content;
+  LocalCache(unsigned int size): size_(size) {};
+  // Returns content of file either from cache or read into loaded
+  Content const* Get(std::string const& fname, Content& loaded);
+  void Put(std::string const& fname, struct stat const& st, Content const& content);
+  void Drop(std::string const& fname);
+  void Size(unsigned int size);
+ private:
+  struct Entry {
+    struct stat st;
+    Content content;
+    std::list<std::string>::iterator lru;
+  };
+  static bool Same(struct stat const& st1, struct stat const& st2);
+  unsigned int size_;
+  std::map<std::string,Entry> entries_;
+  std::list<std::string> lru_; // most recently used first
+};
+
+static LocalCache local_cache(4096);
+
+bool LocalCache::Same(struct stat const& st1, struct stat const& st2) {
+  if((st1.st_dev != st2.st_dev) || (st1.st_ino != st2.st_ino)) return false;
+  if(st1.st_size != st2.st_size) return false;
+  if(st1.st_mtime != st2.st_mtime) return false;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  if(st1.st_mtim.tv_nsec != st2.st_mtim.tv_nsec) return false;
+#endif
+  return true;
+}
+
+LocalCache::Content const* LocalCache::Get(std::string const& fname, Content& loaded) {
+  std::map<std::string,Entry>::iterator entry = entries_.find(fname);
+  if(entry != entries_.end()) {
+    struct stat st;
+    if((::stat(fname.c_str(), &st) == 0) && Same(st, entry->second.st)) {
+      lru_.splice(lru_.begin(), lru_, entry->second.lru);
+      return &(entry->second.content);
+    };
+    Drop(fname);
+  };
+  KeyValueFile f(fname,KeyValueFile::Fetch);
+  if(!f) return NULL;
+  for(;;) {
+    std::string name;
+    std::string buf;
+    if(!f.Read(name,buf)) return NULL;
+    if(name.empty() && buf.empty()) break; // EOF
+    if(name.empty()) continue;
+    if(buf.empty()) continue;
+    loaded.push_back(std::pair<std::string,std::string>(name,buf));
+  };
+  struct stat st;
+  if(f.Stat(st)) Put(fname, st, loaded);
+  return &loaded;
+}
+
+void LocalCache::Put(std::string const& fname, struct stat const& st, Content const& content) {
+  if(size_ == 0) return;
+  Drop(fname);
+  while(entries_.size() >= size_) Drop(lru_.back());
+  Entry& entry = entries_[fname];
+  entry.st = st;
+  entry.content = content;
+  entry.lru = lru_.insert(lru_.begin(), fname);
+}
+
+void LocalCache::Drop(std::string const& fname) {
+  std::map<std::string,Entry>::iterator entry = entries_.find(fname);
+  if(entry == entries_.end()) return;
+  lru_.erase(entry->second.lru);
+  entries_.erase(entry);
+}
+
+void LocalCache::Size(unsigned int size) {
+  size_ = size;
+  while(entries_.size() > size_) Drop(lru_.back());
+}
+
 std::ostream &operator<< (std::ostream &o,const FileData &fd) {
   // TODO: switch to HEX encoding and drop dependency on ConfigIni in major release
   std::string escaped_pfn(Arc::escape_chars(fd.pfn, " \\\r\n", '\\', false));
@@ -535,8 +626,11 @@ static inline bool parse_boolean(const std::string& buf) {
 bool JobLocalDescription::write(const std::string& fname) const {
   Glib::Mutex::Lock lock_(local_lock);
   // *.local file is accessed concurently. To avoid improper readings lock is acquired.
+  local_cache.Drop(fname);
   KeyValueFile f(fname,KeyValueFile::Create);
   if(!f) return false;
+  LocalCache::Content content;
+  f.Record(&content);
   for (std::list<std::string>::const_iterator it=jobreport.begin();
        it!=jobreport.end();
        it++) {
@@ -599,155 +693,155 @@ bool JobLocalDescription::write(const std::string& fname) const {
   if(!write_pair(f,"transfershare",transfershare)) return false;
   if(!write_pair(f,"priority",Arc::tostring(priority))) return false;
   if(!write_pair(f,"dryrun",dryrun)) return false;
+  struct stat st;
+  if(f.Stat(st)) local_cache.Put(fname,st,content);
   return true;
 }
 
 bool JobLocalDescription::read(const std::string& fname) {
   Glib::Mutex::Lock lock_(local_lock);
   // *.local file is accessed concurently. To avoid improper readings lock is acquired.
-  KeyValueFile f(fname,KeyValueFile::Fetch);
-  if(!f) return false;
+  LocalCache::Content loaded;
+  LocalCache::Content const* content = local_cache.Get(fname,loaded);
+  if(!content) return false;
   activityid.clear();
   localvo.clear();
   voms.clear();
-  for(;;) {
-    std::string name;
-    std::string buf;
-    if(!f.Read(name,buf)) return false;
-    if(name.empty() && buf.empty()) break; // EOF
-    if(name.empty()) continue;
-    if(buf.empty()) continue;
-    if(name == "lrms") { lrms = buf; }
-    else if(name == "headnode") { headnode = buf; }
-    else if(name == "headhost") { headhost = buf; }
-    else if(name == "interface") { interface = buf; }
-    else if(name == "queue") { queue = buf; }
-    else if(name == "localid") { localid = buf; }
-    else if(name == "subject") { DN = buf; }
-    else if(name == "starttime") { starttime = buf; }
+  for(LocalCache::Content::const_iterator var = content->begin(); var != content->end(); ++var) {
+    if(!set_var(var->first,var->second)) return false;
+  };
+  return true;
+}
+
+bool JobLocalDescription::set_var(const std::string& name, std::string buf) {
+  if(name == "lrms") { lrms = buf; }
+  else if(name == "headnode") { headnode = buf; }
+  else if(name == "headhost") { headhost = buf; }
+  else if(name == "interface") { interface = buf; }
+  else if(name == "queue") { queue = buf; }
+  else if(name == "localid") { localid = buf; }
+  else if(name == "subject") { DN = buf; }
+  else if(name == "starttime") { starttime = buf; }
 //    else if(name == "UI") { UI = buf; }
-    else if(name == "lifetime") { lifetime = buf; }
-    else if(name == "notify") { notify = buf; }
-    else if(name == "processtime") { processtime = buf; }
-    else if(name == "exectime") { exectime = buf; }
-    else if(name == "jobreport") { jobreport.push_back(std::string(buf)); }
-    else if(name == "globalid") { globalid = buf; }
-    else if(name == "globalurl") { globalurl = buf; }
-    else if(name == "jobname") { jobname = buf; }
-    else if(name == "projectname") { projectnames.push_back(std::string(buf)); }
-    else if(name == "gmlog") { stdlog = buf; }
-    else if(name == "rerun") {
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      reruns = n;
-    }
-    else if(name == "downloads") {
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      downloads = n;
-    }
-    else if(name == "uploads") {
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      uploads = n;
-    }
-    else if(name == "args") {
-      exec.clear(); exec.successcode = 0;
-      while(!buf.empty()) {
-        std::string arg;
-        arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
-        exec.push_back(arg);
-      };
-    }
-    else if(name == "argscode") {
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      exec.successcode = n;
-    }
-    else if(name == "pre") {
-      Exec pe;
-      while(!buf.empty()) {
-        std::string arg;
-        arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
-        pe.push_back(arg);
-      };
-      preexecs.push_back(pe);
-    }
-    else if(name == "precode") {
-      if(preexecs.empty()) return false;
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      preexecs.back().successcode = n;
-    }
-    else if(name == "post") {
-      Exec pe;
-      while(!buf.empty()) {
-        std::string arg;
-        arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
-        pe.push_back(arg);
-      };
-      postexecs.push_back(pe);
-    }
-    else if(name == "postcode") {
-      if(postexecs.empty()) return false;
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      postexecs.back().successcode = n;
-    }
-    else if(name == "cleanuptime") { cleanuptime = buf; }
-    else if(name == "delegexpiretime") { expiretime = buf; }
-    else if(name == "clientname") { clientname = buf; }
-    else if(name == "clientsoftware") { clientsoftware = buf; }
-    else if(name == "delegationid") { delegationid = buf; }
-    else if(name == "sessiondir") { sessiondir = buf; }
-    else if(name == "failedstate") { failedstate = buf; }
-    else if(name == "failedcause") { failedcause = buf; }
-    else if(name == "credentialserver") { credentialserver = buf; }
-    else if(name == "freestagein") { freestagein = parse_boolean(buf); }
-    else if(name == "localvo") {
-      localvo.push_back(buf);
-    }
-    else if(name == "voms") {
-      voms.push_back(buf);
-    }
-    else if(name == "diskspace") {
-      unsigned long long int n;
-      if(!Arc::stringto(buf,n)) return false;
-      diskspace = n;
-    }
-    else if(name == "activityid") {
-      activityid.push_back(buf);
-    }
-    else if(name == "migrateactivityid") { migrateactivityid = buf; }
-    else if(name == "forcemigration") { forcemigration = parse_boolean(buf); }
-    else if(name == "transfershare") { transfershare = buf; }
-    else if(name == "priority") {
-      int n;
-      if(!Arc::stringto(buf,n)) return false;
-      priority = n;
-    }
-    else if(name == "dryrun") { dryrun = parse_boolean(buf); }
+  else if(name == "lifetime") { lifetime = buf; }
+  else if(name == "notify") { notify = buf; }
+  else if(name == "processtime") { processtime = buf; }
+  else if(name == "exectime") { exectime = buf; }
+  else if(name == "jobreport") { jobreport.push_back(std::string(buf)); }
+  else if(name == "globalid") { globalid = buf; }
+  else if(name == "globalurl") { globalurl = buf; }
+  else if(name == "jobname") { jobname = buf; }
+  else if(name == "projectname") { projectnames.push_back(std::string(buf)); }
+  else if(name == "gmlog") { stdlog = buf; }
+  else if(name == "rerun") {
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    reruns = n;
+  }
+  else if(name == "downloads") {
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    downloads = n;
+  }
+  else if(name == "uploads") {
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    uploads = n;
+  }
+  else if(name == "args") {
+    exec.clear(); exec.successcode = 0;
+    while(!buf.empty()) {
+      std::string arg;
+      arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
+      exec.push_back(arg);
+    };
+  }
+  else if(name == "argscode") {
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    exec.successcode = n;
+  }
+  else if(name == "pre") {
+    Exec pe;
+    while(!buf.empty()) {
+      std::string arg;
+      arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
+      pe.push_back(arg);
+    };
+    preexecs.push_back(pe);
+  }
+  else if(name == "precode") {
+    if(preexecs.empty()) return false;
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    preexecs.back().successcode = n;
   }
+  else if(name == "post") {
+    Exec pe;
+    while(!buf.empty()) {
+      std::string arg;
+      arg = Arc::unescape_chars(Arc::extract_escaped_token(buf, ' ', '\\'), '\\');
+      pe.push_back(arg);
+    };
+    postexecs.push_back(pe);
+  }
+  else if(name == "postcode") {
+    if(postexecs.empty()) return false;
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    postexecs.back().successcode = n;
+  }
+  else if(name == "cleanuptime") { cleanuptime = buf; }
+  else if(name == "delegexpiretime") { expiretime = buf; }
+  else if(name == "clientname") { clientname = buf; }
+  else if(name == "clientsoftware") { clientsoftware = buf; }
+  else if(name == "delegationid") { delegationid = buf; }
+  else if(name == "sessiondir") { sessiondir = buf; }
+  else if(name == "failedstate") { failedstate = buf; }
+  else if(name == "failedcause") { failedcause = buf; }
+  else if(name == "credentialserver") { credentialserver = buf; }
+  else if(name == "freestagein") { freestagein = parse_boolean(buf); }
+  else if(name == "localvo") {
+    localvo.push_back(buf);
+  }
+  else if(name == "voms") {
+    voms.push_back(buf);
+  }
+  else if(name == "diskspace") {
+    unsigned long long int n;
+    if(!Arc::stringto(buf,n)) return false;
+    diskspace = n;
+  }
+  else if(name == "activityid") {
+    activityid.push_back(buf);
+  }
+  else if(name == "migrateactivityid") { migrateactivityid = buf; }
+  else if(name == "forcemigration") { forcemigration = parse_boolean(buf); }
+  else if(name == "transfershare") { transfershare = buf; }
+  else if(name == "priority") {
+    int n;
+    if(!Arc::stringto(buf,n)) return false;
+    priority = n;
+  }
+  else if(name == "dryrun") { dryrun = parse_boolean(buf); }
   return true;
 }
 
 bool JobLocalDescription::read_var(const std::string &fname,const std::string &vnam,std::string &value) {
   Glib::Mutex::Lock lock_(local_lock);
   // *.local file is accessed concurently. To avoid improper readings lock is acquired.
-  KeyValueFile f(fname,KeyValueFile::Fetch);
-  if(!f) return false;
-  // using iostream for handling file content
-  bool found = false;
-  for(;;) {
-    std::string buf;
-    std::string name;
-    if(!f.Read(name, buf)) return false;
-    if(name.empty() && buf.empty()) break; // EOF
-    if(name.empty()) continue;
-    if(buf.empty()) continue;
-    if(name == vnam) { value = buf; found=true; break; };
+  LocalCache::Content loaded;
+  LocalCache::Content const* content = local_cache.Get(fname,loaded);
+  if(!content) return false;
+  for(LocalCache::Content::const_iterator var = content->begin(); var != content->end(); ++var) {
+    if(var->first == vnam) { value = var->second; return true; };
   };
-  return found;
+  return false;
+}
+
+void JobLocalDescription::cache_size(unsigned int size) {
+  Glib::Mutex::Lock lock_(local_lock);
+  local_cache.Size(size);
 }
 
 } // namespace ARex
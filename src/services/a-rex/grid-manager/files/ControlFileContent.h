@@ -82,6 +82,12 @@ class JobLocalDescription {
   bool read(const std::string& fname);
   bool write(const std::string& fname) const;
   static bool read_var(const std::string &fname,const std::string &vnam,std::string &value);
+  // Content of recently used .local files is kept in memory. This sets maximal
+  // number of files kept. 0 disables caching.
+  static void cache_size(unsigned int size);
+ private:
+  bool set_var(const std::string& name, std::string buf);
+ public:
   
   // All non-static members are safe to copy
 
@@ -9,11 +9,13 @@
 #include <arc/FileAccess.h>
 #include <arc/FileUtils.h>
 #include <arc/FileLock.h>
+#include <arc/StringConv.h>
 
 #include "../run/RunRedirected.h"
 #include "../conf/GMConfig.h"
 #include "../jobs/GMJob.h"
 
+#include "ControlStore.h"
 #include "ControlFileHandling.h"
 
 namespace ARex {
@@ -45,11 +47,20 @@ const char * const subdir_new      = "accepting";      // Submitted but not yet
 const char * const subdir_cur      = "processing";     // Being processed by A-REX
 const char * const subdir_old      = "finished";       // Finished or deleted jobs
 const char * const subdir_rew      = "restarting";     // Jobs waiting to restart
+const char * const subdir_owners   = "owners";         // Index of jobs by owner
+
+// Present in index of jobs by owner while it is being built
+static const char * const owners_building_mark = ".building";
+// Characters kept as is in owner's name when used as directory name
+static const char * const owners_safe_chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_=,@";
 
 static Arc::Logger& logger = Arc::Logger::getRootLogger();
 
 static job_state_t job_state_read_file(const std::string &fname,bool &pending);
 static bool job_state_write_file(const std::string &fname,job_state_t state,bool pending);
+static bool job_owner_read(const GMJob &job,const GMConfig &config,std::string &owner);
+static std::string job_Xput_format(std::list<FileData> &files,job_output_mode mode);
+static void job_Xput_parse(const std::list<std::string> &lines,std::list<FileData> &files);
 static bool job_mark_put(Arc::FileAccess& fa, const std::string &fname);
 static bool job_mark_remove(Arc::FileAccess& fa,const std::string &fname);
 
@@ -438,7 +449,11 @@ bool job_state_write_file(const GMJob &job,const GMConfig &config,job_state_t st
     fname = config.ControlDir() + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
     fname = config.ControlDir() + "/" + subdir_cur + "/job." + job.get_id() + sfx_status;
   };
-  return job_state_write_file(fname,state,pending) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config);
+  if(!(job_state_write_file(fname,state,pending) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config))) return false;
+  // Index is only a shortcut for finding jobs, so its failures are not fatal
+  std::string owner;
+  if(job_owner_read(job,config,owner)) job_owner_index_put(job.get_id(),config,owner,state);
+  return true;
 }
 
 static job_state_t job_state_read_file(const std::string &fname,bool &pending) {
@@ -487,6 +502,7 @@ bool job_description_write_file(const GMJob &job,const GMConfig &config,const st
 }
 
 bool job_acl_read_file(const JobId &id,const GMConfig &config,std::string &acl) {
+  // ACL is always a file because gridftp job plugin accesses it by path
   std::string fname = config.ControlDir() + "/job." + id + sfx_acl;
   return job_description_read_file(fname,acl);
 }
@@ -559,16 +575,29 @@ bool job_local_read_delegationid(const JobId &id,const GMConfig &config,std::str
 /* job.ID.input functions */
 
 bool job_input_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) return store->Write(job.get_id(),sfx_input,job_Xput_format(files,job_output_all));
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_input;
   return job_Xput_write_file(fname,files) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_input_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) {
+    std::string data;
+    if(!store->Read(id,sfx_input,data)) return false;
+    std::list<std::string> lines;
+    Arc::tokenize(data,lines,"\n");
+    job_Xput_parse(lines,files);
+    return true;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_input;
   return job_Xput_read_file(fname,files);
 }
 
 bool job_input_status_add_file(const GMJob &job,const GMConfig &config,const std::string& file) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) return store->Append(job.get_id(),sfx_inputstatus,file+"\n");
   // 1. lock
   // 2. add
   // 3. unlock
@@ -592,6 +621,13 @@ bool job_input_status_add_file(const GMJob &job,const GMConfig &config,const std
 }
 
 bool job_input_status_read_file(const JobId &id,const GMConfig &config,std::list<std::string>& files) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) {
+    std::string data;
+    if(!store->Read(id,sfx_inputstatus,data)) return false;
+    Arc::tokenize(data,files,"\n");
+    return true;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_inputstatus;
   Arc::FileLock lock(fname);
   for (int i = 10; !lock.acquire() && i >= 0; --i) {
@@ -615,6 +651,12 @@ bool job_output_read_file(const JobId &id,const GMConfig &config,std::list<FileD
 }
 
 bool job_output_status_add_file(const GMJob &job,const GMConfig &config,const FileData& file) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) {
+    std::ostringstream line;
+    line<<file<<"\n";
+    return store->Append(job.get_id(),sfx_outputstatus,line.str());
+  };
   // Not using lock here because concurrent read/write is not expected
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputstatus;
   std::string data;
@@ -626,18 +668,29 @@ bool job_output_status_add_file(const GMJob &job,const GMConfig &config,const Fi
 }
 
 bool job_output_status_write_file(const GMJob &job,const GMConfig &config,std::list<FileData> &files) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) return store->Write(job.get_id(),sfx_outputstatus,job_Xput_format(files,job_output_all));
   std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_outputstatus;
   return job_Xput_write_file(fname,files) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
 bool job_output_status_read_file(const JobId &id,const GMConfig &config,std::list<FileData> &files) {
+  ControlStore* store = ControlStore::Get(config);
+  if(store) {
+    std::string data;
+    if(!store->Read(id,sfx_outputstatus,data)) return false;
+    std::list<std::string> lines;
+    Arc::tokenize(data,lines,"\n");
+    job_Xput_parse(lines,files);
+    return true;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_outputstatus;
   return job_Xput_read_file(fname,files);
 }
 
 /* common functions */
 
-bool job_Xput_write_file(const std::string &fname,std::list<FileData> &files,job_output_mode mode, uid_t uid, gid_t gid) {
+static std::string job_Xput_format(std::list<FileData> &files,job_output_mode mode) {
   std::ostringstream s;
   for(FileData::iterator i=files.begin();i!=files.end(); ++i) { 
     if(mode == job_output_all) {
@@ -662,19 +715,27 @@ bool job_Xput_write_file(const std::string &fname,std::list<FileData> &files,job
       };
     };
   };
-  if (!Arc::FileCreate(fname, s.str(), uid, gid)) return false;
-  return true;
+  return s.str();
 }
 
-bool job_Xput_read_file(const std::string &fname,std::list<FileData> &files, uid_t uid, gid_t gid) {
-  std::list<std::string> file_content;
-  if (!Arc::FileRead(fname, file_content, uid, gid)) return false;
-  for(std::list<std::string>::iterator i = file_content.begin(); i != file_content.end(); ++i) {
+static void job_Xput_parse(const std::list<std::string> &lines,std::list<FileData> &files) {
+  for(std::list<std::string>::const_iterator i = lines.begin(); i != lines.end(); ++i) {
     FileData fd;
     std::istringstream s(*i);
     s >> fd;
     if(!fd.pfn.empty()) files.push_back(fd);
   };
+}
+
+bool job_Xput_write_file(const std::string &fname,std::list<FileData> &files,job_output_mode mode, uid_t uid, gid_t gid) {
+  if (!Arc::FileCreate(fname, job_Xput_format(files,mode), uid, gid)) return false;
+  return true;
+}
+
+bool job_Xput_read_file(const std::string &fname,std::list<FileData> &files, uid_t uid, gid_t gid) {
+  std::list<std::string> file_content;
+  if (!Arc::FileRead(fname, file_content, uid, gid)) return false;
+  job_Xput_parse(file_content,files);
   return true;
 }
 
@@ -721,6 +782,14 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config,std::list<std::st
   fname = config.ControlDir()+"/job."+id+sfx_outputstatus; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_inputstatus; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_statistics; remove(fname.c_str());
+  ControlStore* store = ControlStore::Get(config);
+  if(store) {
+    std::list<std::string> sfxs;
+    sfxs.push_back(sfx_input);
+    sfxs.push_back(sfx_inputstatus);
+    sfxs.push_back(sfx_outputstatus);
+    store->Remove(id,sfxs);
+  };
   /* remove session directory */
   if(config.StrictSession()) {
     Arc::DirDelete(session, true, job.get_user().get_uid(), job.get_user().get_gid());
@@ -736,6 +805,8 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config,std::list<std::st
 
 bool job_clean_final(const GMJob &job,const GMConfig &config) {
   std::string id = job.get_id();
+  std::string owner;
+  if(job_owner_read(job,config,owner)) job_owner_index_remove(id,config,owner);
   job_clean_finished(id,config);
   job_clean_deleted(job,config);
   std::string fname;
@@ -751,7 +822,132 @@ bool job_clean_final(const GMJob &job,const GMConfig &config) {
   fname = config.ControlDir()+"/"+subdir_rew+"/job."+id+sfx_status; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_desc; remove(fname.c_str());
   fname = config.ControlDir()+"/job."+id+sfx_xml; remove(fname.c_str());
+  ControlStore* store = ControlStore::Get(config);
+  if(store) store->Remove(id);
   return true;
 }
 
+/* Index of jobs by owner: owners/<owner>/<id> files containing job state */
+
+static bool job_owner_read(const GMJob &job,const GMConfig &config,std::string &owner) {
+  JobLocalDescription* local = job.GetLocalDescription();
+  if(local) { owner = local->DN; return true; };
+  std::string fname = config.ControlDir() + "/job." + job.get_id() + sfx_local;
+  if(job_local_read_var(fname,"subject",owner)) return true;
+  // Anonymous jobs have no subject stored
+  owner.clear();
+  return job_mark_check(fname);
+}
+
+static std::string job_owner_index_dir(const GMConfig &config,const std::string &owner) {
+  // Owner's name is encoded to be usable as file name. Long names are
+  // split into nested directories to stay within file name length limit.
+  // Continuation parts start with '+', which never appears in encoded
+  // name or job id.
+  std::string key = Arc::escape_chars(owner,owners_safe_chars,'%',true,Arc::escape_hex);
+  if(key.empty()) key = "%";
+  std::string dir = config.ControlDir() + "/" + subdir_owners + "/" + key.substr(0,200);
+  for(std::string::size_type p = 200; p < key.length(); p += 200) {
+    dir += "/+" + key.substr(p,200);
+  };
+  return dir;
+}
+
+static bool job_owner_index_exists(const GMConfig &config) {
+  struct stat st;
+  std::string dir = config.ControlDir() + "/" + subdir_owners;
+  return (lstat(dir.c_str(),&st) == 0) && S_ISDIR(st.st_mode);
+}
+
+static bool job_owner_index_entry(const std::string &name) {
+  // Skips continuation directories and temporary files
+  return !name.empty() && (name[0] != '+') && (name.find('.') == std::string::npos);
+}
+
+bool job_owner_index_ready(const GMConfig &config) {
+  if(!job_owner_index_exists(config)) return false;
+  return !job_mark_check(config.ControlDir() + "/" + subdir_owners + "/" + owners_building_mark);
+}
+
+bool job_owner_index_put(const JobId &id,const GMConfig &config,const std::string &owner,job_state_t state,bool keep) {
+  // Index is created only by job_owner_index_start(). Until then there is nothing to update.
+  if(!job_owner_index_exists(config)) return false;
+  std::string dir = job_owner_index_dir(config,owner);
+  std::string fname = dir + "/" + id;
+  if(keep) {
+    // Entry written by job_state_write_file() is more recent than the one being added
+    if(!Arc::DirCreate(dir,S_IRWXU,true)) return false;
+    int h = open(fname.c_str(),O_WRONLY | O_CREAT | O_EXCL,S_IRUSR | S_IWUSR);
+    if(h == -1) return (errno == EEXIST);
+    std::string data(GMJob::get_state_name(state));
+    bool r = (write(h,data.c_str(),data.length()) == (ssize_t)data.length());
+    close(h);
+    return r;
+  };
+  if(job_mark_write(fname,GMJob::get_state_name(state))) return true;
+  if(!Arc::DirCreate(dir,S_IRWXU,true)) return false;
+  return job_mark_write(fname,GMJob::get_state_name(state));
+}
+
+bool job_owner_index_remove(const JobId &id,const GMConfig &config,const std::string &owner) {
+  if(!job_owner_index_exists(config)) return true;
+  return job_mark_remove(job_owner_index_dir(config,owner) + "/" + id);
+}
+
+bool job_owner_index_list(const GMConfig &config,const std::string &owner,std::list<std::pair<JobId,job_state_t> > &jobs) {
+  if(!job_owner_index_ready(config)) return false;
+  std::string dir = job_owner_index_dir(config,owner);
+  struct stat st;
+  if(lstat(dir.c_str(),&st) != 0) return (errno == ENOENT); // no jobs of this owner yet
+  try {
+    Glib::Dir d(dir);
+    for(;;) {
+      std::string name = d.read_name();
+      if(name.empty()) break;
+      if(!job_owner_index_entry(name)) continue;
+      std::string state = job_mark_read(dir + "/" + name);
+      if(state.empty()) continue; // removed meanwhile
+      jobs.push_back(std::pair<JobId,job_state_t>(name,GMJob::get_state(state.c_str())));
+    };
+  } catch(Glib::FileError& e) {
+    return false;
+  };
+  return true;
+}
+
+bool job_owner_index_start(const GMConfig &config) {
+  std::string dir = config.ControlDir() + "/" + subdir_owners;
+  if(!Arc::DirCreate(dir,S_IRWXU,false)) return false;
+  return job_mark_put(dir + "/" + owners_building_mark);
+}
+
+static void job_owner_index_sweep(const GMConfig &config,const std::string &dir) {
+  try {
+    Glib::Dir d(dir);
+    for(;;) {
+      std::string name = d.read_name();
+      if(name.empty()) break;
+      std::string fname = dir + "/" + name;
+      struct stat st;
+      if(lstat(fname.c_str(),&st) != 0) continue;
+      if(S_ISDIR(st.st_mode)) {
+        job_owner_index_sweep(config,fname);
+      } else if(name != owners_building_mark) {
+        // Entries may be left behind if job was removed while index was built
+        if(!job_owner_index_entry(name) ||
+           !job_mark_check(config.ControlDir() + "/job." + name + sfx_local)) {
+          job_mark_remove(fname);
+        };
+      };
+    };
+  } catch(Glib::FileError& e) {
+  };
+}
+
+bool job_owner_index_finish(const GMConfig &config) {
+  std::string dir = config.ControlDir() + "/" + subdir_owners;
+  job_owner_index_sweep(config,dir);
+  return job_mark_remove(dir + "/" + owners_building_mark);
+}
+
 } // namespace ARex
@@ -31,6 +31,7 @@ extern const char * const subdir_new;
 extern const char * const subdir_cur;
 extern const char * const subdir_old;
 extern const char * const subdir_rew;
+extern const char * const subdir_owners;
 
 enum job_output_mode {
   job_output_all,
@@ -199,6 +200,21 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config, std::list<std::s
 // Remove all job's files.
 bool job_clean_final(const GMJob &job,const GMConfig &config);
 
+// Index of jobs by owner. It is kept in control dir and updated by
+// job_state_write_file() and job_clean_final(). It is created by calling
+// job_owner_index_start(), adding all existing jobs with 'keep' set and
+// calling job_owner_index_finish(). Index is not used till then.
+// Returns true if index exists and is complete.
+bool job_owner_index_ready(const GMConfig &config);
+// Add job or set its state. If 'keep' is set existing entry is not changed.
+bool job_owner_index_put(const JobId &id,const GMConfig &config,const std::string &owner,job_state_t state,bool keep = false);
+bool job_owner_index_remove(const JobId &id,const GMConfig &config,const std::string &owner);
+// Get ids and states of jobs belonging to owner. Returns false if index is
+// not ready.
+bool job_owner_index_list(const GMConfig &config,const std::string &owner,std::list<std::pair<JobId,job_state_t> > &jobs);
+bool job_owner_index_start(const GMConfig &config);
+bool job_owner_index_finish(const GMConfig &config);
+
 } // namespace ARex
 
 #endif
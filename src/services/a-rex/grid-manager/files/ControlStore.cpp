@@ -0,0 +1,161 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <map>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "../../SQLhelpers.h"
+#include "../conf/GMConfig.h"
+
+#include "ControlStore.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+const char* const ControlStore::DbName = "control.db";
+
+const char* const ControlStore::Suffixes[] = {
+  ".input", ".input_status", ".output_status", NULL
+};
+
+bool ControlStore::Stored(const std::string& sfx) {
+  for(int n = 0; Suffixes[n]; ++n) {
+    if(sfx == Suffixes[n]) return true;
+  };
+  return false;
+}
+
+ControlStore* ControlStore::Get(const GMConfig& config) {
+  if(config.ControlDBType() != GMConfig::control_db_sqlite) return NULL;
+  static Glib::Mutex stores_lock;
+  static std::map<std::string,ControlStore*> stores;
+  Glib::Mutex::Lock lock(stores_lock);
+  std::map<std::string,ControlStore*>::iterator store = stores.find(config.ControlDir());
+  if(store != stores.end()) return store->second;
+  ControlStore* new_store = new ControlStore(config.ControlDir());
+  if(!*new_store) {
+    // Files are used instead. Failure is remembered so that store
+    // is not switched in the middle of processing.
+    logger.msg(Arc::ERROR, "Failed to open control database in %s: %s", config.ControlDir(), new_store->Error());
+    logger.msg(Arc::ERROR, "Control files in %s will be used instead of database", config.ControlDir());
+    delete new_store;
+    new_store = NULL;
+  };
+  stores[config.ControlDir()] = new_store;
+  return new_store;
+}
+
+bool ControlStore::dberr(const char* s, int err) {
+  if(err == SQLITE_OK) return true;
+#ifdef HAVE_SQLITE3_ERRSTR
+  error_str_ = std::string(s)+": "+sqlite3_errstr(err);
+#else
+  error_str_ = std::string(s)+": error code "+Arc::tostring(err);
+#endif
+  return false;
+}
+
+ControlStore::ControlStore(const std::string& controldir, bool create) {
+  std::string dbpath = controldir + G_DIR_SEPARATOR_S + DbName;
+  if(!dberr("Error opening database", db_.Open(dbpath, create))) return;
+  if(!dberr("Error creating table ctl", db_.Exec("CREATE TABLE IF NOT EXISTS ctl(id, sfx, content, UNIQUE(id, sfx))"))) {
+    db_.Close();
+    return;
+  };
+}
+
+ControlStore::~ControlStore(void) {
+  db_.Close();
+}
+
+bool ControlStore::Read(const std::string& id, const std::string& sfx, std::string& content) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteStatement stmt(db_, "SELECT content FROM ctl WHERE (id = ?) AND (sfx = ?)");
+  stmt.Bind(sql_escape(id)).Bind(sql_escape(sfx));
+  bool found = (stmt.Step() == SQLITE_ROW);
+  if(found) content = sql_unescape(stmt.Text(0));
+  if(!dberr("Failed to read record", stmt.Error())) return false;
+  return found;
+}
+
+bool ControlStore::Write(const std::string& id, const std::string& sfx, const std::string& content) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteStatement stmt(db_, "INSERT OR REPLACE INTO ctl(id, sfx, content) VALUES (?, ?, ?)");
+  stmt.Bind(sql_escape(id)).Bind(sql_escape(sfx)).Bind(sql_escape(content));
+  return dberr("Failed to write record", stmt.Exec());
+}
+
+bool ControlStore::Append(const std::string& id, const std::string& sfx, const std::string& content) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteTransaction transaction(db_);
+  if(!transaction) {
+    error_str_ = "Failed to start transaction";
+    return false;
+  };
+  {
+    SQLiteStatement stmt(db_, "INSERT OR IGNORE INTO ctl(id, sfx, content) VALUES (?, ?, '')");
+    stmt.Bind(sql_escape(id)).Bind(sql_escape(sfx));
+    if(!dberr("Failed to append to record", stmt.Exec())) return false;
+  };
+  {
+    // Escaping is done per character, hence escaped strings can be concatenated directly.
+    SQLiteStatement stmt(db_, "UPDATE ctl SET content = content || ? WHERE (id = ?) AND (sfx = ?)");
+    stmt.Bind(sql_escape(content)).Bind(sql_escape(id)).Bind(sql_escape(sfx));
+    if(!dberr("Failed to append to record", stmt.Exec())) return false;
+  };
+  return dberr("Failed to commit transaction", transaction.Commit());
+}
+
+bool ControlStore::Remove(const std::string& id, const std::string& sfx) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteStatement stmt(db_, "DELETE FROM ctl WHERE (id = ?) AND (sfx = ?)");
+  stmt.Bind(sql_escape(id)).Bind(sql_escape(sfx));
+  return dberr("Failed to remove record", stmt.Exec());
+}
+
+bool ControlStore::Remove(const std::string& id, const std::list<std::string>& sfxs) {
+  if(sfxs.empty()) return true;
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  // Same prepared statement is used for every suffix and
+  // transaction makes it one write to database.
+  SQLiteTransaction transaction(db_);
+  if(!transaction) {
+    error_str_ = "Failed to start transaction";
+    return false;
+  };
+  for(std::list<std::string>::const_iterator sfx = sfxs.begin(); sfx != sfxs.end(); ++sfx) {
+    SQLiteStatement stmt(db_, "DELETE FROM ctl WHERE (id = ?) AND (sfx = ?)");
+    stmt.Bind(sql_escape(id)).Bind(sql_escape(*sfx));
+    if(!dberr("Failed to remove records", stmt.Exec())) return false;
+  };
+  return dberr("Failed to commit transaction", transaction.Commit());
+}
+
+bool ControlStore::Remove(const std::string& id) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteStatement stmt(db_, "DELETE FROM ctl WHERE (id = ?)");
+  stmt.Bind(sql_escape(id));
+  return dberr("Failed to remove records", stmt.Exec());
+}
+
+bool ControlStore::ListJobs(std::list<std::string>& ids) {
+  Glib::Mutex::Lock lock(lock_);
+  if(!db_) return false;
+  SQLiteStatement stmt(db_, "SELECT DISTINCT id FROM ctl");
+  while(stmt.Step() == SQLITE_ROW) {
+    ids.push_back(sql_unescape(stmt.Text(0)));
+  };
+  return dberr("Failed to list jobs", stmt.Error());
+}
+
+} // namespace ARex
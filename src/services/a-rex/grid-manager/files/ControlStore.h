@@ -0,0 +1,69 @@
+#ifndef GRID_MANAGER_CONTROL_STORE_H
+#define GRID_MANAGER_CONTROL_STORE_H
+
+#include <string>
+#include <list>
+
+#include <sqlite3.h>
+
+#include <arc/Thread.h>
+
+#include "../../SQLiteDB.h"
+
+namespace ARex {
+
+class GMConfig;
+
+/// Database holding content of control files used only by A-REX itself.
+/**
+ * Per-job files like job.ID.input_status are kept as records identified
+ * by job id and file suffix in one SQLite database in control directory.
+ * Files read by LRMS scripts and information providers are never
+ * stored here.
+ */
+class ControlStore {
+ private:
+  Glib::Mutex lock_;
+  SQLiteDB db_;
+  std::string error_str_;
+  bool dberr(const char* s, int err);
+  ControlStore(const ControlStore&);
+ public:
+  /// Name of database file in control directory
+  static const char* const DbName;
+  /// Suffixes of control files which are kept in database
+  static const char* const Suffixes[];
+
+  ControlStore(const std::string& controldir, bool create = true);
+  ~ControlStore(void);
+  operator bool(void) const { return (bool)db_; };
+  bool operator!(void) const { return !db_; };
+  const std::string& Error(void) const { return error_str_; };
+
+  /// Returns true if files with suffix sfx are kept in database
+  static bool Stored(const std::string& sfx);
+
+  /// Returns database for control directory of config or NULL if control files are used.
+  /** Databases are opened once per control directory and stay open till the end of process.
+      If database can't be opened NULL is returned for the rest of process life too. */
+  static ControlStore* Get(const GMConfig& config);
+
+  /// Read content of file. Returns false if there is no such file.
+  bool Read(const std::string& id, const std::string& sfx, std::string& content);
+  /// Create or overwrite file
+  bool Write(const std::string& id, const std::string& sfx, const std::string& content);
+  /// Append to content of file creating it if needed
+  bool Append(const std::string& id, const std::string& sfx, const std::string& content);
+  /// Remove file. Missing file is not an error.
+  bool Remove(const std::string& id, const std::string& sfx);
+  /// Remove several files of job at once
+  bool Remove(const std::string& id, const std::list<std::string>& sfxs);
+  /// Remove all files of job
+  bool Remove(const std::string& id);
+  /// Get identifiers of jobs which have files in database
+  bool ListJobs(std::list<std::string>& ids);
+};
+
+} // namespace ARex
+
+#endif // GRID_MANAGER_CONTROL_STORE_H
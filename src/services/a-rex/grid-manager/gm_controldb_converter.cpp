@@ -0,0 +1,151 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/OptionParser.h>
+#include <arc/StringConv.h>
+
+#include "conf/GMConfig.h"
+#include "jobs/JobsList.h"
+#include "files/ControlStore.h"
+
+using namespace ARex;
+
+// Moves content of files of one job into database
+static bool files_to_db(const std::string& control_dir, ControlStore& store, const JobId& id, unsigned int& num) {
+  for(int n = 0; ControlStore::Suffixes[n]; ++n) {
+    std::string fname = control_dir + "/job." + id + ControlStore::Suffixes[n];
+    std::string data;
+    if(!Arc::FileRead(fname, data)) continue;
+    if(!store.Write(id, ControlStore::Suffixes[n], data)) {
+      std::cerr << "Failed storing " << fname << " - " << store.Error() << std::endl;
+      return false;
+    };
+    if(!Arc::FileDelete(fname)) {
+      std::cerr << "Failed deleting " << fname << std::endl;
+      return false;
+    };
+    ++num;
+  };
+  return true;
+}
+
+// Writes records of one job into files owned by same user as rest of job's files
+static bool db_to_files(const std::string& control_dir, ControlStore& store, const JobId& id, unsigned int& num) {
+  struct stat st;
+  bool fix_owner = (::stat((control_dir + "/job." + id + ".local").c_str(), &st) == 0);
+  for(int n = 0; ControlStore::Suffixes[n]; ++n) {
+    std::string fname = control_dir + "/job." + id + ControlStore::Suffixes[n];
+    std::string data;
+    if(!store.Read(id, ControlStore::Suffixes[n], data)) continue;
+    if(!Arc::FileCreate(fname, data, 0, 0, S_IRUSR | S_IWUSR)) {
+      std::cerr << "Failed writing " << fname << std::endl;
+      return false;
+    };
+    if(fix_owner) (void)::chown(fname.c_str(), st.st_uid, st.st_gid);
+    if(!store.Remove(id, ControlStore::Suffixes[n])) {
+      std::cerr << "Failed removing record for " << fname << " - " << store.Error() << std::endl;
+      return false;
+    };
+    ++num;
+  };
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+
+  // stderr destination for error messages
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::DEBUG);
+
+  Arc::OptionParser options(" ",
+                            istring("gm-controldb-converter moves control files "
+                                    "of existing jobs between control directory "
+                                    "and control database. A-REX must not be running."));
+
+  std::string conf_file;
+  options.AddOption('c', "conffile",
+                    istring("use specified configuration file"),
+                    istring("file"), conf_file);
+
+  std::string control_dir;
+  options.AddOption('d', "controldir",
+                    istring("read information from specified control directory"),
+                    istring("dir"), control_dir);
+
+  std::string output_format;
+  options.AddOption('o', "output",
+                    istring("convert into specified storage format [files|sqlite]"),
+                    istring("storage format"), output_format);
+
+  std::list<std::string> params = options.Parse(argc, argv);
+
+  GMConfig config;
+  if (!conf_file.empty()) config.SetConfigFile(conf_file);
+
+  std::cout << "Using configuration at " << config.ConfigFile() << std::endl;
+  if(!config.Load()) exit(1);
+
+  if (!control_dir.empty()) config.SetControlDir(control_dir);
+
+  config.Print();
+
+  // By default convert into format chosen in configuration
+  bool to_db = (config.ControlDBType() == GMConfig::control_db_sqlite);
+  if(!output_format.empty()) {
+    if(output_format == "files") {
+      to_db = false;
+    } else if(output_format == "sqlite") {
+      to_db = true;
+    } else {
+      std::cerr << "Unknown output storage format requested - " << output_format << std::endl;
+      exit(-1);
+    };
+  };
+
+  ControlStore store(config.ControlDir(), to_db);
+  if(!store) {
+    std::cerr << "Failed opening control database - " << store.Error() << std::endl;
+    exit(-1);
+  };
+
+  std::list<JobId> ids;
+  if(to_db) {
+    std::cout << "Moving control files into database" << std::endl;
+    if(!JobsList::GetAllJobIds(config, ids)) {
+      std::cerr << "Failed listing jobs in " << config.ControlDir() << std::endl;
+      exit(-1);
+    };
+  } else {
+    std::cout << "Moving control database content into files" << std::endl;
+    if(!store.ListJobs(ids)) {
+      std::cerr << "Failed listing jobs in control database - " << store.Error() << std::endl;
+      exit(-1);
+    };
+  };
+
+  unsigned int num = 0;
+  for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+    bool r = to_db ? files_to_db(config.ControlDir(), store, *id, num)
+                   : db_to_files(config.ControlDir(), store, *id, num);
+    if(!r) {
+      std::cerr << "Conversion stopped at job " << *id << ". It can be restarted." << std::endl;
+      exit(-1);
+    };
+  };
+  std::cout << "Converted " << num << " control files of " << ids.size() << " jobs" << std::endl;
+  if(to_db != (config.ControlDBType() == GMConfig::control_db_sqlite)) {
+    std::cout << "Do NOT forget to set controldb=" << (to_db ? "sqlite" : "files")
+              << " in configuration file before starting A-REX." << std::endl;
+  };
+  return 0;
+}
@@ -6,9 +6,17 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <stdint.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
+#include <vector>
 
 #include "CommFIFO.h"
 
@@ -18,24 +26,44 @@ static const unsigned int MAX_ID_SIZE = 64;
 
 static const std::string fifo_file("/gm.fifo");
 
+// Current time in milliseconds not affected by clock adjustments
+static long long int current_msec(void) {
+  struct timespec t;
+  if((clock_gettime(CLOCK_MONOTONIC, &t) != 0) && (clock_gettime(CLOCK_REALTIME, &t) != 0)) return 0;
+  return ((long long int)t.tv_sec)*1000 + t.tv_nsec/1000000;
+}
+
+static void set_nonblock(int h) {
+  int arg = fcntl(h,F_GETFL);
+  if(arg != -1) (void)fcntl(h,F_SETFL,arg|O_NONBLOCK);
+}
+
 bool CommFIFO::make_pipe(void) {
   bool res = false;
   lock.lock();
   if (kick_in != -1) {
-    close(kick_in); kick_in = -1;
+    if (kick_in != kick_out) close(kick_in);
+    kick_in = -1;
   };
   if (kick_out != -1) {
     close(kick_out); kick_out = -1;
   };
+#ifdef HAVE_SYS_EVENTFD_H
+  // Single counter serves as both ends
+  int h = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(h != -1) {
+    kick_in=h;
+    kick_out=h;
+    lock.unlock();
+    return true;
+  };
+#endif
   int filedes[2];
   if(pipe(filedes) == 0) {
     kick_in=filedes[1];
     kick_out=filedes[0];
-    long arg;
-    arg=fcntl(kick_in,F_GETFL);
-    if(arg != -1) { arg|=O_NONBLOCK; fcntl(kick_in,F_SETFL,&arg); };
-    arg=fcntl(kick_out,F_GETFL);
-    if(arg != -1) { arg|=O_NONBLOCK; fcntl(kick_out,F_SETFL,&arg); };
+    set_nonblock(kick_in);
+    set_nonblock(kick_out);
     res = (kick_in != -1);
   };
   lock.unlock();
@@ -49,11 +77,20 @@ CommFIFO::CommFIFO(void) {
 }
 
 CommFIFO::~CommFIFO(void) {
+  lock.lock();
+  for(std::list<elem_t>::iterator i = fds.begin();i!=fds.end();++i) {
+    if(i->fd != -1) close(i->fd);
+    if(i->fd_keep != -1) close(i->fd_keep);
+  };
+  fds.clear();
+  if((kick_in != -1) && (kick_in != kick_out)) close(kick_in);
+  if(kick_out != -1) close(kick_out);
+  kick_in = -1; kick_out = -1;
+  lock.unlock();
 }
 
 bool CommFIFO::wait(int timeout, std::string& event) {
-  time_t start_time = time(NULL);
-  time_t end_time = start_time + timeout;
+  long long int end_time = current_msec() + ((long long int)timeout)*1000;
   bool have_generic_event = false;
   bool kicked = false;
   event.clear();
@@ -72,11 +109,13 @@ bool CommFIFO::wait(int timeout, std::string& event) {
     if(have_generic_event) return true;
     if(kicked) return false;
     // If nothing found - wait for incoming information
-    fd_set fin,fout,fexc;
-    FD_ZERO(&fin); FD_ZERO(&fout); FD_ZERO(&fexc);
-    int maxfd=-1;
+    std::vector<struct pollfd> pfds;
+    struct pollfd pfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
     if(kick_out == -1) make_pipe(); // try to recover if had error previously
-    if(kick_out != -1) { maxfd=kick_out; FD_SET(kick_out,&fin); };
+    int kick_fd = kick_out;
+    if(kick_fd != -1) { pfd.fd = kick_fd; pfds.push_back(pfd); };
     lock.lock();
     for(std::list<elem_t>::iterator i = fds.begin();i!=fds.end();++i) {
       if(i->fd < 0) {
@@ -85,96 +124,87 @@ bool CommFIFO::wait(int timeout, std::string& event) {
         take_pipe(pipe_dir, *i);
         if(i->fd < 0) continue;
       };
-      if(i->fd > maxfd) maxfd=i->fd;
-      FD_SET(i->fd,&fin);
+      pfd.fd = i->fd; pfds.push_back(pfd);
     };
     lock.unlock();
-    int err;
-    maxfd++;
+    int wait_time = -1;
     if(timeout >= 0) {
-      struct timeval t;
-      if(((int)(end_time-start_time)) < 0) return false; // timeout
-      t.tv_sec=end_time-start_time;
-      t.tv_usec=0;
-      if(maxfd > 0) {
-        err = select(maxfd,&fin,&fout,&fexc,&t);
-      } else {
-        sleep(t.tv_sec);
-        err = 0;
-      };
-      start_time = time(NULL);
-    } else {
-      if(maxfd > 0) {
-        err = select(maxfd,&fin,&fout,&fexc,NULL);
-      } else {
-        err = 0;
-      };
+      long long int left = end_time - current_msec();
+      wait_time = (left > 0) ? (int)left : 0;
+    } else if(pfds.empty()) {
+      return false; // nothing to wait for
     };
+    int err = poll(pfds.empty() ? NULL : &pfds[0], pfds.size(), wait_time);
     if(err == 0) return false; // timeout
     if(err == -1) {
-      if(errno == EBADF) {
-        // One of fifos must be broken. Let read() find that out.
-      } else if(errno == EINTR) {
-        // interrupted by signal, retry
-        continue;
-      };
+      // interrupted by signal, retry
+      if(errno == EINTR) continue;
       // No idea how this could happen and how to deal with it.
       // Lets try to escape and start from beginning
       return false;
     };
+    bool kick_ready = false;
     lock.lock();
-    for(std::list<elem_t>::iterator i = fds.begin();i!=fds.end();++i) {
-      if(i->fd < 0) continue;
-      if((err < 0) || FD_ISSET(i->fd,&fin)) {
-        for(;;) {
-          char buf[16];
-          ssize_t l = read(i->fd,buf,sizeof(buf));
-          if(l == 0) {
-            break; // eol
-          } else if(l < 0) {
-            if((errno == EBADF) || (errno == EINVAL) || (errno == EIO)) {
-              close(i->fd); close(i->fd_keep);
-              i->fd = -1; i->fd_keep = -1;
-            };
-            break;
-          } else if(l > 0) {
-            // it must be zero-terminated string representing job id
-            for(ssize_t n = 0; n<l; ++n) {
-              if(buf[n] == '\0') {
-                if(i->buffer.empty()) {
-                  have_generic_event = true;
-                } else {
-                  i->ids.push_back(i->buffer);
-                  i->buffer.clear();
-                };
+    for(std::vector<struct pollfd>::iterator p = pfds.begin(); p != pfds.end(); ++p) {
+      if(p->revents == 0) continue;
+      if(p->fd == kick_fd) { kick_ready = true; continue; };
+      std::list<elem_t>::iterator i = fds.begin();
+      for(;i!=fds.end();++i) if(i->fd == p->fd) break;
+      if(i == fds.end()) continue;
+      if(p->revents & POLLNVAL) {
+        // Broken fifo - it will be recovered on next pass
+        close(i->fd_keep);
+        i->fd = -1; i->fd_keep = -1;
+        continue;
+      };
+      for(;;) {
+        char buf[256];
+        ssize_t l = read(i->fd,buf,sizeof(buf));
+        if(l == 0) {
+          break; // eol
+        } else if(l < 0) {
+          if((errno == EBADF) || (errno == EINVAL) || (errno == EIO)) {
+            close(i->fd); close(i->fd_keep);
+            i->fd = -1; i->fd_keep = -1;
+          };
+          break;
+        } else if(l > 0) {
+          // it must be zero-terminated string representing job id
+          for(ssize_t n = 0; n<l; ++n) {
+            if(buf[n] == '\0') {
+              if(i->buffer.empty()) {
+                have_generic_event = true;
               } else {
-                // Some sanity check
-                if(i->buffer.length() < MAX_ID_SIZE) i->buffer.append(1,buf[n]);
+                i->ids.push_back(i->buffer);
+                i->buffer.clear();
               };
+            } else {
+              // Some sanity check
+              if(i->buffer.length() < MAX_ID_SIZE) i->buffer.append(1,buf[n]);
             };
           };
-        }; // for(;;)
-      };
-    }; // for(fds)
+        };
+      }; // for(;;)
+    }; // for(pfds)
     lock.unlock();
 
-    if(kick_out >= 0) {
-      if((err < 0) || FD_ISSET(kick_out,&fin)) {
-        for(;;) { // read as much as arrived
-          char buf[16];
-          ssize_t l = read(kick_out,buf,sizeof(buf));
-          if(l == -1) {
-            if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-              break; // nothing to read more
-            };
-            // Recover after error
-            make_pipe();
-          } else if(l == 0) {
+    if(kick_ready) {
+      for(;;) { // read as much as arrived
+        char buf[16];
+        // Eventfd counter is read at once and reset
+        ssize_t l = read(kick_fd,buf,sizeof(buf));
+        if(l == -1) {
+          if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
             break; // nothing to read more
-          } else if(l > 0) {
-            kicked = true;
-            break;
           };
+          if(errno == EINTR) continue;
+          // Recover after error
+          make_pipe();
+          break;
+        } else if(l == 0) {
+          break; // nothing to read more
+        } else if(l > 0) {
+          kicked = true;
         };
       };
     };
@@ -206,8 +236,15 @@ CommFIFO::add_result CommFIFO::take_pipe(const std::string& dir_path, elem_t& el
 
 void CommFIFO::kick(void) {
   if(kick_in >= 0) {
+#ifdef HAVE_SYS_EVENTFD_H
+    if(kick_in == kick_out) {
+      uint64_t c = 1;
+      (void)write(kick_in,&c,sizeof(c));
+      return;
+    };
+#endif
     char c = '\0';
-    write(kick_in,&c,1);
+    (void)write(kick_in,&c,1);
   };
 }
 
@@ -217,11 +254,8 @@ CommFIFO::add_result CommFIFO::add(const std::string& dir_path) {
   if(result == add_success) {
     lock.lock();
     fds.push_back(el);
-    if(kick_in != -1) {
-      char c = '\0';
-      write(kick_in,&c,1);
-    };
     lock.unlock();
+    kick();
   };
   return result;
 }
@@ -237,13 +271,20 @@ bool CommFIFO::Signal(const std::string& dir_path, const std::string& id) {
   std::string path = dir_path + fifo_file;
   int fd = OpenFIFO(path);
   if(fd == -1) return false;
-  for(std::string::size_type pos = 0; pos <= id.length(); ++pos) {
-    ssize_t l = write(fd, id.c_str()+pos, id.length()+1-pos);
+  // Including terminating zero. Messages shorter than PIPE_BUF are written
+  // at once, so ids from different writers never mix.
+  std::string::size_type size = id.length()+1;
+  for(std::string::size_type pos = 0; pos < size;) {
+    ssize_t l = write(fd, id.c_str()+pos, size-pos);
     if(l == -1) {
       if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-        sleep(1); // todo: select/poll
+        // FIFO is full - wait till reader takes something
+        struct pollfd pfd;
+        pfd.fd = fd; pfd.events = POLLOUT; pfd.revents = 0;
+        (void)poll(&pfd, 1, 1000);
         continue; // retry
       };
+      if(errno == EINTR) continue;
       close(fd); return false;
     };
     pos += l;
@@ -28,7 +28,8 @@ class CommFIFO {
   // Open external pipes
   std::list<elem_t> fds;
   // Internal pipe used to report about addition
-  // of new external pipes
+  // of new external pipes and to interrupt wait().
+  // If eventfd is available both are same descriptor.
   int kick_in;
   int kick_out;
   // Multi-threading protection 
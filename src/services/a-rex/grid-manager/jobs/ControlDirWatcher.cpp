@@ -0,0 +1,141 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include <arc/Logger.h>
+#include <arc/Utils.h>
+
+#include "../files/ControlFileHandling.h"
+#include "JobsList.h"
+
+#include "ControlDirWatcher.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+ControlDirWatcher::ControlDirWatcher(JobsList& jobs, const std::string& control_dir):
+    jobs_(jobs), control_dir_(control_dir), fd_(-1), to_exit_(false), exited_(true) {
+}
+
+ControlDirWatcher::~ControlDirWatcher(void) {
+  to_exit_ = true;
+  // Thread checks for exit request at least every second
+  while(!exited_) sleep(1);
+  if(fd_ != -1) ::close(fd_);
+  fd_ = -1;
+}
+
+bool ControlDirWatcher::start(void) {
+#ifdef HAVE_SYS_INOTIFY_H
+  if(!exited_) return false;
+  fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(fd_ == -1) {
+    logger.msg(Arc::WARNING, "Failed to initialize watching of control directory: %s", Arc::StrError(errno));
+    return false;
+  };
+  const char* subdirs[] = { subdir_new, subdir_rew, NULL };
+  for(int n = 0; subdirs[n]; ++n) {
+    std::string path = control_dir_ + "/" + subdirs[n];
+    if(::inotify_add_watch(fd_, path.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR) == -1) {
+      logger.msg(Arc::WARNING, "Failed to watch directory %s: %s", path, Arc::StrError(errno));
+      ::close(fd_); fd_ = -1;
+      return false;
+    };
+  };
+  // Set before thread starts because thread resets it when exiting
+  jobs_.ScanWatched(true);
+  exited_ = !Arc::Thread::start();
+  if(exited_) {
+    jobs_.ScanWatched(false);
+    ::close(fd_); fd_ = -1;
+    return false;
+  };
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ControlDirWatcher::process(const std::string& file) {
+  int l = file.length();
+  // job id contains at least 1 character
+  if(l <= 4+1 || file.substr(0,4) != "job.") return;
+  const char* marks[] = { sfx_cancel, sfx_clean, sfx_restart, NULL };
+  for(int n = 0; marks[n]; ++n) {
+    int ll = strlen(marks[n]);
+    if(l > (ll+4) && file.substr(l-ll) == marks[n]) {
+      JobId id(file.substr(4,l-ll-4));
+      logger.msg(Arc::DEBUG, "%s: mark %s appeared", id, marks[n]);
+      jobs_.RequestAttention(id);
+      return;
+    };
+  };
+  if(l > (4+7) && file.substr(l-7) == ".status") {
+    JobId id(file.substr(4,l-7-4));
+    logger.msg(Arc::DEBUG, "%s: job appeared", id);
+    jobs_.RequestNewJob(id);
+  };
+}
+
+void ControlDirWatcher::thread(void) {
+#ifdef HAVE_SYS_INOTIFY_H
+  // Buffer suitable for at least one event with longest possible name
+  char buf[16*1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  for(;;) {
+    if(to_exit_) break;
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int err = ::poll(&pfd, 1, 1000);
+    if(err == 0) continue;
+    if(err == -1) {
+      if(errno == EINTR) continue;
+      logger.msg(Arc::ERROR, "Failed waiting for changes in control directory: %s", Arc::StrError(errno));
+      break;
+    };
+    ssize_t len = ::read(fd_, buf, sizeof(buf));
+    if(len == -1) {
+      if((errno == EAGAIN) || (errno == EINTR)) continue;
+      logger.msg(Arc::ERROR, "Failed reading changes in control directory: %s", Arc::StrError(errno));
+      break;
+    };
+    bool lost = false;
+    for(char* p = buf; p < buf + len; ) {
+      struct inotify_event* event = (struct inotify_event*)p;
+      p += sizeof(struct inotify_event) + event->len;
+      if(event->mask & IN_Q_OVERFLOW) {
+        // Some changes were not reported. Let scanning find them.
+        logger.msg(Arc::WARNING, "Too many changes in control directory, falling back to scanning");
+        jobs_.ScanRequired();
+        continue;
+      };
+      if(event->mask & IN_IGNORED) {
+        // Watched directory disappeared
+        lost = true;
+        continue;
+      };
+      if((event->len > 0) && !(event->mask & IN_ISDIR)) process(event->name);
+    };
+    if(lost) {
+      logger.msg(Arc::ERROR, "Stopped watching control directory %s", control_dir_);
+      break;
+    };
+  };
+  // Without notifications all new jobs and marks must be found by scanning
+  jobs_.ScanWatched(false);
+#endif
+  exited_ = true;
+}
+
+} // namespace ARex
@@ -0,0 +1,40 @@
+#ifndef GM_CONTROLDIRWATCHER_H
+#define GM_CONTROLDIRWATCHER_H
+
+#include <string>
+
+#include <arc/Thread.h>
+
+namespace ARex {
+
+class JobsList;
+
+/// Watches control directory for appearing jobs and marks.
+/**
+ * Status files arriving into accepting and restarting subdirectories and
+ * cancel/clean/restart marks are reported to JobsList by job id, so that
+ * directories do not need to be scanned every time when looking for new
+ * work. Uses inotify and is only available on Linux. If watching fails
+ * or some notifications are lost JobsList is told to do full scanning.
+ */
+class ControlDirWatcher: protected Arc::Thread {
+ public:
+  ControlDirWatcher(JobsList& jobs, const std::string& control_dir);
+  ~ControlDirWatcher(void);
+  /// Start watching. Returns false if watching is not supported or failed.
+  bool start(void);
+ protected:
+  void thread(void);
+ private:
+  JobsList& jobs_;
+  std::string control_dir_;
+  int fd_;
+  bool to_exit_; // tells thread to exit
+  bool exited_;  // set by thread while exiting
+  // Pass file which appeared in control directory to JobsList
+  void process(const std::string& file);
+};
+
+} // namespace ARex
+
+#endif // GM_CONTROLDIRWATCHER_H
@@ -203,6 +203,8 @@ DTRGenerator::DTRGenerator(const GMConfig& config, JobsList& jobs) :
   transfer_limits.averaging_time = staging_conf.min_speed_time;
   transfer_limits.min_average_bandwidth = staging_conf.min_average_speed;
   transfer_limits.max_inactivity_time = staging_conf.max_inactivity_time;
+  transfer_limits.persistent_delivery_transfers = staging_conf.persistent_delivery_transfers;
+  transfer_limits.persistent_delivery_memory = staging_conf.persistent_delivery_memory;
   scheduler->SetTransferParameters(transfer_limits);
 
   // URL mappings
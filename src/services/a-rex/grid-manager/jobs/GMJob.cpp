@@ -66,6 +66,9 @@ void GMJob::set_share(std::string share) {
 GMJob::GMJob(void) {
   job_state=JOB_STATE_UNDEFINED;
   job_pending=false;
+  job_failed=false;
+  job_reserved=JOB_STATE_UNDEFINED;
+  job_dn_reserved=false;
   keep_finished=-1;
   keep_deleted=-1;
   child=NULL;
@@ -78,6 +81,9 @@ GMJob::GMJob(void) {
 GMJob::GMJob(const JobId &id,const Arc::User& u,const std::string &dir,job_state_t state) {
   job_state=state;
   job_pending=false;
+  job_failed=false;
+  job_reserved=JOB_STATE_UNDEFINED;
+  job_dn_reserved=false;
   job_id=id;
   session_dir=dir;
   keep_finished=-1;
@@ -157,8 +163,7 @@ bool GMJob::SwitchQueue(GMJobQueue* new_queue, bool to_front) {
     if(!to_front) return true;
     if(!old_queue) return true;
     // move to front
-    old_queue->queue_.remove(this); // ineffective operation!
-    old_queue->queue_.push_front(this);
+    old_queue->queue_.splice(old_queue->queue_.begin(), old_queue->queue_, queue_pos);
     return true;
   };
   // Check priority
@@ -169,16 +174,16 @@ bool GMJob::SwitchQueue(GMJobQueue* new_queue, bool to_front) {
   }
   if (old_queue) {
     // Remove from current queue
-    old_queue->queue_.remove(this); // ineffective operation!
+    old_queue->queue_.erase(queue_pos);
     queue = NULL;
     // Unlock current queue
   };
   if (new_queue) {
     // Add to new queue
     if(!to_front) {
-      new_queue->queue_.push_back(this);
+      queue_pos = new_queue->queue_.insert(new_queue->queue_.end(), this);
     } else {
-      new_queue->queue_.push_front(this);
+      queue_pos = new_queue->queue_.insert(new_queue->queue_.begin(), this);
     };
     queue = new_queue;
     // Unlock new queue
@@ -252,32 +257,28 @@ bool GMJobQueue::PushSorted(GMJobRef& ref, comparator_t compare) {
   Glib::RecMutex::Lock qlock(lock_);
   GMJobQueue* old_queue = ref->queue;
   if(!ref->SwitchQueue(this)) return false;
-  // Most of the cases job lands last in list
-  std::list<GMJob*>::reverse_iterator opos = queue_.rbegin();
-  while(opos != queue_.rend()) {
-    if(ref == *opos) {
-      // Can it be moved ?
-      std::list<GMJob*>::reverse_iterator npos = opos;
-      std::list<GMJob*>::reverse_iterator rpos = npos;
-      ++npos;
-      while(npos != queue_.rend()) {
-        if(!compare((GMJob*)ref, *npos)) break;
-        rpos = npos;
-        ++npos;
-      };
-      if(rpos != opos) {  // no reason to move to itself
-        queue_.insert(--(rpos.base()),*opos);
-        queue_.erase(--(opos.base()));
-      };
-      return true;
-    };
-    ++opos;
+  if(ref->queue != this) {
+    // Can only happen in case of bug in the code.
+    // Try to recover and bail out.
+    logger.msg(Arc::FATAL,"%s: PushSorted failed to find job where expected",ref->job_id);
+    ref->SwitchQueue(old_queue);
+    return false;
   };
-  // Job is not found in queue - can only happen in case of bug in the code. 
-  // Try to recover and bail out.
-  logger.msg(Arc::FATAL,"%s: PushSorted failed to find job where expected",ref->job_id);
-  ref->SwitchQueue(old_queue); 
-  return false;
+  // Most of the cases job lands last in list. Move it towards
+  // front while it is preceding jobs in front of it.
+  std::list<GMJob*>::iterator opos = ref->queue_pos;
+  std::list<GMJob*>::iterator npos = opos;
+  while(npos != queue_.begin()) {
+    std::list<GMJob*>::iterator ppos = npos;
+    --ppos;
+    if(!compare((GMJob*)ref, *ppos)) break;
+    npos = ppos;
+  };
+  if(npos != opos) {  // no reason to move to itself
+    // splice keeps queue_pos valid
+    queue_.splice(npos, queue_, opos);
+  };
+  return true;
 }
 
 GMJobRef GMJobQueue::Front() {
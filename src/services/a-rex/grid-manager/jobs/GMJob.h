@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <string>
+#include <list>
 
 #include <arc/Run.h>
 #include <arc/User.h>
@@ -57,6 +58,13 @@ class GMJob {
   std::string session_dir;
   // Explanation of job's failure
   std::string failure_reason;
+  // Failure mark of job is stored. Kept here to avoid checking for file.
+  bool job_failed;
+  // State for which job holds place under limits (JobsList::ReserveJobSlot)
+  // or JOB_STATE_UNDEFINED
+  job_state_t job_reserved;
+  // Job is already counted in per-DN limit while moving to PREPARING
+  bool job_dn_reserved;
   // How long job is kept on cluster after it finished
   time_t keep_finished;
   time_t keep_deleted;
@@ -100,6 +108,10 @@ class GMJob {
   /// Queue to which job is currently associated
   GMJobQueue* queue;
 
+  /// Position of job in its queue, valid only if queue is set.
+  /// Allows job to leave queue without searching through it.
+  std::list<GMJob*>::iterator queue_pos;
+
 
  public:
   // external utility being run to perform tasks like stage-in/out,
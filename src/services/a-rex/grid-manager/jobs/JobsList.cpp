@@ -5,6 +5,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <algorithm>
+
 #include <arc/ArcLocation.h>
 #include <arc/JobPerfLog.h>
 #include <arc/credential/VOMSUtil.h>
@@ -67,6 +69,24 @@ void JobsList::ExternalHelpers::thread(void) {
 }
 
 
+JobsCounters::JobsCounters(void) {
+  for(int n = 0;n<JOB_STATE_NUM;n++) {
+    states[n] = 0;
+    pending[n] = 0;
+  };
+  held = 0;
+}
+
+bool JobsCounters::operator==(const JobsCounters& counters) const {
+  for(int n = 0;n<JOB_STATE_NUM;n++) {
+    if(states[n] != counters.states[n]) return false;
+    if(pending[n] != counters.pending[n]) return false;
+  };
+  if(held != counters.held) return false;
+  return true;
+}
+
+
 JobsList::JobsList(const GMConfig& gmconfig) :
     valid(false),
     jobs_processing(ProcessingQueuePriority, "processing"),
@@ -75,15 +95,26 @@ JobsList::JobsList(const GMConfig& gmconfig) :
     jobs_wait_for_running(WaitQueuePriority, "wait for running"),
     config(gmconfig), staging_config(gmconfig),
     dtr_generator(config, *this),
-    job_desc_handler(config), jobs_pending(0),
-    helpers(config.Helpers(), *this) {
+    job_desc_handler(config), jobs_pending(0), jobs_held(0), processing_busy(0),
+    helpers(config.Helpers(), *this), lrms_helpers(gmconfig, *this) {
 
   job_slow_polling_last = time(NULL);
   job_slow_polling_dir = NULL;
 
+  jobs_scan_watched = false;
+  new_jobs_scan_last = 0;
+  new_jobs_scan_required = true;
+  new_marks_scan_last = 0;
+  new_marks_scan_required = true;
+
+  jobs_summaries_changed = false;
+  jobs_snapshot_last = 0;
+  jobs_snapshot = new JobsSnapshot;
+
   for(int n = 0;n<JOB_STATE_NUM;n++) jobs_num[n]=0;
+  for(int n = 0;n<JOB_STATE_NUM;n++) jobs_reserved[n]=0;
+  for(int n = 0;n<JOB_STATE_NUM;n++) jobs_pending_num[n]=0;
   jobs_scripts = 0;
-  jobs.clear();
 
   if(!dtr_generator) {
     logger.msg(Arc::ERROR, "Failed to start data staging threads");
@@ -98,17 +129,99 @@ JobsList::JobsList(const GMConfig& gmconfig) :
 JobsList::~JobsList(void) {
 }
 
+unsigned int JobsList::ShardIndex(const JobId &id) {
+  // FNV-1a
+  unsigned int h = 2166136261U;
+  for(std::string::size_type n = 0; n < id.length(); ++n) {
+    h ^= (unsigned char)(id[n]);
+    h *= 16777619U;
+  };
+  return h % jobs_shards_num;
+}
+
+JobsList::JobsShard& JobsList::Shard(const JobId &id) const {
+  return jobs_shards[ShardIndex(id)];
+}
+
+bool JobsList::InsertJob(const GMJobRef& i) {
+  JobsShard& shard = Shard(i->job_id);
+  Glib::Mutex::Lock lock(shard.lock);
+  return shard.jobs.insert(std::pair<JobId,GMJobRef>(i->job_id,i)).second;
+}
+
 GMJobRef JobsList::FindJob(const JobId &id) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::iterator ji = jobs.find(id);
-  if(ji == jobs.end()) return GMJobRef();
+  JobsShard& shard = Shard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,GMJobRef>::iterator ji = shard.jobs.find(id);
+  if(ji == shard.jobs.end()) return GMJobRef();
   return ji->second;
 }
 
+void JobsList::GetJobsStatus(const std::list<JobId>& ids, std::map<JobId,GMJobStatus>& statuses) const {
+  Arc::ThreadedPointer<JobsSnapshot> snapshot = GetJobsSnapshot();
+  for(std::list<JobId>::const_iterator id = ids.begin(); id != ids.end(); ++id) {
+    std::map<JobId,GMJobStatus>::const_iterator job = snapshot->jobs.find(*id);
+    if(job == snapshot->jobs.end()) continue;
+    statuses.insert(*job);
+  };
+}
+
+Arc::ThreadedPointer<JobsSnapshot> JobsList::GetJobsSnapshot(void) const {
+  // Lock only protects copying of pointer, content of snapshot is never changed
+  Glib::Mutex::Lock lock(jobs_snapshot_lock);
+  return jobs_snapshot;
+}
+
+bool JobsList::PublishJobsSnapshot(void) {
+  time_t now = time(NULL);
+  JobsSnapshot* snapshot = NULL;
+  {
+    Glib::Mutex::Lock lock(jobs_summaries_lock);
+    if(!jobs_summaries_changed) return true;
+    if(now == jobs_snapshot_last) return false;
+    snapshot = new JobsSnapshot;
+    snapshot->jobs = jobs_summaries;
+    jobs_summaries_changed = false;
+    jobs_snapshot_last = now;
+  };
+  Arc::ThreadedPointer<JobsSnapshot> old_snapshot;
+  {
+    Glib::Mutex::Lock lock(jobs_snapshot_lock);
+    old_snapshot = jobs_snapshot;
+    jobs_snapshot = snapshot;
+  };
+  // Previous snapshot is destroyed here or by last service thread using it
+  return true;
+}
+
+void JobsList::UpdateJobSummary(GMJobRef& i, bool dropped) {
+  JobLocalDescription const* local = i->GetLocalDescription();
+  if(dropped || !local) {
+    Glib::Mutex::Lock lock(jobs_summaries_lock);
+    if(jobs_summaries.erase(i->job_id) > 0) jobs_summaries_changed = true;
+    return;
+  };
+  GMJobStatus status;
+  status.owner = local->DN;
+  status.state = i->job_state;
+  status.pending = i->job_pending;
+  // Not every failure sets cause, so .failed mark is what tells job failed
+  status.failed = i->job_failed || !i->failure_reason.empty();
+  status.failed_state = local->failedstate;
+  status.failed_cause = local->failedcause;
+  Glib::Mutex::Lock lock(jobs_summaries_lock);
+  GMJobStatus& current = jobs_summaries[i->job_id];
+  if(current != status) {
+    current = status;
+    jobs_summaries_changed = true;
+  };
+}
+
 bool JobsList::HasJob(const JobId &id) const {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::const_iterator ji = jobs.find(id);
-  return (ji != jobs.end());
+  JobsShard& shard = Shard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,GMJobRef>::const_iterator ji = shard.jobs.find(id);
+  return (ji != shard.jobs.end());
 }
 
 void JobsList::UpdateJobCredentials(GMJobRef i) {
@@ -181,6 +294,8 @@ bool JobsList::AddJobNoCheck(const JobId &id,uid_t uid,gid_t gid,job_state_t sta
   i->job_state = state;
   i->job_pending = false;
   if (!GetLocalDescription(i)) {
+    // Same job may be found by scanning and by watching simultaneously
+    if(!InsertJob(i)) return false;
     // safest thing to do is add failure and move to FINISHED
     i->AddFailure("Internal error");
     SetJobState(i, JOB_STATE_FINISHED, "Internal failure");
@@ -189,39 +304,102 @@ bool JobsList::AddJobNoCheck(const JobId &id,uid_t uid,gid_t gid,job_state_t sta
       logger.msg(Arc::ERROR, "%s: Failed reading .local and changing state, job and "
                              "A-REX may be left in an inconsistent state", id);
     }
-    Glib::RecMutex::Lock lock(jobs_lock);
-    jobs[id] = i;
     RequestReprocess(i); // To make job being properly thrown from system
     return false;
   }
   i->session_dir = i->local->sessiondir;
   if (i->session_dir.empty()) i->session_dir = config.SessionRoot(id)+'/'+id;
-  Glib::RecMutex::Lock lock(jobs_lock);
-  jobs[id] = i;
+  // Failure mark is read once here and then followed in memory
+  i->job_failed = job_failed_mark_check(id,config);
+  // Same job may be found by scanning and by watching simultaneously
+  if(!InsertJob(i)) return false;
   RequestAttention(i);
   return true;
 }
 
 int JobsList::AcceptedJobs() const {
+  Glib::Mutex::Lock lock(jobs_counters_lock);
   return jobs_num[JOB_STATE_ACCEPTED] +
          jobs_num[JOB_STATE_PREPARING] +
          jobs_num[JOB_STATE_SUBMITTING] +
          jobs_num[JOB_STATE_INLRMS] +
          jobs_num[JOB_STATE_FINISHING] +
-         jobs_pending;
+         jobs_pending + jobs_reserved[JOB_STATE_ACCEPTED];
+}
+
+void JobsList::GetJobsCounters(JobsCounters& counters) const {
+  Glib::Mutex::Lock lock(jobs_counters_lock);
+  for(int n = 0;n<JOB_STATE_NUM;n++) {
+    counters.states[n] = jobs_num[n];
+    counters.pending[n] = jobs_pending_num[n];
+  };
+  counters.held = jobs_held;
 }
 
 bool JobsList::RunningJobsLimitReached() const {
   if(config.MaxRunning()==-1) return false;
+  Glib::Mutex::Lock lock(jobs_counters_lock);
   int num = jobs_num[JOB_STATE_SUBMITTING] +
-            jobs_num[JOB_STATE_INLRMS];
+            jobs_num[JOB_STATE_INLRMS] +
+            jobs_reserved[JOB_STATE_SUBMITTING];
   return num >= config.MaxRunning();
 }
 
+bool JobsList::ReserveJobSlot(GMJobRef& i, job_state_t state) {
+  Glib::Mutex::Lock lock(jobs_counters_lock);
+  if(state == JOB_STATE_ACCEPTED) {
+    if(config.MaxJobs() != -1) {
+      int num = jobs_num[JOB_STATE_ACCEPTED] +
+                jobs_num[JOB_STATE_PREPARING] +
+                jobs_num[JOB_STATE_SUBMITTING] +
+                jobs_num[JOB_STATE_INLRMS] +
+                jobs_num[JOB_STATE_FINISHING] +
+                jobs_pending + jobs_reserved[JOB_STATE_ACCEPTED];
+      if(num >= config.MaxJobs()) return false;
+    }
+  } else if(state == JOB_STATE_PREPARING) {
+    if(config.MaxPerDN() > 0) {
+      if(!i->GetLocalDescription()) return false;
+      ZeroUInt& num = jobs_dn[i->local->DN];
+      if(num >= (unsigned int)config.MaxPerDN()) return false;
+      // Counted now, so it is not counted again when job becomes active
+      ++num;
+      i->job_dn_reserved = true;
+    }
+    return true;
+  } else if(state == JOB_STATE_SUBMITTING) {
+    if(config.MaxRunning() != -1) {
+      int num = jobs_num[JOB_STATE_SUBMITTING] +
+                jobs_num[JOB_STATE_INLRMS] +
+                jobs_reserved[JOB_STATE_SUBMITTING];
+      if(num >= config.MaxRunning()) return false;
+    }
+  }
+  ++jobs_reserved[state];
+  i->job_reserved = state;
+  return true;
+}
+
+void JobsList::ReleaseJobSlot(GMJobRef& i) {
+  if(i->job_reserved != JOB_STATE_UNDEFINED) {
+    --jobs_reserved[i->job_reserved];
+    i->job_reserved = JOB_STATE_UNDEFINED;
+  }
+  if(i->job_dn_reserved) {
+    // Job did not become active
+    i->job_dn_reserved = false;
+    if(i->GetLocalDescription()) {
+      if (--(jobs_dn[i->local->DN]) == 0) jobs_dn.erase(i->local->DN);
+    }
+  }
+}
+
 void JobsList::PrepareToDestroy(void) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  for(std::map<JobId,GMJobRef>::iterator i=jobs.begin();i!=jobs.end();++i) {
-    i->second->PrepareToDestroy();
+  for(unsigned int n = 0; n < jobs_shards_num; ++n) {
+    Glib::Mutex::Lock lock(jobs_shards[n].lock);
+    for(std::map<JobId,GMJobRef>::iterator i=jobs_shards[n].jobs.begin();i!=jobs_shards[n].jobs.end();++i) {
+      i->second->PrepareToDestroy();
+    }
   }
 }
 
@@ -261,6 +439,37 @@ void JobsList::RequestAttention(void) {
   jobs_attention_cond.signal();
 }
 
+bool JobsList::RequestNewJob(const JobId& id) {
+  // Status files of handled jobs are rewritten all the time
+  if(HasJob(id)) return false;
+  return ScanNewJob(id);
+}
+
+void JobsList::ScanWatched(bool watched) {
+  Glib::Mutex::Lock lock(jobs_scan_lock);
+  if(jobs_scan_watched && !watched) {
+    // Something may have been missed while switching
+    new_jobs_scan_required = true;
+    new_marks_scan_required = true;
+  };
+  jobs_scan_watched = watched;
+}
+
+void JobsList::ScanRequired(void) {
+  Glib::Mutex::Lock lock(jobs_scan_lock);
+  new_jobs_scan_required = true;
+  new_marks_scan_required = true;
+}
+
+bool JobsList::ScanNeeded(time_t& last, bool& required) {
+  Glib::Mutex::Lock lock(jobs_scan_lock);
+  time_t now = time(NULL);
+  if(jobs_scan_watched && !required && ((now - last) < jobs_scan_period)) return false;
+  required = false;
+  last = now;
+  return true;
+}
+
 bool JobsList::ScanOldJobs(void) {
   if(job_slow_polling_dir) {
     // continue already started scaning
@@ -289,12 +498,19 @@ bool JobsList::ScanOldJobs(void) {
 }
 
 void JobsList::WaitAttention(void) {
+  // Processing round is over - let service threads see its results
+  bool published = PublishJobsSnapshot();
   // Check if condition signaled
   while(!jobs_attention_cond.wait(0)) {
     // Use spare time to process slow polling queue
     if(!ScanOldJobs()) {
-      // If there is no scanning going on then simply wait and exit
-      jobs_attention_cond.wait();
+      // If there is no scanning going on then simply wait and exit.
+      // Changes held back by snapshot rate limit must not wait for next request.
+      if(published || PublishJobsSnapshot()) {
+        jobs_attention_cond.wait();
+      } else {
+        jobs_attention_cond.wait(1000);
+      };
       return;
     };
   }; // while !jobs_attention_cond
@@ -333,13 +549,57 @@ bool JobsList::RequestReprocess(GMJobRef i) {
   return false;
 }
 
-bool JobsList::ActJobsProcessing(void) {
+void JobsList::ActJobsProcessingThread(void* arg) {
+  ((JobsList*)arg)->ActJobsProcessingLoop();
+}
+
+void JobsList::ActJobsProcessingLoop(void) {
+  Glib::Mutex::Lock lock(processing_lock);
   while(true) {
     GMJobRef i = jobs_processing.Pop();
-    if(!i) break;
+    if(!i) {
+      // Jobs being processed may still be put back into queue
+      if(processing_busy == 0) break;
+      processing_cond.wait(processing_lock);
+      continue;
+    };
+    if(processing_active.find(i) != processing_active.end()) {
+      // ActJob requested reprocessing of job it is still working on
+      processing_postponed.push_back(i);
+      continue;
+    };
+    GMJob const* job = i;
+    processing_active.insert(job);
+    ++processing_busy;
+    lock.release();
     logger.msg(Arc::DEBUG, "%s: job being processed", i->job_id);
     ActJob(i);
+    lock.acquire();
+    // Job object may be destroyed already, only pointer value is used here
+    processing_active.erase(job);
+    --processing_busy;
+    for(std::list<GMJobRef>::iterator p = processing_postponed.begin(); p != processing_postponed.end();) {
+      if(*p == job) {
+        RequestReprocess(*p);
+        p = processing_postponed.erase(p);
+      } else {
+        ++p;
+      };
+    };
+    processing_cond.broadcast();
+  };
+  processing_cond.broadcast();
+}
+
+bool JobsList::ActJobsProcessing(void) {
+  int threads = config.ProcessingThreads();
+  if(threads > 1) threads = std::min(threads, jobs_processing.Size());
+  Arc::SimpleCounter threads_count;
+  for(int n = 1; n < threads; ++n) {
+    if(!Arc::CreateThreadFunction(&ActJobsProcessingThread, this, &threads_count)) break;
   };
+  ActJobsProcessingLoop();
+  threads_count.wait();
   // Check limit on number of running jobs and activate some of them if possible
   if(!RunningJobsLimitReached()) {
     GMJobRef i = jobs_wait_for_running.Pop();
@@ -371,7 +631,7 @@ bool JobsList::ActJobsPolling(void) {
   ActJobsProcessing();
   // debug info on jobs per DN
   {
-    Glib::RecMutex::Lock lock(jobs_lock);
+    Glib::Mutex::Lock lock(jobs_counters_lock);
     logger.msg(Arc::VERBOSE, "Current jobs in system (PREPARING to FINISHING) per-DN (%i entries)", jobs_dn.size());
     for (std::map<std::string, ZeroUInt>::iterator it = jobs_dn.begin(); it != jobs_dn.end(); ++it)
       logger.msg(Arc::VERBOSE, "%s: %i", it->first, (unsigned int)(it->second));
@@ -385,6 +645,7 @@ bool JobsList::FailedJob(GMJobRef i,bool cancel) {
   // add failure mark
   if(job_failed_mark_add(*i,config,i->failure_reason)) {
     i->failure_reason = "";
+    i->job_failed = true;
   } else {
     logger.msg(Arc::ERROR,"%s: Failed storing failure reason: %s",i->job_id,Arc::StrError(errno));
     r = false;
@@ -455,13 +716,71 @@ bool JobsList::GetLocalDescription(GMJobRef i) const {
 
 void JobsList::CleanChildProcess(GMJobRef i) {
   delete i->child; i->child=NULL;
-  if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) --jobs_scripts;
+  lrms_helpers.Forget(i->job_id);
+  if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) ScriptsSlotRelease();
+}
+
+bool JobsList::StartChildProcess(GMJobRef i, const std::string& action) {
+  std::string lrms = i->local->lrms;
+  if(lrms_helpers.Request(*i,lrms,action)) return true;
+  std::string cmd = Arc::ArcLocation::GetDataDir()+"/"+action+"-"+lrms+"-job";
+  std::string grami = config.ControlDir()+"/job."+(*i).job_id+".grami";
+  cmd += " --config " + config.ConfigFile() + " " + grami;
+  return RunParallel::run(config,*i,*this,cmd,&(i->child));
+}
+
+bool JobsList::ChildProcessActive(GMJobRef i) {
+  return (i->child != NULL) || lrms_helpers.Has(i->job_id);
+}
+
+bool JobsList::ChildProcessRunning(GMJobRef i) {
+  if(i->child) return i->child->Running();
+  bool running = false; int result; Arc::Time run_time; Arc::Time exit_time;
+  if(!lrms_helpers.Check(i->job_id,running,result,run_time,exit_time)) return false;
+  return running;
+}
+
+int JobsList::ChildProcessResult(GMJobRef i) {
+  if(i->child) return i->child->Result();
+  bool running; int result = -1; Arc::Time run_time; Arc::Time exit_time;
+  if(!lrms_helpers.Check(i->job_id,running,result,run_time,exit_time)) return -1;
+  return result;
+}
+
+Arc::Time JobsList::ChildProcessRunTime(GMJobRef i) {
+  if(i->child) return i->child->RunTime();
+  bool running; int result; Arc::Time run_time; Arc::Time exit_time;
+  if(!lrms_helpers.Check(i->job_id,running,result,run_time,exit_time)) return Arc::Time();
+  return run_time;
+}
+
+Arc::Time JobsList::ChildProcessExitTime(GMJobRef i) {
+  if(i->child) return i->child->ExitTime();
+  bool running; int result; Arc::Time run_time; Arc::Time exit_time(Arc::Time::UNDEFINED);
+  if(!lrms_helpers.Check(i->job_id,running,result,run_time,exit_time)) return Arc::Time(Arc::Time::UNDEFINED);
+  return exit_time;
+}
+
+bool JobsList::ScriptsSlotAcquire(const JobId& id) {
+  Glib::Mutex::Lock lock(jobs_counters_lock);
+  if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) return false;
+  ++jobs_scripts;
+  if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
+                         id,config.MaxScripts());
+  }
+  return true;
+}
+
+void JobsList::ScriptsSlotRelease(void) {
+  Glib::Mutex::Lock lock(jobs_counters_lock);
+  --jobs_scripts;
 }
 
 bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
-  if(i->child == NULL) {
+  if(!ChildProcessActive(i)) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(!ScriptsSlotAcquire(i->job_id)) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -472,47 +791,43 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
     if(!(i->GetLocalDescription(config))) {
       logger.msg(Arc::ERROR,"%s: Failed reading local information",i->job_id);
       i->AddFailure("Internal error: can't read local file");
+      ScriptsSlotRelease();
       return false;
     };
     JobLocalDescription* job_desc = i->local;
     if(!job_desc_handler.write_grami(*i)) {
       logger.msg(Arc::ERROR,"%s: Failed creating grami file",i->job_id);
+      ScriptsSlotRelease();
       return false;
     }
     if(!job_desc_handler.set_execs(*i)) {
       logger.msg(Arc::ERROR,"%s: Failed setting executable permissions",i->job_id);
+      ScriptsSlotRelease();
       return false;
     }
     // precreate file to store diagnostics from lrms
     job_diagnostics_mark_put(*i,config);
     job_lrmsoutput_mark_put(*i,config);
     // submit job to LRMS using submit-X-job
-    std::string cmd = Arc::ArcLocation::GetDataDir()+"/submit-"+job_desc->lrms+"-job";
-    logger.msg(Arc::INFO,"%s: state SUBMIT: starting child: %s",i->job_id,cmd);
-    std::string grami = config.ControlDir()+"/job."+(*i).job_id+".grami";
-    cmd += " --config " + config.ConfigFile() + " " + grami;
+    logger.msg(Arc::INFO,"%s: state SUBMIT: starting child: %s",i->job_id,"submit-"+job_desc->lrms+"-job");
     job_errors_mark_put(*i,config);
-    if(!RunParallel::run(config,*i,*this,cmd,&(i->child))) {
+    if(!StartChildProcess(i,"submit")) {
       i->AddFailure("Failed initiating job submission to LRMS");
       logger.msg(Arc::ERROR,"%s: Failed running submission process",i->job_id);
+      ScriptsSlotRelease();
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
-      logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
-                           i->job_id,config.MaxScripts());
-    }
     return true;
   }
   // child was run - check if exited and then exit code
   bool simulate_success = false;
-  if(i->child->Running()) {
+  if(ChildProcessRunning(i)) {
     // child is running - come later
     // Due to unknown reason sometimes child exit event is lost.
     // As workaround check if child is running for too long. If
     // it does then check in grami file for generated local id
     // or in case of cancel just assume child exited.
-    if((Arc::Time() - i->child->RunTime()) > Arc::Period(CHILD_RUN_TIME_SUSPICIOUS)) {
+    if((Arc::Time() - ChildProcessRunTime(i)) > Arc::Period(CHILD_RUN_TIME_SUSPICIOUS)) {
       // Check if local id is already obtained
       std::string local_id=job_desc_handler.get_local_id(i->job_id);
       if(local_id.length() > 0) {
@@ -520,7 +835,7 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
         logger.msg(Arc::ERROR,"%s: Job submission to LRMS takes too long, but ID is already obtained. Pretending submission is done.",i->job_id);
       }
     }
-    if((!simulate_success) && (Arc::Time() - i->child->RunTime()) > Arc::Period(CHILD_RUN_TIME_TOO_LONG)) {
+    if((!simulate_success) && (Arc::Time() - ChildProcessRunTime(i)) > Arc::Period(CHILD_RUN_TIME_TOO_LONG)) {
       // In any case it is way too long. Job must fail. Otherwise it will hang forever.
       CleanChildProcess(i);
       logger.msg(Arc::ERROR,"%s: Job submission to LRMS takes too long. Failing.",i->job_id);
@@ -533,11 +848,11 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
   }
   if(!simulate_success) {
     // real processing
-    logger.msg(Arc::INFO,"%s: state SUBMIT: child exited with code %i",i->job_id,i->child->Result());
+    logger.msg(Arc::INFO,"%s: state SUBMIT: child exited with code %i",i->job_id,ChildProcessResult(i));
     // Another workaround in Run class may also detect lost child.
     // It then sets exit code to -1. This value is also set in
     // case child was killed. So it is worth to check grami anyway.
-    if((i->child->Result() != 0) && (i->child->Result() != -1)) {
+    if((ChildProcessResult(i) != 0) && (ChildProcessResult(i) != -1)) {
       logger.msg(Arc::ERROR,"%s: Job submission to LRMS failed",i->job_id);
       JobFailStateRemember(i,JOB_STATE_SUBMITTING);
       CleanChildProcess(i);
@@ -573,9 +888,9 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
 }
 
 bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
-  if(i->child == NULL) {
+  if(!ChildProcessActive(i)) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if(!ScriptsSlotAcquire(i->job_id)) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -584,48 +899,42 @@ bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
     // write grami file for cancel-X-job
     if(!(i->GetLocalDescription(config))) {
       logger.msg(Arc::ERROR,"%s: Failed reading local information",i->job_id);
+      ScriptsSlotRelease();
       return false;
     };
     JobLocalDescription* job_desc = i->local;
     // cancel job to LRMS using cancel-X-job
-    std::string cmd;
-    cmd=Arc::ArcLocation::GetDataDir()+"/cancel-"+job_desc->lrms+"-job";
     if(!job_lrms_mark_check(i->job_id,config)) {
-      logger.msg(Arc::INFO,"%s: state CANCELING: starting child: %s",i->job_id,cmd);
+      logger.msg(Arc::INFO,"%s: state CANCELING: starting child: %s",i->job_id,"cancel-"+job_desc->lrms+"-job");
     } else {
       logger.msg(Arc::INFO,"%s: Job has completed already. No action taken to cancel",i->job_id);
+      ScriptsSlotRelease();
       state_changed=true;
       return true;
     }
-    std::string grami = config.ControlDir()+"/job."+(*i).job_id+".grami";
-    cmd += " --config " + config.ConfigFile() + " " + grami;
     job_errors_mark_put(*i,config);
-    if(!RunParallel::run(config,*i,*this,cmd,&(i->child))) {
+    if(!StartChildProcess(i,"cancel")) {
       logger.msg(Arc::ERROR,"%s: Failed running cancellation process",i->job_id);
+      ScriptsSlotRelease();
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
-      logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
-                           i->job_id,config.MaxScripts());
-    }
     return true;
   }
   // child was run - check if exited
   bool simulate_success = false;
-  if(i->child->Running()) {
+  if(ChildProcessRunning(i)) {
     // child is running - come later
     // Due to unknown reason sometimes child exit event is lost.
     // As workaround check if child is running for too long.
     // In case of cancel just assume child exited.
-    if((Arc::Time() - i->child->RunTime()) > Arc::Period(CHILD_RUN_TIME_SUSPICIOUS)) {
+    if((Arc::Time() - ChildProcessRunTime(i)) > Arc::Period(CHILD_RUN_TIME_SUSPICIOUS)) {
       // Check if diagnostics collection is done
       if(job_lrms_mark_check(i->job_id,config)) {
         simulate_success = true;
         logger.msg(Arc::ERROR,"%s: Job cancellation takes too long, but diagnostic collection seems to be done. Pretending cancellation succeeded.",i->job_id);
       }
     }
-    if((!simulate_success) && (Arc::Time() - i->child->RunTime()) > Arc::Period(CHILD_RUN_TIME_TOO_LONG)) {
+    if((!simulate_success) && (Arc::Time() - ChildProcessRunTime(i)) > Arc::Period(CHILD_RUN_TIME_TOO_LONG)) {
       // In any case it is way too long. Job must fail. Otherwise it will hang forever.
       logger.msg(Arc::ERROR,"%s: Job cancellation takes too long. Failing.",i->job_id);
       CleanChildProcess(i);
@@ -635,15 +944,15 @@ bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
   }
   if(!simulate_success) {
     // real processing
-    if((i->child->ExitTime() != Arc::Time::UNDEFINED) &&
-       ((Arc::Time() - i->child->ExitTime()) < (config.WakeupPeriod()*2))) {
+    if((ChildProcessExitTime(i) != Arc::Time::UNDEFINED) &&
+       ((Arc::Time() - ChildProcessExitTime(i)) < (config.WakeupPeriod()*2))) {
       // not ideal solution
-      logger.msg(Arc::INFO,"%s: state CANCELING: child exited with code %i",i->job_id,i->child->Result());
+      logger.msg(Arc::INFO,"%s: state CANCELING: child exited with code %i",i->job_id,ChildProcessResult(i));
     }
     // Another workaround in Run class may also detect lost child.
     // It then sets exit code to -1. This value is also set in
     // case child was killed. So it is worth to check grami anyway.
-    if((i->child->Result() != 0) && (i->child->Result() != -1)) {
+    if((ChildProcessResult(i) != 0) && (ChildProcessResult(i) != -1)) {
       logger.msg(Arc::ERROR,"%s: Failed to cancel running job",i->job_id);
       CleanChildProcess(i);
       return false;
@@ -654,8 +963,8 @@ bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
   // job diagnostics collection done in background (scan-*-job script)
   if(!job_lrms_mark_check(i->job_id,config)) {
     // job diag not yet collected - come later
-    if((i->child->ExitTime() != Arc::Time::UNDEFINED) &&
-       ((Arc::Time() - i->child->ExitTime()) > Arc::Period(Arc::Time::HOUR))) {
+    if((ChildProcessExitTime(i) != Arc::Time::UNDEFINED) &&
+       ((Arc::Time() - ChildProcessExitTime(i)) > Arc::Period(Arc::Time::HOUR))) {
       // it takes too long
       logger.msg(Arc::ERROR,"%s: state CANCELING: timeout waiting for cancellation",i->job_id);
       CleanChildProcess(i);
@@ -853,7 +1162,7 @@ JobsList::ActJobResult JobsList::ActJobUndefined(GMJobRef i) {
   ActJobResult job_result = JobDropped;
   // new job - read its status from status file, but first check if it is
   // under the limit of maximum jobs allowed in the system
-  if((AcceptedJobs() < config.MaxJobs()) || (config.MaxJobs() == -1)) {
+  if(ReserveJobSlot(i, JOB_STATE_ACCEPTED)) {
     bool new_pending = false;
     job_state_t new_state=job_state_read_file(i->job_id,config,new_pending);
     if(new_state == JOB_STATE_UNDEFINED) { // something failed
@@ -953,12 +1262,7 @@ JobsList::ActJobResult JobsList::ActJobAccepted(GMJobRef i) {
 
 
   if (config.MaxPerDN() > 0) {
-    bool limited = false;
-    {
-      Glib::RecMutex::Lock lock(jobs_lock);
-      limited = (jobs_dn[i->local->DN] >= config.MaxPerDN());
-    }
-    if (limited) {
+    if (!ReserveJobSlot(i, JOB_STATE_PREPARING)) {
       SetJobPending(i,"Jobs per DN limit is reached");
       // Because we have no event for per-DN limit just do polling
       RequestPolling(i);
@@ -1024,7 +1328,7 @@ JobsList::ActJobResult JobsList::ActJobPreparing(GMJobRef i) {
         // RequestPolling(i);
       } else if(i->local->exec.size() > 0 && !i->local->exec.front().empty()) {
         // Job has executable
-        if(!RunningJobsLimitReached()) {
+        if(ReserveJobSlot(i, JOB_STATE_SUBMITTING)) {
           // And limit of running jobs is not reached
           SetJobState(i, JOB_STATE_SUBMITTING, "Pre-staging finished, passing job to LRMS");
           RequestReprocess(i); // act on new state immediately
@@ -1162,6 +1466,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
     if(state_ == JOB_STATE_PREPARING) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        i->job_failed = false;
         SetJobState(i, JOB_STATE_ACCEPTED, "Request to restart job failed in PREPARING");
         SetJobPending(i, "Skip job to PREPARING immediately"); // make it go to end of state immediately
         logger.msg(Arc::DEBUG, "%s: restarted PREPARING job", i->job_id);
@@ -1172,6 +1477,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
               (state_ == JOB_STATE_INLRMS)) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        i->job_failed = false;
         if(i->local->downloads > 0) {
           // missing input files has to be re-downloaded
           SetJobState(i, JOB_STATE_ACCEPTED, "Request to restart job failed in INLRMS (some input files are missing)");
@@ -1187,6 +1493,7 @@ JobsList::ActJobResult JobsList::ActJobFinished(GMJobRef i) {
     } else if(state_ == JOB_STATE_FINISHING) {
       if(RecreateTransferLists(i)) {
         job_failed_mark_remove(i->job_id,config);
+        i->job_failed = false;
         SetJobState(i, JOB_STATE_INLRMS, "Request to restart job failed in FINISHING");
         SetJobPending(i, "Skip job to FINISHING immediately"); // make it go to end of state immediately
         logger.msg(Arc::DEBUG, "%s: restarted FINISHING job", i->job_id);
@@ -1344,38 +1651,52 @@ bool JobsList::CheckJobContinuePlugins(GMJobRef i) {
 bool JobsList::NextJob(GMJobRef i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
   // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
-  }
-  if(!i->job_pending) {
-    jobs_num[i->job_state]++;
-  } else {
-    jobs_pending++;
+  {
+    Glib::Mutex::Lock lock(jobs_counters_lock);
+    if(!old_pending) {
+      jobs_num[old_state]--;
+    } else {
+      jobs_pending--;
+      jobs_pending_num[old_state]--;
+    }
+    if(!i->job_pending) {
+      jobs_num[i->job_state]++;
+    } else {
+      jobs_pending++;
+      jobs_pending_num[i->job_state]++;
+    }
+    ReleaseJobSlot(i);
   }
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     //RequestAttention();
   };
+  UpdateJobSummary(i, false);
   return i;
 }
 
 bool JobsList::DropJob(GMJobRef& i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
   // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
+  {
+    Glib::Mutex::Lock lock(jobs_counters_lock);
+    if(!old_pending) {
+      jobs_num[old_state]--;
+    } else {
+      jobs_pending--;
+      jobs_pending_num[old_state]--;
+    }
+    ReleaseJobSlot(i);
   }
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     RequestAttention(); // TODO: Check if really needed
   };
+  UpdateJobSummary(i, true);
   {
-    Glib::RecMutex::Lock lock(jobs_lock);
-    jobs.erase(i->job_id);
+    JobsShard& shard = Shard(i->job_id);
+    Glib::Mutex::Lock lock(shard.lock);
+    shard.jobs.erase(i->job_id);
   };
   i.Destroy();
   return true;
@@ -1481,20 +1802,23 @@ bool JobsList::ActJob(GMJobRef& i) {
     // Manage per-DN counter
     // Any job state change goes through here
     if(!IS_ACTIVE_STATE(old_state)) {
-      if(IS_ACTIVE_STATE(i->job_state)) {
+      if(i->job_dn_reserved && IS_ACTIVE_STATE(i->job_state)) {
+        // already counted when admitted under per-DN limit
+        i->job_dn_reserved = false;
+      } else if(IS_ACTIVE_STATE(i->job_state)) {
         if(i->GetLocalDescription(config)) {
           // add to DN map
           if (i->local->DN.empty()) {
              logger.msg(Arc::WARNING, "Failed to get DN information from .local file for job %s", i->job_id);
           }
-          Glib::RecMutex::Lock lock(jobs_lock);
+          Glib::Mutex::Lock lock(jobs_counters_lock);
           ++(jobs_dn[i->local->DN]);
         };
       };
     } else if(IS_ACTIVE_STATE(old_state)) {
       if(!IS_ACTIVE_STATE(i->job_state)) {
         if(i->GetLocalDescription(config)) {
-          Glib::RecMutex::Lock lock(jobs_lock);
+          Glib::Mutex::Lock lock(jobs_counters_lock);
           if (--(jobs_dn[i->local->DN]) == 0) jobs_dn.erase(i->local->DN);
         };
       };
@@ -1728,10 +2052,18 @@ bool JobsList::ScanNewJob(const JobId& id) {
   if((AcceptedJobs() < config.MaxJobs()) || (config.MaxJobs() == -1)) {
     JobFDesc fid(id);
     std::string cdir=config.ControlDir();
+    std::string odir=cdir+"/"+subdir_rew;
     std::string ndir=cdir+"/"+subdir_new;
-    if(!ScanJob(ndir,fid)) return false;
+    if(!ScanJob(odir,fid) && !ScanJob(ndir,fid)) return false;
     return AddJobNoCheck(fid.id,fid.uid,fid.gid);
   }
+  // Job is left for scanning which picks up jobs in proper order
+  {
+    Glib::Mutex::Lock lock(jobs_counters_lock);
+    ++jobs_held;
+  };
+  Glib::Mutex::Lock lock(jobs_scan_lock);
+  new_jobs_scan_required = true;
   return false;
 }
 
@@ -1749,40 +2081,60 @@ bool JobsList::ScanOldJob(const JobId& id) {
 
 // find new jobs - sort by date to implement FIFO
 bool JobsList::ScanNewJobs(void) {
+  // If directories are watched new jobs are picked up as they appear
+  if(!ScanNeeded(new_jobs_scan_last,new_jobs_scan_required)) return true;
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
   // New jobs will be accepted only if number of jobs being processed
   // does not exceed allowed. So avoid scanning if no jobs will be allowed.
+  // Jobs left behind because of limit must be looked for again later.
+  bool limited = false;
   std::string cdir=config.ControlDir();
   if((config.MaxJobs() == -1) || (AcceptedJobs() < config.MaxJobs())) {
     std::list<JobFDesc> ids;
     // For picking up jobs after service restart
     std::string odir=cdir+"/"+subdir_rew;
-    if(!ScanJobs(odir,ids)) return false;
+    if(!ScanJobs(odir,ids)) { ScanRequired(); return false; };
     // sorting by date
     ids.sort();
     for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
-      if((config.MaxJobs() != -1) && (AcceptedJobs() >= config.MaxJobs())) break;
+      if((config.MaxJobs() != -1) && (AcceptedJobs() >= config.MaxJobs())) { limited = true; break; };
       AddJobNoCheck(id->id,id->uid,id->gid);
     };
+  } else {
+    limited = true;
   };
   if((config.MaxJobs() == -1) || (AcceptedJobs() < config.MaxJobs())) {
     std::list<JobFDesc> ids;
     // For new jobs
     std::string ndir=cdir+"/"+subdir_new;
-    if(!ScanJobs(ndir,ids)) return false;
+    if(!ScanJobs(ndir,ids)) { ScanRequired(); return false; };
     // sorting by date
     ids.sort();
-    for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
-      if((config.MaxJobs() != -1) && (AcceptedJobs() >= config.MaxJobs())) break;
+    std::list<JobFDesc>::iterator id=ids.begin();
+    for(;id!=ids.end();++id) {
+      if((config.MaxJobs() != -1) && (AcceptedJobs() >= config.MaxJobs())) { limited = true; break; };
       // adding job with file's uid/gid
       AddJobNoCheck(id->id,id->uid,id->gid);
     };
+    // Jobs left behind are reported by information system as accepted
+    int held = 0;
+    for(;id!=ids.end();++id) ++held;
+    Glib::Mutex::Lock lock(jobs_counters_lock);
+    jobs_held = held;
+  } else {
+    limited = true;
+  };
+  if(limited) {
+    Glib::Mutex::Lock lock(jobs_scan_lock);
+    new_jobs_scan_required = true;
   };
   perfrecord.End("SCAN-JOBS-NEW");
   return true;
 }
 
 bool JobsList::ScanNewMarks(void) {
+  // If directories are watched marks are processed as they appear
+  if(!ScanNeeded(new_marks_scan_last,new_marks_scan_required)) return true;
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
 
   std::string cdir=config.ControlDir();
@@ -1792,7 +2144,11 @@ bool JobsList::ScanNewMarks(void) {
   sfx.push_back(sfx_clean);
   sfx.push_back(sfx_restart);
   sfx.push_back(sfx_cancel);
-  if(!ScanMarks(ndir,sfx,ids)) return false;
+  if(!ScanMarks(ndir,sfx,ids)) {
+    Glib::Mutex::Lock lock(jobs_scan_lock);
+    new_marks_scan_required = true;
+    return false;
+  };
   ids.sort();
   std::string last_id;
   for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
@@ -1879,6 +2235,26 @@ bool JobsList::GetAllJobIds(const GMConfig& config, std::list<JobId>& alljobs) {
   return true;
 }
 
+bool JobsList::BuildOwnerIndex(const GMConfig& config) {
+  if(job_owner_index_ready(config)) return true;
+  logger.msg(Arc::INFO,"Building index of jobs by owner in %s",config.ControlDir());
+  if(!job_owner_index_start(config)) {
+    logger.msg(Arc::ERROR,"Failed to create index of jobs by owner in %s",config.ControlDir());
+    return false;
+  };
+  std::list<JobId> ids;
+  if(!GetAllJobIds(config,ids)) return false;
+  for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+    JobLocalDescription job_desc;
+    if(!job_local_read_file(*id,config,job_desc)) continue;
+    // Jobs changing state meanwhile are already indexed with newer state
+    job_owner_index_put(*id,config,job_desc.DN,job_state_read_file(*id,config),true);
+  };
+  if(!job_owner_index_finish(config)) return false;
+  logger.msg(Arc::INFO,"Index of jobs by owner contains %u jobs",(unsigned int)ids.size());
+  return true;
+}
+
 // Only used by gm-jobs
 GMJobRef JobsList::GetJob(const GMConfig& config, const JobId& id) {
   std::list<std::string> subdirs;
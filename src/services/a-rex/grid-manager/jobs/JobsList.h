@@ -3,11 +3,14 @@
 
 #include <sys/types.h>
 #include <list>
+#include <map>
+#include <set>
 #include <glib.h>
 
 #include <arc/Thread.h>
 
 #include "../conf/StagingConfig.h"
+#include "../run/LRMSHelpers.h"
 
 #include "GMJob.h"
 #include "JobDescriptionHandler.h"
@@ -38,6 +41,44 @@ public:
  operator unsigned int(void) const { return value_; };
 };
 
+/// Numbers of jobs currently handled by JobsList. Pending jobs are counted
+/// separately under state they are waiting to leave.
+class JobsCounters {
+ public:
+  int states[JOB_STATE_NUM];
+  int pending[JOB_STATE_NUM];
+  int held; // new jobs not picked up yet, mostly because of maxjobs limit
+  JobsCounters(void);
+  bool operator==(const JobsCounters& counters) const;
+  bool operator!=(const JobsCounters& counters) const { return !operator==(counters); };
+};
+
+/// State of job as known to JobsList. Used to answer client requests
+/// without reading job's control files.
+class GMJobStatus {
+ public:
+  std::string owner; // identity (DN) of job's owner
+  job_state_t state;
+  bool pending;
+  bool failed; // job has failure reason or failure mark
+  std::string failed_state; // state in which job failed, if restartable
+  std::string failed_cause; // internal or client, may be empty even for failed job
+  GMJobStatus(void): state(JOB_STATE_UNDEFINED), pending(false), failed(false) {};
+  bool operator==(const GMJobStatus& status) const {
+    return (state == status.state) && (pending == status.pending) && (failed == status.failed) && (owner == status.owner) &&
+           (failed_state == status.failed_state) && (failed_cause == status.failed_cause);
+  };
+  bool operator!=(const GMJobStatus& status) const { return !operator==(status); };
+};
+
+/// Immutable view of states of all jobs in JobsList taken after processing
+/// round. Shared by service threads which only need to hold reference.
+class JobsSnapshot {
+ public:
+  std::map<JobId,GMJobStatus> jobs;
+  time_t created;
+  JobsSnapshot(void): created(time(NULL)) {};
+};
 
 /// List of jobs. This class contains the main job management logic which moves
 /// jobs through the state machine. New jobs found through Scan methods are
@@ -47,11 +88,23 @@ class JobsList {
   bool valid;
 
   // List of jobs currently tracked in memory conveniently indexed by identifier.
+  // Jobs are spread over several maps chosen by hash of identifier, each with
+  // own lock, so that service threads looking up jobs do not wait for each
+  // other and for processing thread.
   // TODO: It would be nice to remove it and use status files distribution among
   // subfolders in controldir.
-  std::map<JobId,GMJobRef> jobs;         
+  class JobsShard {
+   public:
+    std::map<JobId,GMJobRef> jobs;
+    Glib::Mutex lock;
+  };
+  static const unsigned int jobs_shards_num = 64;
+  mutable JobsShard jobs_shards[jobs_shards_num];
 
-  mutable Glib::RecMutex jobs_lock;
+  static unsigned int ShardIndex(const JobId& id);
+  JobsShard& Shard(const JobId& id) const;
+  // Adds job to its shard. Returns false if job with same id is already there.
+  bool InsertJob(const GMJobRef& i);
 
   GMJobQueue jobs_processing;   // List of jobs currently scheduled for processing
 
@@ -67,6 +120,19 @@ class JobsList {
   static time_t const job_slow_polling_period = 24UL*60UL*60UL; // todo: variable
   Glib::Dir* job_slow_polling_dir;
 
+  // When control directory is watched for new jobs and marks, scanning of
+  // directories is only done occasionally to catch anything missed, or
+  // when explicitly required.
+  Glib::Mutex jobs_scan_lock;
+  bool jobs_scan_watched;
+  time_t new_jobs_scan_last;
+  bool new_jobs_scan_required;
+  time_t new_marks_scan_last;
+  bool new_marks_scan_required;
+  static time_t const jobs_scan_period = 60UL*60UL;
+  // Returns true if scanning controlled by last and required is to be done now
+  bool ScanNeeded(time_t& last, bool& required);
+
   // GM configuration
   const GMConfig& config;
   // Staging configuration
@@ -75,13 +141,43 @@ class JobsList {
   DTRGenerator dtr_generator;
   // Job description handler
   JobDescriptionHandler job_desc_handler;
+  // Protects counters below while jobs are processed in parallel
+  mutable Glib::Mutex jobs_counters_lock;
   // number of jobs for every state
   int jobs_num[JOB_STATE_NUM];
+  // number of jobs admitted to state under limits but not counted
+  // in jobs_num yet
+  int jobs_reserved[JOB_STATE_NUM];
   int jobs_scripts;
   // map of number of active jobs for each DN
   std::map<std::string, ZeroUInt> jobs_dn;
   // number of jobs currently in pending state
   int jobs_pending;
+  // number of pending jobs for every state
+  int jobs_pending_num[JOB_STATE_NUM];
+  // number of new jobs left in accepting directory because of limits,
+  // as seen by latest scan plus those reported by watcher since
+  int jobs_held;
+
+  // States of jobs updated by processing threads and published for
+  // service threads as immutable snapshots
+  Glib::Mutex jobs_summaries_lock;
+  std::map<JobId,GMJobStatus> jobs_summaries;
+  bool jobs_summaries_changed;
+  time_t jobs_snapshot_last;
+  mutable Glib::Mutex jobs_snapshot_lock;
+  Arc::ThreadedPointer<JobsSnapshot> jobs_snapshot;
+  // Record state of job after it was processed. Removes job if it is dropped.
+  void UpdateJobSummary(GMJobRef& i, bool dropped);
+
+  // Jobs currently being processed by ActJob in one of processing threads
+  std::set<GMJob const*> processing_active;
+  // Jobs taken from processing queue while other thread was still processing them
+  std::list<GMJobRef> processing_postponed;
+  // Number of threads currently running ActJob
+  int processing_busy;
+  Glib::Mutex processing_lock;
+  Glib::Cond processing_cond;
 
   // Add job into list without checking if it is already there.
   bool AddJobNoCheck(const JobId &id,uid_t uid,gid_t gid,job_state_t state = JOB_STATE_UNDEFINED);
@@ -91,6 +187,22 @@ class JobsList {
 
   // Cleaning reference to running child process
   void CleanChildProcess(GMJobRef i);
+  // Start submit or cancel script for job. It is passed to LRMS helper
+  // if possible, otherwise run as child process.
+  bool StartChildProcess(GMJobRef i, const std::string& action);
+  // Following methods hide difference between script being run as child
+  // process and through LRMS helper. Returns true if script was started
+  // and is not cleaned yet.
+  bool ChildProcessActive(GMJobRef i);
+  bool ChildProcessRunning(GMJobRef i);
+  int ChildProcessResult(GMJobRef i);
+  Arc::Time ChildProcessRunTime(GMJobRef i);
+  Arc::Time ChildProcessExitTime(GMJobRef i);
+  // Take place for one more submit/cancel script. Returns false if limit
+  // on number of scripts is reached.
+  bool ScriptsSlotAcquire(const JobId& id);
+  // Give back place taken by ScriptsSlotAcquire if script was not started
+  void ScriptsSlotRelease(void);
   // Remove Job from list. All corresponding files are deleted and pointer is
   // advanced. If finished is false - job is not destroyed if it is FINISHED
   // If active is false - job is not destroyed if it is not UNDEFINED. Returns
@@ -144,6 +256,14 @@ class JobsList {
   // Helper method for ActJob. Finishes processing of job, removes it from list.
   bool DropJob(GMJobRef& i, job_state_t old_state, bool old_pending);
 
+  // Checks limit for job entering state (ACCEPTED for MaxJobs, PREPARING for
+  // MaxPerDN, SUBMITTING for MaxRunning) and takes place under it in same
+  // step, so parallel processing threads can't overshoot limits. Place is
+  // turned into counted job or given back by NextJob or DropJob.
+  bool ReserveJobSlot(GMJobRef& i, job_state_t state);
+  // Gives back place not used by job. Must be called with jobs_counters_lock.
+  void ReleaseJobSlot(GMJobRef& i);
+
   enum ActJobResult {
     JobSuccess,
     JobFailed,
@@ -184,9 +304,16 @@ class JobsList {
   // Returns false if job is not allowed to continue.
   bool CheckJobContinuePlugins(GMJobRef i);
 
-  // Call ActJob for all jobs in processing queue
+  // Call ActJob for all jobs in processing queue. If configured, jobs are
+  // processed by several threads.
   bool ActJobsProcessing(void);
 
+  // Body of each thread of ActJobsProcessing. Takes jobs from processing
+  // queue till it is empty and no thread is processing anything. Same job
+  // is never processed by two threads at same time.
+  void ActJobsProcessingLoop(void);
+  static void ActJobsProcessingThread(void* arg);
+
   // Inform this instance that job with specified id needs immediate re-processing
   bool RequestReprocess(GMJobRef i);
 
@@ -254,6 +381,9 @@ class JobsList {
   /// Associated external processes
   ExternalHelpers helpers;
 
+  /// Long-running processes starting submit/cancel scripts
+  LRMSHelpers lrms_helpers;
+
   // Return iterator to object matching given id or null if not found
   GMJobRef FindJob(const JobId &id);
 
@@ -275,6 +405,17 @@ class JobsList {
   int AcceptedJobs() const;
   // No of jobs in batch system or in process of submission to batch system
   bool RunningJobsLimitReached() const;
+  // Numbers of jobs in every state for information system
+  void GetJobsCounters(JobsCounters& counters) const;
+  // States of requested jobs which are currently processed. Jobs not in
+  // latest snapshot are not included in result.
+  void GetJobsStatus(const std::list<JobId>& ids, std::map<JobId,GMJobStatus>& statuses) const;
+  // Latest published snapshot of jobs' states. Never NULL.
+  Arc::ThreadedPointer<JobsSnapshot> GetJobsSnapshot(void) const;
+  // Make changes in jobs' states visible through snapshot. Snapshot is
+  // renewed only if something changed and not more often than once per
+  // second. Returns false if some changes are still not published.
+  bool PublishJobsSnapshot(void);
   // No of jobs in data staging
   //int ProcessingJobs() const;
   // No of jobs staging in data before job execution
@@ -289,6 +430,17 @@ class JobsList {
   // Inform this instance that generic unscheduled attention is needed
   void RequestAttention();
 
+  // Inform this instance that job with specified id may have appeared
+  // among new or restarted jobs. Jobs already handled are not touched.
+  bool RequestNewJob(const JobId& id);
+
+  // Inform this instance that control directory is watched (or not anymore)
+  // for new jobs and marks, so regular scanning is not needed.
+  void ScanWatched(bool watched);
+
+  // Request full scanning for new jobs and marks at next polling
+  void ScanRequired(void);
+
   // Call ActJob for all current jobs
   bool ActJobs(void);
 
@@ -351,6 +503,10 @@ class JobsList {
 
   static int CountAllJobs(const GMConfig& config);
 
+  // Create index of jobs by owner from content of control directory
+  // unless complete index already exists.
+  static bool BuildOwnerIndex(const GMConfig& config);
+
 };
 
 } // namespace ARex
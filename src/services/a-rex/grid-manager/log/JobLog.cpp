@@ -18,17 +18,18 @@
 #include "../files/ControlFileContent.h"
 #include "../conf/GMConfig.h"
 #include "../accounting/AAR.h"
-#include "../accounting/AccountingDBSQLite.h"
+#include "../accounting/AccountingDBAsync.h"
 #include "JobLog.h"
 
 #define ACCOUNTING_SUBDIR "accounting"
 #define ACCOUNTING_DB_FILE "accounting.db"
+#define ACCOUNTING_PENDING_SUBDIR "pending"
 
 namespace ARex {
 
 static Arc::Logger& logger = Arc::Logger::getRootLogger();
 
-JobLog::JobLog(void):filename(""),reporter_proc(NULL),reporter_last_run(0),reporter_period(3600) {
+JobLog::JobLog(void):filename(""),reporter_proc(NULL),reporter_last_run(0),reporter_period(3600),accounting_db(NULL) {
 }
 
 void JobLog::SetOutput(const char* fname) {
@@ -160,15 +161,32 @@ bool JobLog::SetReporterLogFile(const char* fname) {
   return true;
 }
 
-bool JobLog::WriteJobRecord(GMJob &job, const GMConfig& config) {
-  // Create accounting DB connection
-  std::string accounting_db_path = config.ControlDir() + G_DIR_SEPARATOR_S + ACCOUNTING_SUBDIR + G_DIR_SEPARATOR_S + ACCOUNTING_DB_FILE;
-  AccountingDBSQLite adb(accounting_db_path);
+bool JobLog::accounting_fetch(void* arg, const std::string& jobid, const std::string& state, AAR& aar) {
+  const GMConfig& config = *reinterpret_cast<const GMConfig*>(arg);
+  GMJob job(jobid, Arc::User(), "", GMJob::get_state(state.c_str()));
+  // fails if job is already cleaned
+  return aar.FetchJobData(job, config);
+}
 
-  if (!adb.IsValid()) {
-    logger.msg(Arc::ERROR,": Failure creating accounting database connection");
-    return false;
+bool JobLog::WriteJobRecord(GMJob &job, const GMConfig& config) {
+  // Create accounting DB writer on first use
+  {
+    Glib::Mutex::Lock lock(accounting_lock);
+    if(!accounting_db) {
+      std::string accounting_dir = config.ControlDir() + G_DIR_SEPARATOR_S + ACCOUNTING_SUBDIR;
+      accounting_db = new AccountingDBAsync(accounting_dir + G_DIR_SEPARATOR_S + ACCOUNTING_DB_FILE,
+                                            accounting_dir + G_DIR_SEPARATOR_S + ACCOUNTING_PENDING_SUBDIR);
+      if (!accounting_db->IsValid()) {
+        logger.msg(Arc::ERROR,": Failure creating accounting database connection");
+        delete accounting_db;
+        accounting_db = NULL;
+        return false;
+      }
+      // records of previous run which were not written (done by writer thread)
+      accounting_db->Replay(&accounting_fetch, (void*)&config);
+    }
   }
+  AccountingDBAsync& adb = *accounting_db;
   
   // create initial AAR record in the accounting database on ACCEPTED
   if(job.get_state() == JOB_STATE_ACCEPTED) {
@@ -189,6 +207,12 @@ bool JobLog::WriteJobRecord(GMJob &job, const GMConfig& config) {
   return adb.addJobEvent(jobevent, job.get_id());
 }
 
+unsigned int JobLog::AccountingQueueSize(void) {
+  Glib::Mutex::Lock lock(accounting_lock);
+  if(!accounting_db) return 0;
+  return accounting_db->QueueSize();
+}
+
 void JobLog::SetCredentials(std::string const &key_path,std::string const &certificate_path,std::string const &ca_certificates_dir)
 {
   if (!key_path.empty()) 
@@ -205,6 +229,8 @@ JobLog::~JobLog(void) {
     delete reporter_proc;
     reporter_proc=NULL;
   };
+  // writes remaining accounting records
+  delete accounting_db;
 }
 
 void JobLog::initializer(void* arg) {
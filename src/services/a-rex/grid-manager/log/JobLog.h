@@ -7,6 +7,7 @@
 #include <fstream>
 
 #include <arc/Run.h>
+#include <arc/Thread.h>
 
 #include "../jobs/GMJob.h"
 
@@ -14,6 +15,8 @@ namespace ARex {
 
 class GMConfig;
 class JobLocalDescription;
+class AccountingDBAsync;
+class AAR;
 
 ///  Put short information into log when every job starts/finishes.
 ///  And store more detailed information for Reporter.
@@ -29,9 +32,13 @@ class JobLog {
   Arc::Run *reporter_proc;
   time_t reporter_last_run;
   int reporter_period;
+  // accounting database writer, created on first record
+  AccountingDBAsync* accounting_db;
+  Glib::Mutex accounting_lock;
 
   bool open_stream(std::ofstream &o);
   static void initializer(void* arg);
+  static bool accounting_fetch(void* arg, const std::string& jobid, const std::string& state, AAR& aar);
  public:
   JobLog(void);
   //JobLog(const char* fname);
@@ -54,6 +61,8 @@ class JobLog {
   bool SetReporterLogFile(const char* fname);
   /* Create data file for Reporter */
   bool WriteJobRecord(GMJob &job,const GMConfig &config);
+  /* Number of records waiting to be written to accounting database */
+  unsigned int AccountingQueueSize(void);
   /* Set credential file names for accessing logging service */
   void SetCredentials(std::string const &key_path,std::string const &certificate_path,std::string const &ca_certificates_dir);
   /* Set accounting options (e.g. batch size for SGAS LUTS) */
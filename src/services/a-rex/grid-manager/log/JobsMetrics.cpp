@@ -105,6 +105,9 @@ JobsMetrics::JobsMetrics():enabled(false),proc(NULL) {
 
   fail_changed = false;
 
+  accounting_queue = 0;
+  accounting_queue_changed = false;
+
   time_lastupdate = time(NULL);
 
   jobstatelist = new JobStateList(100);
@@ -158,6 +161,13 @@ void JobsMetrics::SetGmetricPath(const char* path) {
   Sync();
 }
 
+void JobsMetrics::ReportAccountingQueue(unsigned int size) {
+  Glib::RecMutex::Lock lock_(lock);
+  if(size == accounting_queue) return;
+  accounting_queue = size;
+  accounting_queue_changed = true;
+}
+
 bool JobsMetrics::CheckRunMetrics(void) {
   if(!proc) return true;
   if(proc->Running()) return false;
@@ -202,6 +212,16 @@ void JobsMetrics::Sync(void) {
     };
   };
 
+  if(accounting_queue_changed) {
+    if(RunMetrics(
+          std::string("AREX-ACCOUNTING-QUEUE"),
+          Arc::tostring(accounting_queue), "int32", "records"
+                    )) {
+      accounting_queue_changed = false;
+      return;
+    };
+  };
+
 
 }
 
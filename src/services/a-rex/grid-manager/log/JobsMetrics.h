@@ -77,11 +77,13 @@ class JobsMetrics {
   unsigned long long int jobs_state_accum[JOB_STATE_UNDEFINED+1];
   unsigned long long int jobs_state_accum_last[JOB_STATE_UNDEFINED+1];
   double jobs_rate[JOB_STATE_UNDEFINED];
+  unsigned int accounting_queue;
 
   bool fail_changed;
   bool jobs_in_state_changed[JOB_STATE_UNDEFINED];
   bool jobs_state_old_new_changed[JOB_STATE_UNDEFINED+1][JOB_STATE_UNDEFINED];
   bool jobs_rate_changed[JOB_STATE_UNDEFINED];
+  bool accounting_queue_changed;
 
   //id,state
   std::map<std::string,job_state_t> jobs_state_old_map;
@@ -110,6 +112,9 @@ class JobsMetrics {
 
   void ReportJobStateChange(const GMConfig& config, GMJobRef i, job_state_t old_state, job_state_t new_state);
 
+  /* Number of records waiting to be written to accounting database */
+  void ReportAccountingQueue(unsigned int size);
+
   void Sync(void);
 
 };
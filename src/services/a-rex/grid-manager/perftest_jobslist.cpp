@@ -0,0 +1,205 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_jobslist.cpp
+//
+// Drives many jobs through the A-REX job state machine and measures the time
+// until all of them reach FINISHED. Jobs have no input or output files. The
+// LRMS is replaced by mock scripts: submit-mock-job reports a local id and
+// writes the lrms_done mark immediately, so every job passes through all
+// states without waiting for a batch system.
+//
+// ARC_LOCATION is pointed to a temporary directory holding the mock scripts,
+// so this test does not need an installed LRMS backend.
+//
+// CPU time used by this process per job is reported too. Running with cache
+// of .local files disabled (size 0) and enabled shows cost of parsing them.
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <string>
+
+#include <glibmm.h>
+
+#include <arc/ArcLocation.h>
+#include <arc/FileUtils.h>
+#include <arc/JobPerfLog.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/User.h>
+#include <arc/Utils.h>
+#include <arc/compute/JobDescription.h>
+
+#include "conf/GMConfig.h"
+#include "files/ControlFileContent.h"
+#include "files/ControlFileHandling.h"
+#include "jobs/JobDescriptionHandler.h"
+#include "jobs/JobsList.h"
+#include "log/JobLog.h"
+
+static const char* mock_submit =
+  "#!/bin/sh\n"
+  "# Arguments: --config <arc.conf> <grami file>\n"
+  "grami=\"$3\"\n"
+  "id=`basename \"$grami\" .grami`\n"
+  "id=${id#job.}\n"
+  "echo \"joboption_jobid=mock$$\" >> \"$grami\"\n"
+  "echo \"0 Executable finished with exit code 0\" > \"`dirname \"$grami\"`/job.$id.lrms_done\"\n";
+
+static const char* mock_noop =
+  "#!/bin/sh\n"
+  "exit 0\n";
+
+static int count_files(const std::string& dir, const std::string& suffix) {
+  int n = 0;
+  try {
+    Glib::Dir d(dir);
+    for (;;) {
+      std::string f = d.read_name();
+      if (f.empty()) break;
+      if (f.length() > suffix.length() && f.compare(f.length()-suffix.length(), suffix.length(), suffix) == 0) ++n;
+    }
+  } catch (Glib::FileError&) {
+  }
+  return n;
+}
+
+static double cpu_time(void) {
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+static bool create_job(const ARex::GMConfig& config, const std::string& id) {
+  ARex::JobLocalDescription local;
+  ARex::GMJob job(id, Arc::User(), config.SessionRoot(id) + "/" + id, ARex::JOB_STATE_ACCEPTED);
+  if (!ARex::job_description_write_file(job, config, "&(executable=/bin/true)")) return false;
+  ARex::JobDescriptionHandler handler(config);
+  Arc::JobDescription desc;
+  if (handler.parse_job_req(id, local, desc) != ARex::JobReqSuccess) return false;
+  local.sessiondir = job.SessionDir();
+  local.DN = "/CN=perftest";
+  if (!ARex::job_local_write_file(job, config, local)) return false;
+  if (!config.CreateSessionDirectory(job.SessionDir(), job.get_user())) return false;
+  ARex::job_input_status_add_file(job, config);
+  return ARex::job_state_write_file(job, config, ARex::JOB_STATE_ACCEPTED, false);
+}
+
+int main(int argc, char** argv) {
+
+  int num = 100000;
+  int threads = 1;
+  int cache = -1;
+  if ((argc > 1 && !Arc::stringto(argv[1], num)) ||
+      (argc > 2 && !Arc::stringto(argv[2], threads)) ||
+      (argc > 3 && !Arc::stringto(argv[3], cache)) ||
+      num <= 0 || threads <= 0) {
+    std::cout << "Usage: perftest_jobslist [num jobs] [processing threads] [local cache size]" << std::endl;
+    return 1;
+  }
+  if (cache >= 0) ARex::JobLocalDescription::cache_size(cache);
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  std::string dir;
+  if (!Arc::TmpDirCreate(dir)) {
+    std::cout << "Failed to create temporary directory" << std::endl;
+    return 1;
+  }
+  std::string datadir = dir + G_DIR_SEPARATOR_S + PKGDATASUBDIR;
+  if (!Arc::DirCreate(datadir, S_IRWXU, true) ||
+      !Arc::FileCreate(datadir + "/submit-mock-job", mock_submit, 0, 0, S_IRWXU) ||
+      !Arc::FileCreate(datadir + "/cancel-mock-job", mock_noop, 0, 0, S_IRWXU) ||
+      !Arc::FileCreate(datadir + "/scan-mock-job", mock_noop, 0, 0, S_IRWXU)) {
+    std::cout << "Failed to create mock LRMS scripts in " << datadir << std::endl;
+    Arc::DirDelete(dir);
+    return 1;
+  }
+  Arc::SetEnv("ARC_LOCATION", dir);
+  Arc::ArcLocation::Init("");
+
+  std::string conffile = dir + "/arc.conf";
+  std::string conf = "[arex]\n"
+                     "controldir=" + dir + "/control\n"
+                     "sessiondir=" + dir + "/session\n"
+                     "processingthreads=" + Arc::tostring(threads) + "\n"
+                     "[lrms]\n"
+                     "lrms=mock\n";
+  if (!Arc::FileCreate(conffile, conf)) {
+    std::cout << "Failed to write configuration to " << conffile << std::endl;
+    Arc::DirDelete(dir);
+    return 1;
+  }
+
+  ARex::GMConfig config(conffile);
+  ARex::JobLog job_log;
+  Arc::JobPerfLog perf_log;
+  config.SetJobLog(&job_log);
+  config.SetJobPerfLog(&perf_log);
+  if (!config.Load() || !config.CreateControlDirectory() ||
+      !Arc::DirCreate(dir + "/session", S_IRWXU)) {
+    std::cout << "Failed to set up control and session directories in " << dir << std::endl;
+    Arc::DirDelete(dir);
+    return 1;
+  }
+
+  for (int n = 0; n < num; ++n) {
+    if (!create_job(config, "perftest" + Arc::tostring(n))) {
+      std::cout << "Failed to create job " << n << std::endl;
+      Arc::DirDelete(dir);
+      return 1;
+    }
+  }
+
+  int finished = 0;
+  double elapsed = 0;
+  double cpu = 0;
+  {
+    ARex::JobsList jobs(config);
+    if (!jobs) {
+      std::cout << "Failed to initialize jobs list" << std::endl;
+      Arc::DirDelete(dir);
+      return 1;
+    }
+    Glib::TimeVal start;
+    start.assign_current_time();
+    Glib::TimeVal checked(start);
+    double cpu_start = cpu_time();
+    jobs.ScanNewJobs();
+    // Same calls as in main loop of GridManager, only without waiting
+    // for wakeup period to run polling.
+    for (;;) {
+      jobs.ActJobsAttention();
+      jobs.ActJobsPolling();
+      Glib::TimeVal now;
+      now.assign_current_time();
+      if ((now - checked).as_double() >= 1.0) {
+        checked = now;
+        finished = count_files(config.ControlDir() + "/" + ARex::subdir_old, ".status");
+        if (finished >= num) break;
+      }
+      Glib::usleep(10000);
+    }
+    Glib::TimeVal end;
+    end.assign_current_time();
+    elapsed = (end - start).as_double();
+    cpu = cpu_time() - cpu_start;
+  }
+
+  int failed = count_files(config.ControlDir(), ".failed");
+  std::cout << num << " jobs with " << threads << " processing threads: "
+            << elapsed << " s, " << (num / elapsed) << " jobs/s, "
+            << (cpu * 1000.0 / num) << " ms CPU per job, "
+            << failed << " failed" << std::endl;
+  Arc::DirDelete(dir);
+  return 0;
+}
@@ -0,0 +1,239 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_sqlite.cpp
+//
+// Measures throughput of SQLite databases used by A-REX.
+//
+// First same rows are written to and read from plain table using SQL text
+// built by concatenation and run by sqlite3_exec() in rollback journal
+// mode, then using SQLiteDB prepared statements in WAL mode, with and
+// without grouping writes into transactions.
+//
+// Then stores used on job processing path are driven through their public
+// interfaces: delegation records are added and looked up in
+// FileRecordSQLite and accounting records are created and updated in
+// AccountingDBSQLite.
+//
+// ARC_LOCATION is pointed to a temporary directory holding copy of the
+// accounting database schema, so this test does not need installed ARC.
+
+#include <sys/stat.h>
+
+#include <iostream>
+#include <string>
+
+#include <glibmm.h>
+
+#include <arc/ArcLocation.h>
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "../SQLhelpers.h"
+#include "../SQLiteDB.h"
+#include "../delegation/FileRecordSQLite.h"
+#include "accounting/AccountingDBSQLite.h"
+
+// Rows written in one transaction - about as many as one AAR has
+#define ROWS_PER_TRANSACTION 10
+
+class Timer {
+ private:
+  Glib::TimeVal start_;
+ public:
+  Timer(void) { start_.assign_current_time(); };
+  double Elapsed(void) const {
+    Glib::TimeVal now;
+    now.assign_current_time();
+    now -= start_;
+    return now.as_double();
+  };
+};
+
+static void report(const char* what, int num, double elapsed) {
+  std::cout << "  " << what << ": " << elapsed << " s, "
+            << (elapsed > 0 ? (num / elapsed) : 0) << " ops/s" << std::endl;
+}
+
+static int count_callback(void* arg, int colnum, char** texts, char** names) {
+  ++(*(int*)arg);
+  return 0;
+}
+
+static bool test_exec(const std::string& path, int num) {
+  ARex::SQLiteDB db;
+  if (db.Open(path, true, false) != SQLITE_OK) return false;
+  if (db.Exec("CREATE TABLE IF NOT EXISTS t(id, value, UNIQUE(id))") != SQLITE_OK) return false;
+  std::cout << "sqlite3_exec, rollback journal" << std::endl;
+  Timer insert_timer;
+  for (int n = 0; n < num; ++n) {
+    std::string sql = "INSERT INTO t(id, value) VALUES ('" + ARex::sql_escape("id" + Arc::tostring(n)) +
+                      "', '" + ARex::sql_escape("value" + Arc::tostring(n)) + "')";
+    if (db.Exec(sql.c_str()) != SQLITE_OK) return false;
+  }
+  report("insert", num, insert_timer.Elapsed());
+  Timer select_timer;
+  int found = 0;
+  for (int n = 0; n < num; ++n) {
+    std::string sql = "SELECT value FROM t WHERE (id = '" + ARex::sql_escape("id" + Arc::tostring(n)) + "')";
+    if (db.Exec(sql.c_str(), &count_callback, &found) != SQLITE_OK) return false;
+  }
+  report("select", num, select_timer.Elapsed());
+  return (found == num);
+}
+
+static bool test_prepared(const std::string& path, int num, bool transactions) {
+  ARex::SQLiteDB db;
+  if (db.Open(path, true) != SQLITE_OK) return false;
+  if (db.Exec("CREATE TABLE IF NOT EXISTS t(id, value, UNIQUE(id))") != SQLITE_OK) return false;
+  std::cout << "prepared statements, WAL" << (transactions ? ", transactions of " + Arc::tostring(ROWS_PER_TRANSACTION) + " rows" : "") << std::endl;
+  Timer insert_timer;
+  for (int n = 0; n < num; ) {
+    ARex::SQLiteTransaction* transaction = transactions ? new ARex::SQLiteTransaction(db) : NULL;
+    int last = transactions ? (n + ROWS_PER_TRANSACTION) : (n + 1);
+    for (; (n < num) && (n < last); ++n) {
+      ARex::SQLiteStatement stmt(db, "INSERT INTO t(id, value) VALUES (?, ?)");
+      stmt.Bind(ARex::sql_escape("id" + Arc::tostring(n))).Bind(ARex::sql_escape("value" + Arc::tostring(n)));
+      if (stmt.Exec() != SQLITE_OK) { delete transaction; return false; }
+    }
+    if (transaction) {
+      int err = transaction->Commit();
+      delete transaction;
+      if (err != SQLITE_OK) return false;
+    }
+  }
+  report("insert", num, insert_timer.Elapsed());
+  Timer select_timer;
+  int found = 0;
+  for (int n = 0; n < num; ++n) {
+    ARex::SQLiteStatement stmt(db, "SELECT value FROM t WHERE (id = ?)");
+    stmt.Bind(ARex::sql_escape("id" + Arc::tostring(n)));
+    if (stmt.Step() == SQLITE_ROW) ++found;
+    if (stmt.Error() != SQLITE_OK) return false;
+  }
+  report("select", num, select_timer.Elapsed());
+  return (found == num);
+}
+
+static bool test_filerecord(const std::string& dir, int num) {
+  ARex::FileRecordSQLite frec(dir);
+  if (!frec) return false;
+  std::cout << "FileRecordSQLite" << std::endl;
+  std::list<std::string> meta;
+  meta.push_back("/DC=org/DC=perftest/CN=user");
+  Timer add_timer;
+  for (int n = 0; n < num; ++n) {
+    std::string id = "delegation" + Arc::tostring(n);
+    if (frec.Add(id, "owner", meta).empty()) return false;
+  }
+  report("add", num, add_timer.Elapsed());
+  Timer find_timer;
+  for (int n = 0; n < num; ++n) {
+    std::list<std::string> found_meta;
+    if (frec.Find("delegation" + Arc::tostring(n), "owner", found_meta).empty()) return false;
+  }
+  report("find", num, find_timer.Elapsed());
+  Timer lock_timer;
+  for (int n = 0; n < num; ++n) {
+    std::list<std::string> ids;
+    ids.push_back("delegation" + Arc::tostring(n));
+    if (!frec.AddLock("job" + Arc::tostring(n), ids, "owner")) return false;
+  }
+  report("lock", num, lock_timer.Elapsed());
+  return true;
+}
+
+static bool test_accounting(const std::string& path, int num) {
+  ARex::AccountingDBSQLite adb(path);
+  if (!adb.IsValid()) return false;
+  std::cout << "AccountingDBSQLite" << std::endl;
+  ARex::AAR aar;
+  aar.endpoint.interface = "org.ogf.glue.emies.activitycreation";
+  aar.endpoint.url = "https://arc.example.org:443/arex";
+  aar.queue = "grid";
+  aar.userdn = "/DC=org/DC=perftest/CN=user";
+  aar.wlcgvo = "perftest";
+  aar.status = "in-progress";
+  aar.submittime = Arc::Time();
+  aar.authtokenattrs.push_back(ARex::aar_authtoken_t("vomsfqan", "/perftest"));
+  aar.authtokenattrs.push_back(ARex::aar_authtoken_t("vomsfqan", "/perftest/Role=NULL"));
+  aar.jobevents.push_back(ARex::aar_jobevent_t("ACCEPTED", Arc::Time()));
+  Timer create_timer;
+  for (int n = 0; n < num; ++n) {
+    aar.jobid = "perftest" + Arc::tostring(n);
+    if (!adb.createAAR(aar)) return false;
+  }
+  report("create", num, create_timer.Elapsed());
+  ARex::aar_jobevent_t event("PREPARING", Arc::Time());
+  Timer event_timer;
+  for (int n = 0; n < num; ++n) {
+    if (!adb.addJobEvent(event, "perftest" + Arc::tostring(n))) return false;
+  }
+  report("event", num, event_timer.Elapsed());
+  aar.status = "completed";
+  aar.exitcode = 0;
+  aar.endtime = Arc::Time();
+  aar.jobevents.clear();
+  aar.jobevents.push_back(ARex::aar_jobevent_t("FINISHED", Arc::Time()));
+  aar.rtes.push_back("ENV/PROXY");
+  aar.extrainfo["jobname"] = "perftest";
+  aar.extrainfo["lrms"] = "fork";
+  aar.extrainfo["localuser"] = "nobody";
+  aar.transfers.push_back(ARex::aar_data_transfer_t());
+  aar.transfers.back().url = "https://data.example.org/file";
+  aar.transfers.back().size = 1024;
+  aar.transfers.back().type = ARex::dtr_input;
+  Timer update_timer;
+  for (int n = 0; n < num; ++n) {
+    aar.jobid = "perftest" + Arc::tostring(n);
+    if (!adb.updateAAR(aar)) return false;
+  }
+  report("update", num, update_timer.Elapsed());
+  return true;
+}
+
+int main(int argc, char** argv) {
+
+  int num = 10000;
+  if ((argc > 1 && !Arc::stringto(argv[1], num)) || num <= 0) {
+    std::cout << "Usage: perftest_sqlite [num records]" << std::endl;
+    return 1;
+  }
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  std::string dir;
+  if (!Arc::TmpDirCreate(dir)) {
+    std::cout << "Failed to create temporary directory" << std::endl;
+    return 1;
+  }
+  std::string schema;
+  std::string schemadir = dir + G_DIR_SEPARATOR_S + PKGDATASUBDIR + G_DIR_SEPARATOR_S + "sql-schema";
+  if (!Arc::FileRead(ACCOUNTING_SCHEMA, schema) ||
+      !Arc::DirCreate(schemadir, S_IRWXU, true) ||
+      !Arc::FileCreate(schemadir + G_DIR_SEPARATOR_S + Glib::path_get_basename(ACCOUNTING_SCHEMA), schema)) {
+    std::cout << "Failed to copy accounting database schema to " << schemadir << std::endl;
+    Arc::DirDelete(dir);
+    return 1;
+  }
+  Arc::SetEnv("ARC_LOCATION", dir);
+  Arc::ArcLocation::Init("");
+
+  std::cout << num << " records" << std::endl;
+  bool result = test_exec(dir + "/exec.db", num) &&
+                test_prepared(dir + "/prepared.db", num, false) &&
+                test_prepared(dir + "/transactions.db", num, true) &&
+                Arc::DirCreate(dir + "/delegations", S_IRWXU) &&
+                test_filerecord(dir + "/delegations", num) &&
+                test_accounting(dir + "/accounting/accounting.db", num);
+  if (!result) std::cout << "Test failed" << std::endl;
+  Arc::DirDelete(dir);
+  return result ? 0 : 1;
+}
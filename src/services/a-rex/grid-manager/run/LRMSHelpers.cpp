@@ -0,0 +1,293 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glibmm/fileutils.h>
+
+#include <arc/ArcLocation.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "../conf/GMConfig.h"
+#include "../jobs/JobsList.h"
+
+#include "LRMSHelpers.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+// Collects output of helper process and splits it into lines
+class LRMSHelpers::Helper: public Arc::Run::Data {
+ public:
+  Helper(LRMSHelpers& owner): owner(owner), proc(NULL), exited(false) {};
+  virtual ~Helper(void) {
+    if(proc) {
+      // Closed input tells helper to exit after all started scripts finish
+      proc->CloseStdin();
+      proc->Wait(10);
+      delete proc;
+    };
+  };
+  virtual void Append(char const* data, unsigned int size) {
+    for(unsigned int n = 0; n < size; ++n) {
+      if(data[n] == '\n') {
+        owner.Reply(this, buffer);
+        buffer.clear();
+      } else {
+        buffer.append(1, data[n]);
+      };
+    };
+  };
+  virtual void Remove(unsigned int size) { };
+  virtual char const* Get() const { return buffer.c_str(); };
+  virtual unsigned int Size() const { return buffer.length(); };
+  LRMSHelpers& owner;
+  Arc::Run* proc;
+  std::string key;
+  std::string buffer;
+  bool exited;
+};
+
+LRMSHelpers::LRMSHelpers(const GMConfig& config, JobsList& jobs): config_(config), jobs_(jobs) {
+  if(!config_.UseLRMSHelper()) return;
+  std::string command = Arc::ArcLocation::GetDataDir() + "/lrms-helper";
+  if(!Glib::file_test(command, Glib::FILE_TEST_IS_EXECUTABLE)) {
+    logger.msg(Arc::WARNING, "Missing %s - LRMS scripts will be started for every job", command);
+    return;
+  };
+  command_ = command;
+}
+
+LRMSHelpers::~LRMSHelpers(void) {
+  std::list<Helper*> helpers;
+  {
+    Glib::Mutex::Lock lock(lock_);
+    for(std::map<std::string,Helper*>::iterator h = helpers_.begin(); h != helpers_.end(); ++h) {
+      helpers.push_back(h->second);
+    };
+    helpers_.clear();
+    helpers.splice(helpers.end(), exited_);
+  };
+  // No lock held here because helpers report their exit while being destroyed
+  for(std::list<Helper*>::iterator h = helpers.begin(); h != helpers.end(); ++h) delete *h;
+}
+
+LRMSHelpers::Helper* LRMSHelpers::GetHelper(const std::string& lrms, const Arc::User& user, const JobId& id) {
+  // Must be called without lock_ held. Request is registered before
+  // lock_ is released, so helper is not destroyed while being used.
+  std::string key = lrms + ":" + Arc::tostring(user.get_uid()) + ":" + Arc::tostring(user.get_gid());
+  Helper* helper = NULL;
+  {
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string,Helper*>::iterator h = helpers_.find(key);
+    if(h != helpers_.end()) helper = h->second;
+  };
+  if(!helper) {
+    // Starting process registers it in RunPump which calls Reply() and
+    // Exited() with own lock held. So lock_ must not be held while starting.
+    Glib::Mutex::Lock slock(start_lock_);
+    {
+      Glib::Mutex::Lock lock(lock_);
+      std::map<std::string,Helper*>::iterator h = helpers_.find(key);
+      if(h != helpers_.end()) helper = h->second;
+    };
+    if(!helper) {
+      helper = StartHelper(key, user);
+      if(!helper) return NULL;
+      Glib::Mutex::Lock lock(lock_);
+      if(helper->exited) {
+        // Exited before it could be used
+        exited_.push_back(helper);
+        return NULL;
+      };
+      helpers_[key] = helper;
+      RequestState& request = requests_[id];
+      request = RequestState();
+      request.helper = helper;
+      return helper;
+    };
+  };
+  Glib::Mutex::Lock lock(lock_);
+  // Helper may have exited and be destroyed since it was found
+  std::map<std::string,Helper*>::iterator h = helpers_.find(key);
+  if((h == helpers_.end()) || (h->second != helper)) return NULL;
+  RequestState& request = requests_[id];
+  request = RequestState();
+  request.helper = helper;
+  return helper;
+}
+
+LRMSHelpers::Helper* LRMSHelpers::StartHelper(const std::string& key, const Arc::User& user) {
+  std::list<std::string> args;
+  args.push_back(command_);
+  args.push_back("--config");
+  args.push_back(config_.ConfigFile());
+  Helper* helper = new Helper(*this);
+  helper->key = key;
+  Arc::Run* proc = new Arc::Run(args);
+  if(!*proc) {
+    delete proc;
+    delete helper;
+    return NULL;
+  };
+  // Same environment as RunParallel provides for scripts, except proxy
+  // which differs per job and is set by helper.
+  proc->AssignUserId(user.get_uid());
+  proc->AssignGroupId(user.get_gid());
+  proc->RemoveEnvironment("X509_RUN_AS_SERVER");
+  std::string cert_dir = config_.CertDir();
+  if(!cert_dir.empty()) {
+    proc->AddEnvironment("X509_CERT_DIR",cert_dir);
+  } else {
+    proc->RemoveEnvironment("X509_CERT_DIR");
+  };
+  std::string voms_dir = config_.VomsDir();
+  if(!voms_dir.empty()) {
+    proc->AddEnvironment("X509_VOMS_DIR",voms_dir);
+  } else {
+    proc->RemoveEnvironment("X509_VOMS_DIR");
+  };
+  proc->KeepStderr(true);
+  proc->AssignStdout(*helper);
+  proc->AssignKicker(&ExitedKicker, helper);
+  helper->proc = proc;
+  if(!proc->Start()) {
+    logger.msg(Arc::ERROR, "Failed to start LRMS helper %s", command_);
+    helper->proc = NULL;
+    delete proc;
+    delete helper;
+    return NULL;
+  };
+  logger.msg(Arc::INFO, "Started LRMS helper for %s", key);
+  return helper;
+}
+
+void LRMSHelpers::PurgeExited(void) {
+  std::list<Helper*> helpers;
+  {
+    Glib::Mutex::Lock lock(lock_);
+    for(std::list<Helper*>::iterator h = exited_.begin(); h != exited_.end();) {
+      bool used = false;
+      for(std::map<JobId,RequestState>::iterator request = requests_.begin(); request != requests_.end(); ++request) {
+        if(request->second.helper == *h) { used = true; break; };
+      };
+      if(used) { ++h; continue; };
+      helpers.push_back(*h);
+      h = exited_.erase(h);
+    };
+  };
+  // Destroying process takes lock of RunPump, so lock_ is not held here
+  for(std::list<Helper*>::iterator h = helpers.begin(); h != helpers.end(); ++h) delete *h;
+}
+
+bool LRMSHelpers::Request(const GMJob& job, const std::string& lrms, const std::string& action) {
+  if(command_.empty()) return false;
+  std::string grami = config_.ControlDir() + "/job." + job.get_id() + ".grami";
+  // Request must fit into single line
+  if((grami.find('\n') != std::string::npos) || (lrms.find_first_of(" \n") != std::string::npos)) return false;
+  std::string line = action + " " + lrms + " " + grami + "\n";
+  PurgeExited();
+  // Registered before sending because reply may come immediately
+  Helper* helper = GetHelper(lrms, job.get_user(), job.get_id());
+  if(!helper) return false;
+  // Helper reads requests while writing replies, so no lock is held here.
+  // Lines shorter than PIPE_BUF are written at once, hence no mixing
+  // happens between processing threads.
+  if(helper->proc->WriteStdin(10000, line.c_str(), line.length()) != (int)line.length()) {
+    logger.msg(Arc::ERROR, "%s: Failed passing request to LRMS helper", job.get_id());
+    Glib::Mutex::Lock lock(lock_);
+    requests_.erase(job.get_id());
+    return false;
+  };
+  logger.msg(Arc::DEBUG, "%s: Passed %s request to LRMS helper", job.get_id(), action);
+  return true;
+}
+
+void LRMSHelpers::Reply(Helper* helper, const std::string& line) {
+  // <grami file> <exit code>
+  std::string::size_type p = line.rfind(' ');
+  if(p == std::string::npos) return;
+  std::string grami = line.substr(0, p);
+  int result = -1;
+  if(!Arc::stringto(line.substr(p+1), result)) result = -1;
+  std::string::size_type n = grami.rfind('/');
+  if(n != std::string::npos) grami.erase(0, n+1);
+  if((grami.length() <= 4+6) || (grami.compare(0, 4, "job.") != 0) ||
+     (grami.compare(grami.length()-6, 6, ".grami") != 0)) {
+    logger.msg(Arc::WARNING, "Unexpected output from LRMS helper: %s", line);
+    return;
+  };
+  JobId id = grami.substr(4, grami.length()-6-4);
+  {
+    Glib::Mutex::Lock lock(lock_);
+    std::map<JobId,RequestState>::iterator request = requests_.find(id);
+    if(request == requests_.end()) return; // forgotten meanwhile
+    // Helper runs under mapped account of its user and may only
+    // complete requests passed to it
+    if(request->second.helper != helper) {
+      logger.msg(Arc::WARNING, "%s: LRMS helper %s replied to request it did not get", id, helper->key);
+      return;
+    };
+    request->second.running = false;
+    request->second.result = result;
+    request->second.exit_time = Arc::Time();
+  };
+  logger.msg(Arc::DEBUG, "%s: LRMS helper finished request with code %i", id, result);
+  jobs_.RequestAttention(id);
+}
+
+void LRMSHelpers::Exited(Helper* helper) {
+  std::list<JobId> ids;
+  {
+    Glib::Mutex::Lock lock(lock_);
+    // Helper which is still being started is taken care of by starter
+    helper->exited = true;
+    std::map<std::string,Helper*>::iterator h = helpers_.find(helper->key);
+    if((h != helpers_.end()) && (h->second == helper)) {
+      helpers_.erase(h);
+      // Process may still be referenced by request being sent, so it is
+      // only destroyed together with this object.
+      exited_.push_back(helper);
+      logger.msg(Arc::WARNING, "LRMS helper for %s exited", helper->key);
+    };
+    // Scripts of lost requests are treated like lost child processes
+    for(std::map<JobId,RequestState>::iterator request = requests_.begin(); request != requests_.end(); ++request) {
+      if((request->second.helper == helper) && request->second.running) {
+        request->second.running = false;
+        request->second.result = -1;
+        request->second.exit_time = Arc::Time();
+        ids.push_back(request->first);
+      };
+    };
+  };
+  for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) jobs_.RequestAttention(*id);
+}
+
+void LRMSHelpers::ExitedKicker(void* arg) {
+  Helper* helper = reinterpret_cast<Helper*>(arg);
+  if(helper) helper->owner.Exited(helper);
+}
+
+bool LRMSHelpers::Has(const JobId& id) {
+  Glib::Mutex::Lock lock(lock_);
+  return (requests_.find(id) != requests_.end());
+}
+
+bool LRMSHelpers::Check(const JobId& id, bool& running, int& result, Arc::Time& run_time, Arc::Time& exit_time) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<JobId,RequestState>::iterator request = requests_.find(id);
+  if(request == requests_.end()) return false;
+  running = request->second.running;
+  result = request->second.result;
+  run_time = request->second.run_time;
+  exit_time = request->second.exit_time;
+  return true;
+}
+
+void LRMSHelpers::Forget(const JobId& id) {
+  Glib::Mutex::Lock lock(lock_);
+  requests_.erase(id);
+}
+
+} // namespace ARex
@@ -0,0 +1,81 @@
+#ifndef GRID_MANAGER_LRMS_HELPERS_H
+#define GRID_MANAGER_LRMS_HELPERS_H
+
+#include <string>
+#include <map>
+#include <list>
+
+#include <arc/DateTime.h>
+#include <arc/Run.h>
+#include <arc/Thread.h>
+
+#include "../jobs/GMJob.h"
+
+namespace ARex {
+
+class GMConfig;
+class JobsList;
+
+/// Long-running processes passing job submission and cancellation to LRMS.
+/**
+ * Instead of starting submit-*-job and cancel-*-job scripts from A-REX
+ * for every job, requests are written to the lrms-helper script which
+ * stays running, one per LRMS type and user. Helper starts scripts itself
+ * and reports their exit codes back. Job is passed to JobsList for
+ * attention when its request is processed.
+ */
+class LRMSHelpers {
+ private:
+  class Helper;
+  class RequestState {
+   public:
+    Helper* helper;
+    bool running;
+    int result;
+    Arc::Time run_time;
+    Arc::Time exit_time;
+    RequestState(void): helper(NULL), running(true), result(-1), exit_time(Arc::Time::UNDEFINED) {};
+  };
+  const GMConfig& config_;
+  JobsList& jobs_;
+  std::string command_;
+  // Protects lists below. Also taken from callbacks of child processes,
+  // hence processes must not be started or destroyed while it is held.
+  Glib::Mutex lock_;
+  // Serializes starting of helpers. Never taken from callbacks.
+  Glib::Mutex start_lock_;
+  // Running helpers identified by LRMS and user
+  std::map<std::string,Helper*> helpers_;
+  // Helpers which exited and wait to be destroyed
+  std::list<Helper*> exited_;
+  std::map<JobId,RequestState> requests_;
+  // Called by Helper when line of output arrives or helper exits
+  void Reply(Helper* helper, const std::string& line);
+  void Exited(Helper* helper);
+  static void ExitedKicker(void* arg);
+  // Finds or starts helper and registers request for job with it
+  Helper* GetHelper(const std::string& lrms, const Arc::User& user, const JobId& id);
+  Helper* StartHelper(const std::string& key, const Arc::User& user);
+  // Destroys exited helpers not referenced by requests anymore
+  void PurgeExited(void);
+  LRMSHelpers(const LRMSHelpers&);
+ public:
+  LRMSHelpers(const GMConfig& config, JobsList& jobs);
+  ~LRMSHelpers(void);
+  /// Returns false if helpers are disabled or not installed
+  operator bool(void) const { return !command_.empty(); };
+  bool operator!(void) const { return command_.empty(); };
+  /// Pass request to run action (submit or cancel) script of job's LRMS
+  /** Returns false if request could not be passed. Then script must be run by caller. */
+  bool Request(const GMJob& job, const std::string& lrms, const std::string& action);
+  /// Returns true if there is request for job which was not forgotten yet
+  bool Has(const JobId& id);
+  /// Obtain state of request. Returns false if there is no request for job.
+  bool Check(const JobId& id, bool& running, int& result, Arc::Time& run_time, Arc::Time& exit_time);
+  /// Forget about request. Script may still be running.
+  void Forget(const JobId& id);
+};
+
+} // namespace ARex
+
+#endif // GRID_MANAGER_LRMS_HELPERS_H
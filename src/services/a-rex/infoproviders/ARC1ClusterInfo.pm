@@ -866,6 +866,8 @@ sub collect($) {
         $gmsharecount{$sharevomsvo}{totaljobs}++ if defined $vomsvo;
 
         # count GM states by category
+        # Only preparing and finishing jobs are staging. Same counting is
+        # done by A-REX between runs of the information provider.
 
         my %states = ( 'UNDEFINED'        => [0, 'undefined'],
                        'ACCEPTING'        => [1, 'accepted'],
@@ -873,12 +875,12 @@ sub collect($) {
                        'PENDING:ACCEPTED' => [1, 'accepted'],
                        'PREPARING'        => [2, 'preparing'],
                        'PENDING:PREPARING'=> [2, 'preparing'],
-                       'SUBMIT'           => [2, 'preparing'],
-                       'SUBMITTING'       => [2, 'preparing'],
+                       'SUBMIT'           => [2, 'submitting'],
+                       'SUBMITTING'       => [2, 'submitting'],
                        'INLRMS'           => [3, 'inlrms'],
-                       'PENDING:INLRMS'   => [4, 'finishing'],
+                       'PENDING:INLRMS'   => [4, 'executed'],
                        'FINISHING'        => [4, 'finishing'],
-                       'CANCELING'        => [4, 'finishing'],
+                       'CANCELING'        => [4, 'canceling'],
                        'FAILED'           => [5, 'finished'],
                        'KILLED'           => [5, 'finished'],
                        'FINISHED'         => [5, 'finished'],
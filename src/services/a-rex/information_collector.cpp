@@ -10,7 +10,9 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <string.h>
 #include <time.h>
+#include <zlib.h>
 
 #include <glibmm.h>
 
@@ -18,15 +20,87 @@
 #include <arc/Run.h>
 #include <arc/message/PayloadSOAP.h>
 #include <arc/FileUtils.h>
+#include <arc/CheckSum.h>
 
 #include "grid-manager/files/ControlFileHandling.h"
 #include "job.h"
 #include "arex.h"
 
+#include "grid-manager/jobs/JobsList.h"
+
 namespace ARex {
 
+// How often job counters in information document are refreshed (ms)
+#define JOBS_INFORMATION_UPDATE_PERIOD (10000)
+
+// Sum of jobs in listed states, including pending ones
+static int CountJobs(const JobsCounters& counters, const job_state_t* states, bool pending = true) {
+  int count = 0;
+  for(;*states != JOB_STATE_UNDEFINED;++states) {
+    count += counters.states[*states];
+    if(pending) count += counters.pending[*states];
+  };
+  return count;
+}
+
+// Sets job counters which grid-manager knows better than information
+// provider. Counting follows ARC1ClusterInfo.pm. Elements missing in
+// document are not added to keep order required by schema.
+static void SetJobsCounters(Arc::XMLNode node, const JobsCounters& counters) {
+  static const job_state_t notfinished[] = { JOB_STATE_ACCEPTED, JOB_STATE_PREPARING,
+        JOB_STATE_SUBMITTING, JOB_STATE_INLRMS, JOB_STATE_FINISHING, JOB_STATE_CANCELING,
+        JOB_STATE_UNDEFINED };
+  // Neither submitting, canceling nor PENDING:INLRMS jobs are staging
+  static const job_state_t staging[] = { JOB_STATE_PREPARING, JOB_STATE_FINISHING,
+        JOB_STATE_UNDEFINED };
+  static const job_state_t accepted[] = { JOB_STATE_ACCEPTED, JOB_STATE_UNDEFINED };
+  Arc::XMLNode item;
+  // Jobs waiting in accepting directory are ACCEPTED for information provider
+  if((bool)(item = node["TotalJobs"])) item = Arc::tostring(CountJobs(counters, notfinished) +
+                                                            counters.held);
+  if((bool)(item = node["StagingJobs"])) item = Arc::tostring(CountJobs(counters, staging));
+  if((bool)(item = node["PreLRMSWaitingJobs"])) item = Arc::tostring(CountJobs(counters, accepted) +
+                                                                     counters.held);
+}
+
+bool ARexService::UpdateJobsInformation(JobsCounters& last_counters, bool force) {
+  if(!gm_) return false;
+  JobsCounters counters;
+  if(!gm_->GetJobsCounters(counters)) return false;
+  if((!force) && (counters == last_counters)) return true;
+  std::string xml_str;
+  {
+    Arc::XMLNode root = infodoc_.Acquire();
+    Arc::XMLNode service = root["Domains"]["AdminDomain"]["Services"]["ComputingService"];
+    if(!service) {
+      infodoc_.Release();
+      return false;
+    };
+    for(;(bool)service;++service) {
+      SetJobsCounters(service, counters);
+      for(Arc::XMLNode endpoint = service["ComputingEndpoint"];(bool)endpoint;++endpoint) {
+        SetJobsCounters(endpoint, counters);
+      };
+    };
+    root.GetXML(xml_str);
+    infodoc_.Release();
+  };
+  infodoc_.Assign(xml_str,config_.ControlDir()+G_DIR_SEPARATOR_S+"info.xml");
+  last_counters = counters;
+  logger_.msg(Arc::DEBUG,"Updated jobs information in informational document");
+  return true;
+}
+
 void ARexService::InformationCollector(void) {
   thread_count_.RegisterThread();
+  // Information provider is run every infoprovider_wakeup_period_*100 ms.
+  // In between, job counters are taken directly from grid-manager, so
+  // published numbers follow jobs without waiting for next provider run.
+  // Provider itself still reads control files of every job, so cost of
+  // its run is not reduced by that.
+  int provider_period = infoprovider_wakeup_period_*100;
+  int update_period = (provider_period < JOBS_INFORMATION_UPDATE_PERIOD)?provider_period:JOBS_INFORMATION_UPDATE_PERIOD;
+  JobsCounters last_counters;
   for(;;) {
     // Run information provider
     std::string xml_str;
@@ -77,7 +151,20 @@ void ARexService::InformationCollector(void) {
         logger_.msg(Arc::ERROR,"Informational document is empty");
       };
     };
-    if(thread_count_.WaitOrCancel(infoprovider_wakeup_period_*100)) break;
+    // New document carries counters collected by provider - replace them
+    bool force = true;
+    int waited = 0;
+    bool cancel = false;
+    for(;;) {
+      UpdateJobsInformation(last_counters, force);
+      force = false;
+      int wait = provider_period - waited;
+      if(wait > update_period) wait = update_period;
+      if((cancel = thread_count_.WaitOrCancel(wait))) break;
+      waited += wait;
+      if(waited >= provider_period) break;
+    };
+    if(cancel) break;
   };
   thread_count_.UnregisterThread();
 }
@@ -261,12 +348,68 @@ int OptimizedInformationContainer::OpenDocument(void) {
   return h;
 }
 
+int OptimizedInformationContainer::OpenDocument(Arc::ThreadedPointer<Rendition>& rendition) {
+  int h = -1;
+  olock_.lock();
+  if(handle_ != -1) h = ::dup(handle_);
+  rendition = rendition_;
+  olock_.unlock();
+  return h;
+}
+
+OptimizedInformationContainer::Rendition* OptimizedInformationContainer::Render(const std::string& xml) {
+  Rendition* rendition = new Rendition;
+  // Entity tag is derived from content so that it stays same for
+  // unchanged document even if service is restarted.
+  Arc::MD5Sum md5;
+  md5.start();
+  md5.add((void*)xml.c_str(),xml.length());
+  md5.end();
+  unsigned char* res = NULL;
+  unsigned int len = 0;
+  md5.result(res,len);
+  rendition->etag = "\"";
+  for(unsigned int n = 0;n<len;++n) {
+    static const char hex[] = "0123456789abcdef";
+    rendition->etag += hex[(res[n] >> 4) & 0x0f];
+    rendition->etag += hex[res[n] & 0x0f];
+  };
+  // Different content-codings must not share strong entity tag
+  rendition->gzip_etag = rendition->etag + "-gzip\"";
+  rendition->etag += "\"";
+  // Compressed copy is made once per revision instead of for every request
+  z_stream zs;
+  memset(&zs,0,sizeof(zs));
+  // 16 added to window bits selects gzip format
+  if(deflateInit2(&zs,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY) == Z_OK) {
+    rendition->gzip.resize(deflateBound(&zs,xml.length()));
+    zs.next_in = (Bytef*)xml.c_str();
+    zs.avail_in = xml.length();
+    zs.next_out = (Bytef*)&(rendition->gzip[0]);
+    zs.avail_out = rendition->gzip.length();
+    if(deflate(&zs,Z_FINISH) == Z_STREAM_END) {
+      rendition->gzip.resize(zs.total_out);
+    } else {
+      Arc::Logger::getRootLogger().msg(Arc::WARNING,"OptimizedInformationContainer failed to compress XML document");
+      rendition->gzip.clear();
+    };
+    deflateEnd(&zs);
+  };
+  return rendition;
+}
+
 void OptimizedInformationContainer::AssignFile(const std::string& filename) {
+  Rendition* rendition = NULL;
+  if(!filename.empty()) {
+    std::string xml;
+    if(Arc::FileRead(filename,xml)) rendition = Render(xml);
+  };
   olock_.lock();
   if(!filename_.empty()) ::unlink(filename_.c_str());
   if(handle_ != -1) ::close(handle_);
   filename_ = filename;
   handle_ = -1;
+  rendition_ = rendition;
   if(!filename_.empty()) {
     handle_ = ::open(filename_.c_str(),O_RDONLY);
     if(parse_xml_) {
@@ -312,6 +455,7 @@ void OptimizedInformationContainer::Assign(const std::string& xml, const std::st
     return;
   };
   // Here we have XML stored in file and optionally parsed
+  Rendition* rendition = Render(xml);
   // Attach to new file
   olock_.lock();
   if(filename.empty()) {
@@ -320,6 +464,10 @@ void OptimizedInformationContainer::Assign(const std::string& xml, const std::st
   } else {
     if(::rename(tmpfilename.c_str(), filename.c_str()) != 0) {
       Arc::Logger::getRootLogger().msg(Arc::ERROR,"OptimizedInformationContainer failed to rename temprary file");
+      olock_.unlock();
+      ::unlink(tmpfilename.c_str());
+      ::close(h);
+      delete rendition;
       return;
     };
     // Do not delete old file if same name requested - it is removed by rename()
@@ -328,6 +476,7 @@ void OptimizedInformationContainer::Assign(const std::string& xml, const std::st
   };   
   if(handle_ != -1) ::close(handle_);
   handle_ = h;
+  rendition_ = rendition;
   if(parse_xml_) {
     // Assign parsed xml
     lock_.lock();
@@ -919,6 +919,15 @@ int ARexJob::TotalJobs(ARexGMConfig& config,Arc::Logger& /* logger */) {
 // TODO: optimize
 std::list<std::string> ARexJob::Jobs(ARexGMConfig& config,Arc::Logger& logger) {
   std::list<std::string> jlist;
+  std::list<std::pair<JobId,job_state_t> > owned;
+  if(job_owner_index_list(config.GmConfig(),config.GridName(),owned)) {
+    // Session directory of deleted job is gone, hence such
+    // job is not accessible anymore.
+    for(std::list<std::pair<JobId,job_state_t> >::iterator i = owned.begin();i!=owned.end();++i) {
+      if(i->second != JOB_STATE_DELETED) jlist.push_back(i->first);
+    };
+    return jlist;
+  };
   JobsList::GetAllJobIds(config.GmConfig(),jlist);
   std::list<std::string>::iterator i = jlist.begin();
   while(i!=jlist.end()) {
@@ -0,0 +1,56 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_checksum.cpp
+//
+// Measures throughput of every checksum algorithm supported by CheckSumAny
+// when data is added in blocks of sizes from 4 KiB to 64 MiB. The same
+// amount of data is checksummed for every block size.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glibmm.h>
+
+#include <arc/CheckSum.h>
+#include <arc/StringConv.h>
+
+int main(int argc, char** argv) {
+
+  // Total amount of data per measurement in MB
+  int total = 256;
+  if ((argc > 1 && !Arc::stringto(argv[1], total)) || total <= 0) {
+    std::cout << "Usage: perftest_checksum [MB per measurement]" << std::endl;
+    return 1;
+  }
+  unsigned long long int total_bytes = ((unsigned long long int)total) << 20;
+
+  const unsigned int max_block = 64 << 20;
+  std::vector<char> data(max_block);
+  for (unsigned int i = 0; i < max_block; ++i) data[i] = (char)(i * 7 + (i >> 13));
+
+  const char* types[] = { "cksum", "md5", "adler32", NULL };
+  for (int t = 0; types[t]; ++t) {
+    for (unsigned int block = 4096; block <= max_block; block <<= 2) {
+      Arc::CheckSumAny sum(types[t]);
+      Glib::TimeVal start;
+      start.assign_current_time();
+      sum.start();
+      for (unsigned long long int done = 0; done < total_bytes; done += block) {
+        sum.add(&data[0], block);
+      }
+      sum.end();
+      Glib::TimeVal end;
+      end.assign_current_time();
+      end.subtract(start);
+      char result[64];
+      sum.print(result, sizeof(result));
+      std::cout << types[t] << " block " << block << " bytes: "
+                << (total_bytes / 1048576.0 / end.as_double()) << " MB/s ("
+                << result << ")" << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_databuffer.cpp
+//
+// Measures how many buffers per second can be passed from a reading thread
+// to a writing thread through DataBuffer, without checksum, with checksum
+// computed while the buffer is locked and with checksum computed in a
+// separate thread. No real I/O is done so the result shows the overhead of
+// DataBuffer itself.
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <arc/CheckSum.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/data/DataBuffer.h>
+
+static int num = 100000;
+
+static void reader(void *arg) {
+  Arc::DataBuffer& buffer = *(Arc::DataBuffer*)arg;
+  unsigned long long int offset = 0;
+  for (int n = 0; n < num; ++n) {
+    int h;
+    unsigned int l;
+    if (!buffer.for_read(h, l, true)) {
+      buffer.error_read(true);
+      return;
+    }
+    std::memset(buffer[h], n & 0xff, l);
+    buffer.is_read(h, l, offset);
+    offset += l;
+  }
+  buffer.eof_read(true);
+}
+
+static void writer(void *arg) {
+  Arc::DataBuffer& buffer = *(Arc::DataBuffer*)arg;
+  for (;;) {
+    int h;
+    unsigned int l;
+    unsigned long long int offset;
+    if (!buffer.for_write(h, l, offset, true)) {
+      if (!buffer.eof_read()) buffer.error_write(true);
+      break;
+    }
+    buffer.is_written(h);
+  }
+  buffer.eof_write(true);
+}
+
+static void run(const std::string& name, unsigned int size, int blocks,
+                Arc::CheckSum *sum, bool async) {
+  Arc::DataBuffer buffer(sum, size, blocks);
+  buffer.set_async_checksum(async);
+  Arc::SimpleCounter threads;
+  Glib::TimeVal start;
+  start.assign_current_time();
+  Arc::CreateThreadFunction(&writer, &buffer, &threads);
+  Arc::CreateThreadFunction(&reader, &buffer, &threads);
+  threads.wait();
+  Glib::TimeVal end;
+  end.assign_current_time();
+  end.subtract(start);
+  std::cout << name << ": " << num << " buffers of " << size << " bytes in "
+            << end.as_double() << " s, " << (num / end.as_double()) << " buffers/s, "
+            << (num / end.as_double() * size / 1048576) << " MB/s"
+            << (buffer.error() ? " (failed)" : "")
+            << ((sum && !buffer.checksum_valid()) ? " (checksum not valid)" : "")
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+
+  int size = 65536;
+  int blocks = 3;
+  if ((argc > 1 && !Arc::stringto(argv[1], num)) ||
+      (argc > 2 && !Arc::stringto(argv[2], size)) ||
+      (argc > 3 && !Arc::stringto(argv[3], blocks)) ||
+      num <= 0 || size <= 0 || blocks <= 0) {
+    std::cout << "Usage: perftest_databuffer [num buffers] [buffer size] [buffers]" << std::endl;
+    return 1;
+  }
+
+  run("No checksum", size, blocks, NULL, false);
+  Arc::Adler32Sum inline_sum;
+  run("Adler32 in reading thread", size, blocks, &inline_sum, false);
+  Arc::Adler32Sum async_sum;
+  run("Adler32 in own thread", size, blocks, &async_sum, true);
+  return 0;
+}
@@ -0,0 +1,130 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_delivery.cpp
+//
+// Measures the time taken to copy many small local files through
+// DataDelivery, once starting a new DataStagingDelivery process for each
+// transfer and once using persistent delivery processes. DataStagingDelivery
+// is found through ARC_LOCATION so ARC must be installed there.
+//
+// Transfers are kept to a fixed number running in parallel in the same way
+// as the Scheduler limits them with maxdelivery.
+
+#include <sys/stat.h>
+
+#include <iostream>
+#include <string>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/User.h>
+#include <arc/UserConfig.h>
+#include <arc/data-staging/DataDelivery.h>
+
+class BenchGenerator: public DataStaging::DTRCallback {
+ public:
+  Arc::SimpleCondition cond;
+  int running;
+  int failed;
+
+  BenchGenerator(): running(0), failed(0) {};
+
+  virtual void receiveDTR(DataStaging::DTR_ptr dtr) {
+    cond.lock();
+    if (dtr->error()) ++failed;
+    --running;
+    cond.signal_nonblock();
+    cond.unlock();
+  }
+};
+
+static bool run(const std::string& dir, int num, int parallel, unsigned int persistent) {
+
+  DataStaging::TransferParameters params;
+  params.persistent_delivery_transfers = persistent;
+  BenchGenerator generator;
+  DataStaging::DataDelivery delivery;
+  delivery.SetTransferParameters(params);
+  delivery.start();
+
+  Arc::UserConfig cfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  std::list<DataStaging::DTRLogDestination> logs;
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  for (int i = 0; i < num; ++i) {
+    std::string n(Arc::tostring(i));
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR(dir + "/src/" + n, dir + "/dest/" + n,
+                                                  cfg, "perftest", Arc::User().get_uid(), logs));
+    if (!(*dtr)) {
+      std::cout << "Failed to create DTR" << std::endl;
+      return false;
+    }
+    dtr->registerCallback(&generator, DataStaging::SCHEDULER);
+    generator.cond.lock();
+    while (generator.running >= parallel) generator.cond.wait_nonblock();
+    ++generator.running;
+    generator.cond.unlock();
+    delivery.receiveDTR(dtr);
+  }
+  generator.cond.lock();
+  while (generator.running > 0) generator.cond.wait_nonblock();
+  generator.cond.unlock();
+  Glib::TimeVal end;
+  end.assign_current_time();
+  end.subtract(start);
+  delivery.stop();
+
+  std::cout << (persistent ? "Persistent processes (" + Arc::tostring(persistent) + " transfers each): "
+                           : std::string("One process per transfer: "))
+            << num << " files in " << end.as_double() << " s, "
+            << (num / end.as_double()) << " files/s, "
+            << generator.failed << " failed" << std::endl;
+  return true;
+}
+
+int main(int argc, char** argv) {
+
+  int num = 10000;
+  int parallel = 10;
+  int persistent = 1000;
+  if ((argc > 1 && !Arc::stringto(argv[1], num)) ||
+      (argc > 2 && !Arc::stringto(argv[2], parallel)) ||
+      (argc > 3 && !Arc::stringto(argv[3], persistent)) ||
+      num <= 0 || parallel <= 0 || persistent <= 0) {
+    std::cout << "Usage: perftest_delivery [num files] [parallel transfers] [transfers per process]" << std::endl;
+    return 1;
+  }
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+  DataStaging::DTR::LOG_LEVEL = Arc::ERROR;
+
+  std::string dir;
+  if (!Arc::TmpDirCreate(dir)) {
+    std::cout << "Failed to create temporary directory" << std::endl;
+    return 1;
+  }
+  Arc::DirCreate(dir + "/src", S_IRWXU);
+  for (int i = 0; i < num; ++i) {
+    if (!Arc::FileCreate(dir + "/src/" + Arc::tostring(i), std::string(1024, 'x'))) {
+      std::cout << "Failed to create source files in " << dir << std::endl;
+      Arc::DirDelete(dir);
+      return 1;
+    }
+  }
+
+  bool result = true;
+  for (int mode = 0; mode < 2 && result; ++mode) {
+    Arc::DirDelete(dir + "/dest");
+    Arc::DirCreate(dir + "/dest", S_IRWXU);
+    result = run(dir, num, parallel, mode ? persistent : 0);
+  }
+  Arc::DirDelete(dir);
+  return result ? 0 : 1;
+}
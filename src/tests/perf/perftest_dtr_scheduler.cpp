@@ -0,0 +1,136 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// perftest_dtr_scheduler.cpp
+//
+// Measures the cost of the DTR Scheduler main loop with a large number of
+// queued DTRs. The DTRs use mock:// URLs so ARC must be built with
+// configure --enable-mock-dmc and ARC_PLUGIN_PATH must point to the mock DMC.
+//
+// All processing slots are set to 1 so that almost all DTRs stay queued in
+// the Scheduler. First the CPU used by the process while the queue is idle is
+// measured, then all jobs are cancelled and the time each DTR takes to
+// return to the generator is measured. Cancelled DTRs go through two state
+// transitions inside the Scheduler before they are returned.
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arc/GUID.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Thread.h>
+#include <arc/User.h>
+#include <arc/UserConfig.h>
+#include <arc/data-staging/Scheduler.h>
+
+class BenchGenerator: public DataStaging::DTRCallback {
+ public:
+  Glib::Mutex lock;
+  Arc::SimpleCounter counter;
+  Glib::TimeVal cancel_time;
+  std::vector<double> latencies;
+
+  virtual void receiveDTR(DataStaging::DTR_ptr dtr) {
+    Glib::TimeVal now;
+    now.assign_current_time();
+    now.subtract(cancel_time);
+    lock.lock();
+    latencies.push_back(now.as_double());
+    lock.unlock();
+    counter.dec();
+  }
+};
+
+static double cpu_time() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+
+  int num = 10000;
+  int idle = 10;
+  if ((argc > 1 && !Arc::stringto(argv[1], num)) ||
+      (argc > 2 && !Arc::stringto(argv[2], idle)) || num <= 0) {
+    std::cout << "Usage: perftest_dtr_scheduler [num DTRs] [idle seconds]" << std::endl;
+    std::cout << "Typical runs use 10000, 100000 and 1000000 DTRs" << std::endl;
+    return 1;
+  }
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+  DataStaging::DTR::LOG_LEVEL = Arc::ERROR;
+
+  BenchGenerator generator;
+  DataStaging::Scheduler scheduler;
+  scheduler.SetSlots(1, 1, 1, 1, 1);
+  scheduler.start();
+
+  Arc::UserConfig cfg(Arc::initializeCredentialsType(Arc::initializeCredentialsType::SkipCredentials));
+  std::list<DataStaging::DTRLogDestination> logs;
+  std::list<std::string> jobs;
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  for (int i = 0; i < num; ++i) {
+    // 100 DTRs per job, similar to a job with many input files
+    if (i % 100 == 0) jobs.push_back(Arc::UUID());
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR("mock://mocksrc/mock." + Arc::tostring(i),
+                                                  "mock://mockdest/mock." + Arc::tostring(i),
+                                                  cfg, jobs.back(), Arc::User().get_uid(), logs));
+    if (!(*dtr)) {
+      std::cout << "Failed to create DTR" << std::endl;
+      return 1;
+    }
+    dtr->registerCallback(&generator, DataStaging::GENERATOR);
+    dtr->registerCallback(&scheduler, DataStaging::SCHEDULER);
+    generator.counter.inc();
+    DataStaging::DTR::push(dtr, DataStaging::SCHEDULER);
+  }
+  Glib::TimeVal submitted;
+  submitted.assign_current_time();
+  submitted.subtract(start);
+  std::cout << "Submitted " << num << " DTRs in " << submitted.as_double() << " s" << std::endl;
+
+  // Let the Scheduler settle and then measure CPU used by an idle queue
+  sleep(2);
+  double cpu_start = cpu_time();
+  sleep(idle);
+  double cpu_used = cpu_time() - cpu_start;
+  std::cout << "CPU used with idle queue: " << cpu_used << " s in " << idle
+            << " s (" << (100.0 * cpu_used / idle) << "% of one core)" << std::endl;
+
+  generator.cancel_time.assign_current_time();
+  cpu_start = cpu_time();
+  for (std::list<std::string>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+    scheduler.cancelDTRs(*job);
+  }
+  generator.counter.wait();
+  cpu_used = cpu_time() - cpu_start;
+
+  generator.lock.lock();
+  std::sort(generator.latencies.begin(), generator.latencies.end());
+  double median = generator.latencies[generator.latencies.size()/2];
+  double p99 = generator.latencies[generator.latencies.size()*99/100];
+  double total = generator.latencies.back();
+  generator.lock.unlock();
+
+  std::cout << "Cancelled " << num << " DTRs in " << total << " s using "
+            << cpu_used << " s CPU" << std::endl;
+  std::cout << "Time to return a cancelled DTR: median " << median
+            << " s, 99th percentile " << p99 << " s" << std::endl;
+  std::cout << "Mean time per state transition: " << (total / num / 2) * 1000000 << " us" << std::endl;
+
+  scheduler.stop();
+  return 0;
+}